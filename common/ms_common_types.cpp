@@ -1,4 +1,6 @@
 
+#include <sstream>
+
 #include "ms_common_types.h"
 
 using namespace std;
@@ -6,6 +8,7 @@ using namespace common_types;
 
 const SWALClientOperation::TUniqueKey SWALClientOperation::ALL_KEYS = "all_keys";
 const SWALClientOperation::TUniqueKey SWALClientOperation::NON_INTEGRITY_KEYS = "non_integrity_keys";
+const SWALUserRegistration::TRegisterId SWALUserRegistration::ALL_IDS = "";
 
 // wal
 void SWALClientOperation::accept( IWALRecordVisitor * _visitor ) const {
@@ -25,13 +28,36 @@ void SWALUserRegistration::accept( IWALRecordVisitor * _visitor ) const {
 }
 
 string SWALClientOperation::serializeToStr() const {
-    return string();
+
+    stringstream ss;
+    ss << "unique key: " << uniqueKey
+       << " begin: " << begin
+       << " command: " << commandFullText
+       << endl;
+    return ss.str();
 }
 
 string SWALUserRegistration::serializeToStr() const {
-    return string();
+
+    stringstream ss;
+    ss << "register id: " << registerId
+       << " ip: " << userIp
+       << " pid: " << userPid
+       << " registered at: " << registeredAtDateTime
+       << endl;
+    return ss.str();
 }
 
 string SWALProcessEvent::serializeToStr() const {
-    return string();
+
+    stringstream ss;
+    ss << "pid: " << pid
+       << " begin: " << begin
+       << " program: " << programName
+       << " args:";
+    for( const string & arg : programArgs ){
+        ss << " " << arg;
+    }
+    ss << endl;
+    return ss.str();
 }
@@ -4,6 +4,8 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <limits>
+#include <functional>
 
 namespace common_types {
 
@@ -73,6 +75,19 @@ enum class EPersistenceDataType {
     UNDEFINED
 };
 
+enum class EPersistenceStorageLayout {
+    DOCUMENT_PER_POINT,
+    CHUNK_PER_STEP, // all points of one logic step in one binary document
+    UNDEFINED
+};
+
+enum class EDownsampleMode {
+    NONE,
+    FIRST,
+    LAST,
+    AVG // coordinates are averaged, times are taken from the first point of bucket
+};
+
 // ---------------------------------------------------------------------------
 // simple ADT
 // ---------------------------------------------------------------------------
@@ -84,6 +99,7 @@ struct SPersistenceMetadataDescr {
         , timeStepIntervalMillisec(-1)
         , lastRecordedSession(-1)
         , sourceType(EPersistenceSourceType::UNDEFINED)
+        , storageLayout(EPersistenceStorageLayout::DOCUMENT_PER_POINT)
     {}
 
     static constexpr TPersistenceSetId INVALID_PERSISTENCE_ID = -1;
@@ -96,6 +112,7 @@ struct SPersistenceMetadataDescr {
                  && this->lastRecordedSession == _rhs.lastRecordedSession
                  && this->sourceType == _rhs.sourceType
                  && this->dataType == _rhs.dataType
+                 && this->storageLayout == _rhs.storageLayout
                 );
     }
 
@@ -106,6 +123,7 @@ struct SPersistenceMetadataDescr {
     TSessionNum lastRecordedSession;
     EPersistenceSourceType sourceType;
     EPersistenceDataType dataType; // TODO: do
+    EPersistenceStorageLayout storageLayout;
 };
 
 struct SPersistenceMetadataVideo : SPersistenceMetadataDescr {
@@ -166,23 +184,73 @@ struct SPersistenceWeather : SPersistenceObj {
     double humidity;
 };
 
+// no antimeridian crossing ( min < max )
+struct SGeoBoundingBox {
+    SGeoBoundingBox()
+        : minLatDeg(0)
+        , maxLatDeg(0)
+        , minLonDeg(0)
+        , maxLonDeg(0)
+    {}
+
+    bool empty() const {
+        return ! ( minLatDeg < maxLatDeg && minLonDeg < maxLonDeg );
+    }
+
+    bool contains( double _latDeg, double _lonDeg ) const {
+        return ( _latDeg >= minLatDeg && _latDeg <= maxLatDeg && _lonDeg >= minLonDeg && _lonDeg <= maxLonDeg );
+    }
+
+    double minLatDeg;
+    double maxLatDeg;
+    double minLonDeg;
+    double maxLonDeg;
+};
+
 struct SPersistenceSetFilter {
     SPersistenceSetFilter()
         : persistenceSetId(-1)
         , sessionNum(0)
         , maxLogicStep(0)
         , minLogicStep(0)
+        , downsampleMode(EDownsampleMode::NONE)
+        , bucketLogicSteps(0)
+        , bucketMillisec(0)
     {}
 
+    // whole set
     SPersistenceSetFilter( TPersistenceSetId _persistenceSetId )
         : persistenceSetId(_persistenceSetId)
+        , sessionNum(0)
+        , maxLogicStep(0)
+        , minLogicStep(std::numeric_limits<TLogicStep>::min())
+        , downsampleMode(EDownsampleMode::NONE)
+        , bucketLogicSteps(0)
+        , bucketMillisec(0)
     {}
 
+    bool hasPointPredicates() const {
+        return ( ! objIds.empty() || ! boundingBox.empty() );
+    }
+
+    bool isDownsampled() const {
+        return ( downsampleMode != EDownsampleMode::NONE && (bucketLogicSteps > 0 || bucketMillisec > 0) );
+    }
+
     TPersistenceSetId persistenceSetId;
 
     TSessionNum sessionNum;
     TLogicStep maxLogicStep;
     TLogicStep minLogicStep;
+
+    // optional point predicates: empty -> any object / anywhere
+    std::vector<TObjectId> objIds;
+    SGeoBoundingBox boundingBox;
+
+    // overview: one point per object in each bucket of logic steps ( priority ) or of astro time
+    EDownsampleMode downsampleMode;
+    TLogicStep bucketLogicSteps;
+    int64_t bucketMillisec;
 };
 
 struct SObjectStep {
@@ -396,6 +464,12 @@ public:
     virtual bool write( const SWALUserRegistration & _userRegistration ) = 0;
     virtual void removeRegistration( SWALUserRegistration::TRegisterId _filter ) = 0;
     virtual const std::vector<SWALUserRegistration> readRegistrations( SWALUserRegistration::TRegisterId _filter ) = 0;
+
+    // callback is fired once record is durable ( by default - synchronous write in caller thread )
+    using TDurableCallback = std::function<void( bool _durable )>;
+    virtual void writeAsync( const SWALClientOperation & _clientOperation, TDurableCallback _callback ){ _callback( write(_clientOperation) ); }
+    virtual void writeAsync( const SWALProcessEvent & _processEvent, TDurableCallback _callback ){ _callback( write(_processEvent) ); }
+    virtual void writeAsync( const SWALUserRegistration & _userRegistration, TDurableCallback _callback ){ _callback( write(_userRegistration) ); }
 };
 
 
@@ -58,6 +58,18 @@ namespace detected_object {
     const std::string ASTRO_TIME = "astro_time";
     const std::string LOGIC_TIME = "logic_time";
     const std::string SESSION = "session";
+    // GeoJSON [ lon, lat ] for 2dsphere index
+    const std::string LOCATION = "loc";
+    // writer instance ( live tail skips own writes from change stream )
+    const std::string ORIGIN = "origin";
+    // chunk layout
+    const std::string POINTS_COUNT = "points_count";
+    const std::string CHUNK = "chunk";
+}
+
+namespace weather {
+    const std::string WIND_SPEED = "wind_speed";
+    const std::string HUMIDITY = "humidity";
 }
 
 }
@@ -74,6 +86,7 @@ namespace persistence_set_metadata {
     const std::string SOURCE_TYPE = "source_type";
     const std::string DATA_TYPE = "data_type";
     const std::string PAYLOAD_TABLE_NAME = "payload_table_name";
+    const std::string STORAGE_LAYOUT = "storage_layout";
 }
 
 namespace persistence_set_metadata_video {
@@ -94,6 +107,13 @@ namespace persistence_set_metadata_dss {
     const std::string REAL = "real";
 }
 
+namespace persistence_set_counter {
+    const std::string COLLECTION_NAME = "persistence_set_counter";
+
+    const std::string PERSISTENCE_ID_KEY = "persistence_id";
+    const std::string SEQ = "seq";
+}
+
 // description
 namespace persistence_set_description {
     const std::string COLLECTION_NAME = "persistence_set_description";
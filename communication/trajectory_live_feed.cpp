@@ -0,0 +1,50 @@
+#include <sstream>
+#include <limits>
+#include <algorithm>
+
+#include "trajectory_live_feed.h"
+
+using namespace std;
+using namespace common_types;
+
+std::string TrajectoryLiveFeed::serialize( TPersistenceSetId _persId, const SPersistenceTrajectory * _points, size_t _count ){
+
+    std::ostringstream out;
+    out.precision( std::numeric_limits<double>::max_digits10 );
+
+    out << "{\"pers_id\":" << _persId << ",\"points\":[";
+    for( size_t i = 0; i < _count; i++ ){
+        const SPersistenceTrajectory & point = _points[ i ];
+        if( i > 0 ){
+            out << ",";
+        }
+
+        out << "{\"obj\":" << point.objId
+            << ",\"session\":" << point.sessionNum
+            << ",\"logic_time\":" << point.logicTime
+            << ",\"astro_time\":" << point.astroTimeMillisec
+            << ",\"lat\":" << point.latDeg
+            << ",\"lon\":" << point.lonDeg
+            << ",\"height\":" << point.height
+            << ",\"yaw\":" << point.yawDeg
+            << ",\"state\":" << (int32_t)point.state
+            << "}";
+    }
+    out << "]}";
+
+    return out.str();
+}
+
+TrajectorySubscriptions::TDeliverFunc TrajectoryLiveFeed::makeDeliverFunc( TPersistenceSetId _persId,
+                                                                          PEnvironmentRequest _request,
+                                                                          size_t _pointsPerFrame ){
+
+    const size_t pointsPerFrame = std::max<size_t>( _pointsPerFrame, 1 );
+
+    return [ _persId, _request, pointsPerFrame ]( TrajectorySubscriptions::TSubscriptionId, const std::vector<SPersistenceTrajectory> & _points ){
+        for( size_t begin = 0; begin < _points.size(); begin += pointsPerFrame ){
+            const size_t count = std::min( pointsPerFrame, _points.size() - begin );
+            _request->setOutcomingMessage( serialize(_persId, _points.data() + begin, count) );
+        }
+    };
+}
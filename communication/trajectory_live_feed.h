@@ -0,0 +1,25 @@
+#ifndef TRAJECTORY_LIVE_FEED_H
+#define TRAJECTORY_LIVE_FEED_H
+
+#include "common/ms_common_types.h"
+#include "communication/network_interface.h"
+#include "storage/trajectory_subscriptions.h"
+
+// live tail points pushed as JSON frames over the connection of request ( websocket )
+class TrajectoryLiveFeed
+{
+public:
+    static constexpr size_t DEFAULT_POINTS_PER_FRAME = 1000;
+
+    // {"pers_id":1,"points":[{"obj":..,"session":..,"logic_time":..,"astro_time":..,"lat":..,"lon":..,"height":..,"yaw":..,"state":..}]}
+    static std::string serialize( common_types::TPersistenceSetId _persId,
+                                  const common_types::SPersistenceTrajectory * _points,
+                                  size_t _count );
+
+    // deliver function for subscribeTrajectory(), big batch is split into several frames
+    static TrajectorySubscriptions::TDeliverFunc makeDeliverFunc( common_types::TPersistenceSetId _persId,
+                                                                  PEnvironmentRequest _request,
+                                                                  size_t _pointsPerFrame = DEFAULT_POINTS_PER_FRAME );
+};
+
+#endif // TRAJECTORY_LIVE_FEED_H
@@ -238,11 +238,14 @@ void WebsocketServer::sendAsyncRequest( const SNetworkPackage & _package, websoc
 
     std::lock_guard<std::mutex> lock( m_mutexSendProtection );
 
-    // dynamic growing
-    if( _package.msg.size() > (m_outcomingBufferSize + 1) ){
+    // dynamic growing ( live tail frames may be much bigger than commands )
+    const size_t packageSize = sizeof(SNetworkPackage::SHeader) + _package.msg.size();
+    if( packageSize > (size_t)m_outcomingBufferSize ){
+        while( packageSize > (size_t)m_outcomingBufferSize ){
+            m_outcomingBufferSize *= 2;
+        }
         delete[] m_outcomingBuffer;
-        m_outcomingBuffer = new char[ m_outcomingBufferSize * 2 ];
-        m_outcomingBufferSize *= 2;
+        m_outcomingBuffer = new char[ m_outcomingBufferSize ];
     }
 
     //
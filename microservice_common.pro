@@ -21,6 +21,7 @@ DEFINES += \
     SWITCH_LOGGER_ASTRA \
     OBJREPR_LIBRARY_EXIST \
 #    UNIT_TESTS_GOOGLE \
+#    STORAGE_BENCHMARK \
 
 INCLUDEPATH += \
     /usr/include/libgtop-2.0 \
@@ -71,7 +72,20 @@ SOURCES += \
         communication/unified_command_convertor.cpp \
         communication/webserver.cpp \
         communication/websocket_server.cpp \
+        communication/trajectory_live_feed.cpp \
         storage/database_manager_base.cpp \
+        storage/trajectory_cache.cpp \
+        storage/trajectory_write_behind.cpp \
+        storage/session_summary.cpp \
+        storage/trajectory_prefetcher.cpp \
+        storage/trajectory_chunk_codec.cpp \
+        storage/metadata_catalog.cpp \
+        storage/mapped_storage_engine.cpp \
+        storage/trajectory_downsampler.cpp \
+        storage/retention_engine.cpp \
+        storage/trajectory_subscriptions.cpp \
+        storage/persistence_snapshot.cpp \
+        storage/bulk_write_policies.cpp \
         system/a_args_parser.cpp \
         system/a_config_reader.cpp \
         system/daemonizator.cpp \
@@ -86,6 +100,9 @@ SOURCES += \
         system/thread_pool.cpp \
         system/threaded_multitask_service.cpp \
         system/wal.cpp \
+        system/wal_file_storage.cpp \
+        system/wal_record_codec.cpp \
+        system/wal_replication.cpp \
         unit_tests/communication_tests.cpp \
         unit_tests/storage_tests.cpp \
         unit_tests/system_tests.cpp \
@@ -95,7 +112,10 @@ SOURCES += \
 contains( DEFINES, UNIT_TESTS_GOOGLE ){
     message("connect 'gtests' library")
 SOURCES += \
-    unit_tests/test_database_manager_base.cpp
+    storage/storage_benchmark.cpp \
+    unit_tests/test_database_manager_base.cpp \
+    unit_tests/test_mapped_storage_engine.cpp \
+    unit_tests/test_wal_file_storage.cpp
 }
 
 HEADERS += \
@@ -121,8 +141,26 @@ HEADERS += \
     communication/unified_command_convertor.h \
     communication/webserver.h \
     communication/websocket_server.h \
+    communication/trajectory_live_feed.h \
     datasource/dummy.h \
     storage/database_manager_base.h \
+    storage/trajectory_cache.h \
+    storage/trajectory_write_behind.h \
+    storage/session_summary.h \
+    storage/trajectory_prefetcher.h \
+    storage/trajectory_chunk_codec.h \
+    storage/bson_record_decoder.h \
+    storage/payload_schema.h \
+    storage/metadata_catalog.h \
+    storage/i_persistence_storage.h \
+    storage/mapped_storage_engine.h \
+    storage/trajectory_downsampler.h \
+    storage/trajectory_point_predicate.h \
+    storage/retention_engine.h \
+    storage/trajectory_subscriptions.h \
+    storage/persistence_snapshot.h \
+    storage/bulk_write_policies.h \
+    storage/persistence_cursor.h \
     system/a_args_parser.h \
     system/a_config_reader.h \
     system/class_factory.h \
@@ -141,6 +179,9 @@ HEADERS += \
     system/thread_pool_task.h \
     system/threaded_multitask_service.h \
     system/wal.h \
+    system/wal_file_storage.h \
+    system/wal_record_codec.h \
+    system/wal_replication.h \
     unit_tests/communication_tests.h \
     unit_tests/storage_tests.h \
     unit_tests/system_tests.h \
@@ -151,8 +192,17 @@ HEADERS += \
 contains( DEFINES, UNIT_TESTS_GOOGLE ){
     message("connect 'gtests' library")
 HEADERS += \
-    unit_tests/test_database_manager_base.h
+    storage/storage_benchmark.h \
+    unit_tests/test_database_manager_base.h \
+    unit_tests/test_mapped_storage_engine.h \
+    unit_tests/test_wal_file_storage.h
 }
 
-
-
+# storage throughput & latency suite ( gtest runner, needs UNIT_TESTS_GOOGLE too )
+contains( DEFINES, STORAGE_BENCHMARK ){
+    message("connect storage benchmark")
+SOURCES += \
+    unit_tests/test_storage_benchmark.cpp
+HEADERS += \
+    unit_tests/test_storage_benchmark.h
+}
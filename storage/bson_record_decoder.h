@@ -0,0 +1,141 @@
+#ifndef BSON_RECORD_DECODER_H
+#define BSON_RECORD_DECODER_H
+
+#include <cstring>
+#include <vector>
+
+#include <mongoc.h>
+
+#include "common/ms_common_types.h"
+#include "common/ms_common_vars.h"
+
+// field of record layout: document key + reader into record member
+template< typename T_Record >
+struct SBsonRecordField {
+    const char * key;
+    void ( * read )( const bson_iter_t * _iter, T_Record & _out );
+};
+
+// specialized per record type: fields in the order they are written to store
+template< typename T_Record >
+struct SBsonRecordLayout;
+
+// one pass over document: field is matched to expected position first ( known layout ),
+// name lookup over layout is only a fallback ( '_id', reordered or absent fields )
+template< typename T_Record >
+class BsonRecordDecoder
+{
+public:
+    static bool decode( const bson_t * _doc, T_Record & _out ){
+
+        bson_iter_t iter;
+        if( ! bson_iter_init( & iter, _doc ) ){
+            return false;
+        }
+
+        const SBsonRecordField<T_Record> * fields = SBsonRecordLayout<T_Record>::fields();
+        const size_t fieldsCount = SBsonRecordLayout<T_Record>::FIELDS_COUNT;
+        size_t expected = 0;
+
+        while( bson_iter_next( & iter ) ){
+            const char * key = bson_iter_key( & iter );
+
+            size_t idx = expected;
+            if( idx >= fieldsCount || 0 != std::strcmp(key, fields[ idx ].key) ){
+                idx = find( fields, fieldsCount, key );
+                if( idx == fieldsCount ){
+                    continue;
+                }
+            }
+
+            fields[ idx ].read( & iter, _out );
+            expected = idx + 1;
+        }
+
+        return true;
+    }
+
+    // record is constructed in place at the end of output
+    static bool decodeAppend( const bson_t * _doc, std::vector<T_Record> & _out ){
+
+        _out.emplace_back();
+        if( ! decode(_doc, _out.back()) ){
+            _out.pop_back();
+            return false;
+        }
+        return true;
+    }
+
+
+private:
+    static size_t find( const SBsonRecordField<T_Record> * _fields, size_t _count, const char * _key ){
+
+        for( size_t i = 0; i < _count; i++ ){
+            if( _fields[ i ].key[ 0 ] == _key[ 0 ] && 0 == std::strcmp(_fields[ i ].key, _key) ){
+                return i;
+            }
+        }
+        return _count;
+    }
+};
+
+// numeric readers tolerate int32 / int64 / double representation of the same field
+inline int64_t bsonReadInteger( const bson_iter_t * _iter ){
+    return bson_iter_as_int64( _iter );
+}
+
+inline double bsonReadDouble( const bson_iter_t * _iter ){
+    return BSON_ITER_HOLDS_DOUBLE( _iter ) ? bson_iter_double( _iter ) : (double)bson_iter_as_int64( _iter );
+}
+
+// -------------------------------------------------------------------------------------
+// layouts
+// -------------------------------------------------------------------------------------
+template<>
+struct SBsonRecordLayout<common_types::SPersistenceTrajectory> {
+    using TRecord = common_types::SPersistenceTrajectory;
+    static constexpr size_t FIELDS_COUNT = 11;
+
+    static const SBsonRecordField<TRecord> * fields(){
+        using namespace common_vars::mongo_fields::analytic::detected_object;
+
+        static const SBsonRecordField<TRecord> layout[ FIELDS_COUNT ] = {
+            { OBJRERP_ID.c_str(), []( const bson_iter_t * _iter, TRecord & _out ){ _out.objId = bsonReadInteger( _iter ); } },
+            { STATE.c_str(),      []( const bson_iter_t * _iter, TRecord & _out ){ _out.state = (common_types::SPersistenceObj::EState)bsonReadInteger( _iter ); } },
+            { ASTRO_TIME.c_str(), []( const bson_iter_t * _iter, TRecord & _out ){ _out.astroTimeMillisec = bsonReadInteger( _iter ); } },
+            { LOGIC_TIME.c_str(), []( const bson_iter_t * _iter, TRecord & _out ){ _out.logicTime = bsonReadInteger( _iter ); } },
+            { SESSION.c_str(),    []( const bson_iter_t * _iter, TRecord & _out ){ _out.sessionNum = bsonReadInteger( _iter ); } },
+            { LAT.c_str(),        []( const bson_iter_t * _iter, TRecord & _out ){ _out.latDeg = bsonReadDouble( _iter ); } },
+            { LON.c_str(),        []( const bson_iter_t * _iter, TRecord & _out ){ _out.lonDeg = bsonReadDouble( _iter ); } },
+            { HEIGHT.c_str(),     []( const bson_iter_t * _iter, TRecord & _out ){ _out.height = bsonReadDouble( _iter ); } },
+            { YAW.c_str(),        []( const bson_iter_t * _iter, TRecord & _out ){ _out.yawDeg = bsonReadDouble( _iter ); } },
+            // index-only copy of lat/lon, kept in layout to stay on the positional path
+            { LOCATION.c_str(),   []( const bson_iter_t *, TRecord & ){ } },
+            { ORIGIN.c_str(),     []( const bson_iter_t *, TRecord & ){ } }
+        };
+        return layout;
+    }
+};
+
+template<>
+struct SBsonRecordLayout<common_types::SEventsSessionInfo> {
+    using TRecord = common_types::SEventsSessionInfo;
+    static constexpr size_t FIELDS_COUNT = 7;
+
+    static const SBsonRecordField<TRecord> * fields(){
+        using namespace common_vars::mongo_fields::persistence_set_description;
+
+        static const SBsonRecordField<TRecord> layout[ FIELDS_COUNT ] = {
+            { SESSION_NUM.c_str(),       []( const bson_iter_t * _iter, TRecord & _out ){ _out.number = bsonReadInteger( _iter ); } },
+            { LOGIC_TIME_MIN.c_str(),    []( const bson_iter_t * _iter, TRecord & _out ){ _out.minLogicStep = bsonReadInteger( _iter ); } },
+            { LOGIC_TIME_MAX.c_str(),    []( const bson_iter_t * _iter, TRecord & _out ){ _out.maxLogicStep = bsonReadInteger( _iter ); } },
+            { ASTRO_TIME_MIN.c_str(),    []( const bson_iter_t * _iter, TRecord & _out ){ _out.minTimestampMillisec = bsonReadInteger( _iter ); } },
+            { ASTRO_TIME_MAX.c_str(),    []( const bson_iter_t * _iter, TRecord & _out ){ _out.maxTimestampMillisec = bsonReadInteger( _iter ); } },
+            { EMPTY_STEPS_BEGIN.c_str(), []( const bson_iter_t * _iter, TRecord & _out ){ _out.emptyStepsBegin = bsonReadInteger( _iter ); } },
+            { EMPTY_STEPS_END.c_str(),   []( const bson_iter_t * _iter, TRecord & _out ){ _out.emptyStepsEnd = bsonReadInteger( _iter ); } }
+        };
+        return layout;
+    }
+};
+
+#endif // BSON_RECORD_DECODER_H
@@ -0,0 +1,164 @@
+#include <limits>
+#include <algorithm>
+
+#include "system/logger.h"
+#include "bulk_write_policies.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "BulkPolicy:";
+
+BulkWritePolicies::BulkWritePolicies()
+{
+
+}
+
+BulkWritePolicies::~BulkWritePolicies()
+{
+
+}
+
+bool BulkWritePolicies::setDefaultPolicy( const SWritePolicy & _policy ){
+
+    if( ! isPolicyValid(_policy) ){
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexPolicies );
+
+    m_defaultPolicy = _policy;
+    for( auto & valuePair : m_setStates ){
+        SSetState & state = valuePair.second;
+        if( ! state.customPolicy ){
+            state.policy = _policy;
+            state.bulkSize = initialBulkSize( _policy );
+        }
+    }
+    return true;
+}
+
+bool BulkWritePolicies::setPolicy( TPersistenceSetId _persId, const SWritePolicy & _policy ){
+
+    if( ! isPolicyValid(_policy) ){
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexPolicies );
+
+    SSetState & state = m_setStates[ _persId ];
+    state.policy = _policy;
+    state.bulkSize = initialBulkSize( _policy );
+    state.customPolicy = true;
+
+    VS_LOG_INFO << PRINT_HEADER << " pers id [" << _persId << "] policy [" << _policy.name << "]"
+                << " ordered [" << _policy.ordered << "]"
+                << " w [" << ( _policy.fireAndForget ? 0 : _policy.w ) << "]"
+                << " journal [" << _policy.journal << "]"
+                << " target bulk latency [" << _policy.targetBulkLatencyMillisec << "] ms"
+                << endl;
+    return true;
+}
+
+void BulkWritePolicies::removePolicy( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexPolicies );
+    m_setStates.erase( _persId );
+}
+
+BulkWritePolicies::SWritePolicy BulkWritePolicies::getPolicy( TPersistenceSetId _persId, int32_t & _bulkSize ){
+
+    std::lock_guard<std::mutex> lock( m_mutexPolicies );
+
+    const SSetState & state = getState( _persId );
+    _bulkSize = state.bulkSize;
+    return state.policy;
+}
+
+void BulkWritePolicies::bulkExecuted( TPersistenceSetId _persId, int32_t _records, int64_t _latencyMicrosec, bool _success ){
+
+    std::lock_guard<std::mutex> lock( m_mutexPolicies );
+
+    SSetState & state = getState( _persId );
+    const SWritePolicy & policy = state.policy;
+
+    SPolicyStats & stats = m_statsByPolicy[ policy.name ];
+    stats.name = policy.name;
+    stats.bulksCount++;
+    stats.lastBulkLatencyMicrosec = _latencyMicrosec;
+    stats.lastBulkSize = _records;
+    stats.totalBulkLatencyMicrosec += _latencyMicrosec;
+    if( _success ){
+        stats.recordsWritten += _records;
+    }
+    else{
+        stats.bulkErrors++;
+    }
+
+    // only full bulks tell about the size limit ( tail of a write is usually smaller )
+    if( policy.targetBulkLatencyMillisec <= 0 || _records < state.bulkSize ){
+        return;
+    }
+
+    const int64_t targetMicrosec = policy.targetBulkLatencyMillisec * 1000;
+    int64_t bulkSize = state.bulkSize;
+    if( _latencyMicrosec <= 0 ){
+        bulkSize *= 2;
+    }
+    else{
+        bulkSize = bulkSize * targetMicrosec / _latencyMicrosec;
+        bulkSize = std::min<int64_t>( std::max<int64_t>(bulkSize, state.bulkSize / 2), (int64_t)state.bulkSize * 2 );
+    }
+
+    // rescale of a tiny bulk may reach zero
+    state.bulkSize = (int32_t)std::min<int64_t>( std::max<int64_t>(bulkSize, std::max(policy.minBulkSize, 1)), policy.maxBulkSize );
+}
+
+std::vector<BulkWritePolicies::SPolicyStats> BulkWritePolicies::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexPolicies );
+
+    std::vector<SPolicyStats> out;
+    out.reserve( m_statsByPolicy.size() );
+    for( const auto & valuePair : m_statsByPolicy ){
+        SPolicyStats stats = valuePair.second;
+        if( stats.totalBulkLatencyMicrosec > 0 ){
+            stats.recordsPerSec = stats.recordsWritten * 1000000.0 / stats.totalBulkLatencyMicrosec;
+        }
+        out.push_back( stats );
+    }
+    return out;
+}
+
+BulkWritePolicies::SSetState & BulkWritePolicies::getState( TPersistenceSetId _persId ){
+
+    auto iter = m_setStates.find( _persId );
+    if( iter != m_setStates.end() ){
+        return iter->second;
+    }
+
+    SSetState & state = m_setStates[ _persId ];
+    state.policy = m_defaultPolicy;
+    state.bulkSize = initialBulkSize( m_defaultPolicy );
+    return state;
+}
+
+bool BulkWritePolicies::isPolicyValid( const SWritePolicy & _policy ){
+
+    if( _policy.maxBulkSize <= 0 || _policy.minBulkSize > _policy.maxBulkSize ){
+        VS_LOG_ERROR << PRINT_HEADER << " policy [" << _policy.name << "] has invalid bulk size range"
+                     << " min [" << _policy.minBulkSize << "] max [" << _policy.maxBulkSize << "]"
+                     << endl;
+        return false;
+    }
+    return true;
+}
+
+int32_t BulkWritePolicies::initialBulkSize( const SWritePolicy & _policy ){
+
+    // no target -> no limit, otherwise grows from the minimum
+    if( _policy.targetBulkLatencyMillisec <= 0 ){
+        return std::numeric_limits<int32_t>::max();
+    }
+    return std::max( _policy.minBulkSize, 1 );
+}
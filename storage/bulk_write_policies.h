@@ -0,0 +1,97 @@
+#ifndef BULK_WRITE_POLICIES_H
+#define BULK_WRITE_POLICIES_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "common/ms_common_types.h"
+
+// how payload of a persistence set goes to store: bulk ordering, write concern
+// and bulk size, which follows the target latency of one bulk ( proportional, x0.5 .. x2 per full bulk )
+class BulkWritePolicies
+{
+public:
+    struct SWritePolicy {
+        SWritePolicy()
+            : name("default")
+            , ordered(false)
+            , w(1)
+            , journal(false)
+            , fireAndForget(false)
+            , targetBulkLatencyMillisec(0)
+            , minBulkSize(500)
+            , maxBulkSize(100000)
+        {}
+        std::string name; // ingest stats are reported per name
+        bool ordered; // stop on the first failed document
+        int32_t w; // acknowledging nodes, -3 ( MONGOC_WRITE_CONCERN_W_MAJORITY ) - majority
+        bool journal; // acknowledged after journal commit
+        bool fireAndForget; // unacknowledged ( w = 0 ), failures are not detected
+        int32_t targetBulkLatencyMillisec; // 0 - whole write in one bulk
+        int32_t minBulkSize;
+        int32_t maxBulkSize;
+    };
+
+    struct SPolicyStats {
+        SPolicyStats()
+            : bulksCount(0)
+            , bulkErrors(0)
+            , recordsWritten(0)
+            , totalBulkLatencyMicrosec(0)
+            , lastBulkLatencyMicrosec(0)
+            , lastBulkSize(0)
+            , recordsPerSec(0.0)
+        {}
+        std::string name;
+        int64_t bulksCount;
+        int64_t bulkErrors;
+        int64_t recordsWritten;
+        int64_t totalBulkLatencyMicrosec;
+        int64_t lastBulkLatencyMicrosec;
+        int64_t lastBulkSize;
+        double recordsPerSec; // of time spent in bulks
+    };
+
+    BulkWritePolicies();
+    ~BulkWritePolicies();
+
+    // false - bulk size range is invalid ( max <= 0 or min > max )
+    bool setDefaultPolicy( const SWritePolicy & _policy );
+    bool setPolicy( common_types::TPersistenceSetId _persId, const SWritePolicy & _policy );
+    void removePolicy( common_types::TPersistenceSetId _persId );
+
+    // policy & records count of the next bulk
+    SWritePolicy getPolicy( common_types::TPersistenceSetId _persId, int32_t & _bulkSize );
+    void bulkExecuted( common_types::TPersistenceSetId _persId, int32_t _records, int64_t _latencyMicrosec, bool _success );
+
+    std::vector<SPolicyStats> getStats();
+
+
+private:
+    struct SSetState {
+        SSetState()
+            : bulkSize(0)
+            , customPolicy(false)
+        {}
+        SWritePolicy policy;
+        int32_t bulkSize;
+        bool customPolicy;
+    };
+
+    SSetState & getState( common_types::TPersistenceSetId _persId );
+    static bool isPolicyValid( const SWritePolicy & _policy );
+    static int32_t initialBulkSize( const SWritePolicy & _policy );
+
+    // data
+    SWritePolicy m_defaultPolicy;
+    std::unordered_map<common_types::TPersistenceSetId, SSetState> m_setStates;
+    std::map<std::string, SPolicyStats> m_statsByPolicy;
+
+    // service
+    std::mutex m_mutexPolicies;
+};
+
+#endif // BULK_WRITE_POLICIES_H
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -7,6 +11,11 @@
 #include "common/ms_common_vars.h"
 #include "common/ms_common_utils.h"
 #include "database_manager_base.h"
+#include "trajectory_chunk_codec.h"
+#include "bson_record_decoder.h"
+#include "payload_schema.h"
+#include "trajectory_downsampler.h"
+#include "trajectory_point_predicate.h"
 
 using namespace std;
 using namespace common_types;
@@ -14,6 +23,7 @@ using namespace common_vars;
 
 static constexpr const char * PRINT_HEADER = "DatabaseMgr:";
 static const string ARGS_DELIMETER = "$";
+static constexpr TLogicStep NO_GAP_SPLIT = -1;
 
 bool DatabaseManagerBase::m_systemInited = false;
 int DatabaseManagerBase::m_instanceCounter = 0;
@@ -38,12 +48,12 @@ static string convertDataTypeToStr( const EPersistenceDataType _type ){
     }
 }
 
-static EPersistenceDataType convertDataTypeFromStr( const std::string & _str ){
+static EPersistenceDataType convertDataTypeFromStr( const char * _str ){
 
-    if( "traj" == _str ){
+    if( 0 == strcmp("traj", _str) ){
         return EPersistenceDataType::TRAJECTORY;
     }
-    else if( "weather" == _str ){
+    else if( 0 == strcmp("weather", _str) ){
         return EPersistenceDataType::WEATHER;
     }
     else{
@@ -51,22 +61,124 @@ static EPersistenceDataType convertDataTypeFromStr( const std::string & _str ){
     }
 }
 
+static string convertStorageLayoutToStr( const EPersistenceStorageLayout _layout ){
+    switch( _layout ){
+    case EPersistenceStorageLayout::DOCUMENT_PER_POINT : {
+        return "point";
+    }
+    case EPersistenceStorageLayout::CHUNK_PER_STEP : {
+        return "chunk";
+    }
+    default : {
+        assert( false && "incorrect storage layout enum" );
+    }
+    }
+}
+
+static EPersistenceStorageLayout convertStorageLayoutFromStr( const char * _str ){
+
+    if( 0 == strcmp("chunk", _str) ){
+        return EPersistenceStorageLayout::CHUNK_PER_STEP;
+    }
+    else if( 0 == strcmp("point", _str) ){
+        return EPersistenceStorageLayout::DOCUMENT_PER_POINT;
+    }
+    else{
+        assert( false && "incorrect storage layout str" );
+        return EPersistenceStorageLayout::UNDEFINED;
+    }
+}
+
+// global metadata document ( payload table name is read separately )
+template<>
+struct SBsonRecordLayout<SPersistenceMetadataDescr> {
+    using TRecord = SPersistenceMetadataDescr;
+    static constexpr size_t FIELDS_COUNT = 8;
+
+    static const SBsonRecordField<TRecord> * fields(){
+        using namespace mongo_fields::persistence_set_metadata;
+
+        static const SBsonRecordField<TRecord> layout[ FIELDS_COUNT ] = {
+            { PERSISTENCE_ID.c_str(),       []( const bson_iter_t * _iter, TRecord & _out ){ _out.persistenceSetId = bsonReadInteger( _iter ); } },
+            { CTX_ID.c_str(),               []( const bson_iter_t * _iter, TRecord & _out ){ _out.contextId = bsonReadInteger( _iter ); } },
+            { MISSION_ID.c_str(),           []( const bson_iter_t * _iter, TRecord & _out ){ _out.missionId = bsonReadInteger( _iter ); } },
+            { LAST_SESSION_ID.c_str(),      []( const bson_iter_t * _iter, TRecord & _out ){ _out.lastRecordedSession = bsonReadInteger( _iter ); } },
+            { UPDATE_STEP_MILLISEC.c_str(), []( const bson_iter_t * _iter, TRecord & _out ){ _out.timeStepIntervalMillisec = bsonReadInteger( _iter ); } },
+            { SOURCE_TYPE.c_str(),          []( const bson_iter_t * _iter, TRecord & _out ){ _out.sourceType = common_utils::convertPersistenceTypeFromStr( bson_iter_utf8(_iter, nullptr) ); } },
+            { DATA_TYPE.c_str(),            []( const bson_iter_t * _iter, TRecord & _out ){ _out.dataType = convertDataTypeFromStr( bson_iter_utf8(_iter, nullptr) ); } },
+            { STORAGE_LAYOUT.c_str(),       []( const bson_iter_t * _iter, TRecord & _out ){ _out.storageLayout = convertStorageLayoutFromStr( bson_iter_utf8(_iter, nullptr) ); } }
+        };
+        return layout;
+    }
+};
+
+static string makeStorageLayoutSuffix( const EPersistenceStorageLayout _layout ){
+    return ( EPersistenceStorageLayout::CHUNK_PER_STEP == _layout ) ? "_chunk" : "";
+}
+
 DatabaseManagerBase::DatabaseManagerBase()
-    : m_mongoClient(nullptr)
-    , m_mongoDatabase(nullptr)
+    : m_trajectoryCache(nullptr)
+    , m_writeBehind(nullptr)
+    , m_sessionSummary(nullptr)
+    , m_fanOutPool(nullptr)
+    , m_prefetcher(nullptr)
+    , m_retention(nullptr)
+    , m_liveTail(nullptr)
+    , m_originId(0)
+    , m_mongoClientPool(nullptr)
+    , m_sharedHandles(nullptr)
+    , m_handlesOwner(std::make_shared<SHandlesOwner>())
+    , m_tablesGeneration(0)
 {
-
+    m_handlesOwner->manager = this;
 }
 
 DatabaseManagerBase::~DatabaseManagerBase(){    
 
-    mongoc_cleanup();
+    for( auto & valuePair : m_changeStreams ){
+        stopChangeStream( valuePair.second );
+    }
+    m_changeStreams.clear();
+    delete m_liveTail;
+    m_liveTail = nullptr;
+
+    delete m_retention;
+    m_retention = nullptr;
+    delete m_fanOutPool;
+    m_fanOutPool = nullptr;
+    delete m_prefetcher;
+    m_prefetcher = nullptr;
 
-    for( mongoc_collection_t * collect : m_allTables ){
-        mongoc_collection_destroy( collect );
+    // drain queued payload while handles are still alive
+    delete m_writeBehind;
+    m_writeBehind = nullptr;
+
+    if( m_sessionSummary ){
+        flushSessionDescriptions();
+        delete m_sessionSummary;
+        m_sessionSummary = nullptr;
+    }
+
+    // threads exiting from now on leave their handles to this destructor
+    {
+        std::lock_guard<std::mutex> lock( m_handlesOwner->mutex );
+        m_handlesOwner->manager = nullptr;
     }
-    mongoc_database_destroy( m_mongoDatabase );
-    mongoc_client_destroy( m_mongoClient );
+
+    for( auto & valuePair : m_handlesByThread ){
+        destroyThreadHandles( valuePair.second );
+    }
+    m_handlesByThread.clear();
+    destroyThreadHandles( m_sharedHandles );
+    m_sharedHandles = nullptr;
+
+    if( m_mongoClientPool ){
+        mongoc_client_pool_destroy( m_mongoClientPool );
+        m_mongoClientPool = nullptr;
+    }
+
+    delete m_trajectoryCache;
+    m_trajectoryCache = nullptr;
 }
 
 void DatabaseManagerBase::systemInit(){
@@ -98,6 +210,12 @@ void DatabaseManagerBase::destroyInstance( DatabaseManagerBase * & _inst ){
     _inst = nullptr;
     m_instanceCounter--;
 
+    // NOTE: driver is global for the process, release it only after the last instance
+    if( 0 == m_instanceCounter && m_systemInited ){
+        mongoc_cleanup();
+        m_systemInited = false;
+    }
+
     m_muStaticProtect.unlock();
 }
 
@@ -107,6 +225,9 @@ void DatabaseManagerBase::destroyInstance( DatabaseManagerBase * & _inst ){
 bool DatabaseManagerBase::init( SInitSettings _settings ){
 
     m_settings = _settings;
+    if( ! m_bulkPolicies.setDefaultPolicy(_settings.writePolicy) ){
+        return false;
+    }
 
     // init mongo
     const mongoc_uri_t * uri = mongoc_uri_new_for_host_port( _settings.host.c_str(), _settings.port );
@@ -115,61 +236,279 @@ bool DatabaseManagerBase::init( SInitSettings _settings ){
         return false;
     }
 
-    m_mongoClient = mongoc_client_new_from_uri( uri );
-    if( ! m_mongoClient ){
-        VS_LOG_ERROR << PRINT_HEADER << " mongo connect failed to: " << _settings.host << endl;
-        return false;
+    m_tableNamePrefix = _settings.databaseName + "_";
+
+    // NOTE: write-behind, fan-out, prefetch, retention & change streams work in own threads, so they can't share one client with callers
+    const bool changeStreams = ( _settings.liveTailEnable && _settings.liveTailChangeStreams );
+    if( _settings.clientPoolEnable
+            || _settings.writeBehindEnable
+            || _settings.fanOutThreads > 0
+            || _settings.prefetchEnable
+            || _settings.retentionEnable
+            || changeStreams ){
+        m_mongoClientPool = mongoc_client_pool_new( uri );
+        if( ! m_mongoClientPool ){
+            VS_LOG_ERROR << PRINT_HEADER << " mongo client pool creation failed to: " << _settings.host << endl;
+            return false;
+        }
+
+        if( _settings.clientPoolMaxSize > 0 ){
+            // the first change stream is counted, the next ones are checked on subscribe
+            const uint32_t pinnedClients = getPinnedClientsCount( changeStreams ? 1 : 0 );
+            if( _settings.clientPoolMaxSize < pinnedClients ){
+                VS_LOG_ERROR << PRINT_HEADER << " client pool max size [" << _settings.clientPoolMaxSize << "]"
+                             << " is less than clients pinned by threads of instance [" << pinnedClients << "]"
+                             << endl;
+                return false;
+            }
+            mongoc_client_pool_max_size( m_mongoClientPool, _settings.clientPoolMaxSize );
+        }
     }
+    else{
+        mongoc_client_t * client = mongoc_client_new_from_uri( uri );
+        if( ! client ){
+            VS_LOG_ERROR << PRINT_HEADER << " mongo connect failed to: " << _settings.host << endl;
+            return false;
+        }
 
-    m_mongoDatabase = mongoc_client_get_database( m_mongoClient, _settings.databaseName.c_str() );
+        m_sharedHandles = createThreadHandles( client );
+    }
 
-    m_tableNamePrefix = _settings.databaseName + "_";
+    initPayloadTableReferences();
+
+    // payload cache
+    if( _settings.trajectoryCacheEnable ){
+        m_trajectoryCache = new TrajectoryCache();
+        if( ! m_trajectoryCache->init(_settings.trajectoryCache) ){
+            return false;
+        }
+    }
+
+    // sessions summary
+    if( _settings.sessionSummaryEnable ){
+        m_sessionSummary = new SessionSummary();
+    }
+
+    // playback read-ahead
+    if( _settings.prefetchEnable ){
+        TrajectoryPrefetcher::SInitSettings settings = _settings.prefetch;
+        settings.fetchFunc = std::bind( & DatabaseManagerBase::readTrajectoryDataFromStore, this, std::placeholders::_1 );
+
+        m_prefetcher = new TrajectoryPrefetcher();
+        if( ! m_prefetcher->init(settings) ){
+            return false;
+        }
+    }
+
+    // batch reads
+    if( _settings.fanOutThreads > 0 ){
+        m_fanOutPool = new ThreadPool( _settings.fanOutThreads );
+    }
+
+    // payload write-behind
+    if( _settings.writeBehindEnable ){
+        TrajectoryWriteBehind::SInitSettings settings = _settings.writeBehind;
+        settings.flushFunc = std::bind( & DatabaseManagerBase::writeTrajectoryDataToStore, this, std::placeholders::_1, std::placeholders::_2 );
+
+        m_writeBehind = new TrajectoryWriteBehind();
+        if( ! m_writeBehind->init(settings) ){
+            return false;
+        }
+    }
+
+    // payload cleanup
+    if( _settings.retentionEnable ){
+        RetentionEngine::SInitSettings settings = _settings.retention;
+        settings.storage = this;
+        settings.deleteBatchFunc = std::bind( & DatabaseManagerBase::deleteExpiredPayload, this, std::placeholders::_1, std::placeholders::_2 );
+        settings.dropSetFunc = std::bind( & DatabaseManagerBase::dropPersistenceSet, this, std::placeholders::_1 );
+
+        m_retention = new RetentionEngine();
+        if( ! m_retention->init(settings) ){
+            return false;
+        }
+    }
 
-    m_tableWALClientOperations = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    // live tail
+    if( _settings.liveTailEnable ){
+        m_liveTail = new TrajectorySubscriptions();
+        if( ! m_liveTail->init(_settings.liveTail) ){
+            return false;
+        }
+
+        // own writes are marked to skip them in change stream ( they are published directly )
+        if( changeStreams ){
+            std::random_device device;
+            std::mt19937_64 generator( ((uint64_t)device() << 32) ^ device() ^ (uint64_t)common_utils::getCurrentTimeMillisec() );
+            m_originId = std::uniform_int_distribution<int64_t>( 1, std::numeric_limits<int64_t>::max() )( generator );
+        }
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " instance connected to [" << _settings.host << "]" << endl;
+    return true;
+}
+
+// pooled client stays with its thread until the thread exits, so the pool must cover all threads at once
+// ( otherwise the last of them blocks forever in pop )
+uint32_t DatabaseManagerBase::getPinnedClientsCount( size_t _changeStreams ) const {
+
+    uint32_t out = 1; // callers
+    out += std::max( m_settings.fanOutThreads, 0 );
+    out += ( m_settings.writeBehindEnable ? 1 : 0 );
+    out += ( m_settings.prefetchEnable ? 1 : 0 );
+    out += ( m_settings.retentionEnable ? 1 : 0 );
+    out += ( m_settings.clientPoolEnable ? std::max(m_settings.snapshotImportThreads, 1) : 0 );
+    out += _changeStreams;
+    return out;
+}
+
+DatabaseManagerBase::SThreadHandles * DatabaseManagerBase::createThreadHandles( mongoc_client_t * _client ){
+
+    SThreadHandles * handles = new SThreadHandles();
+    handles->client = _client;
+    handles->database = mongoc_client_get_database( _client, m_settings.databaseName.c_str() );
+
+    handles->tableWALClientOperations = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::wal_client_operations::COLLECTION_NAME).c_str() );
 
-    m_tableWALProcessEvents = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    handles->tableWALProcessEvents = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::wal_process_events::COLLECTION_NAME).c_str() );
 
-    m_tableWALUserRegistrations = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    handles->tableWALUserRegistrations = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::wal_user_registrations::COLLECTION_NAME).c_str() );
 
-    m_tablePersistenceMetadata = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    handles->tablePersistenceMetadata = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::persistence_set_metadata::COLLECTION_NAME).c_str() );
 
-    m_tablePersistenceDescription = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    handles->tablePersistenceDescription = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::persistence_set_description::COLLECTION_NAME).c_str() );
 
-    m_tablePersistenceFromVideo = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    handles->tablePersistenceCounter = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
+        (m_tableNamePrefix + mongo_fields::persistence_set_counter::COLLECTION_NAME).c_str() );
+
+    handles->tablePersistenceFromVideo = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::persistence_set_metadata_video::COLLECTION_NAME).c_str() );
 
-    m_tablePersistenceFromRaw = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    handles->tablePersistenceFromRaw = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::persistence_set_metadata_raw::COLLECTION_NAME).c_str() );
 
-    m_tablePersistenceFromDSS = mongoc_client_get_collection( m_mongoClient,
-        _settings.databaseName.c_str(),
+    handles->tablePersistenceFromDSS = mongoc_client_get_collection( _client,
+        m_settings.databaseName.c_str(),
         (m_tableNamePrefix + mongo_fields::persistence_set_metadata_dss::COLLECTION_NAME).c_str() );
 
-    m_allTables.push_back( m_tableWALClientOperations );
-    m_allTables.push_back( m_tableWALProcessEvents );
-    m_allTables.push_back( m_tableWALUserRegistrations );
-    m_allTables.push_back( m_tablePersistenceMetadata );
-    m_allTables.push_back( m_tablePersistenceDescription );
-    m_allTables.push_back( m_tablePersistenceFromVideo );
-    m_allTables.push_back( m_tablePersistenceFromRaw );
-    m_allTables.push_back( m_tablePersistenceFromDSS );
+    handles->allTables.push_back( handles->tableWALClientOperations );
+    handles->allTables.push_back( handles->tableWALProcessEvents );
+    handles->allTables.push_back( handles->tableWALUserRegistrations );
+    handles->allTables.push_back( handles->tablePersistenceMetadata );
+    handles->allTables.push_back( handles->tablePersistenceDescription );
+    handles->allTables.push_back( handles->tablePersistenceCounter );
+    handles->allTables.push_back( handles->tablePersistenceFromVideo );
+    handles->allTables.push_back( handles->tablePersistenceFromRaw );
+    handles->allTables.push_back( handles->tablePersistenceFromDSS );
+
+    return handles;
+}
+
+void DatabaseManagerBase::destroyThreadHandles( SThreadHandles * _handles ){
 
-    initPayloadTableReferences();
+    if( ! _handles ){
+        return;
+    }
 
-    VS_LOG_INFO << PRINT_HEADER << " instance connected to [" << _settings.host << "]" << endl;
-    return true;
+    for( mongoc_collection_t * collect : _handles->allTables ){
+        mongoc_collection_destroy( collect );
+    }
+    for( auto & valuePair : _handles->tablesByPersistenceId ){
+        mongoc_collection_destroy( valuePair.second );
+    }
+    mongoc_database_destroy( _handles->database );
+
+    // pooled client goes back
+    if( m_mongoClientPool ){
+        mongoc_client_pool_push( m_mongoClientPool, _handles->client );
+    }
+    else{
+        mongoc_client_destroy( _handles->client );
+    }
+
+    delete _handles;
+}
+
+DatabaseManagerBase::SThreadHandles & DatabaseManagerBase::handles(){
+
+    if( ! m_mongoClientPool ){
+        return ( * m_sharedHandles );
+    }
+
+    const std::thread::id threadId = std::this_thread::get_id();
+    {
+        std::shared_lock<std::shared_timed_mutex> lock( m_mutexHandles );
+        auto iter = m_handlesByThread.find( threadId );
+        if( iter != m_handlesByThread.end() ){
+            return ( * iter->second );
+        }
+    }
+
+    // first call from this thread ( blocks if pool is exhausted )
+    SThreadHandles * handles = createThreadHandles( mongoc_client_pool_pop(m_mongoClientPool) );
+
+    // client returns to the pool when this thread exits
+    thread_local SThreadHandlesGuard guard;
+    guard.add( m_handlesOwner );
+
+    std::unique_lock<std::shared_timed_mutex> lock( m_mutexHandles );
+    m_handlesByThread.insert( {threadId, handles} );
+    return ( * handles );
+}
+
+DatabaseManagerBase::SThreadHandlesGuard::~SThreadHandlesGuard(){
+
+    for( const std::shared_ptr<SHandlesOwner> & owner : owners ){
+        std::lock_guard<std::mutex> lock( owner->mutex );
+        if( owner->manager ){
+            owner->manager->releaseThreadHandles();
+        }
+    }
+}
+
+void DatabaseManagerBase::SThreadHandlesGuard::add( const std::shared_ptr<SHandlesOwner> & _owner ){
+
+    // forget destroyed managers ( guard is the last holder )
+    owners.erase( std::remove_if( owners.begin(), owners.end(), []( const std::shared_ptr<SHandlesOwner> & _held ){ return _held.use_count() == 1; } ),
+                  owners.end() );
+
+    if( std::find(owners.begin(), owners.end(), _owner) == owners.end() ){
+        owners.push_back( _owner );
+    }
+}
+
+void DatabaseManagerBase::releaseThreadHandles(){
+
+    if( ! m_mongoClientPool ){
+        return;
+    }
+
+    SThreadHandles * handles = nullptr;
+    {
+        std::unique_lock<std::shared_timed_mutex> lock( m_mutexHandles );
+        auto iter = m_handlesByThread.find( std::this_thread::get_id() );
+        if( iter == m_handlesByThread.end() ){
+            return;
+        }
+
+        handles = iter->second;
+        m_handlesByThread.erase( iter );
+    }
+
+    destroyThreadHandles( handles );
 }
 
 inline bool DatabaseManagerBase::createIndex( const std::string & _tableName, const std::vector<std::string> & _fieldNames ){
@@ -195,7 +534,7 @@ inline bool DatabaseManagerBase::createIndex( const std::string & _tableName, co
     // perform Q
     bson_t reply;
     bson_error_t error;
-    const bool rt = mongoc_database_command_simple( m_mongoDatabase,
+    const bool rt = mongoc_database_command_simple( handles().database,
                                                     createIndex,
                                                     NULL,
                                                     & reply,
@@ -215,11 +554,56 @@ inline bool DatabaseManagerBase::createIndex( const std::string & _tableName, co
     return false;
 }
 
+inline bool DatabaseManagerBase::createIndex( const std::string & _tableName, const std::vector<std::pair<std::string, std::string>> & _fieldTypes ){
+
+    // "1" / "-1" -> ascending / descending, other -> special index type ( "2dsphere", ... )
+    bson_t keys;
+    bson_init( & keys );
+    for( const std::pair<std::string, std::string> & fieldType : _fieldTypes ){
+        if( "1" == fieldType.second || "-1" == fieldType.second ){
+            BSON_APPEND_INT32( & keys, fieldType.first.c_str(), std::stoi(fieldType.second) );
+        }
+        else{
+            BSON_APPEND_UTF8( & keys, fieldType.first.c_str(), fieldType.second.c_str() );
+        }
+    }
+
+    char * indexName = mongoc_collection_keys_to_index_string( & keys );
+    bson_t * createIndex = BCON_NEW( "createIndexes",
+                                     BCON_UTF8(_tableName.c_str()),
+                                     "indexes", "[",
+                                         "{", "key", BCON_DOCUMENT(& keys),
+                                              "name", BCON_UTF8(indexName),
+                                         "}",
+                                     "]"
+                                );
+
+    bson_t reply;
+    bson_error_t error;
+    const bool rt = mongoc_database_command_simple( handles().database,
+                                                    createIndex,
+                                                    NULL,
+                                                    & reply,
+                                                    & error );
+
+    bson_free( indexName );
+    bson_destroy( & keys );
+    bson_destroy( & reply );
+    bson_destroy( createIndex );
+
+    if( ! rt ){
+        VS_LOG_ERROR << PRINT_HEADER << " index creation failed, reason: " << error.message << endl;
+        return false;
+    }
+
+    return true;
+}
+
 void DatabaseManagerBase::initPayloadTableReferences(){
 
     // make query
     bson_t * query = BCON_NEW( nullptr );
-    mongoc_cursor_t * cursor = mongoc_collection_find( m_tablePersistenceMetadata,
+    mongoc_cursor_t * cursor = mongoc_collection_find( handles().tablePersistenceMetadata,
             MONGOC_QUERY_NONE,
             0,
             0,
@@ -229,230 +613,1641 @@ void DatabaseManagerBase::initPayloadTableReferences(){
             nullptr );
 
     // get results
+    m_metadataCatalog.clear();
+
     const bson_t * doc;
     while( mongoc_cursor_next( cursor, & doc ) ){
-        uint len;
-        bson_iter_t iter;
 
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::SOURCE_TYPE.c_str() );
-        const common_types::EPersistenceSourceType persType = common_utils::convertPersistenceTypeFromStr( bson_iter_utf8( & iter, & len ) );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::CTX_ID.c_str() );
-        const TContextId ctxId = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::MISSION_ID.c_str() );
-        const TMissionId missionId = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::UPDATE_STEP_MILLISEC.c_str() );
-        const int64_t updateStepMillisec = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::LAST_SESSION_ID.c_str() );
-        const TSessionNum sessionNum = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str() );
-        const TPersistenceSetId persId = bson_iter_int64( & iter );
+        SPersistenceMetadataDescr descr;
+        BsonRecordDecoder<SPersistenceMetadataDescr>::decode( doc, descr );
+
+        bson_iter_t iter;
         bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::PAYLOAD_TABLE_NAME.c_str() );
-        const std::string payloadTableName = bson_iter_utf8( & iter, & len );
+        const std::string payloadTableName = bson_iter_utf8( & iter, nullptr );
 
         // reference to table
-        createPayloadTableRef( persId, payloadTableName );
+        createPayloadTableRef( descr.persistenceSetId, payloadTableName, descr.storageLayout, descr.dataType );
+
+        // catalog ( specific parameters are read once here )
+        switch( descr.sourceType ){
+        case common_types::EPersistenceSourceType::VIDEO_SERVER : {
+            SPersistenceMetadataVideo videoMetadata;
+            static_cast<SPersistenceMetadataDescr &>( videoMetadata ) = descr;
+            getPersistenceFromVideo( descr.persistenceSetId, videoMetadata );
+            m_metadataCatalog.put( videoMetadata );
+            break;
+        }
+        case common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER : {
+            SPersistenceMetadataRaw rawMetadata;
+            static_cast<SPersistenceMetadataDescr &>( rawMetadata ) = descr;
+            getPersistenceFromRaw( descr.persistenceSetId, rawMetadata );
+            m_metadataCatalog.put( rawMetadata );
+            break;
+        }
+        case common_types::EPersistenceSourceType::DSS : {
+            SPersistenceMetadataDSS dssMetadata;
+            static_cast<SPersistenceMetadataDescr &>( dssMetadata ) = descr;
+            getPersistenceFromDSS( descr.persistenceSetId, dssMetadata );
+            m_metadataCatalog.put( dssMetadata );
+            break;
+        }
+        default : {
+            VS_LOG_WARN << PRINT_HEADER << " unknown source type of persistence id: " << descr.persistenceSetId << endl;
+        }
+        }
     }
 
     mongoc_cursor_destroy( cursor );
     bson_destroy( query );
-}
 
-inline void DatabaseManagerBase::createPayloadTableRef( common_types::TPersistenceSetId _persId, const std::string _tableName ){
+    // ids written before the counter existed must not be issued again
+    seedPersistenceIdCounter( m_metadataCatalog.getMaxPersistenceId() );
+}
 
-    mongoc_collection_t * contextTable = mongoc_client_get_collection(
-            m_mongoClient,
-            m_settings.databaseName.c_str(),
-            _tableName.c_str() );
+inline void DatabaseManagerBase::createPayloadTableRef( common_types::TPersistenceSetId _persId,
+                                                        const std::string _tableName,
+                                                        common_types::EPersistenceStorageLayout _layout,
+                                                        common_types::EPersistenceDataType _dataType ){
 
-    // TODO: each time when creating ref ?
-    createIndex( _tableName, {mongo_fields::analytic::detected_object::SESSION,
-            mongo_fields::analytic::detected_object::LOGIC_TIME}
-            );
+    // only missing indexes are created
+    createPayloadIndexes( _tableName, _layout, _dataType );
 
-    m_tablesByPersistenceId.insert( {_persId, contextTable} );
+    // NOTE: collection handles are created lazily by each thread
+    std::unique_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
     m_tableNameByPersistenceId.insert( {_persId, _tableName} );
+    m_storageLayoutByPersistenceId[ _persId ] = _layout;
+    m_dataTypeByPersistenceId[ _persId ] = _dataType;
 }
 
-inline mongoc_collection_t * DatabaseManagerBase::getPayloadTableRef( TPersistenceSetId _persId ){
+// same as 'mongoc_collection_keys_to_index_string'
+static std::string makeIndexName( const std::vector<std::pair<std::string, std::string>> & _fieldTypes ){
 
-    assert( _persId > 0 && m_tablesByPersistenceId.find(_persId) != m_tablesByPersistenceId.end() );
-    return m_tablesByPersistenceId[ _persId ];
+    std::string name;
+    for( const std::pair<std::string, std::string> & fieldType : _fieldTypes ){
+        name += ( name.empty() ? "" : "_" ) + fieldType.first + "_" + fieldType.second;
+    }
+    return name;
 }
 
-inline string DatabaseManagerBase::getTableName( common_types::TPersistenceSetId _persId ){
+static std::string makeIndexName( const std::vector<std::string> & _fieldNames ){
 
-    assert( m_tableNameByPersistenceId.find(_persId) != m_tableNameByPersistenceId.end() );
-    return m_tableNameByPersistenceId[ _persId ];
+    std::vector<std::pair<std::string, std::string>> fieldTypes;
+    for( const std::string & fieldName : _fieldNames ){
+        fieldTypes.push_back( {fieldName, "1"} );
+    }
+    return makeIndexName( fieldTypes );
 }
 
-// -------------------------------------------------------------------------------------
-// object payload
-// -------------------------------------------------------------------------------------
-bool DatabaseManagerBase::writeTrajectoryData( TPersistenceSetId _persId, const vector<SPersistenceTrajectory> & _data ){
-
-    // get table
-    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
-    mongoc_bulk_operation_t * bulkedWrite = mongoc_collection_create_bulk_operation( contextTable, false, NULL );
-
-    // build data into one set
-    for( const SPersistenceTrajectory & traj : _data ){
-
-        bson_t * doc = BCON_NEW( mongo_fields::analytic::detected_object::OBJRERP_ID.c_str(), BCON_INT64( traj.objId ),
-                                 mongo_fields::analytic::detected_object::STATE.c_str(), BCON_INT32( (int32_t)(traj.state) ),
-                                 mongo_fields::analytic::detected_object::ASTRO_TIME.c_str(), BCON_INT64( traj.astroTimeMillisec ),
-                                 mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), BCON_INT64( traj.logicTime ),
-                                 mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32( traj.sessionNum ),
-                                 mongo_fields::analytic::detected_object::LAT.c_str(), BCON_DOUBLE( traj.latDeg ),
-                                 mongo_fields::analytic::detected_object::LON.c_str(), BCON_DOUBLE( traj.lonDeg ),
-                                 mongo_fields::analytic::detected_object::HEIGHT.c_str(), BCON_DOUBLE( traj.height ),
-                                 mongo_fields::analytic::detected_object::YAW.c_str(), BCON_DOUBLE( traj.yawDeg )
-                               );
-
-        mongoc_bulk_operation_insert( bulkedWrite, doc );
-        bson_destroy( doc );
+void DatabaseManagerBase::createPayloadIndexes( const std::string & _tableName,
+                                                common_types::EPersistenceStorageLayout _layout,
+                                                common_types::EPersistenceDataType _dataType ){
+
+    // existing indexes are not rebuilt on each init
+    const std::unordered_set<std::string> existingIndexes = getIndexNames( _tableName );
+    auto isMissing = [ & existingIndexes ]( const std::string & _indexName ){
+        return ( existingIndexes.find(_indexName) == existingIndexes.end() );
+    };
+
+    // schema-described payload
+    if( EPersistenceDataType::WEATHER == _dataType ){
+        for( const std::vector<std::string> & fieldNames : PayloadCodec<SPersistenceWeather>::indexes() ){
+            if( isMissing(makeIndexName(fieldNames)) ){
+                createIndex( _tableName, fieldNames );
+            }
+        }
+        return;
     }
 
-    // write
-    bson_error_t error;
-    const bool rt = mongoc_bulk_operation_execute( bulkedWrite, NULL, & error );
-    if( 0 == rt ){
-        VS_LOG_ERROR << PRINT_HEADER << " bulked process event write failed, reason: " << error.message << endl;
-        mongoc_bulk_operation_destroy( bulkedWrite );
-        return false;
+    const std::vector<std::string> stepIndex = { mongo_fields::analytic::detected_object::SESSION,
+                                                 mongo_fields::analytic::detected_object::LOGIC_TIME };
+    if( isMissing(makeIndexName(stepIndex)) ){
+        createIndex( _tableName, stepIndex );
     }
-    mongoc_bulk_operation_destroy( bulkedWrite );
-
-    return true;
-}
-
-std::vector<SPersistenceTrajectory> DatabaseManagerBase::readTrajectoryData( const SPersistenceSetFilter & _filter ){
-
-    mongoc_collection_t * contextTable = getPayloadTableRef( _filter.persistenceSetId );
-    assert( contextTable );
 
-    bson_t * projection = nullptr;
-    bson_t * query = nullptr;
+    // point predicates ( chunks are opaque, filtered after decode )
+    if( EPersistenceStorageLayout::DOCUMENT_PER_POINT == _layout ){
+        const std::vector<std::string> objectIndex = { mongo_fields::analytic::detected_object::SESSION,
+                                                       mongo_fields::analytic::detected_object::OBJRERP_ID,
+                                                       mongo_fields::analytic::detected_object::LOGIC_TIME };
+        if( isMissing(makeIndexName(objectIndex)) ){
+            createIndex( _tableName, objectIndex );
+        }
 
-    // only one step
-    if( (_filter.minLogicStep == _filter.maxLogicStep) && _filter.minLogicStep >= 0 ){
-        query = BCON_NEW( "$and", "[", "{", mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32(_filter.sessionNum), "}",
-                                       "{", mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), "{", "$eq", BCON_INT64(_filter.minLogicStep), "}", "}",
-                                  "]"
-                        );
-    }
-    // steps range
-    else if( _filter.minLogicStep >= 0 && _filter.maxLogicStep >= 0 ){
-        query = BCON_NEW( "$and", "[", "{", mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32(_filter.sessionNum), "}",
-                                       "{", mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), "{", "$gte", BCON_INT64(_filter.minLogicStep), "}", "}",
-                                       "{", mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), "{", "$lte", BCON_INT64(_filter.maxLogicStep), "}", "}",
-                                        "]"
-                        );
-    }
-    // whole area
-    else{
-        query = BCON_NEW( nullptr );
+        // documents written before location field appeared are invisible to $geoWithin,
+        // backfill goes once before index creation ( failed one is retried on next init )
+        const std::vector<std::pair<std::string, std::string>> geoIndex = { {mongo_fields::analytic::detected_object::SESSION, "1"},
+                                                                            {mongo_fields::analytic::detected_object::LOCATION, "2dsphere"} };
+        if( isMissing(makeIndexName(geoIndex)) && backfillPayloadLocation(_tableName) ){
+            createIndex( _tableName, geoIndex );
+        }
     }
+}
 
-    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
-                                                        MONGOC_QUERY_NONE,
-                                                        0,
-                                                        0,
-                                                        1000000, // 10000 ~= inf
-                                                        query,
-                                                        projection,
-                                                        nullptr );
+std::unordered_set<std::string> DatabaseManagerBase::getIndexNames( const std::string & _tableName ){
 
-    std::vector<SPersistenceTrajectory> out;
-    const uint32_t size = mongoc_cursor_get_batch_size( cursor );
-    out.reserve( size );
+    mongoc_collection_t * table = mongoc_client_get_collection( handles().client, m_settings.databaseName.c_str(), _tableName.c_str() );
+    mongoc_cursor_t * cursor = mongoc_collection_find_indexes_with_opts( table, nullptr );
 
+    // NOTE: not yet created table has no indexes ( cursor just fails )
+    std::unordered_set<std::string> out;
     const bson_t * doc;
     while( mongoc_cursor_next( cursor, & doc ) ){
         bson_iter_t iter;
-
-        SPersistenceTrajectory detectedObject;
-        bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::OBJRERP_ID.c_str() );
-        detectedObject.objId = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::ASTRO_TIME.c_str() );
-        detectedObject.astroTimeMillisec = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::LOGIC_TIME.c_str() );
-        detectedObject.logicTime = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::SESSION.c_str() );
-        detectedObject.sessionNum = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::STATE.c_str() );
-        detectedObject.state = (SPersistenceObj::EState)bson_iter_int32( & iter );
-
-        if( detectedObject.state == SPersistenceObj::EState::ACTIVE ){
-            bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::LAT.c_str() );
-            detectedObject.latDeg = bson_iter_double( & iter );
-            bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::LON.c_str() );
-            detectedObject.lonDeg = bson_iter_double( & iter );
-            bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::HEIGHT.c_str() );
-            detectedObject.height = bson_iter_double( & iter );
-            bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::YAW.c_str() );
-            detectedObject.yawDeg = bson_iter_double( & iter );
+        if( bson_iter_init_find( & iter, doc, "name" ) && BSON_ITER_HOLDS_UTF8( & iter ) ){
+            out.insert( bson_iter_utf8( & iter, nullptr ) );
         }
-
-        out.push_back( detectedObject );
     }
 
     mongoc_cursor_destroy( cursor );
-    bson_destroy( query );
-
+    mongoc_collection_destroy( table );
     return out;
 }
 
-void DatabaseManagerBase::deleteDataRange( const SPersistenceSetFilter & _filter ){
+inline mongoc_collection_t * DatabaseManagerBase::getPayloadTableRef( TPersistenceSetId _persId ){
+
+    SThreadHandles & threadHandles = handles();
+
+    const uint64_t generation = m_tablesGeneration.load();
+    if( threadHandles.tablesGeneration != generation ){
+        dropRemovedTableRefs( threadHandles );
+        threadHandles.tablesGeneration = generation;
+    }
+
+    auto iter = threadHandles.tablesByPersistenceId.find( _persId );
+    if( iter != threadHandles.tablesByPersistenceId.end() ){
+        return iter->second;
+    }
+
+    std::string tableName;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
+        auto nameIter = m_tableNameByPersistenceId.find( _persId );
+        if( nameIter == m_tableNameByPersistenceId.end() ){
+            VS_LOG_ERROR << PRINT_HEADER << " payload table of unknown pers id [" << _persId << "]" << endl;
+            return nullptr;
+        }
+        tableName = nameIter->second;
+    }
+
+    mongoc_collection_t * contextTable = mongoc_client_get_collection( threadHandles.client,
+                                                                       m_settings.databaseName.c_str(),
+                                                                       tableName.c_str() );
+
+    // NOTE: handles set belongs to this thread ( or to single-threaded shared mode )
+    threadHandles.tablesByPersistenceId.insert( {_persId, contextTable} );
+    return contextTable;
+}
+
+bool DatabaseManagerBase::isPersistenceSetKnown( TPersistenceSetId _persId ){
+
+    std::shared_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
+    return m_tableNameByPersistenceId.find( _persId ) != m_tableNameByPersistenceId.end();
+}
+
+// set is removed: its id becomes unknown for writes, cached collections go away on the next use of each thread
+void DatabaseManagerBase::forgetPayloadTable( TPersistenceSetId _persId ){
+
+    {
+        std::unique_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
+        m_tableNameByPersistenceId.erase( _persId );
+        m_storageLayoutByPersistenceId.erase( _persId );
+        m_dataTypeByPersistenceId.erase( _persId );
+    }
+    m_tablesGeneration++;
+}
+
+void DatabaseManagerBase::dropRemovedTableRefs( SThreadHandles & _handles ){
+
+    std::shared_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
+    for( auto iter = _handles.tablesByPersistenceId.begin(); iter != _handles.tablesByPersistenceId.end(); ){
+        if( m_tableNameByPersistenceId.find(iter->first) == m_tableNameByPersistenceId.end() ){
+            mongoc_collection_destroy( iter->second );
+            iter = _handles.tablesByPersistenceId.erase( iter );
+        }
+        else{
+            ++iter;
+        }
+    }
+}
+
+inline string DatabaseManagerBase::getTableName( common_types::TPersistenceSetId _persId ){
+
+    std::shared_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
+    auto iter = m_tableNameByPersistenceId.find( _persId );
+    assert( _persId > 0 && iter != m_tableNameByPersistenceId.end() );
+    return iter->second;
+}
+
+inline EPersistenceStorageLayout DatabaseManagerBase::getStorageLayout( common_types::TPersistenceSetId _persId ){
+
+    std::shared_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
+    auto iter = m_storageLayoutByPersistenceId.find( _persId );
+    return ( iter != m_storageLayoutByPersistenceId.end() ) ? iter->second : EPersistenceStorageLayout::DOCUMENT_PER_POINT;
+}
+
+inline EPersistenceDataType DatabaseManagerBase::getDataType( common_types::TPersistenceSetId _persId ){
+
+    std::shared_lock<std::shared_timed_mutex> lock( m_mutexTableNames );
+    auto iter = m_dataTypeByPersistenceId.find( _persId );
+    return ( iter != m_dataTypeByPersistenceId.end() ) ? iter->second : EPersistenceDataType::TRAJECTORY;
+}
+
+// -------------------------------------------------------------------------------------
+// object payload
+// -------------------------------------------------------------------------------------
+bool DatabaseManagerBase::writeTrajectoryData( TPersistenceSetId _persId, const vector<SPersistenceTrajectory> & _data ){
+
+    if( ! isPersistenceSetKnown(_persId) ){
+        VS_LOG_ERROR << PRINT_HEADER << " write to unknown pers id [" << _persId << "]" << endl;
+        return false;
+    }
+
+    const bool rt = ( m_writeBehind ? m_writeBehind->enqueue(_persId, _data) : writeTrajectoryDataToStore(_persId, _data) == _data.size() );
+
+    // subscribers get points as soon as they are accepted, not when write-behind flushes them
+    if( rt && m_liveTail ){
+        m_liveTail->publish( _persId, _data );
+    }
+
+    return rt;
+}
+
+// one document per ( session, logic step ) of this write, step may consist of several chunks
+static void appendTrajectoryChunks( mongoc_bulk_operation_t * _bulk, const SPersistenceTrajectory * _data, size_t _count, int64_t _originId ){
+
+    std::map<std::pair<TSessionNum, TLogicStep>, std::vector<const SPersistenceTrajectory *>> pointsByStep;
+    for( size_t i = 0; i < _count; i++ ){
+        pointsByStep[ std::make_pair(_data[ i ].sessionNum, _data[ i ].logicTime) ].push_back( _data + i );
+    }
+
+    std::string chunk;
+    for( const auto & valuePair : pointsByStep ){
+        const std::vector<const SPersistenceTrajectory *> & points = valuePair.second;
+        TrajectoryChunkCodec::encode( points, chunk );
+
+        // astro time of step is kept as plain field for sessions discovery
+        int64_t astroTimeMillisec = points.front()->astroTimeMillisec;
+        for( const SPersistenceTrajectory * point : points ){
+            astroTimeMillisec = std::max( astroTimeMillisec, point->astroTimeMillisec );
+        }
+
+        bson_t * doc = BCON_NEW( mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32( valuePair.first.first ),
+                                 mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), BCON_INT64( valuePair.first.second ),
+                                 mongo_fields::analytic::detected_object::ASTRO_TIME.c_str(), BCON_INT64( astroTimeMillisec ),
+                                 mongo_fields::analytic::detected_object::POINTS_COUNT.c_str(), BCON_INT32( (int32_t)points.size() ),
+                                 mongo_fields::analytic::detected_object::CHUNK.c_str(), BCON_BIN( BSON_SUBTYPE_BINARY, (const uint8_t *)chunk.data(), (uint32_t)chunk.size() )
+                               );
+        if( _originId != 0 ){
+            BSON_APPEND_INT64( doc, mongo_fields::analytic::detected_object::ORIGIN.c_str(), _originId );
+        }
+
+        mongoc_bulk_operation_insert( _bulk, doc );
+        bson_destroy( doc );
+    }
+}
+
+static bool isGeoPointValid( double _latDeg, double _lonDeg ){
+    return ( _latDeg >= -90.0 && _latDeg <= 90.0 && _lonDeg >= -180.0 && _lonDeg <= 180.0 );
+}
+
+bool DatabaseManagerBase::backfillPayloadLocation( const std::string & _tableName ){
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    mongoc_collection_t * table = mongoc_client_get_collection( handles().client, m_settings.databaseName.c_str(), _tableName.c_str() );
+
+    bson_t * query = BCON_NEW( LOCATION.c_str(), "{", "$exists", BCON_BOOL(false), "}" );
+    bson_t * fields = BCON_NEW( "_id", BCON_INT32(1), LAT.c_str(), BCON_INT32(1), LON.c_str(), BCON_INT32(1) );
+    mongoc_cursor_t * cursor = mongoc_collection_find( table, MONGOC_QUERY_NONE, 0, 0, 0, query, fields, nullptr );
+
+    // one-off migration, updates go in bulks
+    constexpr int32_t BACKFILL_BULK_SIZE = 1000;
+    mongoc_bulk_operation_t * bulk = nullptr;
+    int32_t inBulk = 0;
+    int64_t backfilled = 0;
+    bool rt = true;
+
+    auto executeBulk = [ & ](){
+        bson_error_t error;
+        if( ! mongoc_bulk_operation_execute( bulk, NULL, & error ) ){
+            VS_LOG_ERROR << PRINT_HEADER << " location backfill of [" << _tableName << "] failed, reason: " << error.message << endl;
+            rt = false;
+        }
+        else{
+            backfilled += inBulk;
+        }
+        mongoc_bulk_operation_destroy( bulk );
+        bulk = nullptr;
+        inBulk = 0;
+    };
+
+    const bson_t * doc;
+    while( rt && mongoc_cursor_next( cursor, & doc ) ){
+        bson_iter_t idIter, latIter, lonIter;
+        if( ! bson_iter_init_find( & idIter, doc, "_id" )
+                || ! bson_iter_init_find( & latIter, doc, LAT.c_str() )
+                || ! bson_iter_init_find( & lonIter, doc, LON.c_str() ) ){
+            continue;
+        }
+
+        // invalid coords can't match any box anyway
+        const double latDeg = bsonReadDouble( & latIter );
+        const double lonDeg = bsonReadDouble( & lonIter );
+        if( ! isGeoPointValid(latDeg, lonDeg) ){
+            continue;
+        }
+
+        bson_t selector;
+        bson_init( & selector );
+        BSON_APPEND_VALUE( & selector, "_id", bson_iter_value(& idIter) );
+        bson_t * update = BCON_NEW( "$set", "{", LOCATION.c_str(), "[", BCON_DOUBLE(lonDeg), BCON_DOUBLE(latDeg), "]", "}" );
+
+        if( ! bulk ){
+            bulk = mongoc_collection_create_bulk_operation( table, false, nullptr );
+        }
+        mongoc_bulk_operation_update_one( bulk, & selector, update, false );
+        bson_destroy( update );
+        bson_destroy( & selector );
+
+        if( ++inBulk == BACKFILL_BULK_SIZE ){
+            executeBulk();
+        }
+    }
+
+    if( bulk ){
+        executeBulk();
+    }
+
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( fields );
+    bson_destroy( query );
+    mongoc_collection_destroy( table );
+
+    if( backfilled > 0 ){
+        VS_LOG_INFO << PRINT_HEADER << " location backfilled in [" << _tableName << "] documents: " << backfilled << endl;
+    }
+    return rt;
+}
+
+static void appendTrajectoryDocuments( mongoc_bulk_operation_t * _bulk, const SPersistenceTrajectory * _data, size_t _count, int64_t _originId ){
+
+    for( size_t i = 0; i < _count; i++ ){
+        const SPersistenceTrajectory & traj = _data[ i ];
+
+        bson_t * doc = BCON_NEW( mongo_fields::analytic::detected_object::OBJRERP_ID.c_str(), BCON_INT64( traj.objId ),
+                                 mongo_fields::analytic::detected_object::STATE.c_str(), BCON_INT32( (int32_t)(traj.state) ),
+                                 mongo_fields::analytic::detected_object::ASTRO_TIME.c_str(), BCON_INT64( traj.astroTimeMillisec ),
+                                 mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), BCON_INT64( traj.logicTime ),
+                                 mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32( traj.sessionNum ),
+                                 mongo_fields::analytic::detected_object::LAT.c_str(), BCON_DOUBLE( traj.latDeg ),
+                                 mongo_fields::analytic::detected_object::LON.c_str(), BCON_DOUBLE( traj.lonDeg ),
+                                 mongo_fields::analytic::detected_object::HEIGHT.c_str(), BCON_DOUBLE( traj.height ),
+                                 mongo_fields::analytic::detected_object::YAW.c_str(), BCON_DOUBLE( traj.yawDeg )
+                               );
+
+        // GeoJSON point for 2dsphere index ( invalid coords would fail the whole bulk )
+        if( isGeoPointValid(traj.latDeg, traj.lonDeg) ){
+            bson_t location;
+            BSON_APPEND_ARRAY_BEGIN( doc, mongo_fields::analytic::detected_object::LOCATION.c_str(), & location );
+            BSON_APPEND_DOUBLE( & location, "0", traj.lonDeg );
+            BSON_APPEND_DOUBLE( & location, "1", traj.latDeg );
+            bson_append_array_end( doc, & location );
+        }
+
+        if( _originId != 0 ){
+            BSON_APPEND_INT64( doc, mongo_fields::analytic::detected_object::ORIGIN.c_str(), _originId );
+        }
+
+        mongoc_bulk_operation_insert( _bulk, doc );
+        bson_destroy( doc );
+    }
+}
+
+mongoc_bulk_operation_t * DatabaseManagerBase::createPayloadBulk( mongoc_collection_t * _table, const BulkWritePolicies::SWritePolicy & _policy ){
+
+    mongoc_write_concern_t * writeConcern = mongoc_write_concern_new();
+    if( _policy.fireAndForget ){
+        mongoc_write_concern_set_w( writeConcern, MONGOC_WRITE_CONCERN_W_UNACKNOWLEDGED );
+    }
+    else{
+        mongoc_write_concern_set_w( writeConcern, _policy.w );
+        mongoc_write_concern_set_journal( writeConcern, _policy.journal );
+    }
+
+    // write concern is copied into bulk
+    mongoc_bulk_operation_t * bulk = mongoc_collection_create_bulk_operation( _table, _policy.ordered, writeConcern );
+    mongoc_write_concern_destroy( writeConcern );
+    return bulk;
+}
+
+bool DatabaseManagerBase::executePayloadBulk( TPersistenceSetId _persId, mongoc_bulk_operation_t * _bulk, int32_t _records ){
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    bson_error_t error;
+    const bool rt = mongoc_bulk_operation_execute( _bulk, NULL, & error );
+
+    const int64_t latencyMicrosec = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count();
+    m_bulkPolicies.bulkExecuted( _persId, _records, latencyMicrosec, rt );
+
+    if( 0 == rt ){
+        VS_LOG_ERROR << PRINT_HEADER << " bulked payload write failed, pers id: " << _persId << " reason: " << error.message << endl;
+    }
+    mongoc_bulk_operation_destroy( _bulk );
+    return rt;
+}
+
+size_t DatabaseManagerBase::writeTrajectoryDataToStore( TPersistenceSetId _persId, const vector<SPersistenceTrajectory> & _data ){
+
+    // get table ( set may be dropped while its points were queued )
+    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
+    if( ! contextTable ){
+        return 0;
+    }
+    const bool chunked = ( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_persId) );
+
+    // bulk size may change after each bulk
+    size_t begin = 0;
+    while( begin < _data.size() ){
+        int32_t bulkSize = 0;
+        const BulkWritePolicies::SWritePolicy policy = m_bulkPolicies.getPolicy( _persId, bulkSize );
+        const size_t count = std::min<size_t>( bulkSize, _data.size() - begin );
+
+        mongoc_bulk_operation_t * bulkedWrite = createPayloadBulk( contextTable, policy );
+        if( chunked ){
+            appendTrajectoryChunks( bulkedWrite, _data.data() + begin, count, m_originId );
+        }
+        else{
+            appendTrajectoryDocuments( bulkedWrite, _data.data() + begin, count, m_originId );
+        }
+
+        if( ! executePayloadBulk(_persId, bulkedWrite, count) ){
+            break;
+        }
+
+        // committed bulk stays in store even if the next one fails
+        if( count == _data.size() ){
+            payloadWritten( _persId, _data );
+        }
+        else{
+            payloadWritten( _persId, std::vector<SPersistenceTrajectory>(_data.begin() + begin, _data.begin() + begin + count) );
+        }
+        begin += count;
+    }
+
+    if( m_sessionSummary && begin > 0 ){
+        flushSessionDescriptions( _persId, false );
+    }
+    return begin;
+}
+
+void DatabaseManagerBase::payloadWritten( TPersistenceSetId _persId, const vector<SPersistenceTrajectory> & _data ){
+
+    if( m_trajectoryCache ){
+        m_trajectoryCache->append( _persId, _data );
+    }
+
+    if( m_prefetcher ){
+        TSessionNum lastInvalidated = common_vars::INVALID_SESSION_NUM;
+        for( const SPersistenceTrajectory & traj : _data ){
+            if( traj.sessionNum != lastInvalidated ){
+                m_prefetcher->invalidate( _persId, traj.sessionNum );
+                lastInvalidated = traj.sessionNum;
+            }
+        }
+    }
+
+    if( m_sessionSummary ){
+        m_sessionSummary->update( _persId, _data );
+    }
+}
+
+std::vector<SPersistenceTrajectory> DatabaseManagerBase::readTrajectoryData( const SPersistenceSetFilter & _filter ){
+
+    if( _filter.isDownsampled() ){
+        return readTrajectoryDataDownsampled( _filter );
+    }
+
+    // read-your-writes
+    flushTrajectoryData( _filter.persistenceSetId );
+
+    if( m_trajectoryCache ){
+        std::vector<SPersistenceTrajectory> out;
+        if( m_trajectoryCache->read(_filter, out) ){
+            return out;
+        }
+
+        // first touch of the session -> bring it into memory entirely
+        if( loadTrajectorySessionToCache(_filter) && m_trajectoryCache->read(_filter, out) ){
+            return out;
+        }
+    }
+
+    if( m_prefetcher ){
+        std::vector<SPersistenceTrajectory> out;
+        if( m_prefetcher->read(_filter, out) ){
+            // prefetched windows are fetched without point predicates
+            TrajectoryPointPredicate( _filter ).apply( out );
+            return out;
+        }
+    }
+
+    return readTrajectoryDataFromStore( _filter );
+}
+
+// one read of the batch
+class TrajectoryReadTask : public IThreadPoolTask {
+public:
+    TrajectoryReadTask( DatabaseManagerBase * _database,
+                        const SPersistenceSetFilter & _filter,
+                        std::vector<SPersistenceTrajectory> & _out,
+                        int & _pendingCount,
+                        std::mutex & _mutexPending,
+                        std::condition_variable & _cvPending )
+        : IThreadPoolTask(false)
+        , m_database(_database)
+        , m_filter(_filter)
+        , m_out(_out)
+        , m_pendingCount(_pendingCount)
+        , m_mutexPending(_mutexPending)
+        , m_cvPending(_cvPending)
+    {}
+
+    virtual bool processInThread() override {
+
+        m_out = m_database->readTrajectoryData( m_filter );
+
+        std::lock_guard<std::mutex> lock( m_mutexPending );
+        if( 0 == --m_pendingCount ){
+            m_cvPending.notify_one();
+        }
+        return true;
+    }
+
+private:
+    DatabaseManagerBase * m_database;
+    const SPersistenceSetFilter m_filter;
+    std::vector<SPersistenceTrajectory> & m_out;
+    int & m_pendingCount;
+    std::mutex & m_mutexPending;
+    std::condition_variable & m_cvPending;
+};
+
+std::vector<std::vector<SPersistenceTrajectory>> DatabaseManagerBase::readTrajectoryDataBatch( const std::vector<SPersistenceSetFilter> & _filters ){
+
+    std::vector<std::vector<SPersistenceTrajectory>> out( _filters.size() );
+
+    if( ! m_fanOutPool || _filters.size() < 2 ){
+        for( size_t i = 0; i < _filters.size(); i++ ){
+            out[ i ] = readTrajectoryData( _filters[ i ] );
+        }
+        return out;
+    }
+
+    // fan-out over workers ( each has its own pooled client ), then wait for the slowest one
+    int pendingCount = _filters.size();
+    std::mutex mutexPending;
+    std::condition_variable cvPending;
+
+    std::vector<TrajectoryReadTask *> tasks;
+    tasks.reserve( _filters.size() );
+    for( size_t i = 0; i < _filters.size(); i++ ){
+        tasks.push_back( new TrajectoryReadTask(this, _filters[ i ], out[ i ], pendingCount, mutexPending, cvPending) );
+        m_fanOutPool->enqueue( tasks.back() );
+    }
+
+    {
+        std::unique_lock<std::mutex> lock( mutexPending );
+        cvPending.wait( lock, [&pendingCount](){ return 0 == pendingCount; } );
+    }
+
+    for( TrajectoryReadTask * task : tasks ){
+        delete task;
+    }
+
+    return out;
+}
+
+std::vector<SPersistenceTrajectory> DatabaseManagerBase::readTrajectoryDataMerged( const std::vector<SPersistenceSetFilter> & _filters ){
+
+    std::vector<std::vector<SPersistenceTrajectory>> grouped = readTrajectoryDataBatch( _filters );
+
+    size_t totalSize = 0;
+    for( const std::vector<SPersistenceTrajectory> & group : grouped ){
+        totalSize += group.size();
+    }
+
+    std::vector<SPersistenceTrajectory> out;
+    out.reserve( totalSize );
+    for( const std::vector<SPersistenceTrajectory> & group : grouped ){
+        out.insert( out.end(), group.begin(), group.end() );
+    }
+
+    // one timeline for all sets ( set order is kept inside one step )
+    std::stable_sort( out.begin(), out.end(), []( const SPersistenceTrajectory & _lhs, const SPersistenceTrajectory & _rhs ){
+        return ( _lhs.sessionNum < _rhs.sessionNum || (_lhs.sessionNum == _rhs.sessionNum && _lhs.logicTime < _rhs.logicTime) );
+    });
+
+    return out;
+}
+
+bool DatabaseManagerBase::loadTrajectorySessionToCache( const SPersistenceSetFilter & _filter ){
+
+    // only session scoped requests
+    if( _filter.minLogicStep < 0 || _filter.maxLogicStep < 0 ){
+        return false;
+    }
+
+    const uint64_t loadTicket = m_trajectoryCache->beginSessionLoad( _filter.persistenceSetId, _filter.sessionNum );
+
+    SPersistenceSetFilter sessionFilter( _filter.persistenceSetId );
+    sessionFilter.sessionNum = _filter.sessionNum;
+    sessionFilter.minLogicStep = 0;
+    sessionFilter.maxLogicStep = std::numeric_limits<TLogicStep>::max();
+
+    const std::vector<SPersistenceTrajectory> sessionData = readTrajectoryDataFromStore( sessionFilter );
+    return m_trajectoryCache->loadSession( _filter.persistenceSetId, _filter.sessionNum, loadTicket, sessionData );
+}
+
+void DatabaseManagerBase::flushTrajectoryData( TPersistenceSetId _persId ){
+
+    if( m_writeBehind ){
+        m_writeBehind->flush( _persId );
+    }
+}
+
+TrajectoryPrefetcher::SPrefetchStats DatabaseManagerBase::getTrajectoryPrefetchStats(){
+
+    if( ! m_prefetcher ){
+        return TrajectoryPrefetcher::SPrefetchStats();
+    }
+
+    return m_prefetcher->getStats();
+}
+
+bool DatabaseManagerBase::setWritePolicy( TPersistenceSetId _persId, const BulkWritePolicies::SWritePolicy & _policy ){
+
+    // queued points go with the previous policy
+    flushTrajectoryData( _persId );
+    return m_bulkPolicies.setPolicy( _persId, _policy );
+}
+
+std::vector<BulkWritePolicies::SPolicyStats> DatabaseManagerBase::getWritePolicyStats(){
+
+    return m_bulkPolicies.getStats();
+}
+
+TrajectoryWriteBehind::SIngestStats DatabaseManagerBase::getTrajectoryIngestStats(){
+
+    if( ! m_writeBehind ){
+        return TrajectoryWriteBehind::SIngestStats();
+    }
+
+    return m_writeBehind->getStats();
+}
+
+TrajectoryCache::SCacheStats DatabaseManagerBase::getTrajectoryCacheStats(){
+
+    if( ! m_trajectoryCache ){
+        return TrajectoryCache::SCacheStats();
+    }
+
+    return m_trajectoryCache->getStats();
+}
+
+static bson_t * makeStepsQuery( const SPersistenceSetFilter & _filter ){
+
+    // only one step
+    if( (_filter.minLogicStep == _filter.maxLogicStep) && _filter.minLogicStep >= 0 ){
+        return BCON_NEW( "$and", "[", "{", mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32(_filter.sessionNum), "}",
+                                       "{", mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), "{", "$eq", BCON_INT64(_filter.minLogicStep), "}", "}",
+                                  "]"
+                        );
+    }
+    // steps range
+    else if( _filter.minLogicStep >= 0 && _filter.maxLogicStep >= 0 ){
+        return BCON_NEW( "$and", "[", "{", mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32(_filter.sessionNum), "}",
+                                       "{", mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), "{", "$gte", BCON_INT64(_filter.minLogicStep), "}", "}",
+                                       "{", mongo_fields::analytic::detected_object::LOGIC_TIME.c_str(), "{", "$lte", BCON_INT64(_filter.maxLogicStep), "}", "}",
+                                        "]"
+                        );
+    }
+    // whole area
+    else{
+        return BCON_NEW( nullptr );
+    }
+}
+
+// 2dsphere edges are geodesics -> horizontal edges are densified and the box is widened,
+// exact bounds are checked by plain lat/lon predicates
+static constexpr double GEO_EDGE_STEP_DEG = 1.0;
+static constexpr double GEO_MARGIN_DEG = 0.01;
+
+static void appendGeoWithinPredicate( bson_t * _predicates, const SGeoBoundingBox & _box ){
+
+    const double minLat = std::max( _box.minLatDeg - GEO_MARGIN_DEG, -90.0 );
+    const double maxLat = std::min( _box.maxLatDeg + GEO_MARGIN_DEG, 90.0 );
+    const double minLon = std::max( _box.minLonDeg - GEO_MARGIN_DEG, -180.0 );
+    const double maxLon = std::min( _box.maxLonDeg + GEO_MARGIN_DEG, 180.0 );
+
+    // ring: south edge west -> east, north edge east -> west, closed
+    std::vector<std::pair<double, double>> ring;
+    const int edgeSteps = std::max( 1, (int)std::ceil((maxLon - minLon) / GEO_EDGE_STEP_DEG) );
+    for( int i = 0; i <= edgeSteps; i++ ){
+        ring.push_back( {minLon + (maxLon - minLon) * i / edgeSteps, minLat} );
+    }
+    for( int i = edgeSteps; i >= 0; i-- ){
+        ring.push_back( {minLon + (maxLon - minLon) * i / edgeSteps, maxLat} );
+    }
+    ring.push_back( ring.front() );
+
+    bson_t location, geoWithin, geometry, coordinates, points;
+    BSON_APPEND_DOCUMENT_BEGIN( _predicates, mongo_fields::analytic::detected_object::LOCATION.c_str(), & location );
+    BSON_APPEND_DOCUMENT_BEGIN( & location, "$geoWithin", & geoWithin );
+    BSON_APPEND_DOCUMENT_BEGIN( & geoWithin, "$geometry", & geometry );
+    BSON_APPEND_UTF8( & geometry, "type", "Polygon" );
+    BSON_APPEND_ARRAY_BEGIN( & geometry, "coordinates", & coordinates );
+    BSON_APPEND_ARRAY_BEGIN( & coordinates, "0", & points );
+    for( size_t i = 0; i < ring.size(); i++ ){
+        const std::string key = std::to_string( i );
+        bson_t point;
+        BSON_APPEND_ARRAY_BEGIN( & points, key.c_str(), & point );
+        BSON_APPEND_DOUBLE( & point, "0", ring[ i ].first );
+        BSON_APPEND_DOUBLE( & point, "1", ring[ i ].second );
+        bson_append_array_end( & points, & point );
+    }
+    bson_append_array_end( & coordinates, & points );
+    bson_append_array_end( & geometry, & coordinates );
+    bson_append_document_end( & geoWithin, & geometry );
+    bson_append_document_end( & location, & geoWithin );
+    bson_append_document_end( _predicates, & location );
+}
+
+static bson_t * makeTrajectoryQuery( const SPersistenceSetFilter & _filter, bool _withPointPredicates = true ){
+
+    bson_t * steps = makeStepsQuery( _filter );
+    if( ! _withPointPredicates || ! _filter.hasPointPredicates() ){
+        return steps;
+    }
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    bson_t * predicates = bson_new();
+
+    if( ! _filter.objIds.empty() ){
+        bson_t objects, objectsIn;
+        BSON_APPEND_DOCUMENT_BEGIN( predicates, OBJRERP_ID.c_str(), & objects );
+        BSON_APPEND_ARRAY_BEGIN( & objects, "$in", & objectsIn );
+        for( size_t i = 0; i < _filter.objIds.size(); i++ ){
+            const std::string key = std::to_string( i );
+            BSON_APPEND_INT64( & objectsIn, key.c_str(), _filter.objIds[ i ] );
+        }
+        bson_append_array_end( & objects, & objectsIn );
+        bson_append_document_end( predicates, & objects );
+    }
+
+    if( ! _filter.boundingBox.empty() ){
+        const SGeoBoundingBox & box = _filter.boundingBox;
+
+        // polygon must be smaller than hemisphere
+        if( box.maxLonDeg - box.minLonDeg < 180.0 ){
+            appendGeoWithinPredicate( predicates, box );
+        }
+
+        bson_t lat, lon;
+        BSON_APPEND_DOCUMENT_BEGIN( predicates, LAT.c_str(), & lat );
+        BSON_APPEND_DOUBLE( & lat, "$gte", box.minLatDeg );
+        BSON_APPEND_DOUBLE( & lat, "$lte", box.maxLatDeg );
+        bson_append_document_end( predicates, & lat );
+        BSON_APPEND_DOCUMENT_BEGIN( predicates, LON.c_str(), & lon );
+        BSON_APPEND_DOUBLE( & lon, "$gte", box.minLonDeg );
+        BSON_APPEND_DOUBLE( & lon, "$lte", box.maxLonDeg );
+        bson_append_document_end( predicates, & lon );
+    }
+
+    bson_t * query = BCON_NEW( "$and", "[", BCON_DOCUMENT(steps), BCON_DOCUMENT(predicates), "]" );
+    bson_destroy( predicates );
+    bson_destroy( steps );
+    return query;
+}
+
+// reserve of read result: steps x objects of a steps range, unbounded read grows on its own
+static constexpr size_t READ_RESERVE_OBJECTS_PER_STEP = 64;
+static constexpr size_t READ_RESERVE_MAX_RECORDS = 64 * 1024;
+
+static size_t estimateRecordsCount( const SPersistenceSetFilter & _filter ){
+
+    if( _filter.minLogicStep < 0 || _filter.maxLogicStep < _filter.minLogicStep ){
+        return 0;
+    }
+
+    const size_t steps = std::min<size_t>( _filter.maxLogicStep - _filter.minLogicStep + 1, READ_RESERVE_MAX_RECORDS );
+    const size_t objects = _filter.objIds.empty() ? READ_RESERVE_OBJECTS_PER_STEP : _filter.objIds.size();
+    return std::min( steps * objects, READ_RESERVE_MAX_RECORDS );
+}
+
+static void decodeTrajectory( const bson_t * _doc, SPersistenceTrajectory & _out ){
+
+    BsonRecordDecoder<SPersistenceTrajectory>::decode( _doc, _out );
+}
+
+static void decodeTrajectoryChunk( const bson_t * _doc, std::vector<SPersistenceTrajectory> & _out ){
+
+    bson_iter_t iter;
+
+    bson_iter_init_find( & iter, _doc, mongo_fields::analytic::detected_object::SESSION.c_str() );
+    const TSessionNum sessionNum = bson_iter_int32( & iter );
+    bson_iter_init_find( & iter, _doc, mongo_fields::analytic::detected_object::LOGIC_TIME.c_str() );
+    const TLogicStep logicTime = bson_iter_int64( & iter );
+
+    if( ! bson_iter_init_find( & iter, _doc, mongo_fields::analytic::detected_object::CHUNK.c_str() ) || ! BSON_ITER_HOLDS_BINARY( & iter ) ){
+        VS_LOG_ERROR << PRINT_HEADER << " chunk is absent, session: " << sessionNum << " step: " << logicTime << endl;
+        return;
+    }
+
+    bson_subtype_t subtype;
+    uint32_t size = 0;
+    const uint8_t * data = nullptr;
+    bson_iter_binary( & iter, & subtype, & size, & data );
+
+    if( ! TrajectoryChunkCodec::decode(data, size, sessionNum, logicTime, _out) ){
+        VS_LOG_ERROR << PRINT_HEADER << " chunk is corrupted, session: " << sessionNum << " step: " << logicTime << endl;
+    }
+}
+
+std::vector<SPersistenceTrajectory> DatabaseManagerBase::readTrajectoryDataFromStore( const SPersistenceSetFilter & _filter ){
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _filter.persistenceSetId );
+    assert( contextTable );
+
+    const bool chunked = ( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_filter.persistenceSetId) );
+
+    bson_t * projection = nullptr;
+    bson_t * query = makeTrajectoryQuery( _filter, ! chunked );
+
+    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        0,
+                                                        1000000, // 10000 ~= inf
+                                                        query,
+                                                        projection,
+                                                        nullptr );
+
+    std::vector<SPersistenceTrajectory> out;
+    out.reserve( estimateRecordsCount(_filter) );
+
+    const TrajectoryPointPredicate predicate( _filter );
+
+    const bson_t * doc;
+    while( mongoc_cursor_next( cursor, & doc ) ){
+
+        if( chunked ){
+            const size_t chunkBegin = out.size();
+            decodeTrajectoryChunk( doc, out );
+            predicate.apply( out, chunkBegin );
+            continue;
+        }
+
+        BsonRecordDecoder<SPersistenceTrajectory>::decodeAppend( doc, out );
+    }
+
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( query );
+
+    return out;
+}
+
+std::vector<SPersistenceTrajectory> DatabaseManagerBase::readTrajectoryDataDownsampled( const SPersistenceSetFilter & _filter ){
+
+    flushTrajectoryData( _filter.persistenceSetId );
+
+    // session already in memory -> reduce here, no round trip
+    if( m_trajectoryCache ){
+        std::vector<SPersistenceTrajectory> points;
+        if( m_trajectoryCache->read(_filter, points) || (loadTrajectorySessionToCache(_filter) && m_trajectoryCache->read(_filter, points)) ){
+            TrajectoryDownsampler downsampler( _filter );
+            downsampler.add( points );
+            return downsampler.getResult();
+        }
+    }
+
+    // binary chunks are opaque for aggregation
+    if( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_filter.persistenceSetId) ){
+        TrajectoryDownsampler downsampler( _filter );
+        downsampler.add( readTrajectoryDataFromStore(_filter) );
+        return downsampler.getResult();
+    }
+
+    return aggregateTrajectoryDataInStore( _filter );
+}
+
+static bson_t * makeDownsampleGroupStage( const SPersistenceSetFilter & _filter ){
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    // bucket = v - v % n
+    const string bucketField = "$" + ( _filter.bucketLogicSteps > 0 ? LOGIC_TIME : ASTRO_TIME );
+    const int64_t bucketSize = ( _filter.bucketLogicSteps > 0 ? _filter.bucketLogicSteps : _filter.bucketMillisec );
+    const string sessionField = "$" + SESSION;
+    const string objectField = "$" + OBJRERP_ID;
+
+    bson_t * group = BCON_NEW( "_id", "{",
+                                   "s", BCON_UTF8( sessionField.c_str() ),
+                                   "b", "{", "$subtract", "[", BCON_UTF8( bucketField.c_str() ),
+                                                               "{", "$mod", "[", BCON_UTF8( bucketField.c_str() ), BCON_INT64( bucketSize ), "]", "}",
+                                                          "]", "}",
+                                   "o", BCON_UTF8( objectField.c_str() ),
+                               "}",
+                               "p", "{", ( EDownsampleMode::LAST == _filter.downsampleMode ? "$last" : "$first" ), BCON_UTF8( "$$ROOT" ), "}"
+                             );
+
+    if( EDownsampleMode::AVG == _filter.downsampleMode ){
+        for( const string * field : { & LAT, & LON, & HEIGHT, & YAW } ){
+            const string fieldPath = "$" + ( * field );
+            bson_t avg;
+            BSON_APPEND_DOCUMENT_BEGIN( group, field->c_str(), & avg );
+            BSON_APPEND_UTF8( & avg, "$avg", fieldPath.c_str() );
+            bson_append_document_end( group, & avg );
+        }
+    }
+
+    return group;
+}
+
+std::vector<SPersistenceTrajectory> DatabaseManagerBase::aggregateTrajectoryDataInStore( const SPersistenceSetFilter & _filter ){
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _filter.persistenceSetId );
+    assert( contextTable );
+
+    // match -> order inside bucket -> one point per ( session, bucket, object )
+    bson_t * match = makeTrajectoryQuery( _filter );
+    bson_t * group = makeDownsampleGroupStage( _filter );
+    bson_t * pipeline = BCON_NEW( "pipeline", "[",
+                                  "{", "$match", BCON_DOCUMENT( match ), "}",
+                                  "{", "$sort", "{", SESSION.c_str(), BCON_INT32(1), LOGIC_TIME.c_str(), BCON_INT32(1), "}", "}",
+                                  "{", "$group", BCON_DOCUMENT( group ), "}",
+                                  "{", "$sort", "{", "_id.s", BCON_INT32(1), "_id.b", BCON_INT32(1), "_id.o", BCON_INT32(1), "}", "}",
+                                  "]"
+                                );
+    bson_t * opts = BCON_NEW( "allowDiskUse", BCON_BOOL(true) );
+
+    mongoc_cursor_t * cursor = mongoc_collection_aggregate( contextTable,
+                                                            MONGOC_QUERY_NONE,
+                                                            pipeline,
+                                                            opts,
+                                                            nullptr );
+
+    const bool averaged = ( EDownsampleMode::AVG == _filter.downsampleMode );
+
+    std::vector<SPersistenceTrajectory> out;
+    const bson_t * doc;
+    while( mongoc_cursor_next( cursor, & doc ) ){
+        bson_iter_t iter;
+        if( ! bson_iter_init_find( & iter, doc, "p" ) || ! BSON_ITER_HOLDS_DOCUMENT( & iter ) ){
+            continue;
+        }
+
+        uint32_t pointLen = 0;
+        const uint8_t * pointData = nullptr;
+        bson_iter_document( & iter, & pointLen, & pointData );
+
+        bson_t point;
+        if( ! bson_init_static( & point, pointData, pointLen ) || ! BsonRecordDecoder<SPersistenceTrajectory>::decodeAppend( & point, out ) ){
+            continue;
+        }
+
+        if( averaged ){
+            SPersistenceTrajectory & traj = out.back();
+            if( bson_iter_init_find( & iter, doc, LAT.c_str() ) ){
+                traj.latDeg = bsonReadDouble( & iter );
+            }
+            if( bson_iter_init_find( & iter, doc, LON.c_str() ) ){
+                traj.lonDeg = bsonReadDouble( & iter );
+            }
+            if( bson_iter_init_find( & iter, doc, HEIGHT.c_str() ) ){
+                traj.height = bsonReadDouble( & iter );
+            }
+            if( bson_iter_init_find( & iter, doc, YAW.c_str() ) ){
+                traj.yawDeg = bsonReadDouble( & iter );
+            }
+        }
+    }
+
+    bson_error_t error;
+    if( mongoc_cursor_error( cursor, & error ) ){
+        VS_LOG_ERROR << PRINT_HEADER << " downsampled read failed, reason: " << error.message << endl;
+    }
+
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( opts );
+    bson_destroy( pipeline );
+    bson_destroy( group );
+    bson_destroy( match );
+
+    return out;
+}
+
+DatabaseManagerBase::PTrajectoryCursor DatabaseManagerBase::openTrajectoryCursor( const SPersistenceSetFilter & _filter, int32_t _batchSize ){
+
+    flushTrajectoryData( _filter.persistenceSetId );
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _filter.persistenceSetId );
+    assert( contextTable );
 
-    // TODO: remove by logic step range
+    const bool chunked = ( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_filter.persistenceSetId) );
+
+    // NOTE: server batch equals to client batch -> one network round trip per consumer batch
+    bson_t * query = makeTrajectoryQuery( _filter, ! chunked );
+    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        0,
+                                                        _batchSize,
+                                                        query,
+                                                        nullptr,
+                                                        nullptr );
+
+    if( chunked ){
+        if( _filter.hasPointPredicates() ){
+            auto predicate = std::make_shared<TrajectoryPointPredicate>( _filter );
+            auto decode = [ predicate ]( const bson_t * _doc, std::vector<SPersistenceTrajectory> & _out ){
+                const size_t chunkBegin = _out.size();
+                decodeTrajectoryChunk( _doc, _out );
+                predicate->apply( _out, chunkBegin );
+            };
+            return std::make_shared<PersistenceCursor<SPersistenceTrajectory>>( cursor, query, _batchSize, decode );
+        }
+        return std::make_shared<PersistenceCursor<SPersistenceTrajectory>>( cursor, query, _batchSize, & decodeTrajectoryChunk );
+    }
+    return std::make_shared<PersistenceCursor<SPersistenceTrajectory>>( cursor, query, _batchSize, & decodeTrajectory );
+}
+
+DatabaseManagerBase::PWeatherCursor DatabaseManagerBase::openWeatherCursor( const SPersistenceSetFilter & _filter, int32_t _batchSize ){
+
+    return openPayloadCursor<SPersistenceWeather>( _filter, _batchSize );
+}
+
+bool DatabaseManagerBase::readTrajectoryDataStream( const SPersistenceSetFilter & _filter,
+                                                    int32_t _batchSize,
+                                                    std::function<bool( const std::vector<SPersistenceTrajectory> & )> _consumer ){
+
+    PTrajectoryCursor cursor = openTrajectoryCursor( _filter, _batchSize );
+
+    while( ! cursor->isDone() ){
+        const std::vector<SPersistenceTrajectory> & batch = cursor->nextBatch();
+        if( batch.empty() ){
+            break;
+        }
+
+        // consumer asks to stop
+        if( ! _consumer(batch) ){
+            return true;
+        }
+    }
+
+    if( ! cursor->getLastError().empty() ){
+        VS_LOG_ERROR << PRINT_HEADER << " trajectory stream failed, reason: " << cursor->getLastError() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+void DatabaseManagerBase::deleteDataRange( const SPersistenceSetFilter & _filter ){
 
     mongoc_collection_t * contextTable = getPayloadTableRef( _filter.persistenceSetId );
     assert( contextTable );
 
-    bson_t * query = BCON_NEW( nullptr );
+    flushTrajectoryData( _filter.persistenceSetId );
+    invalidatePayloadCaches( _filter.persistenceSetId );
+
+    const bool chunked = ( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_filter.persistenceSetId) );
+
+    // whole area - drop is instant and doesn't hold the collection for the whole removal
+    if( (_filter.minLogicStep < 0 || _filter.maxLogicStep < 0) && ! _filter.hasPointPredicates() ){
+        bson_error_t error;
+        if( ! mongoc_collection_drop( contextTable, & error ) ){
+            // NOTE: empty table may be not created yet
+            VS_LOG_WARN << PRINT_HEADER << " payload table drop failed, reason: " << error.message << endl;
+        }
+
+        // readers may refill caches from the table while it is being dropped
+        invalidatePayloadCaches( _filter.persistenceSetId );
+
+        createPayloadIndexes( getTableName(_filter.persistenceSetId), getStorageLayout(_filter.persistenceSetId), getDataType(_filter.persistenceSetId) );
+        return;
+    }
+
+    // chunk holds points of all objects
+    if( chunked && _filter.hasPointPredicates() ){
+        VS_LOG_ERROR << PRINT_HEADER << " point predicates are not supported by delete from chunked pers id: " << _filter.persistenceSetId << endl;
+        return;
+    }
+
+    // steps range - small batches in index order
+    bson_t * query = makeTrajectoryQuery( _filter, ! chunked );
+    while( removePayloadBatch(_filter.persistenceSetId, query, m_settings.deleteBatchSize) == m_settings.deleteBatchSize );
+
+    bson_destroy( query );
+}
+
+int64_t DatabaseManagerBase::removePayloadBatch( TPersistenceSetId _persId, const bson_t * _query, int32_t _batchSize ){
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
+    assert( contextTable );
+
+    // select ids by ( session, logic_time ) index, then remove exactly them
+    bson_t * query = BCON_NEW( "$query", BCON_DOCUMENT(_query),
+                               "$orderby", "{", SESSION.c_str(), BCON_INT32(1), LOGIC_TIME.c_str(), BCON_INT32(1), "}"
+                             );
+    bson_t * fields = BCON_NEW( "_id", BCON_INT32(1), SESSION.c_str(), BCON_INT32(1) );
+
+    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        _batchSize,
+                                                        0,
+                                                        query,
+                                                        fields,
+                                                        nullptr );
+
+    bson_t removeQuery, idDoc, idsIn;
+    bson_init( & removeQuery );
+    BSON_APPEND_DOCUMENT_BEGIN( & removeQuery, "_id", & idDoc );
+    BSON_APPEND_ARRAY_BEGIN( & idDoc, "$in", & idsIn );
+
+    int64_t selected = 0;
+    std::vector<TSessionNum> sessions;
+
+    const bson_t * doc;
+    while( mongoc_cursor_next( cursor, & doc ) ){
+        bson_iter_t iter;
+        if( ! bson_iter_init_find( & iter, doc, "_id" ) ){
+            continue;
+        }
+
+        const std::string key = std::to_string( selected++ );
+        bson_append_value( & idsIn, key.c_str(), -1, bson_iter_value( & iter ) );
+
+        if( bson_iter_init_find( & iter, doc, SESSION.c_str() ) ){
+            const TSessionNum sessionNum = bson_iter_as_int64( & iter );
+            if( sessions.empty() || sessions.back() != sessionNum ){
+                sessions.push_back( sessionNum );
+            }
+        }
+    }
+
+    bson_append_array_end( & idDoc, & idsIn );
+    bson_append_document_end( & removeQuery, & idDoc );
 
     bson_error_t error;
-    const bool result = mongoc_collection_remove( contextTable, MONGOC_REMOVE_NONE, query, nullptr, & error );
-    if( ! result ){
-        VS_LOG_ERROR << PRINT_HEADER << " total delete failed, reason: " << error.message << endl;
+    bool failed = mongoc_cursor_error( cursor, & error );
+    if( failed ){
+        VS_LOG_ERROR << PRINT_HEADER << " batch selection failed, reason: " << error.message << endl;
+    }
+    else if( selected > 0 ){
+        failed = ! mongoc_collection_remove( contextTable, MONGOC_REMOVE_NONE, & removeQuery, nullptr, & error );
+        if( failed ){
+            VS_LOG_ERROR << PRINT_HEADER << " batch delete failed, reason: " << error.message << endl;
+        }
+    }
+
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( & removeQuery );
+    bson_destroy( fields );
+    bson_destroy( query );
+
+    // only touched sessions leave memory
+    for( const TSessionNum sessionNum : sessions ){
+        if( m_trajectoryCache ){
+            m_trajectoryCache->invalidate( _persId, sessionNum );
+        }
+        if( m_prefetcher ){
+            m_prefetcher->invalidate( _persId, sessionNum );
+        }
+    }
+    if( m_sessionSummary && ! sessions.empty() ){
+        m_sessionSummary->invalidate( _persId );
+    }
+
+    return ( failed ? -1 : selected );
+}
+
+void DatabaseManagerBase::invalidatePayloadCaches( TPersistenceSetId _persId ){
+
+    if( m_trajectoryCache ){
+        m_trajectoryCache->invalidate( _persId );
+    }
+    if( m_prefetcher ){
+        m_prefetcher->invalidate( _persId );
+    }
+    if( m_sessionSummary ){
+        m_sessionSummary->invalidate( _persId );
+    }
+}
+
+int64_t DatabaseManagerBase::deleteExpiredPayload( const RetentionEngine::SRetentionCut & _cut, int32_t _batchSize ){
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    flushTrajectoryData( _cut.persId );
+
+    bson_t * query = nullptr;
+    if( common_vars::INVALID_SESSION_NUM == _cut.boundarySession ){
+        query = BCON_NEW( SESSION.c_str(), "{", "$lt", BCON_INT32(_cut.beforeSession), "}" );
+    }
+    else{
+        query = BCON_NEW( "$or", "[", "{", SESSION.c_str(), "{", "$lt", BCON_INT32(_cut.beforeSession), "}", "}",
+                                      "{", SESSION.c_str(), BCON_INT32(_cut.boundarySession),
+                                           ASTRO_TIME.c_str(), "{", "$lt", BCON_INT64(_cut.beforeAstroTimeMillisec), "}",
+                                      "}",
+                                 "]"
+                        );
+    }
+
+    const int64_t removed = removePayloadBatch( _cut.persId, query, _batchSize );
+    bson_destroy( query );
+    return removed;
+}
+
+bool DatabaseManagerBase::dropPersistenceSet( TPersistenceSetId _persId ){
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
+    if( ! contextTable ){
+        return false;
+    }
+
+    flushTrajectoryData( _persId );
+    invalidatePayloadCaches( _persId );
+
+    bson_error_t error;
+    if( ! mongoc_collection_drop( contextTable, & error ) ){
+        VS_LOG_WARN << PRINT_HEADER << " payload table drop failed, pers id [" << _persId << "] reason: " << error.message << endl;
+    }
+
+    deleteSessionDescription( _persId );
+    deletePersistenceSetMetadata( _persId );
+    m_bulkPolicies.removePolicy( _persId );
+    return true;
+}
+
+void DatabaseManagerBase::setRetentionPolicies( const std::vector<RetentionEngine::SRetentionPolicy> & _policies ){
+
+    if( m_retention ){
+        m_retention->setPolicies( _policies );
+    }
+}
+
+void DatabaseManagerBase::runRetention(){
+
+    if( m_retention ){
+        m_retention->runOnce();
+    }
+}
+
+RetentionEngine::SRetentionStats DatabaseManagerBase::getRetentionStats(){
+
+    if( ! m_retention ){
+        return RetentionEngine::SRetentionStats();
+    }
+
+    return m_retention->getStats();
+}
+
+TrajectorySubscriptions::TSubscriptionId DatabaseManagerBase::subscribeTrajectory( TPersistenceSetId _persId,
+                                                                                   const std::vector<TObjectId> & _objIds,
+                                                                                   TrajectorySubscriptions::TDeliverFunc _deliver ){
+
+    if( ! m_liveTail ){
+        VS_LOG_ERROR << PRINT_HEADER << " live tail is not enabled, pers id [" << _persId << "]" << endl;
+        return TrajectorySubscriptions::INVALID_SUBSCRIPTION_ID;
+    }
+
+    if( ! isPersistenceSetKnown(_persId) ){
+        VS_LOG_ERROR << PRINT_HEADER << " live tail on unknown pers id [" << _persId << "]" << endl;
+        return TrajectorySubscriptions::INVALID_SUBSCRIPTION_ID;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexChangeStreams );
+
+    const bool newChangeStream = ( m_settings.liveTailChangeStreams && m_changeStreams.find(_persId) == m_changeStreams.end() );
+    if( newChangeStream && m_settings.clientPoolMaxSize > 0 && m_settings.clientPoolMaxSize < getPinnedClientsCount(m_changeStreams.size() + 1) ){
+        VS_LOG_ERROR << PRINT_HEADER << " client pool max size [" << m_settings.clientPoolMaxSize << "]"
+                     << " has no client for change stream of pers id [" << _persId << "]"
+                     << endl;
+        return TrajectorySubscriptions::INVALID_SUBSCRIPTION_ID;
+    }
+
+    const TrajectorySubscriptions::TSubscriptionId id = m_liveTail->subscribe( _persId, _objIds, _deliver );
+    if( TrajectorySubscriptions::INVALID_SUBSCRIPTION_ID == id ){
+        return id;
+    }
+
+    // writes of other processes ( one watcher per set )
+    if( newChangeStream ){
+        SChangeStream * stream = new SChangeStream();
+        stream->thread = new std::thread( & DatabaseManagerBase::threadChangeStream, this, _persId, stream );
+        m_changeStreams.insert( {_persId, stream} );
+    }
+
+    return id;
+}
+
+void DatabaseManagerBase::unsubscribeTrajectory( TrajectorySubscriptions::TSubscriptionId _id ){
+
+    if( ! m_liveTail ){
+        return;
+    }
+
+    SChangeStream * stream = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( m_mutexChangeStreams );
+
+        TPersistenceSetId persId = common_vars::INVALID_PERS_ID;
+        if( ! m_liveTail->unsubscribe(_id, persId) || m_liveTail->hasSubscribers(persId) ){
+            return;
+        }
+
+        auto iter = m_changeStreams.find( persId );
+        if( iter != m_changeStreams.end() ){
+            stream = iter->second;
+            m_changeStreams.erase( iter );
+        }
+    }
+
+    // last subscriber of the set
+    if( stream ){
+        stopChangeStream( stream );
+    }
+}
+
+TrajectorySubscriptions::SLiveTailStats DatabaseManagerBase::getLiveTailStats(){
+
+    if( ! m_liveTail ){
+        return TrajectorySubscriptions::SLiveTailStats();
+    }
+
+    return m_liveTail->getStats();
+}
+
+bool DatabaseManagerBase::exportSnapshot( TPersistenceSetId _persId, const std::string & _path ){
+
+    PersistenceSnapshot::SExportSettings settings;
+    settings.storage = this;
+    settings.persId = _persId;
+    settings.path = _path;
+
+    return PersistenceSnapshot::exportSet( settings );
+}
+
+TPersistenceSetId DatabaseManagerBase::importSnapshot( const std::string & _path ){
+
+    PersistenceSnapshot::SImportSettings settings;
+    settings.storage = this;
+    settings.path = _path;
+    // one client can't be shared between writers
+    settings.threads = ( m_mongoClientPool ? std::max( m_settings.snapshotImportThreads, 1 ) : 1 );
+    // blocks go as unordered bulks directly, bypassing write-behind queue & live tail
+    settings.writeFunc = [ this ]( TPersistenceSetId _persId, const std::vector<SPersistenceTrajectory> & _data ){
+        return writeTrajectoryDataToStore( _persId, _data ) == _data.size();
+    };
+    settings.writerExitFunc = std::bind( & DatabaseManagerBase::releaseThreadHandles, this );
+
+    return PersistenceSnapshot::importSet( settings );
+}
+
+void DatabaseManagerBase::stopChangeStream( SChangeStream * _stream ){
+
+    _stream->stop.store( true );
+    common_utils::threadShutdown( _stream->thread );
+    delete _stream;
+}
+
+void DatabaseManagerBase::threadChangeStream( TPersistenceSetId _persId, SChangeStream * _stream ){
+
+    VS_LOG_INFO << PRINT_HEADER << " change stream thread of pers id [" << _persId << "] is STARTED" << endl;
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    // stop flag is checked at least once per await
+    constexpr int64_t CHANGE_STREAM_AWAIT_MILLISEC = 200;
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
+    const bool chunked = ( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_persId) );
+
+    const std::string originField = "fullDocument." + ORIGIN;
+    bson_t * pipeline = BCON_NEW( "pipeline", "[",
+                                    "{", "$match", "{",
+                                        "operationType", BCON_UTF8("insert"),
+                                        originField.c_str(), "{", "$ne", BCON_INT64(m_originId), "}",
+                                    "}", "}",
+                                  "]"
+                                );
+    bson_t * opts = BCON_NEW( "maxAwaitTimeMS", BCON_INT64(CHANGE_STREAM_AWAIT_MILLISEC) );
+
+    mongoc_change_stream_t * changeStream = mongoc_collection_watch( contextTable, pipeline, opts );
+
+    std::vector<SPersistenceTrajectory> points;
+    const bson_t * event = nullptr;
+    while( ! _stream->stop.load() ){
+
+        if( ! mongoc_change_stream_next(changeStream, & event) ){
+            bson_error_t error;
+            const bson_t * errorDoc = nullptr;
+            if( mongoc_change_stream_error_document(changeStream, & error, & errorDoc) ){
+                // e.g. standalone server - only local writes are delivered
+                VS_LOG_WARN << PRINT_HEADER << " change stream of pers id [" << _persId << "] is unavailable, reason: " << error.message << endl;
+                break;
+            }
+            continue;
+        }
+
+        bson_iter_t iter;
+        if( ! bson_iter_init_find( & iter, event, "fullDocument" ) || ! BSON_ITER_HOLDS_DOCUMENT( & iter ) ){
+            continue;
+        }
+
+        uint32_t docLen = 0;
+        const uint8_t * docData = nullptr;
+        bson_iter_document( & iter, & docLen, & docData );
+
+        bson_t doc;
+        if( ! bson_init_static( & doc, docData, docLen ) ){
+            continue;
+        }
+
+        // one event - one point or one step chunk
+        points.clear();
+        if( chunked ){
+            decodeTrajectoryChunk( & doc, points );
+        }
+        else{
+            BsonRecordDecoder<SPersistenceTrajectory>::decodeAppend( & doc, points );
+        }
+
+        if( ! points.empty() ){
+            m_liveTail->publish( _persId, points );
+        }
+    }
+
+    mongoc_change_stream_destroy( changeStream );
+    bson_destroy( opts );
+    bson_destroy( pipeline );
+    releaseThreadHandles();
+
+    VS_LOG_INFO << PRINT_HEADER << " change stream thread of pers id [" << _persId << "] go to EXIT" << endl;
+}
+
+void DatabaseManagerBase::deleteTotalData( const common_types::TContextId _ctxId ){
+
+    // get persistenceId of this contextId
+    const vector<SPersistenceMetadata> metadatas = getPersistenceSetMetadata( _ctxId );
+    for( const SPersistenceMetadata & meta : metadatas ){
+        for( const SPersistenceMetadataDSS & metaDSS : meta.persistenceFromDSS ){
+            deleteDataRange( SPersistenceSetFilter(metaDSS.persistenceSetId) );
+        }
+
+        for( const SPersistenceMetadataRaw & metaRaw : meta.persistenceFromRaw ){
+            deleteDataRange( SPersistenceSetFilter(metaRaw.persistenceSetId) );
+        }
+
+        for( const SPersistenceMetadataVideo & metaVideo : meta.persistenceFromVideo ){
+            deleteDataRange( SPersistenceSetFilter(metaVideo.persistenceSetId) );
+        }
+    }
+}
+
+bool DatabaseManagerBase::writeWeatherData( TPersistenceSetId _persId, const std::vector<SPersistenceWeather> & _data ){
+
+    return writePayloadToStore( _persId, _data );
+}
+
+std::vector<common_types::SPersistenceWeather> DatabaseManagerBase::readWeatherData( const common_types::SPersistenceSetFilter & _filter ){
+
+    return readPayloadFromStore<SPersistenceWeather>( _filter );
+}
+
+// schema-described payload ( see payload_schema.h ), one document per record
+template< typename T_Record >
+bool DatabaseManagerBase::writePayloadToStore( TPersistenceSetId _persId, const std::vector<T_Record> & _data ){
+
+    if( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_persId) ){
+        VS_LOG_ERROR << PRINT_HEADER << " chunked layout is supported only for trajectory, pers id: " << _persId << endl;
+        return false;
+    }
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
+    if( ! contextTable ){
+        return false;
+    }
+
+    size_t begin = 0;
+    while( begin < _data.size() ){
+        int32_t bulkSize = 0;
+        const BulkWritePolicies::SWritePolicy policy = m_bulkPolicies.getPolicy( _persId, bulkSize );
+        const size_t count = std::min<size_t>( bulkSize, _data.size() - begin );
+
+        mongoc_bulk_operation_t * bulkedWrite = createPayloadBulk( contextTable, policy );
+        PayloadCodec<T_Record>::appendBulk( bulkedWrite, _data.data() + begin, count );
+
+        if( ! executePayloadBulk(_persId, bulkedWrite, count) ){
+            break;
+        }
+
+        // committed bulk stays in store even if the next one fails ( as in trajectory write )
+        if( m_sessionSummary ){
+            if( count == _data.size() ){
+                m_sessionSummary->update( _persId, _data );
+            }
+            else{
+                m_sessionSummary->update( _persId, std::vector<T_Record>(_data.begin() + begin, _data.begin() + begin + count) );
+            }
+        }
+        begin += count;
+    }
+
+    if( m_sessionSummary && begin > 0 ){
+        flushSessionDescriptions( _persId, false );
+    }
+    return begin == _data.size();
+}
+
+template< typename T_Record >
+std::vector<T_Record> DatabaseManagerBase::readPayloadFromStore( const SPersistenceSetFilter & _filter ){
+
+    std::vector<T_Record> out;
+
+    if( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_filter.persistenceSetId) ){
+        VS_LOG_ERROR << PRINT_HEADER << " chunked layout is supported only for trajectory, pers id: " << _filter.persistenceSetId << endl;
+        return out;
     }
 
-    bson_destroy( query );
-}
+    mongoc_collection_t * contextTable = getPayloadTableRef( _filter.persistenceSetId );
 
-void DatabaseManagerBase::deleteTotalData( const common_types::TContextId _ctxId ){
+    // no coordinates in this payload
+    SPersistenceSetFilter filter = _filter;
+    filter.boundingBox = SGeoBoundingBox();
+    bson_t * query = makeTrajectoryQuery( filter );
 
-    // get persistenceId of this contextId
-    const vector<SPersistenceMetadata> metadatas = getPersistenceSetMetadata( _ctxId );
-    for( const SPersistenceMetadata & meta : metadatas ){
-        for( const SPersistenceMetadataDSS & metaDSS : meta.persistenceFromDSS ){
-            deleteDataRange( SPersistenceSetFilter(metaDSS.persistenceSetId) );
-        }
+    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        0,
+                                                        1000000,
+                                                        query,
+                                                        nullptr,
+                                                        nullptr );
 
-        for( const SPersistenceMetadataRaw & metaRaw : meta.persistenceFromRaw ){
-            deleteDataRange( SPersistenceSetFilter(metaRaw.persistenceSetId) );
-        }
+    out.reserve( estimateRecordsCount(_filter) );
 
-        for( const SPersistenceMetadataVideo & metaVideo : meta.persistenceFromVideo ){
-            deleteDataRange( SPersistenceSetFilter(metaVideo.persistenceSetId) );
-        }
+    const bson_t * doc;
+    while( mongoc_cursor_next( cursor, & doc ) ){
+        BsonRecordDecoder<T_Record>::decodeAppend( doc, out );
     }
-}
 
-bool DatabaseManagerBase::writeWeatherData( TPersistenceSetId _persId, const std::vector<SPersistenceWeather> & _data ){
+    bson_error_t error;
+    if( mongoc_cursor_error( cursor, & error ) ){
+        VS_LOG_ERROR << PRINT_HEADER << " payload read failed, pers id: " << _filter.persistenceSetId << " reason: " << error.message << endl;
+    }
 
-    assert( false && "TODO: do" );
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( query );
 
-    return true;
+    return out;
 }
 
-std::vector<common_types::SPersistenceWeather> DatabaseManagerBase::readWeatherData( const common_types::SPersistenceSetFilter & _filter ){
+template< typename T_Record >
+std::shared_ptr<PersistenceCursor<T_Record>> DatabaseManagerBase::openPayloadCursor( const SPersistenceSetFilter & _filter, int32_t _batchSize ){
+
+    if( EPersistenceStorageLayout::CHUNK_PER_STEP == getStorageLayout(_filter.persistenceSetId) ){
+        VS_LOG_ERROR << PRINT_HEADER << " chunked layout is supported only for trajectory, pers id: " << _filter.persistenceSetId << endl;
+        return nullptr;
+    }
 
-    std::vector<common_types::SPersistenceWeather> out;
+    mongoc_collection_t * contextTable = getPayloadTableRef( _filter.persistenceSetId );
+    assert( contextTable );
 
-    assert( false && "TODO: do" );
+    // no coordinates in this payload
+    SPersistenceSetFilter filter = _filter;
+    filter.boundingBox = SGeoBoundingBox();
+    bson_t * query = makeTrajectoryQuery( filter );
 
-    return out;
+    // NOTE: server batch equals to client batch -> one network round trip per consumer batch
+    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        0,
+                                                        _batchSize,
+                                                        query,
+                                                        nullptr,
+                                                        nullptr );
+
+    return std::make_shared<PersistenceCursor<T_Record>>( cursor, query, _batchSize, & BsonRecordDecoder<T_Record>::decodeAppend );
 }
 
 // -------------------------------------------------------------------------------------
@@ -466,7 +2261,8 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
             + string("video_")
             + convertDataTypeToStr(_videoMetadata.dataType) + string("_")
             + string("sensor")
-            + std::to_string(_videoMetadata.recordedFromSensorId);
+            + std::to_string(_videoMetadata.recordedFromSensorId)
+            + makeStorageLayoutSuffix(_videoMetadata.storageLayout);
 
     // update existing PersistenceId ( if it valid of course )
     if( _videoMetadata.persistenceSetId != SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID ){
@@ -474,6 +2270,7 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
         if( isPersistenceMetadataValid(_videoMetadata.persistenceSetId, _videoMetadata) ){
             writePersistenceMetadataGlobal( _videoMetadata.persistenceSetId, payloadTableName, _videoMetadata );
             writePersistenceFromVideo( _videoMetadata );
+            m_metadataCatalog.put( _videoMetadata );
 
             return _videoMetadata.persistenceSetId;
         }
@@ -484,10 +2281,20 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
     // create new persistence record
     else{
         const TPersistenceSetId persId = createNewPersistenceId();
+        if( SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID == persId ){
+            return SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+        }
+
+        SPersistenceMetadataVideo metadata = _videoMetadata;
+        metadata.persistenceSetId = persId;
 
-        writePersistenceMetadataGlobal( persId, payloadTableName, _videoMetadata );
-        writePersistenceFromVideo( _videoMetadata );
-        createPayloadTableRef( persId, payloadTableName );
+        writePersistenceMetadataGlobal( persId, payloadTableName, metadata );
+        writePersistenceFromVideo( metadata );
+        m_metadataCatalog.put( metadata );
+        createPayloadTableRef( persId, payloadTableName, _videoMetadata.storageLayout, _videoMetadata.dataType );
+        if( m_trajectoryCache ){
+            m_trajectoryCache->markSetAuthoritative( persId );
+        }
 
         return persId;
     }
@@ -501,8 +2308,8 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
             + string("ctx")
             + std::to_string(_dssMetadata.contextId)
             + string("_mission")
-            + std::to_string(_dssMetadata.missionId);
-            + (_dssMetadata.realData ? "_real" : "_simula");
+            + std::to_string(_dssMetadata.missionId)
+            + makeStorageLayoutSuffix(_dssMetadata.storageLayout);
 
     // update existing PersistenceId ( if it valid of course )
     if( _dssMetadata.persistenceSetId != SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID ){
@@ -510,6 +2317,7 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
         if( isPersistenceMetadataValid(_dssMetadata.persistenceSetId, _dssMetadata) ){
             writePersistenceMetadataGlobal( _dssMetadata.persistenceSetId, payloadTableName, _dssMetadata );
             writePersistenceFromDSS( _dssMetadata );
+            m_metadataCatalog.put( _dssMetadata );
 
             return _dssMetadata.persistenceSetId;
         }
@@ -520,10 +2328,20 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
     // create new persistence record
     else{
         const TPersistenceSetId persId = createNewPersistenceId();
+        if( SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID == persId ){
+            return SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+        }
+
+        SPersistenceMetadataDSS metadata = _dssMetadata;
+        metadata.persistenceSetId = persId;
 
-        writePersistenceMetadataGlobal( persId, payloadTableName, _dssMetadata );
-        writePersistenceFromDSS( _dssMetadata );
-        createPayloadTableRef( persId, payloadTableName );
+        writePersistenceMetadataGlobal( persId, payloadTableName, metadata );
+        writePersistenceFromDSS( metadata );
+        m_metadataCatalog.put( metadata );
+        createPayloadTableRef( persId, payloadTableName, _dssMetadata.storageLayout, _dssMetadata.dataType );
+        if( m_trajectoryCache ){
+            m_trajectoryCache->markSetAuthoritative( persId );
+        }
 
         return persId;
     }
@@ -537,7 +2355,8 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
             + string("ctx")
             + std::to_string(_rawMetadata.contextId)
             + string("_mission")
-            + std::to_string(_rawMetadata.missionId);
+            + std::to_string(_rawMetadata.missionId)
+            + makeStorageLayoutSuffix(_rawMetadata.storageLayout);
 
     // update existing PersistenceId ( if it valid of course )
     if( _rawMetadata.persistenceSetId != common_vars::INVALID_PERS_ID ){
@@ -545,6 +2364,7 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
         if( isPersistenceMetadataValid(_rawMetadata.persistenceSetId, _rawMetadata) ){
             writePersistenceMetadataGlobal( _rawMetadata.persistenceSetId, payloadTableName, _rawMetadata );
             writePersistenceFromRaw( _rawMetadata );
+            m_metadataCatalog.put( _rawMetadata );
 
             return _rawMetadata.persistenceSetId;
         }
@@ -555,10 +2375,20 @@ TPersistenceSetId DatabaseManagerBase::writePersistenceSetMetadata( const common
     // create new persistence record
     else{
         const TPersistenceSetId persId = createNewPersistenceId();
+        if( SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID == persId ){
+            return SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+        }
+
+        SPersistenceMetadataRaw metadata = _rawMetadata;
+        metadata.persistenceSetId = persId;
 
-        writePersistenceMetadataGlobal( persId, payloadTableName, _rawMetadata );
-        writePersistenceFromRaw( _rawMetadata );
-        createPayloadTableRef( persId, payloadTableName );
+        writePersistenceMetadataGlobal( persId, payloadTableName, metadata );
+        writePersistenceFromRaw( metadata );
+        m_metadataCatalog.put( metadata );
+        createPayloadTableRef( persId, payloadTableName, _rawMetadata.storageLayout, _rawMetadata.dataType );
+        if( m_trajectoryCache ){
+            m_trajectoryCache->markSetAuthoritative( persId );
+        }
 
         return persId;
     }
@@ -586,10 +2416,11 @@ void DatabaseManagerBase::writePersistenceMetadataGlobal( const common_types::TP
             mongo_fields::persistence_set_metadata::SOURCE_TYPE.c_str(), BCON_UTF8( common_utils::convertPersistenceTypeToStr(_meta.sourceType).c_str() ),
             mongo_fields::persistence_set_metadata::DATA_TYPE.c_str(), BCON_UTF8( convertDataTypeToStr(_meta.dataType).c_str() ),
             mongo_fields::persistence_set_metadata::PAYLOAD_TABLE_NAME.c_str(), BCON_UTF8( _payloadTableName.c_str() ),
+            mongo_fields::persistence_set_metadata::STORAGE_LAYOUT.c_str(), BCON_UTF8( convertStorageLayoutToStr(_meta.storageLayout).c_str() ),
                             "}" );
 
     bson_error_t error;
-    const bool rt = mongoc_collection_update( m_tablePersistenceMetadata,
+    const bool rt = mongoc_collection_update( handles().tablePersistenceMetadata,
                                   MONGOC_UPDATE_UPSERT,
                                   query,
                                   update,
@@ -616,7 +2447,7 @@ void DatabaseManagerBase::writePersistenceFromVideo( const common_types::SPersis
             "}" );
 
     bson_error_t error;
-    const bool rt = mongoc_collection_update( m_tablePersistenceFromVideo,
+    const bool rt = mongoc_collection_update( handles().tablePersistenceFromVideo,
                                   MONGOC_UPDATE_UPSERT,
                                   query,
                                   update,
@@ -643,7 +2474,7 @@ void DatabaseManagerBase::writePersistenceFromDSS( const common_types::SPersiste
             "}" );
 
     bson_error_t error;
-    const bool rt = mongoc_collection_update( m_tablePersistenceFromDSS,
+    const bool rt = mongoc_collection_update( handles().tablePersistenceFromDSS,
                                   MONGOC_UPDATE_UPSERT,
                                   query,
                                   update,
@@ -670,246 +2501,79 @@ void DatabaseManagerBase::writePersistenceFromRaw( const common_types::SPersiste
 // persistence read
 std::vector<SPersistenceMetadata> DatabaseManagerBase::getPersistenceSetMetadata( common_types::TContextId _ctxId ){
 
-//    bson_t * query = nullptr;
-//    bson_t * sortOrder = nullptr;
-//    if( _ctxId == common_vars::ALL_CONTEXT_ID ){
-//        query = BCON_NEW( nullptr );
-//        sortOrder = BCON_NEW( "sort", "{", mongo_fields::persistence_set_metadata::CTX_ID.c_str(), BCON_INT32 (-1), "}" );
-//    }
-//    else{
-//        query = BCON_NEW( mongo_fields::persistence_set_metadata::CTX_ID.c_str(), BCON_INT32( _ctxId ));
-//        sortOrder = BCON_NEW( nullptr );
-//    }
-
-//    mongoc_cursor_t * cursor = mongoc_collection_find_with_opts( m_tablePersistenceDescr,
-//                                                                 query,
-//                                                                 sortOrder,
-//                                                                 nullptr );
-
-    bson_t * query = nullptr;
-    if( _ctxId == common_vars::ALL_CONTEXT_ID ){
-        query = BCON_NEW( "$query", "{", "}",
-                          "$orderby", "{", mongo_fields::persistence_set_metadata::CTX_ID.c_str(), BCON_INT32 (-1), "}" );
-    }
-    else{
-        query = BCON_NEW( "$query", "{", mongo_fields::persistence_set_metadata::CTX_ID.c_str(), BCON_INT32( _ctxId ), "}" );
-    }
-
-    mongoc_cursor_t * cursor = mongoc_collection_find( m_tablePersistenceMetadata,
-            MONGOC_QUERY_NONE,
-            0,
-            0,
-            0,
-            query,
-            nullptr,
-            nullptr );
-
-    std::vector<common_types::SPersistenceMetadata> out;
-    TContextId currentCtxId = 0;
-    int currentStoreIdx = -1;
-
-    const bson_t * doc;
-    while( mongoc_cursor_next( cursor, & doc ) ){
-
-        uint len;
-        bson_iter_t iter;
-
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::SOURCE_TYPE.c_str() );
-        const common_types::EPersistenceSourceType persType = common_utils::convertPersistenceTypeFromStr( bson_iter_utf8( & iter, & len ) );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::DATA_TYPE.c_str() );
-        const EPersistenceDataType dataType = convertDataTypeFromStr( bson_iter_utf8( & iter, & len ) );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::CTX_ID.c_str() );
-        const TContextId ctxId = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::MISSION_ID.c_str() );
-        const TMissionId missionId = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::UPDATE_STEP_MILLISEC.c_str() );
-        const int64_t updateStepMillisec = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::LAST_SESSION_ID.c_str() );
-        const TSessionNum sessionNum = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str() );
-        const TPersistenceSetId persId = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::PAYLOAD_TABLE_NAME.c_str() );
-        const std::string payloadTableName = bson_iter_utf8( & iter, & len );
-
-        //
-        if( ctxId != currentCtxId ){
-            currentCtxId = ctxId;
-            out.resize( out.size() + 1 );
-            currentStoreIdx++;
-        }
-
-        //
-        switch( persType ){
-        case common_types::EPersistenceSourceType::VIDEO_SERVER : {
-
-
-            break;
-        }
-        case common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER : {
-            common_types::SPersistenceMetadata & currentCtxMetadata = out[ currentStoreIdx ];
-            currentCtxMetadata.persistenceFromRaw.resize( currentCtxMetadata.persistenceFromRaw.size() + 1 );
-            common_types::SPersistenceMetadataRaw & currentRawMetadata = currentCtxMetadata.persistenceFromRaw.back();
-
-            // video specific parameters
-            const bool rt = getPersistenceFromRaw( persId, currentRawMetadata );
-
-            // global parameters
-            currentRawMetadata.persistenceSetId = persId;
-            currentRawMetadata.contextId = ctxId;
-            currentRawMetadata.missionId = missionId;
-            currentRawMetadata.timeStepIntervalMillisec = updateStepMillisec;
-            currentRawMetadata.lastRecordedSession = sessionNum;
-            currentRawMetadata.sourceType = persType;
-            currentRawMetadata.dataType = dataType;
-            // ...
-
-            break;
-        }
-        case common_types::EPersistenceSourceType::DSS : {
-
-            break;
-        }
-        default : {
-
-        }
-        }
-    }
-
-    mongoc_cursor_destroy( cursor );
-    bson_destroy( query );
-
-    return out;
+    // NOTE: catalog is loaded on init and follows every write / delete of this instance
+    return m_metadataCatalog.getByContext( _ctxId );
 }
 
 common_types::SPersistenceMetadata DatabaseManagerBase::getPersistenceSetMetadata( common_types::TPersistenceSetId _persId ){
 
-    // make query
-//    bson_t * query = BCON_NEW( mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str(), BCON_INT32( _persId ));
-
-//    mongoc_cursor_t * cursor = mongoc_collection_find_with_opts( m_tablePersistenceDescr,
-//                                                                 query,
-//                                                                 nullptr,
-//                                                                 nullptr );
-    bson_t * query = BCON_NEW( "$query", "{", mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str(), BCON_INT32( _persId ), "}" );
-
-    mongoc_cursor_t * cursor = mongoc_collection_find( m_tablePersistenceMetadata,
-            MONGOC_QUERY_NONE,
-            0,
-            0,
-            0,
-            query,
-            nullptr,
-            nullptr );
+    return m_metadataCatalog.get( _persId );
+}
 
-    // check
-    if( ! mongoc_cursor_more( cursor ) ){
-        return common_types::SPersistenceMetadata();
-    }
+bool DatabaseManagerBase::getPersistenceFromVideo( common_types::TPersistenceSetId _persId,
+                                                   SPersistenceMetadataVideo & _meta ){
 
-    // read
-    common_types::SPersistenceMetadata out;
+    // query
+    bson_t * query = BCON_NEW( mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str(), BCON_INT64( _persId ) );
+    mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tablePersistenceFromVideo,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        1,
+                                                        0,
+                                                        query,
+                                                        nullptr,
+                                                        nullptr );
 
+    // get data
     const bson_t * doc;
-    while( mongoc_cursor_next( cursor, & doc ) ){
-
-        uint len;
+    const bool found = mongoc_cursor_next( cursor, & doc );
+    if( found ){
         bson_iter_t iter;
-
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::SOURCE_TYPE.c_str() );
-        const common_types::EPersistenceSourceType persType = common_utils::convertPersistenceTypeFromStr( bson_iter_utf8( & iter, & len ) );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::CTX_ID.c_str() );
-        const TContextId ctxId = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::MISSION_ID.c_str() );
-        const TMissionId missionId = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::UPDATE_STEP_MILLISEC.c_str() );
-        const int64_t updateStepMillisec = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::LAST_SESSION_ID.c_str() );
-        const TSessionNum sessionNum = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str() );
-        const TPersistenceSetId persId = bson_iter_int64( & iter );
-
-        // only ONE of this types will be appear
-        switch( persType ){
-        case common_types::EPersistenceSourceType::VIDEO_SERVER : {
-            // TODO: do
-            break;
-        }
-        case common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER : {
-            out.persistenceFromRaw.resize( out.persistenceFromRaw.size() + 1 );
-            common_types::SPersistenceMetadataRaw & currentRawMetadata = out.persistenceFromRaw.back();
-
-            // raw specific parameters
-            const bool rt = getPersistenceFromRaw( persId, currentRawMetadata );
-
-            // global parameters
-            currentRawMetadata.persistenceSetId = persId;
-            currentRawMetadata.contextId = ctxId;
-            currentRawMetadata.missionId = missionId;
-            currentRawMetadata.timeStepIntervalMillisec = updateStepMillisec;
-            currentRawMetadata.lastRecordedSession = sessionNum;
-            currentRawMetadata.sourceType = persType;
-            // ...
-
-            break;
-        }
-        case common_types::EPersistenceSourceType::DSS : {
-            // TODO: do
-            break;
-        }
-        default : {
-
-        }
+        if( bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata_video::SENSOR_ID.c_str() ) ){
+            _meta.recordedFromSensorId = bson_iter_as_int64( & iter );
         }
     }
+    else{
+        VS_LOG_ERROR << PRINT_HEADER << " such persistence id (video) not found: " << _persId << endl;
+    }
 
     mongoc_cursor_destroy( cursor );
     bson_destroy( query );
 
-    return out;
+    return found;
 }
 
-bool DatabaseManagerBase::getPersistenceFromVideo( common_types::TPersistenceSetId _persId,
-                                                   SPersistenceMetadataVideo & _meta ){
+bool DatabaseManagerBase::getPersistenceFromDSS( common_types::TPersistenceSetId _persId,
+                                                 common_types::SPersistenceMetadataDSS & _meta ){
 
     // query
-    bson_t * query = BCON_NEW( mongo_fields::persistence_set_metadata::PERSISTENCE_ID, BCON_INT32( _persId ) );
-    mongoc_cursor_t * cursor = mongoc_collection_find(  m_tablePersistenceFromVideo,
+    bson_t * query = BCON_NEW( mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str(), BCON_INT64( _persId ) );
+    mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tablePersistenceFromDSS,
                                                         MONGOC_QUERY_NONE,
                                                         0,
+                                                        1,
                                                         0,
-                                                        1000000, // 10000 ~= inf
                                                         query,
                                                         nullptr,
                                                         nullptr );
 
-    // check existence
-    if( ! mongoc_cursor_more(cursor) ){
-        VS_LOG_ERROR << PRINT_HEADER << " such persistence id (video) not found: " << _persId << endl;
-        return false;
-    }
-
     // get data
     const bson_t * doc;
-    while( mongoc_cursor_next( cursor, & doc ) ){
-
-        uint len;
+    const bool found = mongoc_cursor_next( cursor, & doc );
+    if( found ){
         bson_iter_t iter;
-
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata_video::SENSOR_ID.c_str() );
-        _meta.recordedFromSensorId = bson_iter_int32( & iter );
+        if( bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_metadata_dss::REAL.c_str() ) ){
+            _meta.realData = bson_iter_as_bool( & iter );
+        }
+    }
+    else{
+        VS_LOG_ERROR << PRINT_HEADER << " such persistence id (dss) not found: " << _persId << endl;
     }
 
     mongoc_cursor_destroy( cursor );
     bson_destroy( query );
 
-    return true;
-}
-
-bool DatabaseManagerBase::getPersistenceFromDSS( common_types::TPersistenceSetId _persId,
-                                                 common_types::SPersistenceMetadataDSS & _meta ){
-
-
-
+    return found;
 }
 
 bool DatabaseManagerBase::getPersistenceFromRaw( common_types::TPersistenceSetId _persId,
@@ -943,12 +2607,14 @@ void DatabaseManagerBase::deletePersistenceSetMetadata( common_types::TPersisten
     bson_t * query = BCON_NEW( mongo_fields::persistence_set_metadata::PERSISTENCE_ID.c_str(), BCON_INT64(_id) );
 
     bson_error_t error;
-    const bool result = mongoc_collection_remove( m_tablePersistenceMetadata, MONGOC_REMOVE_NONE, query, nullptr, & error );
+    const bool result = mongoc_collection_remove( handles().tablePersistenceMetadata, MONGOC_REMOVE_NONE, query, nullptr, & error );
     if( ! result ){
         VS_LOG_ERROR << PRINT_HEADER << " persistence id deleting failed, reason: " << error.message << endl;
     }
 
     bson_destroy( query );
+    m_metadataCatalog.removeSet( _id );
+    forgetPayloadTable( _id );
 }
 
 void DatabaseManagerBase::deletePersistenceSetMetadata( common_types::TContextId _ctxId ){
@@ -958,14 +2624,17 @@ void DatabaseManagerBase::deletePersistenceSetMetadata( common_types::TContextId
     for( const SPersistenceMetadata & meta : metadatas ){
         for( const SPersistenceMetadataDSS & metaDSS : meta.persistenceFromDSS ){
             deletePersistenceFromDSS( metaDSS.persistenceSetId );
+            forgetPayloadTable( metaDSS.persistenceSetId );
         }
 
         for( const SPersistenceMetadataRaw & metaRaw : meta.persistenceFromRaw ){
             deletePersistenceFromRaw( metaRaw.persistenceSetId );
+            forgetPayloadTable( metaRaw.persistenceSetId );
         }
 
         for( const SPersistenceMetadataVideo & metaVideo : meta.persistenceFromVideo ){
             deletePersistenceFromVideo( metaVideo.persistenceSetId );
+            forgetPayloadTable( metaVideo.persistenceSetId );
         }
     }
 
@@ -973,12 +2642,13 @@ void DatabaseManagerBase::deletePersistenceSetMetadata( common_types::TContextId
     bson_t * query = BCON_NEW( mongo_fields::persistence_set_metadata::CTX_ID.c_str(), BCON_INT32(_ctxId) );
 
     bson_error_t error;
-    const bool result = mongoc_collection_remove( m_tablePersistenceMetadata, MONGOC_REMOVE_NONE, query, nullptr, & error );
+    const bool result = mongoc_collection_remove( handles().tablePersistenceMetadata, MONGOC_REMOVE_NONE, query, nullptr, & error );
     if( ! result ){
         VS_LOG_ERROR << PRINT_HEADER << " context id deleting failed, reason: " << error.message << endl;
     }
 
     bson_destroy( query );
+    m_metadataCatalog.removeContext( _ctxId );
 }
 
 void DatabaseManagerBase::deletePersistenceFromRaw( common_types::TPersistenceSetId _persId ){
@@ -999,33 +2669,85 @@ void DatabaseManagerBase::deletePersistenceFromVideo( common_types::TPersistence
 // persistence utils
 bool DatabaseManagerBase::isPersistenceMetadataValid( common_types::TPersistenceSetId _persId, const common_types::SPersistenceMetadataDescr & _meta ){
 
-    // for instance: forbid CtxId changing
+    SPersistenceMetadataDescr storedMeta;
+    if( ! m_metadataCatalog.getDescr(_persId, storedMeta) ){
+        VS_LOG_ERROR << PRINT_HEADER << " such persistence id not found in global metadata: " << _persId << endl;
+        return false;
+    }
 
-    const SPersistenceMetadata metadata = getPersistenceSetMetadata( _persId );
+    // set can't move to another context / source, layout defines its payload table
+    if( storedMeta.contextId != _meta.contextId
+            || storedMeta.sourceType != _meta.sourceType
+            || storedMeta.storageLayout != _meta.storageLayout ){
+        VS_LOG_ERROR << PRINT_HEADER << " forbidden change of persistence id: " << _persId
+                     << " (context, source type and storage layout are immutable)"
+                     << endl;
+        return false;
+    }
 
+    return true;
+}
 
+common_types::TPersistenceSetId DatabaseManagerBase::createNewPersistenceId(){
 
-    VS_LOG_ERROR << PRINT_HEADER << " such persistence id not found in global metadata" << endl;
+    // NOTE: one atomic round trip, safe for several instances over the same database
+    bson_t * query = BCON_NEW( "_id", BCON_UTF8( mongo_fields::persistence_set_counter::PERSISTENCE_ID_KEY.c_str() ) );
+    bson_t * update = BCON_NEW( "$inc", "{", mongo_fields::persistence_set_counter::SEQ.c_str(), BCON_INT64( 1 ), "}" );
 
+    bson_t reply;
+    bson_error_t error;
+    const bool rt = mongoc_collection_find_and_modify( handles().tablePersistenceCounter,
+                                                       query,
+                                                       nullptr,
+                                                       update,
+                                                       nullptr,
+                                                       false, // remove
+                                                       true, // upsert
+                                                       true, // return new
+                                                       & reply,
+                                                       & error );
+
+    TPersistenceSetId newId = SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+    if( rt ){
+        bson_iter_t iter;
+        bson_iter_t value;
+        if( bson_iter_init_find( & iter, & reply, "value" )
+                && BSON_ITER_HOLDS_DOCUMENT( & iter )
+                && bson_iter_recurse( & iter, & value )
+                && bson_iter_find( & value, mongo_fields::persistence_set_counter::SEQ.c_str() ) ){
+            newId = bson_iter_as_int64( & value );
+        }
+    }
+    else{
+        VS_LOG_ERROR << PRINT_HEADER << " persistence id allocation failed, reason: " << error.message << endl;
+    }
 
+    bson_destroy( & reply );
+    bson_destroy( query );
+    bson_destroy( update );
 
-    return true;
+    return newId;
 }
 
-common_types::TPersistenceSetId DatabaseManagerBase::createNewPersistenceId(){
+void DatabaseManagerBase::seedPersistenceIdCounter( common_types::TPersistenceSetId _maxExistingId ){
 
-    const vector<SPersistenceMetadata> metadatas = getPersistenceSetMetadata();
-    if( ! metadatas.empty() ){
-        TPersistenceSetId newId = SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+    bson_t * query = BCON_NEW( "_id", BCON_UTF8( mongo_fields::persistence_set_counter::PERSISTENCE_ID_KEY.c_str() ) );
+    bson_t * update = BCON_NEW( "$max", "{", mongo_fields::persistence_set_counter::SEQ.c_str(), BCON_INT64( _maxExistingId ), "}" );
 
-        // WTF?
+    bson_error_t error;
+    const bool rt = mongoc_collection_update( handles().tablePersistenceCounter,
+                                              MONGOC_UPDATE_UPSERT,
+                                              query,
+                                              update,
+                                              NULL,
+                                              & error );
 
-        return newId;
-    }
-    else{
-        const TPersistenceSetId newId = 1;
-        return newId;
+    if( ! rt ){
+        VS_LOG_ERROR << PRINT_HEADER << " persistence id counter seed failed, reason: " << error.message << endl;
     }
+
+    bson_destroy( query );
+    bson_destroy( update );
 }
 
 bool DatabaseManagerBase::insertSessionDescription( const TPersistenceSetId _persId, const SEventsSessionInfo & _descr ){
@@ -1033,7 +2755,7 @@ bool DatabaseManagerBase::insertSessionDescription( const TPersistenceSetId _per
     // ----------------------------------------------------------------------------------------------
     // make shure that session num is not exist
     // ----------------------------------------------------------------------------------------------
-    if( isSessionExistInDescription(_descr.number) ){
+    if( isSessionExistInDescription(_persId, _descr.number) ){
         VS_LOG_ERROR << PRINT_HEADER << " insert description failed, such session num [" << _descr.number << "] ALREADY exist" << endl;
         return false;
     }
@@ -1052,7 +2774,7 @@ bool DatabaseManagerBase::insertSessionDescription( const TPersistenceSetId _per
                            );
 
     bson_error_t error;
-    const bool rt = mongoc_collection_insert( m_tablePersistenceDescription,
+    const bool rt = mongoc_collection_insert( handles().tablePersistenceDescription,
                                               MONGOC_INSERT_NONE,
                                               doc,
                                               NULL,
@@ -1073,7 +2795,7 @@ bool DatabaseManagerBase::updateSessionDescription( const TPersistenceSetId _per
     // ----------------------------------------------------------------------------------------------
     // check that session num exist
     // ----------------------------------------------------------------------------------------------
-    if( ! isSessionExistInDescription(_descr.number) ){
+    if( ! isSessionExistInDescription(_persId, _descr.number) ){
         VS_LOG_ERROR << PRINT_HEADER << " update description failed, such session num [" << _descr.number << "] is NOT exist" << endl;
         return false;
     }
@@ -1081,7 +2803,8 @@ bool DatabaseManagerBase::updateSessionDescription( const TPersistenceSetId _per
     // ----------------------------------------------------------------------------------------------
     // udpate steps
     // ----------------------------------------------------------------------------------------------
-    bson_t * query = BCON_NEW( mongo_fields::persistence_set_description::SESSION_NUM.c_str(), BCON_INT32( _descr.number ) );
+    bson_t * query = BCON_NEW( mongo_fields::persistence_set_description::PERSISTENCE_ID.c_str(), BCON_INT64( _persId ),
+                               mongo_fields::persistence_set_description::SESSION_NUM.c_str(), BCON_INT32( _descr.number ) );
     bson_t * update = BCON_NEW( "$set", "{",
                                 mongo_fields::persistence_set_description::PERSISTENCE_ID.c_str(), BCON_INT64( _persId ),
                                 mongo_fields::persistence_set_description::SESSION_NUM.c_str(), BCON_INT32( _descr.number ),
@@ -1094,7 +2817,7 @@ bool DatabaseManagerBase::updateSessionDescription( const TPersistenceSetId _per
                               "}" );
 
     bson_error_t error;
-    const bool rt = mongoc_collection_update( m_tablePersistenceDescription,
+    const bool rt = mongoc_collection_update( handles().tablePersistenceDescription,
                                   MONGOC_UPDATE_NONE,
                                   query,
                                   update,
@@ -1117,7 +2840,7 @@ vector<SEventsSessionInfo> DatabaseManagerBase::selectSessionDescriptions( const
 
     bson_t * query = BCON_NEW( mongo_fields::persistence_set_description::PERSISTENCE_ID.c_str(), BCON_INT64( _persId ));
 
-    mongoc_cursor_t * cursor = mongoc_collection_find(  m_tablePersistenceDescription,
+    mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tablePersistenceDescription,
                                                         MONGOC_QUERY_NONE,
                                                         0,
                                                         0,
@@ -1129,389 +2852,341 @@ vector<SEventsSessionInfo> DatabaseManagerBase::selectSessionDescriptions( const
     std::vector<SEventsSessionInfo> out;
     const bson_t * doc;
     while( mongoc_cursor_next( cursor, & doc ) ){
+        BsonRecordDecoder<SEventsSessionInfo>::decodeAppend( doc, out );
+    }
+
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( query );
+
+    return out;
+}
+
+bool DatabaseManagerBase::findBoundarySession( const TPersistenceSetId _persId, const bool _first, TSessionNum & _sessionNum ){
+
+    flushTrajectoryData( _persId );
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
+    assert( contextTable );
+
+    // ( session, logic_time ) index gives first/last session without scan
+    bson_t * query = BCON_NEW( "$query", "{", "}",
+                               "$orderby", "{", mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32( _first ? 1 : -1 ), "}"
+                             );
+    bson_t * fields = BCON_NEW( mongo_fields::analytic::detected_object::SESSION.c_str(), BCON_INT32(1) );
+
+    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        1,
+                                                        0,
+                                                        query,
+                                                        fields,
+                                                        nullptr );
+
+    bool found = false;
+    const bson_t * doc;
+    if( mongoc_cursor_next( cursor, & doc ) ){
+        bson_iter_t iter;
+        if( bson_iter_init_find( & iter, doc, mongo_fields::analytic::detected_object::SESSION.c_str() ) ){
+            _sessionNum = bson_iter_as_int64( & iter );
+            found = true;
+        }
+    }
+
+    bson_error_t error;
+    if( mongoc_cursor_error( cursor, & error ) ){
+        VS_LOG_ERROR << PRINT_HEADER << " boundary session search failed, reason: " << error.message << endl;
+    }
+
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( fields );
+    bson_destroy( query );
+    return found;
+}
+
+bool DatabaseManagerBase::discoverSessions( const TPersistenceSetId _persId,
+                                            const std::pair<TSessionNum, TSessionNum> _sessionRange,
+                                            const TLogicStep _gapThreshold,
+                                            const bool _withSteps,
+                                            std::vector<SEventsSessionInfo> & _out ){
+
+    flushTrajectoryData( _persId );
+
+    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
+    assert( contextTable );
+
+    using namespace mongo_fields::analytic::detected_object;
+
+    // one pass over ( session, logic_time ) index: documents come in step order, so steps are collapsed here
+    // ( $group of aggregation would lose this order and sort all distinct steps again )
+    bson_t * query = BCON_NEW( "$query", "{", SESSION.c_str(), "{",
+                                        "$gte", BCON_INT32(_sessionRange.first),
+                                        "$lte", BCON_INT32(_sessionRange.second),
+                               "}", "}",
+                               "$orderby", "{", SESSION.c_str(), BCON_INT32(1), LOGIC_TIME.c_str(), BCON_INT32(1), "}",
+                               "$hint", "{", SESSION.c_str(), BCON_INT32(1), LOGIC_TIME.c_str(), BCON_INT32(1), "}"
+                             );
+    bson_t * fields = BCON_NEW( "_id", BCON_INT32(0),
+                                SESSION.c_str(), BCON_INT32(1),
+                                LOGIC_TIME.c_str(), BCON_INT32(1),
+                                ASTRO_TIME.c_str(), BCON_INT32(1)
+                              );
+
+    mongoc_cursor_t * cursor = mongoc_collection_find(  contextTable,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        0,
+                                                        0,
+                                                        query,
+                                                        fields,
+                                                        nullptr );
+
+    SEventsSessionInfo segment;
+    bool segmentOpened = false;
+
+    const bson_t * doc;
+    while( mongoc_cursor_next( cursor, & doc ) ){
+        TSessionNum sessionNum = 0;
+        TLogicStep logicStep = 0;
+        int64_t astroTime = 0;
+
         bson_iter_t iter;
+        if( bson_iter_init_find(& iter, doc, SESSION.c_str()) ){
+            sessionNum = bson_iter_as_int64( & iter );
+        }
+        if( bson_iter_init_find(& iter, doc, LOGIC_TIME.c_str()) ){
+            logicStep = bson_iter_as_int64( & iter );
+        }
+        if( bson_iter_init_find(& iter, doc, ASTRO_TIME.c_str()) ){
+            astroTime = bson_iter_as_int64( & iter );
+        }
 
-        SEventsSessionInfo info;
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_description::SESSION_NUM.c_str() );
-        info.number = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_description::LOGIC_TIME_MIN.c_str() );
-        info.minLogicStep = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_description::LOGIC_TIME_MAX.c_str() );
-        info.maxLogicStep = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_description::ASTRO_TIME_MIN.c_str() );
-        info.minTimestampMillisec = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_description::ASTRO_TIME_MAX.c_str() );
-        info.maxTimestampMillisec = bson_iter_int64( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_description::EMPTY_STEPS_BEGIN.c_str() );
-        info.emptyStepsBegin = bson_iter_int32( & iter );
-        bson_iter_init_find( & iter, doc, mongo_fields::persistence_set_description::EMPTY_STEPS_END.c_str() );
-        info.emptyStepsEnd = bson_iter_int32( & iter );
-
-        out.push_back( info );
-    }
+        // the same step of other objects
+        if( segmentOpened && sessionNum == segment.number && logicStep == segment.maxLogicStep ){
+            segment.maxTimestampMillisec = std::max( segment.maxTimestampMillisec, astroTime );
+            if( _withSteps ){
+                segment.steps.back().timestampMillisec = segment.maxTimestampMillisec;
+            }
+            continue;
+        }
 
-    mongoc_cursor_destroy( cursor );
-    bson_destroy( query );
+        // close on session change or on gap
+        if( segmentOpened
+                && (sessionNum != segment.number
+                    || (_gapThreshold >= 0 && (logicStep - segment.maxLogicStep) > (_gapThreshold + 1))) ){
+            _out.push_back( segment );
+            segment.clear();
+            segmentOpened = false;
+        }
 
-    return out;
-}
+        if( ! segmentOpened ){
+            segment.number = sessionNum;
+            segment.minLogicStep = logicStep;
+            segment.minTimestampMillisec = astroTime;
+            segmentOpened = true;
+        }
 
-common_types::SEventsSessionInfo DatabaseManagerBase::scanPayloadHeadForSessions( const common_types::TPersistenceSetId _persId ){
+        segment.maxLogicStep = logicStep;
+        segment.maxTimestampMillisec = astroTime;
+        if( _withSteps ){
+            segment.steps.push_back( SObjectStep{logicStep, astroTime} );
+        }
+    }
 
-    const string tableName = getTableName(_persId);
-    bson_t * cmd = BCON_NEW(    "distinct", BCON_UTF8( tableName.c_str() ),
-                                "key", BCON_UTF8( mongo_fields::analytic::detected_object::SESSION.c_str() )
-                            );
+    if( segmentOpened ){
+        _out.push_back( segment );
+    }
 
-    bson_t reply;
     bson_error_t error;
-    const bool rt = mongoc_database_command_simple( m_mongoDatabase,
-                                                    cmd,
-                                                    NULL,
-                                                    & reply,
-                                                    & error );
-
-    if( 0 == rt ){
-        VS_LOG_ERROR << PRINT_HEADER << " scanPayloadHeadForSessions failed, reason: " << error.message << endl;
-        bson_destroy( cmd );
-        return SEventsSessionInfo();
+    const bool failed = mongoc_cursor_error( cursor, & error );
+    if( failed ){
+        VS_LOG_ERROR << PRINT_HEADER << " session discovery failed, reason: " << error.message << endl;
     }
 
-    // fill array with session numbers
-    bson_iter_t iter;
-    bson_iter_t arrayIter;
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( fields );
+    bson_destroy( query );
+    return ! failed;
+}
 
-    if( ! (bson_iter_init_find( & iter, & reply, "values")
-            && BSON_ITER_HOLDS_ARRAY( & iter )
-            && bson_iter_recurse( & iter, & arrayIter ))
-      ){
-        VS_LOG_ERROR << PRINT_HEADER << "TODO: print" << endl;
-        return SEventsSessionInfo();
+common_types::SEventsSessionInfo DatabaseManagerBase::scanPayloadHeadForSessions( const common_types::TPersistenceSetId _persId ){
+
+    SEventsSessionInfo head;
+    if( seedSessionSummary(_persId) && m_sessionSummary->getHead(_persId, head) ){
+        return head;
     }
 
-    // get session
-    vector<TSessionNum> sessionNumbers;
-    while( bson_iter_next( & arrayIter ) ){
-        if( BSON_ITER_HOLDS_INT32( & arrayIter ) ){
-            sessionNumbers.push_back( bson_iter_int32( & arrayIter ) );
-        }
+    TSessionNum sessionNum = 0;
+    if( ! findBoundarySession(_persId, true, sessionNum) ){
+        return SEventsSessionInfo();
     }
 
-    bson_destroy( cmd );
-    bson_destroy( & reply );
-    return getSessionInfo( _persId, * std::min_element(sessionNumbers.begin(), sessionNumbers.end()) );
+    return getSessionInfo( _persId, sessionNum );
 }
 
 common_types::SEventsSessionInfo DatabaseManagerBase::scanPayloadTailForSessions( const common_types::TPersistenceSetId _persId ){
 
-    const string tableName = getTableName(_persId);
-    bson_t * cmd = BCON_NEW(    "distinct", BCON_UTF8( tableName.c_str() ),
-                                "key", BCON_UTF8( mongo_fields::analytic::detected_object::SESSION.c_str() )
-                            );
-
-    bson_t reply;
-    bson_error_t error;
-    const bool rt = mongoc_database_command_simple( m_mongoDatabase,
-                                                    cmd,
-                                                    NULL,
-                                                    & reply,
-                                                    & error );
-
-    if( 0 == rt ){
-        VS_LOG_ERROR << PRINT_HEADER << " scanPayloadTailForSessions failed, reason: " << error.message << endl;
-        bson_destroy( cmd );
-        return SEventsSessionInfo();
+    SEventsSessionInfo tail;
+    if( seedSessionSummary(_persId) && m_sessionSummary->getTail(_persId, tail) ){
+        return tail;
     }
 
-    // fill array with session numbers
-    bson_iter_t iter;
-    bson_iter_t arrayIter;
-
-    if( ! (bson_iter_init_find( & iter, & reply, "values")
-            && BSON_ITER_HOLDS_ARRAY( & iter )
-            && bson_iter_recurse( & iter, & arrayIter ))
-      ){
-        VS_LOG_ERROR << PRINT_HEADER << "TODO: print" << endl;
+    TSessionNum sessionNum = 0;
+    if( ! findBoundarySession(_persId, false, sessionNum) ){
         return SEventsSessionInfo();
     }
 
-    // get session
-    vector<TSessionNum> sessionNumbers;
-    while( bson_iter_next( & arrayIter ) ){
-        if( BSON_ITER_HOLDS_INT32( & arrayIter ) ){
-            sessionNumbers.push_back( bson_iter_int32( & arrayIter ) );
-        }
-    }
-
-    bson_destroy( cmd );
-    bson_destroy( & reply );
-    return getSessionInfo( _persId, * std::max_element(sessionNumbers.begin(), sessionNumbers.end()) );
+    return getSessionInfo( _persId, sessionNum );
 }
 
 vector<SEventsSessionInfo> DatabaseManagerBase::scanPayloadRangeForSessions( const TPersistenceSetId _persId,
         const std::pair<TSessionNum, TSessionNum> _sessionRange ){
 
-    const string tableName = getTableName(_persId);
-    bson_t * cmd = BCON_NEW(    "distinct", BCON_UTF8( tableName.c_str() ),
-                                "key", BCON_UTF8( mongo_fields::analytic::detected_object::SESSION.c_str() )
-                            );
-
-    bson_t reply;
-    bson_error_t error;
-    const bool rt = mongoc_database_command_simple( m_mongoDatabase,
-                                                    cmd,
-                                                    NULL,
-                                                    & reply,
-                                                    & error );
-
-    if( ! rt ){
-        VS_LOG_ERROR << PRINT_HEADER << " scanPayloadRangeForSessions failed, reason: " << error.message << endl;
-        bson_destroy( cmd );
-        return std::vector<SEventsSessionInfo>();
-    }
-
-    // fill array with session numbers
-    bson_iter_t iter;
-    bson_iter_t arrayIter;
-
-    if( ! (bson_iter_init_find( & iter, & reply, "values")
-            && BSON_ITER_HOLDS_ARRAY( & iter )
-            && bson_iter_recurse( & iter, & arrayIter ))
-      ){
-        VS_LOG_ERROR << PRINT_HEADER << "TODO: print" << endl;
-        return std::vector<SEventsSessionInfo>();
-    }
-
-    // get info about each session
     std::vector<SEventsSessionInfo> out;
-
-    while( bson_iter_next( & arrayIter ) ){
-        if( BSON_ITER_HOLDS_INT32( & arrayIter ) ){
-            const TSessionNum sessionNumber = bson_iter_int32( & arrayIter );
-
-            if( sessionNumber >= _sessionRange.first && sessionNumber <= _sessionRange.second ){
-                const SEventsSessionInfo info = getSessionInfo( _persId, sessionNumber );
-                out.push_back( info );
-            }
-        }
+    if( seedSessionSummary(_persId) && m_sessionSummary->getRange(_persId, _sessionRange, out) ){
+        return out;
     }
 
-    bson_destroy( cmd );
-    bson_destroy( & reply );
+    discoverSessions( _persId, _sessionRange, NO_GAP_SPLIT, false, out );
     return out;
 }
 
 vector<SEventsSessionInfo> DatabaseManagerBase::scanPayloadForSessions( const TPersistenceSetId _persId,
                                                                         const TSessionNum _beginFromSession ){
 
-    const string tableName = getTableName(_persId);
-    bson_t * cmd = BCON_NEW(    "distinct", BCON_UTF8( tableName.c_str() ),
-                                "key", BCON_UTF8( mongo_fields::analytic::detected_object::SESSION.c_str() )
+    std::vector<SEventsSessionInfo> out;
+    if( seedSessionSummary(_persId) && m_sessionSummary->getGapSplitted(_persId, {_beginFromSession, std::numeric_limits<TSessionNum>::max()}, 0, out) ){
+        return out;
+    }
 
-                                // TODO: what wrong with this shit ?
-//                                "sort", "{", "logic_time", BCON_INT32(-1), "}"
-//                                "query","{", "$sort", "{", "logic_time", BCON_INT32(-1), "}", "}"
-                            );
+    discoverSessions( _persId, {_beginFromSession, std::numeric_limits<TSessionNum>::max()}, 0, false, out );
+    return out;
+}
 
-    bson_t reply;
-    bson_error_t error;
-    const bool rt = mongoc_database_command_simple( m_mongoDatabase,
-                                                    cmd,
-                                                    NULL,
-                                                    & reply,
-                                                    & error );
+SEventsSessionInfo DatabaseManagerBase::getSessionInfo( const common_types::TPersistenceSetId _persId,
+        const common_types::TSessionNum _sessionNum ){
 
-    if( 0 == rt ){
-        VS_LOG_ERROR << PRINT_HEADER << " scanPayloadForSessions failed, reason: " << error.message << endl;
-        bson_destroy( cmd );
-        return std::vector<SEventsSessionInfo>();
+    std::vector<SEventsSessionInfo> out;
+    if( ! (seedSessionSummary(_persId) && m_sessionSummary->getRange(_persId, {_sessionNum, _sessionNum}, out)) ){
+        discoverSessions( _persId, {_sessionNum, _sessionNum}, NO_GAP_SPLIT, false, out );
     }
 
-    // fill array with session numbers
-    bson_iter_t iter;
-    bson_iter_t arrayIter;
-
-    if( ! (bson_iter_init_find( & iter, & reply, "values")
-            && BSON_ITER_HOLDS_ARRAY( & iter )
-            && bson_iter_recurse( & iter, & arrayIter ))
-      ){
-        VS_LOG_ERROR << PRINT_HEADER << "TODO: print" << endl;
-        return std::vector<SEventsSessionInfo>();
+    if( out.empty() ){
+        SEventsSessionInfo info;
+        info.number = _sessionNum;
+        return info;
     }
 
-    // get info about each session
-    std::vector<SEventsSessionInfo> out;
+    return out.front();
+}
 
-    while( bson_iter_next( & arrayIter ) ){
-        if( BSON_ITER_HOLDS_INT32( & arrayIter ) ){
-            const TSessionNum sessionNumber = bson_iter_int32( & arrayIter );
+vector<SEventsSessionInfo> DatabaseManagerBase::splitSessionByGaps( const TPersistenceSetId _persId,
+                                                                    const TSessionNum _sessionNum,
+                                                                    const TLogicStep _logicStepThreshold ){
 
-            const std::vector<SEventsSessionInfo> splittedSession = splitSessionByGaps( _persId, sessionNumber );
-            out.insert( out.end(), splittedSession.begin(), splittedSession.end() );
-        }
+    std::vector<SEventsSessionInfo> out;
+    if( seedSessionSummary(_persId) && m_sessionSummary->getGapSplitted(_persId, {_sessionNum, _sessionNum}, _logicStepThreshold, out) ){
+        return out;
     }
 
-    bson_destroy( cmd );
-    bson_destroy( & reply );
+    discoverSessions( _persId, {_sessionNum, _sessionNum}, _logicStepThreshold, false, out );
     return out;
 }
 
-SEventsSessionInfo DatabaseManagerBase::getSessionInfo( const common_types::TPersistenceSetId _persId,
-        const common_types::TSessionNum _sessionNum ){
-
-    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
-    assert( contextTable );
+bool DatabaseManagerBase::isSessionExistInDescription( const TPersistenceSetId _persId, const common_types::TSessionNum _sessionNum ){
 
-    SEventsSessionInfo out;
-    out.number = _sessionNum;
-
-    // get MIN value
-    {
-        bson_t * pipeline = BCON_NEW( "pipeline", "[",
-                                      "{", "$match", "{", "session", "{", "$eq", BCON_INT32(_sessionNum), "}", "}", "}",
-                                      "{", "$group", "{", "_id", "$logic_time", "maxAstroTime", "{", "$max", "$astro_time", "}", "}", "}",
-                                      "{", "$project", "{", "_id", BCON_INT32(1), "maxAstroTime", BCON_INT32(1), "}", "}",
-                                      "{", "$sort", "{", "_id", BCON_INT32(-1), "}", "}",
-                                      "]"
-                                    );
+    bson_t * query = BCON_NEW( mongo_fields::persistence_set_description::PERSISTENCE_ID.c_str(), BCON_INT64( _persId ),
+                               mongo_fields::persistence_set_description::SESSION_NUM.c_str(), BCON_INT32( _sessionNum ) );
 
-        mongoc_cursor_t * cursor = mongoc_collection_aggregate( contextTable,
-                                                                MONGOC_QUERY_NONE,
-                                                                pipeline,
-                                                                nullptr,
-                                                                nullptr );
-        const bson_t * doc;
-        while( mongoc_cursor_next( cursor, & doc ) ){
-            bson_iter_t iter;
+    mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tablePersistenceDescription,
+                                                        MONGOC_QUERY_NONE,
+                                                        0,
+                                                        1,
+                                                        0,
+                                                        query,
+                                                        nullptr,
+                                                        nullptr );
 
-            bson_iter_init_find( & iter, doc, "_id" );
-            out.minLogicStep = bson_iter_int64( & iter );
-            bson_iter_init_find( & iter, doc, "maxAstroTime" );
-            out.minTimestampMillisec = bson_iter_int64( & iter );
-        }
+    const bson_t * doc;
+    const bool rt = mongoc_cursor_next( cursor, & doc );
 
-        bson_destroy( pipeline );
-        mongoc_cursor_destroy( cursor );
-    }
+    mongoc_cursor_destroy( cursor );
+    bson_destroy( query );
+    return rt;
+}
 
-    // get MAX value
-    {
-        bson_t * pipeline = BCON_NEW( "pipeline", "[",
-                                      "{", "$match", "{", "session", "{", "$eq", BCON_INT32(_sessionNum), "}", "}", "}",
-                                      "{", "$group", "{", "_id", "$logic_time", "maxAstroTime", "{", "$max", "$astro_time", "}", "}", "}",
-                                      "{", "$project", "{", "_id", BCON_INT32(1), "maxAstroTime", BCON_INT32(1), "}", "}",
-                                      "{", "$sort", "{", "_id", BCON_INT32(1), "}", "}",
-                                      "]"
-                                    );
+bool DatabaseManagerBase::upsertSessionDescription( const TPersistenceSetId _persId, const SEventsSessionInfo & _descr ){
 
-        mongoc_cursor_t * cursor = mongoc_collection_aggregate( contextTable,
-                                                                MONGOC_QUERY_NONE,
-                                                                pipeline,
-                                                                nullptr,
-                                                                nullptr );
-        const bson_t * doc;
-        while( mongoc_cursor_next( cursor, & doc ) ){
-            bson_iter_t iter;
+    bson_t * query = BCON_NEW( mongo_fields::persistence_set_description::PERSISTENCE_ID.c_str(), BCON_INT64( _persId ),
+                               mongo_fields::persistence_set_description::SESSION_NUM.c_str(), BCON_INT32( _descr.number ) );
+    bson_t * update = BCON_NEW( "$set", "{",
+                                mongo_fields::persistence_set_description::LOGIC_TIME_MIN.c_str(), BCON_INT64( _descr.minLogicStep ),
+                                mongo_fields::persistence_set_description::LOGIC_TIME_MAX.c_str(), BCON_INT64( _descr.maxLogicStep ),
+                                mongo_fields::persistence_set_description::ASTRO_TIME_MIN.c_str(), BCON_INT64( _descr.minTimestampMillisec ),
+                                mongo_fields::persistence_set_description::ASTRO_TIME_MAX.c_str(), BCON_INT64( _descr.maxTimestampMillisec ),
+                                mongo_fields::persistence_set_description::EMPTY_STEPS_BEGIN.c_str(), BCON_INT32( 0 ),
+                                mongo_fields::persistence_set_description::EMPTY_STEPS_END.c_str(), BCON_INT32( 0 ),
+                              "}" );
 
-            bson_iter_init_find( & iter, doc, "_id" );
-            out.maxLogicStep = bson_iter_int64( & iter );
-            bson_iter_init_find( & iter, doc, "maxAstroTime" );
-            out.maxTimestampMillisec = bson_iter_int64( & iter );
-        }
+    bson_error_t error;
+    const bool rt = mongoc_collection_update( handles().tablePersistenceDescription,
+                                              MONGOC_UPDATE_UPSERT,
+                                              query,
+                                              update,
+                                              NULL,
+                                              & error );
 
-        bson_destroy( pipeline );
-        mongoc_cursor_destroy( cursor );
+    if( ! rt ){
+        VS_LOG_ERROR << PRINT_HEADER << " upsert session description failed, reason: " << error.message << endl;
     }
 
-    return out;
+    bson_destroy( query );
+    bson_destroy( update );
+    return rt;
 }
 
-vector<SEventsSessionInfo> DatabaseManagerBase::splitSessionByGaps( const TPersistenceSetId _persId,
-                                                                    const TSessionNum _sessionNum,
-                                                                    const TLogicStep _logicStepThreshold ){
-
-    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
-    assert( contextTable );
-
-    bson_t * pipeline = BCON_NEW( "pipeline", "[",
-                                  "{", "$match", "{", "session", "{", "$eq", BCON_INT32(_sessionNum), "}", "}", "}",
-                                  "{", "$group", "{", "_id", "$logic_time", "maxAstroTime", "{", "$max", "$astro_time", "}", "}", "}",
-                                  "{", "$project", "{", "_id", BCON_INT32(1), "maxAstroTime", BCON_INT32(1), "}", "}",
-                                  "{", "$sort", "{", "_id", BCON_INT32(1), "}", "}",
-                                  "]"
-                                );
-
-    mongoc_cursor_t * cursor = mongoc_collection_aggregate( contextTable,
-                                                            MONGOC_QUERY_NONE,
-                                                            pipeline,
-                                                            nullptr,
-                                                            nullptr );
-    std::vector<SEventsSessionInfo> out;
+bool DatabaseManagerBase::seedSessionSummary( const TPersistenceSetId _persId ){
 
-    SEventsSessionInfo session;
-    bool sessionOpened = false;
-    int64_t previousStep = 0;
+    if( ! m_sessionSummary ){
+        return false;
+    }
 
-    const bson_t * doc;
-    while( mongoc_cursor_next( cursor, & doc ) ){
-        bson_iter_t iter;
+    flushTrajectoryData( _persId );
+    if( m_sessionSummary->isSeeded(_persId) ){
+        return true;
+    }
 
-        bson_iter_init_find( & iter, doc, "_id" );
-        const TLogicStep logicStep = bson_iter_int64( & iter );
+    // NOTE: once per set, afterwards it is maintained by writes
+    std::vector<SEventsSessionInfo> segments;
+    if( ! discoverSessions(_persId, {std::numeric_limits<TSessionNum>::min(), std::numeric_limits<TSessionNum>::max()}, 0, false, segments) ){
+        return false;
+    }
 
-        // continue
-        if( sessionOpened ){
-            // OK
-            if( logicStep == (previousStep + 1)  ){
-                previousStep = logicStep;
-                continue;
-            }
-            // gap is catched
-            else{
-                session.maxLogicStep = logicStep;
-                bson_iter_init_find( & iter, doc, "maxAstroTime" );
-                session.maxTimestampMillisec = bson_iter_int64( & iter );
-                session.number = _sessionNum;
-                out.push_back( session );
+    m_sessionSummary->seed( _persId, segments );
+    return true;
+}
 
-                session.clear();
+void DatabaseManagerBase::flushSessionDescriptions( const TPersistenceSetId _persId, bool _withTail ){
 
-                sessionOpened = false;
-                previousStep = logicStep;
-            }
-        }
-        // open
-        else{
-            session.minLogicStep = logicStep;
-            previousStep = logicStep;
+    std::vector<SEventsSessionInfo> dirtySessions;
+    m_sessionSummary->takeDirty( _persId, _withTail, dirtySessions );
 
-            bson_iter_init_find( & iter, doc, "maxAstroTime" );
-            session.minTimestampMillisec = bson_iter_int64( & iter );
+    for( const SEventsSessionInfo & descr : dirtySessions ){
+        if( ! upsertSessionDescription(_persId, descr) ){
+            m_sessionSummary->markDirty( _persId, descr.number );
         }
     }
-
-    bson_destroy( pipeline );
-    mongoc_cursor_destroy( cursor );
-
-    return out;
 }
 
-bool DatabaseManagerBase::isSessionExistInDescription( const common_types::TSessionNum _sessionNum ){
-
-    bson_t * query = BCON_NEW( mongo_fields::persistence_set_description::SESSION_NUM.c_str(), BCON_INT32( _sessionNum ) );
+void DatabaseManagerBase::flushSessionDescriptions(){
 
-    mongoc_cursor_t * cursor = mongoc_collection_find(  m_tablePersistenceDescription,
-                                                        MONGOC_QUERY_NONE,
-                                                        0,
-                                                        0,
-                                                        1000000, // 10000 ~= inf
-                                                        query,
-                                                        nullptr,
-                                                        nullptr );
+    if( ! m_sessionSummary ){
+        return;
+    }
 
-    const bson_t * doc;
-    const bool rt = mongoc_cursor_next( cursor, & doc );
-    return rt;
+    for( const TPersistenceSetId persId : m_sessionSummary->getSeededSets() ){
+        flushSessionDescriptions( persId, true );
+    }
 }
 
 void DatabaseManagerBase::deleteSessionDescription( const common_types::TPersistenceSetId _persId, const TSessionNum _sessionNum ){
@@ -1528,7 +3203,7 @@ void DatabaseManagerBase::deleteSessionDescription( const common_types::TPersist
     }
 
     bson_error_t error;
-    const bool result = mongoc_collection_remove( m_tablePersistenceDescription, MONGOC_REMOVE_NONE, query, nullptr, & error );
+    const bool result = mongoc_collection_remove( handles().tablePersistenceDescription, MONGOC_REMOVE_NONE, query, nullptr, & error );
     if( ! result ){
         VS_LOG_ERROR << PRINT_HEADER << " delete session descr failed, reason: " << error.message << endl;
     }
@@ -1557,106 +3232,21 @@ void DatabaseManagerBase::deleteSessionDescription( const common_types::TContext
 
 std::vector<SEventsSessionInfo> DatabaseManagerBase::getPersistenceSetSessions( TPersistenceSetId _persId ){
 
-    const string tableName = getTableName(_persId);
-    bson_t * cmd = BCON_NEW(    "distinct", BCON_UTF8( tableName.c_str() ),
-                                "key", BCON_UTF8( mongo_fields::analytic::detected_object::SESSION.c_str() )
-
-                                // TODO: what wrong with this shit ?
-//                                "sort", "{", "logic_time", BCON_INT32(-1), "}"
-//                                "query","{", "$sort", "{", "logic_time", BCON_INT32(-1), "}", "}"
-                            );
-
-    bson_t reply;
-    bson_error_t error;
-    const bool rt = mongoc_database_command_simple( m_mongoDatabase,
-                                                    cmd,
-                                                    NULL,
-                                                    & reply,
-                                                    & error );
-
-    if( 0 == rt ){
-        VS_LOG_ERROR << PRINT_HEADER << " getPersistenceSetSessions failed, reason: " << error.message << endl;
-        bson_destroy( cmd );
-        return std::vector<SEventsSessionInfo>();
-    }
-
-    // fill array with session numbers
-    bson_iter_t iter;
-    bson_iter_t arrayIter;
-
-    if( ! (bson_iter_init_find( & iter, & reply, "values")
-            && BSON_ITER_HOLDS_ARRAY( & iter )
-            && bson_iter_recurse( & iter, & arrayIter ))
-      ){
-        VS_LOG_ERROR << PRINT_HEADER << "TODO: print" << endl;
-        return std::vector<SEventsSessionInfo>();
-    }
-
-    // get info about each session
     std::vector<SEventsSessionInfo> out;
-
-    while( bson_iter_next( & arrayIter ) ){
-        if( BSON_ITER_HOLDS_INT32( & arrayIter ) ){
-            const TSessionNum sessionNumber = bson_iter_int32( & arrayIter );
-
-            SEventsSessionInfo info;
-            info.number = sessionNumber;
-            info.steps = getSessionSteps( _persId, sessionNumber );
-            info.minLogicStep = info.steps.front().logicStep;
-            info.maxLogicStep = info.steps.back().logicStep;
-            info.minTimestampMillisec = info.steps.front().timestampMillisec;
-            info.maxTimestampMillisec = info.steps.back().timestampMillisec;
-
-            out.push_back( info );
-        }
-    }
-
-    bson_destroy( cmd );
-    bson_destroy( & reply );
-
-    std::sort( out.begin(), out.end() );
+    discoverSessions( _persId, {std::numeric_limits<TSessionNum>::min(), std::numeric_limits<TSessionNum>::max()}, NO_GAP_SPLIT, true, out );
     return out;
 }
 
 std::vector<SObjectStep> DatabaseManagerBase::getSessionSteps( TPersistenceSetId _persId, TSessionNum _sesNum ){
 
-    mongoc_collection_t * contextTable = getPayloadTableRef( _persId );
-    assert( contextTable );
-
-    bson_t * pipeline = BCON_NEW( "pipeline", "[",
-                                  "{", "$match", "{", "session", "{", "$eq", BCON_INT32(_sesNum), "}", "}", "}",
-                                  "{", "$group", "{", "_id", "$logic_time", "maxAstroTime", "{", "$max", "$astro_time", "}", "}", "}",
-                                  "{", "$project", "{", "_id", BCON_INT32(1), "maxAstroTime", BCON_INT32(1), "}", "}",
-                                  "{", "$sort", "{", "_id", BCON_INT32(1), "}", "}",
-                                  "]"
-                                );
-
-    mongoc_cursor_t * cursor = mongoc_collection_aggregate( contextTable,
-                                                            MONGOC_QUERY_NONE,
-                                                            pipeline,
-                                                            nullptr,
-                                                            nullptr );
-    std::vector<SObjectStep> out;
-
-    const bson_t * doc;
-    while( mongoc_cursor_next( cursor, & doc ) ){
-        bson_iter_t iter;
-
-        SObjectStep step;
-
-        bson_iter_init_find( & iter, doc, "_id" );
-        step.logicStep = bson_iter_int64( & iter );
-
-        bson_iter_init_find( & iter, doc, "maxAstroTime" );
-        step.timestampMillisec = bson_iter_int64( & iter );
+    std::vector<SEventsSessionInfo> out;
+    discoverSessions( _persId, {_sesNum, _sesNum}, NO_GAP_SPLIT, true, out );
 
-        out.push_back( step );
+    if( out.empty() ){
+        return std::vector<SObjectStep>();
     }
 
-    bson_destroy( pipeline );
-    mongoc_cursor_destroy( cursor );
-
-    return out;
+    return out.front().steps;
 }
 
 // -------------------------------------------------------------------------------------
@@ -1674,7 +3264,7 @@ bool DatabaseManagerBase::writeClientOperation( const common_types::SWALClientOp
                             "}" );
 
     bson_error_t error;
-    const bool rt = mongoc_collection_update( m_tableWALClientOperations,
+    const bool rt = mongoc_collection_update( handles().tableWALClientOperations,
                                   MONGOC_UPDATE_UPSERT,
                                   query,
                                   update,
@@ -1700,7 +3290,7 @@ std::vector<common_types::SWALClientOperation> DatabaseManagerBase::getClientOpe
     // - fast filter criteria changing on client side
     bson_t * query = BCON_NEW( nullptr );
 
-    mongoc_cursor_t * cursor = mongoc_collection_find(  m_tableWALClientOperations,
+    mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tableWALClientOperations,
                                                         MONGOC_QUERY_NONE,
                                                         0,
                                                         0,
@@ -1748,7 +3338,7 @@ std::vector<common_types::SWALClientOperation> DatabaseManagerBase::getNonIntegr
                                       "]"
                                     );
 
-        mongoc_cursor_t * cursor = mongoc_collection_aggregate( m_tableWALClientOperations,
+        mongoc_cursor_t * cursor = mongoc_collection_aggregate( handles().tableWALClientOperations,
                                                                 MONGOC_QUERY_NONE,
                                                                 pipeline,
                                                                 nullptr,
@@ -1780,7 +3370,7 @@ std::vector<common_types::SWALClientOperation> DatabaseManagerBase::getNonIntegr
         bson_init( & query );
         bson_append_document( & query, "unique_key", strlen("unique_key"), & criteria );
 
-        mongoc_cursor_t * cursor = mongoc_collection_find(  m_tableWALClientOperations,
+        mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tableWALClientOperations,
                                                             MONGOC_QUERY_NONE,
                                                             0,
                                                             0,
@@ -1824,7 +3414,7 @@ void DatabaseManagerBase::removeClientOperation( std::string _uniqueKey ){
         query = BCON_NEW( mongo_fields::wal_client_operations::UNIQUE_KEY.c_str(), BCON_UTF8( _uniqueKey.c_str() ));
     }
 
-    const bool result = mongoc_collection_remove( m_tableWALClientOperations, MONGOC_REMOVE_NONE, query, nullptr, nullptr );
+    const bool result = mongoc_collection_remove( handles().tableWALClientOperations, MONGOC_REMOVE_NONE, query, nullptr, nullptr );
 
     if( ! result ){
         // TODO: do
@@ -1851,7 +3441,7 @@ bool DatabaseManagerBase::writeProcessEvent( const common_types::SWALProcessEven
     // array
 
     bson_error_t error;
-    const bool rt = mongoc_collection_insert( m_tableWALProcessEvents,
+    const bool rt = mongoc_collection_insert( handles().tableWALProcessEvents,
                                               MONGOC_INSERT_NONE,
                                               doc,
                                               NULL,
@@ -1880,7 +3470,7 @@ std::vector<common_types::SWALProcessEvent> DatabaseManagerBase::getProcessEvent
         query = BCON_NEW( mongo_fields::wal_process_events::PID.c_str(), BCON_INT32( _pid ));
     }
 
-    mongoc_cursor_t * cursor = mongoc_collection_find(  m_tableWALProcessEvents,
+    mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tableWALProcessEvents,
                                                         MONGOC_QUERY_NONE,
                                                         0,
                                                         0,
@@ -1937,7 +3527,7 @@ std::vector<common_types::SWALProcessEvent> DatabaseManagerBase::getNonIntegrity
                                       "]"
                                     );
 
-        mongoc_cursor_t * cursor = mongoc_collection_aggregate( m_tableWALProcessEvents,
+        mongoc_cursor_t * cursor = mongoc_collection_aggregate( handles().tableWALProcessEvents,
                                                                 MONGOC_QUERY_NONE,
                                                                 pipeline,
                                                                 nullptr,
@@ -1971,7 +3561,7 @@ std::vector<common_types::SWALProcessEvent> DatabaseManagerBase::getNonIntegrity
         bson_init( & query );
         bson_append_document( & query, "pid", strlen("pid"), & criteria );
 
-        mongoc_cursor_t * cursor = mongoc_collection_find(  m_tableWALProcessEvents,
+        mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tableWALProcessEvents,
                                                             MONGOC_QUERY_NONE,
                                                             0,
                                                             0,
@@ -2028,7 +3618,7 @@ void DatabaseManagerBase::removeProcessEvent( common_types::TPid _pid ){
         query = BCON_NEW( mongo_fields::wal_process_events::PID.c_str(), BCON_INT32( _pid ));
     }
 
-    const bool result = mongoc_collection_remove( m_tableWALProcessEvents, MONGOC_REMOVE_NONE, query, nullptr, nullptr );
+    const bool result = mongoc_collection_remove( handles().tableWALProcessEvents, MONGOC_REMOVE_NONE, query, nullptr, nullptr );
 
     if( ! result ){
         // TODO: do
@@ -2047,7 +3637,7 @@ bool DatabaseManagerBase::writeUserRegistration( const common_types::SWALUserReg
                            );
 
     bson_error_t error;
-    const bool rt = mongoc_collection_insert( m_tableWALUserRegistrations,
+    const bool rt = mongoc_collection_insert( handles().tableWALUserRegistrations,
                                               MONGOC_INSERT_NONE,
                                               doc,
                                               NULL,
@@ -2066,7 +3656,7 @@ bool DatabaseManagerBase::writeUserRegistration( const common_types::SWALUserReg
 std::vector<common_types::SWALUserRegistration> DatabaseManagerBase::getUserRegistrations(){
 
     bson_t * query = BCON_NEW( nullptr );
-    mongoc_cursor_t * cursor = mongoc_collection_find(  m_tableWALUserRegistrations,
+    mongoc_cursor_t * cursor = mongoc_collection_find(  handles().tableWALUserRegistrations,
                                                         MONGOC_QUERY_NONE,
                                                         0,
                                                         0,
@@ -2110,7 +3700,7 @@ void DatabaseManagerBase::removeUserRegistration( common_types::SWALUserRegistra
         query = BCON_NEW( mongo_fields::wal_user_registrations::USER_ID.c_str(), BCON_UTF8( _id.c_str() ));
     }
 
-    const bool result = mongoc_collection_remove( m_tableWALUserRegistrations, MONGOC_REMOVE_NONE, query, nullptr, nullptr );
+    const bool result = mongoc_collection_remove( handles().tableWALUserRegistrations, MONGOC_REMOVE_NONE, query, nullptr, nullptr );
     if( ! result ){
         // TODO: do
     }
@@ -2,14 +2,32 @@
 #define DATABASE_MANAGER_BASE_H
 
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
 
 #include <mongoc.h>
 
 #include "common/ms_common_types.h"
 #include "common/ms_common_vars.h"
+#include "system/thread_pool.h"
+#include "trajectory_cache.h"
+#include "trajectory_write_behind.h"
+#include "session_summary.h"
+#include "trajectory_prefetcher.h"
+#include "persistence_cursor.h"
+#include "metadata_catalog.h"
+#include "i_persistence_storage.h"
+#include "retention_engine.h"
+#include "trajectory_subscriptions.h"
+#include "persistence_snapshot.h"
+#include "bulk_write_policies.h"
 
-class DatabaseManagerBase
+class DatabaseManagerBase : public IPersistenceStorage
 {
     static bool m_systemInited;
     static int m_instanceCounter;
@@ -22,15 +40,58 @@ class DatabaseManagerBase
 
 
 public:
+    using PTrajectoryCursor = std::shared_ptr<PersistenceCursor<common_types::SPersistenceTrajectory>>;
+    using PWeatherCursor = std::shared_ptr<PersistenceCursor<common_types::SPersistenceWeather>>;
+
     struct SInitSettings {
         SInitSettings()
             : host("localhost")
             , port(MONGOC_DEFAULT_PORT)
+            , clientPoolEnable(false)
+            , clientPoolMaxSize(0)
+            , fanOutThreads(0)
+            , trajectoryCacheEnable(false)
+            , writeBehindEnable(false)
+            , sessionSummaryEnable(false)
+            , prefetchEnable(false)
+            , deleteBatchSize(1000)
+            , retentionEnable(false)
+            , liveTailEnable(false)
+            , liveTailChangeStreams(false)
+            , snapshotImportThreads(4)
         {}
         std::string host;
         uint16_t port;
         std::string databaseName;
         std::string projectPrefix;
+
+        bool clientPoolEnable; // each thread works with its own client ( forced by write-behind )
+        uint32_t clientPoolMaxSize; // 0 - driver default, otherwise covers callers & every thread of instance ( checked )
+        int32_t fanOutThreads; // batch reads workers ( forces client pool ), 0 - sequential
+
+        bool trajectoryCacheEnable;
+        TrajectoryCache::SInitSettings trajectoryCache;
+
+        bool writeBehindEnable;
+        TrajectoryWriteBehind::SInitSettings writeBehind; // flush function is set by manager
+
+        bool sessionSummaryEnable;
+
+        bool prefetchEnable; // forces client pool
+        TrajectoryPrefetcher::SInitSettings prefetch; // fetch function is set by manager
+
+        int32_t deleteBatchSize; // records per one remove of range deletion
+
+        bool retentionEnable; // forces client pool
+        RetentionEngine::SInitSettings retention; // storage & delete functions are set by manager
+
+        bool liveTailEnable;
+        bool liveTailChangeStreams; // writes of other processes ( replica set only ), forces client pool
+        TrajectorySubscriptions::SInitSettings liveTail;
+
+        int32_t snapshotImportThreads; // parallel bulk writers ( client pool only, otherwise 1 )
+
+        BulkWritePolicies::SWritePolicy writePolicy; // payload writes of sets without own policy
     };
 
     static DatabaseManagerBase * getInstance();
@@ -41,39 +102,73 @@ public:
     // -------------------------------------------------------------------------------------
     bool init( SInitSettings _settings );
     inline std::string getTableName( common_types::TPersistenceSetId _persId );
+    void releaseThreadHandles();
 
     // -------------------------------------------------------------------------------------
     // objects ( by 'pers id' -> more precise approach, while by 'ctx id' -> more global
     // -------------------------------------------------------------------------------------
     // metadata
-    common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataVideo & _videoMetadata );
-    common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataDSS & _dssMetadata );
-    common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataRaw & _rawMetadata );
-    std::vector<common_types::SPersistenceMetadata> getPersistenceSetMetadata( common_types::TContextId _ctxId = common_vars::ALL_CONTEXT_ID );
-    common_types::SPersistenceMetadata getPersistenceSetMetadata( common_types::TPersistenceSetId _persId );
-    void deletePersistenceSetMetadata( common_types::TPersistenceSetId _id );
-    void deletePersistenceSetMetadata( common_types::TContextId _ctxId );
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataVideo & _videoMetadata ) override;
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataDSS & _dssMetadata ) override;
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataRaw & _rawMetadata ) override;
+    virtual std::vector<common_types::SPersistenceMetadata> getPersistenceSetMetadata( common_types::TContextId _ctxId = common_vars::ALL_CONTEXT_ID ) override;
+    virtual common_types::SPersistenceMetadata getPersistenceSetMetadata( common_types::TPersistenceSetId _persId ) override;
+    virtual void deletePersistenceSetMetadata( common_types::TPersistenceSetId _id ) override;
+    virtual void deletePersistenceSetMetadata( common_types::TContextId _ctxId ) override;
 
     // payload
-    bool writeTrajectoryData( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data );
-    std::vector<common_types::SPersistenceTrajectory> readTrajectoryData( const common_types::SPersistenceSetFilter & _filter );
+    virtual bool writeTrajectoryData( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data ) override;
+    virtual std::vector<common_types::SPersistenceTrajectory> readTrajectoryData( const common_types::SPersistenceSetFilter & _filter ) override;
+    std::vector<std::vector<common_types::SPersistenceTrajectory>> readTrajectoryDataBatch( const std::vector<common_types::SPersistenceSetFilter> & _filters );
+    std::vector<common_types::SPersistenceTrajectory> readTrajectoryDataMerged( const std::vector<common_types::SPersistenceSetFilter> & _filters );
+    TrajectoryCache::SCacheStats getTrajectoryCacheStats();
+    TrajectoryWriteBehind::SIngestStats getTrajectoryIngestStats();
+    TrajectoryPrefetcher::SPrefetchStats getTrajectoryPrefetchStats();
+    bool setWritePolicy( common_types::TPersistenceSetId _persId, const BulkWritePolicies::SWritePolicy & _policy );
+    std::vector<BulkWritePolicies::SPolicyStats> getWritePolicyStats();
+    void flushTrajectoryData( common_types::TPersistenceSetId _persId );
+    // NOTE: in pooled mode cursor belongs to the client of the opening thread
+    PTrajectoryCursor openTrajectoryCursor( const common_types::SPersistenceSetFilter & _filter, int32_t _batchSize );
+    bool readTrajectoryDataStream( const common_types::SPersistenceSetFilter & _filter,
+                                   int32_t _batchSize,
+                                   std::function<bool( const std::vector<common_types::SPersistenceTrajectory> & )> _consumer );
     bool writeWeatherData( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceWeather> & _data );
     std::vector<common_types::SPersistenceWeather> readWeatherData( const common_types::SPersistenceSetFilter & _filter );
-    void deleteDataRange( const common_types::SPersistenceSetFilter & _filter );
-    void deleteTotalData( const common_types::TContextId _ctxId );
+    PWeatherCursor openWeatherCursor( const common_types::SPersistenceSetFilter & _filter, int32_t _batchSize );
+    virtual void deleteDataRange( const common_types::SPersistenceSetFilter & _filter ) override;
+    virtual void deleteTotalData( const common_types::TContextId _ctxId ) override;
+
+    // retention
+    int64_t deleteExpiredPayload( const RetentionEngine::SRetentionCut & _cut, int32_t _batchSize );
+    bool dropPersistenceSet( common_types::TPersistenceSetId _persId );
+    void setRetentionPolicies( const std::vector<RetentionEngine::SRetentionPolicy> & _policies );
+    void runRetention();
+    RetentionEngine::SRetentionStats getRetentionStats();
+
+    // live tail
+    TrajectorySubscriptions::TSubscriptionId subscribeTrajectory( common_types::TPersistenceSetId _persId,
+                                                                  const std::vector<common_types::TObjectId> & _objIds,
+                                                                  TrajectorySubscriptions::TDeliverFunc _deliver );
+    void unsubscribeTrajectory( TrajectorySubscriptions::TSubscriptionId _id );
+    TrajectorySubscriptions::SLiveTailStats getLiveTailStats();
+
+    // portable copy of one persistence set
+    bool exportSnapshot( common_types::TPersistenceSetId _persId, const std::string & _path );
+    common_types::TPersistenceSetId importSnapshot( const std::string & _path );
 
     // payload description
-    bool insertSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr );
-    bool updateSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr );
-    std::vector<common_types::SEventsSessionInfo> selectSessionDescriptions( const common_types::TPersistenceSetId _persId );
-    std::vector<common_types::SEventsSessionInfo> scanPayloadForSessions( const common_types::TPersistenceSetId _persId,
-            const common_types::TSessionNum _beginFromSession = 0 );
-    common_types::SEventsSessionInfo scanPayloadHeadForSessions( const common_types::TPersistenceSetId _persId );
-    common_types::SEventsSessionInfo scanPayloadTailForSessions( const common_types::TPersistenceSetId _persId );
-    std::vector<common_types::SEventsSessionInfo> scanPayloadRangeForSessions( const common_types::TPersistenceSetId _persId,
-            const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange );
-    void deleteSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::TSessionNum _sessionNum = common_vars::ALL_SESSION_NUM );
-    void deleteSessionDescription( const common_types::TContextId _ctxId );
+    virtual bool insertSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr ) override;
+    virtual bool updateSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr ) override;
+    virtual std::vector<common_types::SEventsSessionInfo> selectSessionDescriptions( const common_types::TPersistenceSetId _persId ) override;
+    virtual std::vector<common_types::SEventsSessionInfo> scanPayloadForSessions( const common_types::TPersistenceSetId _persId,
+            const common_types::TSessionNum _beginFromSession = 0 ) override;
+    virtual common_types::SEventsSessionInfo scanPayloadHeadForSessions( const common_types::TPersistenceSetId _persId ) override;
+    virtual common_types::SEventsSessionInfo scanPayloadTailForSessions( const common_types::TPersistenceSetId _persId ) override;
+    virtual std::vector<common_types::SEventsSessionInfo> scanPayloadRangeForSessions( const common_types::TPersistenceSetId _persId,
+            const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange ) override;
+    virtual void deleteSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::TSessionNum _sessionNum = common_vars::ALL_SESSION_NUM ) override;
+    virtual void deleteSessionDescription( const common_types::TContextId _ctxId ) override;
+    void flushSessionDescriptions();
 
     // TODO: obsoleted ( heavy version )
     std::vector<common_types::SEventsSessionInfo> getPersistenceSetSessions( common_types::TPersistenceSetId _persId );
@@ -98,6 +193,63 @@ public:
 
 
 private:
+    // in pooled mode each thread has its own set, otherwise one set is shared
+    struct SThreadHandles {
+        SThreadHandles()
+            : client(nullptr)
+            , database(nullptr)
+            , tableWALClientOperations(nullptr)
+            , tableWALProcessEvents(nullptr)
+            , tableWALUserRegistrations(nullptr)
+            , tablePersistenceMetadata(nullptr)
+            , tablePersistenceDescription(nullptr)
+            , tablePersistenceCounter(nullptr)
+            , tablePersistenceFromVideo(nullptr)
+            , tablePersistenceFromDSS(nullptr)
+            , tablePersistenceFromRaw(nullptr)
+            , tablesGeneration(0)
+        {}
+        mongoc_client_t * client;
+        mongoc_database_t * database;
+        mongoc_collection_t * tableWALClientOperations;
+        mongoc_collection_t * tableWALProcessEvents;
+        mongoc_collection_t * tableWALUserRegistrations;
+        mongoc_collection_t * tablePersistenceMetadata;
+        mongoc_collection_t * tablePersistenceDescription;
+        mongoc_collection_t * tablePersistenceCounter;
+        mongoc_collection_t * tablePersistenceFromVideo;
+        mongoc_collection_t * tablePersistenceFromDSS;
+        mongoc_collection_t * tablePersistenceFromRaw;
+        std::vector<mongoc_collection_t *> allTables;
+        std::unordered_map<common_types::TPersistenceSetId, mongoc_collection_t *> tablesByPersistenceId;
+        uint64_t tablesGeneration; // collections of removed sets are dropped by the owner thread
+    };
+
+    // pooled client of a thread goes back on thread exit, unless it was released earlier
+    struct SHandlesOwner {
+        SHandlesOwner()
+            : manager(nullptr)
+        {}
+        std::mutex mutex;
+        DatabaseManagerBase * manager; // null after manager destruction
+    };
+
+    struct SThreadHandlesGuard {
+        ~SThreadHandlesGuard();
+        void add( const std::shared_ptr<SHandlesOwner> & _owner );
+        std::vector<std::shared_ptr<SHandlesOwner>> owners;
+    };
+
+    // live tail watcher of one payload table
+    struct SChangeStream {
+        SChangeStream()
+            : thread(nullptr)
+            , stop(false)
+        {}
+        std::thread * thread;
+        std::atomic<bool> stop;
+    };
+
     static void systemInit();
 
     DatabaseManagerBase();
@@ -120,8 +272,39 @@ private:
     void deletePersistenceFromDSS( common_types::TPersistenceSetId _persId );
     void deletePersistenceFromVideo( common_types::TPersistenceSetId _persId );
 
+    // object payload
+    // returns count of written records ( prefix of '_data', the rest is for retry )
+    size_t writeTrajectoryDataToStore( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data );
+    void payloadWritten( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data );
+    std::vector<common_types::SPersistenceTrajectory> readTrajectoryDataFromStore( const common_types::SPersistenceSetFilter & _filter );
+    std::vector<common_types::SPersistenceTrajectory> readTrajectoryDataDownsampled( const common_types::SPersistenceSetFilter & _filter );
+    std::vector<common_types::SPersistenceTrajectory> aggregateTrajectoryDataInStore( const common_types::SPersistenceSetFilter & _filter );
+    bool loadTrajectorySessionToCache( const common_types::SPersistenceSetFilter & _filter );
+    void threadChangeStream( common_types::TPersistenceSetId _persId, SChangeStream * _stream );
+    void stopChangeStream( SChangeStream * _stream );
+    int64_t removePayloadBatch( common_types::TPersistenceSetId _persId, const bson_t * _query, int32_t _batchSize );
+    void invalidatePayloadCaches( common_types::TPersistenceSetId _persId );
+    mongoc_bulk_operation_t * createPayloadBulk( mongoc_collection_t * _table, const BulkWritePolicies::SWritePolicy & _policy );
+    bool executePayloadBulk( common_types::TPersistenceSetId _persId, mongoc_bulk_operation_t * _bulk, int32_t _records );
+    // schema-described payload types
+    template< typename T_Record >
+    bool writePayloadToStore( common_types::TPersistenceSetId _persId, const std::vector<T_Record> & _data );
+    template< typename T_Record >
+    std::vector<T_Record> readPayloadFromStore( const common_types::SPersistenceSetFilter & _filter );
+    template< typename T_Record >
+    std::shared_ptr<PersistenceCursor<T_Record>> openPayloadCursor( const common_types::SPersistenceSetFilter & _filter, int32_t _batchSize );
+
     // object payload - description
-    bool isSessionExistInDescription( const common_types::TSessionNum _sessionNum );
+    bool discoverSessions( const common_types::TPersistenceSetId _persId,
+                           const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange,
+                           const common_types::TLogicStep _gapThreshold,
+                           const bool _withSteps,
+                           std::vector<common_types::SEventsSessionInfo> & _out );
+    bool findBoundarySession( const common_types::TPersistenceSetId _persId, const bool _first, common_types::TSessionNum & _sessionNum );
+    bool isSessionExistInDescription( const common_types::TPersistenceSetId _persId, const common_types::TSessionNum _sessionNum );
+    bool upsertSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr );
+    bool seedSessionSummary( const common_types::TPersistenceSetId _persId );
+    void flushSessionDescriptions( const common_types::TPersistenceSetId _persId, bool _withTail );
     common_types::SEventsSessionInfo getSessionInfo( const common_types::TPersistenceSetId _persId,
             const common_types::TSessionNum _sessionNum );
     std::vector<common_types::SEventsSessionInfo> splitSessionByGaps( const common_types::TPersistenceSetId _persId,
@@ -129,32 +312,58 @@ private:
                                                                       const common_types::TLogicStep _logicStepThreshold = 0 );
 
     // service
+    uint32_t getPinnedClientsCount( size_t _changeStreams ) const;
+    SThreadHandles * createThreadHandles( mongoc_client_t * _client );
+    void destroyThreadHandles( SThreadHandles * _handles );
+    SThreadHandles & handles();
     void initPayloadTableReferences();
-    inline void createPayloadTableRef( common_types::TPersistenceSetId _persId, const std::string _tableName );
+    inline void createPayloadTableRef( common_types::TPersistenceSetId _persId,
+                                       const std::string _tableName,
+                                       common_types::EPersistenceStorageLayout _layout,
+                                       common_types::EPersistenceDataType _dataType );
+    inline common_types::EPersistenceStorageLayout getStorageLayout( common_types::TPersistenceSetId _persId );
+    inline common_types::EPersistenceDataType getDataType( common_types::TPersistenceSetId _persId );
     inline mongoc_collection_t * getPayloadTableRef( common_types::TPersistenceSetId _persId );    
+    bool isPersistenceSetKnown( common_types::TPersistenceSetId _persId );
+    void forgetPayloadTable( common_types::TPersistenceSetId _persId );
+    void dropRemovedTableRefs( SThreadHandles & _handles );
+    void createPayloadIndexes( const std::string & _tableName, common_types::EPersistenceStorageLayout _layout, common_types::EPersistenceDataType _dataType );
     inline bool createIndex( const std::string & _tableName, const std::vector<std::string> & _fieldNames );
+    inline bool createIndex( const std::string & _tableName, const std::vector<std::pair<std::string, std::string>> & _fieldTypes );
+    std::unordered_set<std::string> getIndexNames( const std::string & _tableName );
+    bool backfillPayloadLocation( const std::string & _tableName );
 
     bool isPersistenceMetadataValid( common_types::TPersistenceSetId _persId, const common_types::SPersistenceMetadataDescr & _meta );
     common_types::TPersistenceSetId createNewPersistenceId();
+    void seedPersistenceIdCounter( common_types::TPersistenceSetId _maxExistingId );
 
     // data
     SInitSettings m_settings;
-    mongoc_collection_t * m_tableWALClientOperations;
-    mongoc_collection_t * m_tableWALProcessEvents;
-    mongoc_collection_t * m_tableWALUserRegistrations;
-    mongoc_collection_t * m_tablePersistenceMetadata;
-    mongoc_collection_t * m_tablePersistenceDescription;
-    mongoc_collection_t * m_tablePersistenceFromVideo;
-    mongoc_collection_t * m_tablePersistenceFromDSS;
-    mongoc_collection_t * m_tablePersistenceFromRaw;
-    std::vector<mongoc_collection_t *> m_allTables;
-    std::unordered_map<common_types::TPersistenceSetId, mongoc_collection_t *> m_tablesByPersistenceId;
     std::unordered_map<common_types::TPersistenceSetId, std::string> m_tableNameByPersistenceId;
+    std::unordered_map<common_types::TPersistenceSetId, common_types::EPersistenceStorageLayout> m_storageLayoutByPersistenceId;
+    std::unordered_map<common_types::TPersistenceSetId, common_types::EPersistenceDataType> m_dataTypeByPersistenceId;
     std::string m_tableNamePrefix;
+    MetadataCatalog m_metadataCatalog;
+    BulkWritePolicies m_bulkPolicies;
 
     // service
-    mongoc_client_t * m_mongoClient;
-    mongoc_database_t * m_mongoDatabase;    
+    TrajectoryCache * m_trajectoryCache;
+    TrajectoryWriteBehind * m_writeBehind;
+    SessionSummary * m_sessionSummary;
+    ThreadPool * m_fanOutPool;
+    TrajectoryPrefetcher * m_prefetcher;
+    RetentionEngine * m_retention;
+    TrajectorySubscriptions * m_liveTail;
+    int64_t m_originId;
+    std::unordered_map<common_types::TPersistenceSetId, SChangeStream *> m_changeStreams;
+    std::mutex m_mutexChangeStreams;
+    mongoc_client_pool_t * m_mongoClientPool;
+    SThreadHandles * m_sharedHandles;
+    std::unordered_map<std::thread::id, SThreadHandles *> m_handlesByThread;
+    std::shared_ptr<SHandlesOwner> m_handlesOwner;
+    std::shared_timed_mutex m_mutexHandles;
+    std::shared_timed_mutex m_mutexTableNames;    
+    std::atomic<uint64_t> m_tablesGeneration;
 };
 
 #endif // DATABASE_MANAGER_BASE_H
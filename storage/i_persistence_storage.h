@@ -0,0 +1,44 @@
+#ifndef I_PERSISTENCE_STORAGE_H
+#define I_PERSISTENCE_STORAGE_H
+
+#include <vector>
+
+#include "common/ms_common_types.h"
+#include "common/ms_common_vars.h"
+
+// persistence sets API independent from the storage engine ( mongo, local mapped files, ... )
+class IPersistenceStorage
+{
+public:
+    virtual ~IPersistenceStorage(){}
+
+    // metadata
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataVideo & _videoMetadata ) = 0;
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataDSS & _dssMetadata ) = 0;
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataRaw & _rawMetadata ) = 0;
+    virtual std::vector<common_types::SPersistenceMetadata> getPersistenceSetMetadata( common_types::TContextId _ctxId = common_vars::ALL_CONTEXT_ID ) = 0;
+    virtual common_types::SPersistenceMetadata getPersistenceSetMetadata( common_types::TPersistenceSetId _persId ) = 0;
+    virtual void deletePersistenceSetMetadata( common_types::TPersistenceSetId _id ) = 0;
+    virtual void deletePersistenceSetMetadata( common_types::TContextId _ctxId ) = 0;
+
+    // payload
+    virtual bool writeTrajectoryData( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data ) = 0;
+    virtual std::vector<common_types::SPersistenceTrajectory> readTrajectoryData( const common_types::SPersistenceSetFilter & _filter ) = 0;
+    virtual void deleteDataRange( const common_types::SPersistenceSetFilter & _filter ) = 0;
+    virtual void deleteTotalData( const common_types::TContextId _ctxId ) = 0;
+
+    // payload description
+    virtual bool insertSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr ) = 0;
+    virtual bool updateSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr ) = 0;
+    virtual std::vector<common_types::SEventsSessionInfo> selectSessionDescriptions( const common_types::TPersistenceSetId _persId ) = 0;
+    virtual std::vector<common_types::SEventsSessionInfo> scanPayloadForSessions( const common_types::TPersistenceSetId _persId,
+            const common_types::TSessionNum _beginFromSession = 0 ) = 0;
+    virtual common_types::SEventsSessionInfo scanPayloadHeadForSessions( const common_types::TPersistenceSetId _persId ) = 0;
+    virtual common_types::SEventsSessionInfo scanPayloadTailForSessions( const common_types::TPersistenceSetId _persId ) = 0;
+    virtual std::vector<common_types::SEventsSessionInfo> scanPayloadRangeForSessions( const common_types::TPersistenceSetId _persId,
+            const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange ) = 0;
+    virtual void deleteSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::TSessionNum _sessionNum = common_vars::ALL_SESSION_NUM ) = 0;
+    virtual void deleteSessionDescription( const common_types::TContextId _ctxId ) = 0;
+};
+
+#endif // I_PERSISTENCE_STORAGE_H
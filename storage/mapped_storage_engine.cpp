@@ -0,0 +1,1010 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "system/logger.h"
+#include "common/ms_common_vars.h"
+#include "mapped_storage_engine.h"
+#include "trajectory_downsampler.h"
+#include "trajectory_point_predicate.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "MappedStorage:";
+static constexpr uint32_t SEGMENT_MAGIC = 0x4D534547; // 'MSEG'
+static constexpr uint32_t SEGMENT_VERSION = 1;
+static constexpr TLogicStep NO_GAP_SPLIT = -1;
+static const string CATALOG_FILE_NAME = "catalog";
+static const string SEGMENT_FILE_PREFIX = "set_";
+static const string SEGMENT_FILE_SUFFIX = ".seg";
+
+// records are copied into mapping as is
+static_assert( std::is_trivially_copyable<SPersistenceTrajectory>::value, "trajectory record must be trivially copyable" );
+
+static string makeSegmentPath( const string & _directory, TPersistenceSetId _persId, size_t _segmentNum ){
+
+    char name[ 64 ];
+    std::snprintf( name, sizeof(name), "%lld_%06zu", (long long)_persId, _segmentNum );
+    return _directory + "/" + SEGMENT_FILE_PREFIX + name + SEGMENT_FILE_SUFFIX;
+}
+
+static bool parseSegmentName( const string & _name, TPersistenceSetId & _persId, size_t & _segmentNum ){
+
+    if( _name.size() <= SEGMENT_FILE_PREFIX.size() + SEGMENT_FILE_SUFFIX.size()
+            || 0 != _name.compare(0, SEGMENT_FILE_PREFIX.size(), SEGMENT_FILE_PREFIX)
+            || 0 != _name.compare(_name.size() - SEGMENT_FILE_SUFFIX.size(), SEGMENT_FILE_SUFFIX.size(), SEGMENT_FILE_SUFFIX) ){
+        return false;
+    }
+
+    long long persId = 0;
+    unsigned long long segmentNum = 0;
+    if( 2 != std::sscanf(_name.c_str() + SEGMENT_FILE_PREFIX.size(), "%lld_%llu", & persId, & segmentNum) ){
+        return false;
+    }
+
+    _persId = persId;
+    _segmentNum = segmentNum;
+    return true;
+}
+
+MappedStorageEngine::MappedStorageEngine()
+    : m_lastPersistenceId(0)
+    , m_inited(false)
+{
+
+}
+
+MappedStorageEngine::~MappedStorageEngine()
+{
+    shutdown();
+}
+
+bool MappedStorageEngine::init( const SInitSettings & _settings ){
+
+    if( _settings.directory.empty() ){
+        VS_LOG_ERROR << PRINT_HEADER << " storage directory is not set" << endl;
+        return false;
+    }
+
+    if( _settings.segmentMaxBytes < (int64_t)(sizeof(SSegmentHeader) + sizeof(SPersistenceTrajectory)) || _settings.indexStride <= 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid segment size or index stride" << endl;
+        return false;
+    }
+
+    if( 0 != ::mkdir(_settings.directory.c_str(), 0755) && errno != EEXIST ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot create dir [" << _settings.directory << "], reason: " << strerror(errno) << endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+    m_settings = _settings;
+
+    if( ! loadCatalog() ){
+        return false;
+    }
+    loadPayloadSets();
+
+    m_inited = true;
+    VS_LOG_INFO << PRINT_HEADER << " inited in [" << m_settings.directory << "]"
+                << " sets: " << m_payloadSets.size()
+                << " last persistence id: " << m_lastPersistenceId
+                << endl;
+    return true;
+}
+
+void MappedStorageEngine::shutdown(){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+    if( ! m_inited ){
+        return;
+    }
+
+    for( auto & valuePair : m_payloadSets ){
+        for( SSegment * segment : valuePair.second.segments ){
+            closeSegment( segment, false );
+        }
+    }
+    m_payloadSets.clear();
+    m_descriptions.clear();
+    m_metadataCatalog.clear();
+    m_inited = false;
+}
+
+// -------------------------------------------------------------------------------------
+// segments
+// -------------------------------------------------------------------------------------
+MappedStorageEngine::SSegment * MappedStorageEngine::openSegment( const std::string & _path, bool _create ){
+
+    const int fd = ::open( _path.c_str(), _create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0644 );
+    if( fd < 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot open segment [" << _path << "], reason: " << strerror(errno) << endl;
+        return nullptr;
+    }
+
+    // file is preallocated once, appends only touch mapping
+    if( _create && 0 != ::ftruncate(fd, m_settings.segmentMaxBytes) ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot allocate segment [" << _path << "], reason: " << strerror(errno) << endl;
+        ::close( fd );
+        return nullptr;
+    }
+
+    struct stat st;
+    if( 0 != ::fstat(fd, & st) || st.st_size < (off_t)(sizeof(SSegmentHeader)) ){
+        VS_LOG_ERROR << PRINT_HEADER << " segment is truncated [" << _path << "]" << endl;
+        ::close( fd );
+        return nullptr;
+    }
+
+    void * mapped = ::mmap( nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if( MAP_FAILED == mapped ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot map segment [" << _path << "], reason: " << strerror(errno) << endl;
+        ::close( fd );
+        return nullptr;
+    }
+
+    SSegment * segment = new SSegment();
+    segment->path = _path;
+    segment->fd = fd;
+    segment->mapped = mapped;
+    segment->mappedBytes = st.st_size;
+    segment->capacity = ( st.st_size - sizeof(SSegmentHeader) ) / sizeof(SPersistenceTrajectory);
+
+    SSegmentHeader * header = segment->header();
+    if( _create ){
+        header->magic = SEGMENT_MAGIC;
+        header->version = SEGMENT_VERSION;
+        header->recordSize = sizeof(SPersistenceTrajectory);
+        header->reserved = 0;
+        header->recordsCount = 0;
+        return segment;
+    }
+
+    if( header->magic != SEGMENT_MAGIC
+            || header->version != SEGMENT_VERSION
+            || header->recordSize != sizeof(SPersistenceTrajectory)
+            || header->recordsCount > segment->capacity ){
+        VS_LOG_ERROR << PRINT_HEADER << " incompatible segment [" << _path << "]" << endl;
+        closeSegment( segment, false );
+        return nullptr;
+    }
+
+    for( uint64_t idx = 0; idx < header->recordsCount; idx++ ){
+        indexRecord( segment, idx );
+    }
+
+    return segment;
+}
+
+void MappedStorageEngine::closeSegment( SSegment * _segment, bool _unlink ){
+
+    ::munmap( _segment->mapped, _segment->mappedBytes );
+    ::close( _segment->fd );
+    if( _unlink ){
+        ::unlink( _segment->path.c_str() );
+    }
+    delete _segment;
+}
+
+void MappedStorageEngine::indexRecord( SSegment * _segment, uint64_t _idx ){
+
+    const SPersistenceTrajectory & record = _segment->records()[ _idx ];
+    const TRecordKey key( record.sessionNum, record.logicTime );
+
+    if( 0 == _idx ){
+        _segment->minKey = key;
+        _segment->maxKey = key;
+        _segment->sparseIndex.push_back( std::make_pair(key, _idx) );
+        return;
+    }
+
+    // out of order append -> index is no longer valid, segment will be scanned
+    if( key < _segment->maxKey && _segment->sorted ){
+        _segment->sorted = false;
+        _segment->sparseIndex.clear();
+        _segment->sparseIndex.shrink_to_fit();
+    }
+
+    _segment->minKey = std::min( _segment->minKey, key );
+    _segment->maxKey = std::max( _segment->maxKey, key );
+
+    if( _segment->sorted && 0 == (_idx % m_settings.indexStride) ){
+        _segment->sparseIndex.push_back( std::make_pair(key, _idx) );
+    }
+}
+
+MappedStorageEngine::SPayloadSet & MappedStorageEngine::getPayloadSet( TPersistenceSetId _persId ){
+    return m_payloadSets[ _persId ];
+}
+
+void MappedStorageEngine::loadPayloadSets(){
+
+    DIR * dir = ::opendir( m_settings.directory.c_str() );
+    if( ! dir ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot open dir [" << m_settings.directory << "]" << endl;
+        return;
+    }
+
+    std::map<TPersistenceSetId, std::map<size_t, string>> pathsBySet;
+    dirent * de = nullptr;
+    while( (de = ::readdir( dir )) != nullptr ){
+        TPersistenceSetId persId = 0;
+        size_t segmentNum = 0;
+        if( parseSegmentName(de->d_name, persId, segmentNum) ){
+            pathsBySet[ persId ][ segmentNum ] = m_settings.directory + "/" + de->d_name;
+        }
+    }
+    ::closedir( dir );
+
+    for( const auto & valuePair : pathsBySet ){
+        SPayloadSet & payloadSet = getPayloadSet( valuePair.first );
+        for( const auto & segmentPath : valuePair.second ){
+            SSegment * segment = openSegment( segmentPath.second, false );
+            if( segment ){
+                payloadSet.segments.push_back( segment );
+            }
+        }
+    }
+}
+
+void MappedStorageEngine::removePayloadSet( TPersistenceSetId _persId ){
+
+    auto iter = m_payloadSets.find( _persId );
+    if( iter == m_payloadSets.end() ){
+        return;
+    }
+
+    for( SSegment * segment : iter->second.segments ){
+        closeSegment( segment, true );
+    }
+    m_payloadSets.erase( iter );
+}
+
+void MappedStorageEngine::removePayloadRange( TPersistenceSetId _persId, const TRecordKey & _from, const TRecordKey & _to, const TrajectoryPointPredicate & _predicate ){
+
+    auto iter = m_payloadSets.find( _persId );
+    if( iter == m_payloadSets.end() ){
+        return;
+    }
+
+    // segments are compacted in place, emptied ones stay in sequence
+    for( SSegment * segment : iter->second.segments ){
+        const uint64_t count = segment->header()->recordsCount;
+        if( 0 == count || _to < segment->minKey || segment->maxKey < _from ){
+            continue;
+        }
+
+        SPersistenceTrajectory * records = segment->records();
+        uint64_t kept = 0;
+        for( uint64_t idx = 0; idx < count; idx++ ){
+            const TRecordKey key( records[ idx ].sessionNum, records[ idx ].logicTime );
+            const bool removed = ( ! (key < _from) && ! (_to < key) && (_predicate.empty() || _predicate.accepts(records[ idx ])) );
+            if( ! removed ){
+                if( kept != idx ){
+                    records[ kept ] = records[ idx ];
+                }
+                kept++;
+            }
+        }
+
+        if( kept == count ){
+            continue;
+        }
+
+        segment->header()->recordsCount = kept;
+        segment->sorted = true;
+        segment->sparseIndex.clear();
+        for( uint64_t idx = 0; idx < kept; idx++ ){
+            indexRecord( segment, idx );
+        }
+    }
+}
+
+void MappedStorageEngine::visitRange( TPersistenceSetId _persId, const TRecordKey & _from, const TRecordKey & _to, TTrajectoryViewFunc & _func ){
+
+    auto iter = m_payloadSets.find( _persId );
+    if( iter == m_payloadSets.end() ){
+        return;
+    }
+
+    for( SSegment * segment : iter->second.segments ){
+        const uint64_t count = segment->header()->recordsCount;
+        if( 0 == count || _to < segment->minKey || segment->maxKey < _from ){
+            continue;
+        }
+
+        const SPersistenceTrajectory * records = segment->records();
+
+        // sorted: start from the nearest index entry, stop after range end
+        if( segment->sorted ){
+            // entry strictly before range ( several records may share the same key )
+            auto iterIndex = std::lower_bound( segment->sparseIndex.begin(),
+                                               segment->sparseIndex.end(),
+                                               _from,
+                                               []( const std::pair<TRecordKey, uint64_t> & _entry, const TRecordKey & _key ){ return _entry.first < _key; } );
+            uint64_t begin = ( iterIndex == segment->sparseIndex.begin() ) ? 0 : std::prev( iterIndex )->second;
+
+            while( begin < count && TRecordKey(records[ begin ].sessionNum, records[ begin ].logicTime) < _from ){
+                begin++;
+            }
+
+            uint64_t end = begin;
+            while( end < count && ! (_to < TRecordKey(records[ end ].sessionNum, records[ end ].logicTime)) ){
+                end++;
+            }
+
+            if( end > begin ){
+                _func( records + begin, end - begin );
+            }
+            continue;
+        }
+
+        // unsorted: contiguous runs of matched records
+        uint64_t runBegin = 0;
+        uint64_t runSize = 0;
+        for( uint64_t idx = 0; idx < count; idx++ ){
+            const TRecordKey key( records[ idx ].sessionNum, records[ idx ].logicTime );
+            if( ! (key < _from) && ! (_to < key) ){
+                if( 0 == runSize ){
+                    runBegin = idx;
+                }
+                runSize++;
+            }
+            else if( runSize > 0 ){
+                _func( records + runBegin, runSize );
+                runSize = 0;
+            }
+        }
+
+        if( runSize > 0 ){
+            _func( records + runBegin, runSize );
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------
+// object payload
+// -------------------------------------------------------------------------------------
+bool MappedStorageEngine::writeTrajectoryData( TPersistenceSetId _persId, const std::vector<SPersistenceTrajectory> & _data ){
+
+    if( ! m_metadataCatalog.contains(_persId) ){
+        VS_LOG_ERROR << PRINT_HEADER << " write to unknown persistence id: " << _persId << endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+    SPayloadSet & payloadSet = getPayloadSet( _persId );
+
+    size_t written = 0;
+    while( written < _data.size() ){
+
+        SSegment * segment = payloadSet.segments.empty() ? nullptr : payloadSet.segments.back();
+        if( ! segment || segment->header()->recordsCount == segment->capacity ){
+            segment = openSegment( makeSegmentPath(m_settings.directory, _persId, payloadSet.segments.size()), true );
+            if( ! segment ){
+                return false;
+            }
+            payloadSet.segments.push_back( segment );
+        }
+
+        SSegmentHeader * header = segment->header();
+        const size_t toWrite = std::min( (size_t)(segment->capacity - header->recordsCount), _data.size() - written );
+        std::memcpy( segment->records() + header->recordsCount, _data.data() + written, toWrite * sizeof(SPersistenceTrajectory) );
+
+        for( size_t i = 0; i < toWrite; i++ ){
+            indexRecord( segment, header->recordsCount + i );
+        }
+
+        // count is published after records
+        header->recordsCount += toWrite;
+        written += toWrite;
+    }
+
+    return true;
+}
+
+static void makeRecordRange( const SPersistenceSetFilter & _filter,
+                             std::pair<TSessionNum, TLogicStep> & _from,
+                             std::pair<TSessionNum, TLogicStep> & _to ){
+
+    // only one step
+    if( (_filter.minLogicStep == _filter.maxLogicStep) && _filter.minLogicStep >= 0 ){
+        _from = std::make_pair( _filter.sessionNum, _filter.minLogicStep );
+        _to = _from;
+    }
+    // steps range
+    else if( _filter.minLogicStep >= 0 && _filter.maxLogicStep >= 0 ){
+        _from = std::make_pair( _filter.sessionNum, _filter.minLogicStep );
+        _to = std::make_pair( _filter.sessionNum, _filter.maxLogicStep );
+    }
+    // whole area
+    else{
+        _from = std::make_pair( std::numeric_limits<TSessionNum>::min(), std::numeric_limits<TLogicStep>::min() );
+        _to = std::make_pair( std::numeric_limits<TSessionNum>::max(), std::numeric_limits<TLogicStep>::max() );
+    }
+}
+
+std::vector<SPersistenceTrajectory> MappedStorageEngine::readTrajectoryData( const SPersistenceSetFilter & _filter ){
+
+    // reduced directly from mapping, points are not copied out
+    if( _filter.isDownsampled() ){
+        TrajectoryDownsampler downsampler( _filter );
+        forEachTrajectoryRange( _filter, [ & downsampler ]( const SPersistenceTrajectory * _records, size_t _count ){
+            downsampler.add( _records, _count );
+        });
+        return downsampler.getResult();
+    }
+
+    std::vector<SPersistenceTrajectory> out;
+    forEachTrajectoryRange( _filter, [ & out ]( const SPersistenceTrajectory * _records, size_t _count ){
+        out.insert( out.end(), _records, _records + _count );
+    });
+
+    return out;
+}
+
+void MappedStorageEngine::forEachTrajectoryRange( const SPersistenceSetFilter & _filter, TTrajectoryViewFunc _func ){
+
+    TRecordKey from;
+    TRecordKey to;
+    makeRecordRange( _filter, from, to );
+
+    const TrajectoryPointPredicate predicate( _filter );
+    if( predicate.empty() ){
+        std::lock_guard<std::mutex> lock( m_mutexStorage );
+        visitRange( _filter.persistenceSetId, from, to, _func );
+        return;
+    }
+
+    // accepted points are passed as sub-runs of the same view
+    TTrajectoryViewFunc filteredFunc = [ & predicate, & _func ]( const SPersistenceTrajectory * _records, size_t _count ){
+        size_t runBegin = 0;
+        for( size_t i = 0; i < _count; i++ ){
+            if( ! predicate.accepts(_records[ i ]) ){
+                if( i > runBegin ){
+                    _func( _records + runBegin, i - runBegin );
+                }
+                runBegin = i + 1;
+            }
+        }
+        if( _count > runBegin ){
+            _func( _records + runBegin, _count - runBegin );
+        }
+    };
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+    visitRange( _filter.persistenceSetId, from, to, filteredFunc );
+}
+
+void MappedStorageEngine::deleteDataRange( const SPersistenceSetFilter & _filter ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    // whole area - segment files are removed
+    if( (_filter.minLogicStep < 0 || _filter.maxLogicStep < 0) && ! _filter.hasPointPredicates() ){
+        removePayloadSet( _filter.persistenceSetId );
+        return;
+    }
+
+    TRecordKey from;
+    TRecordKey to;
+    makeRecordRange( _filter, from, to );
+    removePayloadRange( _filter.persistenceSetId, from, to, TrajectoryPointPredicate(_filter) );
+}
+
+void MappedStorageEngine::deleteTotalData( const TContextId _ctxId ){
+
+    const std::vector<TPersistenceSetId> persIds = getPersistenceIds( _ctxId );
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+    for( const TPersistenceSetId persId : persIds ){
+        removePayloadSet( persId );
+    }
+}
+
+// -------------------------------------------------------------------------------------
+// persistence metadata
+// -------------------------------------------------------------------------------------
+template< typename T_Metadata >
+TPersistenceSetId MappedStorageEngine::writeMetadata( const T_Metadata & _meta ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    // update existing PersistenceId ( if it valid of course )
+    if( _meta.persistenceSetId != SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID ){
+        if( ! isPersistenceMetadataValid(_meta.persistenceSetId, _meta) ){
+            return SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+        }
+
+        m_metadataCatalog.put( _meta );
+        saveCatalog();
+        return _meta.persistenceSetId;
+    }
+
+    // create new persistence record
+    T_Metadata metadata = _meta;
+    metadata.persistenceSetId = ++m_lastPersistenceId;
+
+    m_metadataCatalog.put( metadata );
+    if( ! saveCatalog() ){
+        m_metadataCatalog.removeSet( metadata.persistenceSetId );
+        return SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+    }
+
+    return metadata.persistenceSetId;
+}
+
+TPersistenceSetId MappedStorageEngine::writePersistenceSetMetadata( const SPersistenceMetadataVideo & _videoMetadata ){
+    return writeMetadata( _videoMetadata );
+}
+
+TPersistenceSetId MappedStorageEngine::writePersistenceSetMetadata( const SPersistenceMetadataDSS & _dssMetadata ){
+    return writeMetadata( _dssMetadata );
+}
+
+TPersistenceSetId MappedStorageEngine::writePersistenceSetMetadata( const SPersistenceMetadataRaw & _rawMetadata ){
+    return writeMetadata( _rawMetadata );
+}
+
+std::vector<SPersistenceMetadata> MappedStorageEngine::getPersistenceSetMetadata( TContextId _ctxId ){
+    return m_metadataCatalog.getByContext( _ctxId );
+}
+
+SPersistenceMetadata MappedStorageEngine::getPersistenceSetMetadata( TPersistenceSetId _persId ){
+    return m_metadataCatalog.get( _persId );
+}
+
+void MappedStorageEngine::deletePersistenceSetMetadata( TPersistenceSetId _id ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+    if( ! m_metadataCatalog.contains(_id) ){
+        VS_LOG_ERROR << PRINT_HEADER << " persistence id not found for deleting: " << _id << endl;
+        return;
+    }
+
+    m_metadataCatalog.removeSet( _id );
+    saveCatalog();
+}
+
+void MappedStorageEngine::deletePersistenceSetMetadata( TContextId _ctxId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+    m_metadataCatalog.removeContext( _ctxId );
+    saveCatalog();
+}
+
+bool MappedStorageEngine::isPersistenceMetadataValid( TPersistenceSetId _persId, const SPersistenceMetadataDescr & _meta ){
+
+    SPersistenceMetadataDescr storedMeta;
+    if( ! m_metadataCatalog.getDescr(_persId, storedMeta) ){
+        VS_LOG_ERROR << PRINT_HEADER << " such persistence id not found in catalog: " << _persId << endl;
+        return false;
+    }
+
+    if( storedMeta.contextId != _meta.contextId
+            || storedMeta.sourceType != _meta.sourceType
+            || storedMeta.storageLayout != _meta.storageLayout ){
+        VS_LOG_ERROR << PRINT_HEADER << " forbidden change of persistence id: " << _persId
+                     << " (context, source type and storage layout are immutable)"
+                     << endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<TPersistenceSetId> MappedStorageEngine::getPersistenceIds( TContextId _ctxId ){
+
+    std::vector<TPersistenceSetId> out;
+    for( const SPersistenceMetadata & meta : m_metadataCatalog.getByContext(_ctxId) ){
+        for( const SPersistenceMetadataDSS & metaDSS : meta.persistenceFromDSS ){
+            out.push_back( metaDSS.persistenceSetId );
+        }
+
+        for( const SPersistenceMetadataRaw & metaRaw : meta.persistenceFromRaw ){
+            out.push_back( metaRaw.persistenceSetId );
+        }
+
+        for( const SPersistenceMetadataVideo & metaVideo : meta.persistenceFromVideo ){
+            out.push_back( metaVideo.persistenceSetId );
+        }
+    }
+
+    return out;
+}
+
+// -------------------------------------------------------------------------------------
+// catalog file
+// -------------------------------------------------------------------------------------
+// N <last persistence id>
+// M <source type> <pers id> <ctx id> <mission id> <step interval> <last session> <data type> <layout> <source specific>
+// D <pers id> <session> <min step> <max step> <min astro> <max astro> <empty begin> <empty end>
+static void writeDescrLine( FILE * _file, const SPersistenceMetadataDescr & _meta, int64_t _sourceSpecific ){
+
+    std::fprintf( _file, "M %d %lld %u %u %lld %d %d %d %lld\n",
+                  (int)_meta.sourceType,
+                  (long long)_meta.persistenceSetId,
+                  (unsigned)_meta.contextId,
+                  (unsigned)_meta.missionId,
+                  (long long)_meta.timeStepIntervalMillisec,
+                  (int)_meta.lastRecordedSession,
+                  (int)_meta.dataType,
+                  (int)_meta.storageLayout,
+                  (long long)_sourceSpecific );
+}
+
+bool MappedStorageEngine::saveCatalog(){
+
+    const string path = m_settings.directory + "/" + CATALOG_FILE_NAME;
+    const string pathTmp = path + ".tmp";
+
+    FILE * file = std::fopen( pathTmp.c_str(), "w" );
+    if( ! file ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot write catalog [" << pathTmp << "], reason: " << strerror(errno) << endl;
+        return false;
+    }
+
+    std::fprintf( file, "N %lld\n", (long long)m_lastPersistenceId );
+
+    for( const SPersistenceMetadata & meta : m_metadataCatalog.getByContext(common_vars::ALL_CONTEXT_ID) ){
+        for( const SPersistenceMetadataVideo & metaVideo : meta.persistenceFromVideo ){
+            writeDescrLine( file, metaVideo, (int64_t)metaVideo.recordedFromSensorId );
+        }
+
+        for( const SPersistenceMetadataDSS & metaDSS : meta.persistenceFromDSS ){
+            writeDescrLine( file, metaDSS, metaDSS.realData ? 1 : 0 );
+        }
+
+        for( const SPersistenceMetadataRaw & metaRaw : meta.persistenceFromRaw ){
+            writeDescrLine( file, metaRaw, metaRaw.a );
+        }
+    }
+
+    for( const auto & valuePair : m_descriptions ){
+        for( const auto & sessionPair : valuePair.second ){
+            const SEventsSessionInfo & descr = sessionPair.second;
+            std::fprintf( file, "D %lld %d %lld %lld %lld %lld %lld %lld\n",
+                          (long long)valuePair.first,
+                          (int)descr.number,
+                          (long long)descr.minLogicStep,
+                          (long long)descr.maxLogicStep,
+                          (long long)descr.minTimestampMillisec,
+                          (long long)descr.maxTimestampMillisec,
+                          (long long)descr.emptyStepsBegin,
+                          (long long)descr.emptyStepsEnd );
+        }
+    }
+
+    // old catalog is replaced only by complete new one
+    const bool written = ( 0 == std::fflush(file) && 0 == ::fsync(::fileno(file)) );
+    std::fclose( file );
+
+    if( ! written || 0 != std::rename(pathTmp.c_str(), path.c_str()) ){
+        VS_LOG_ERROR << PRINT_HEADER << " catalog replace failed, reason: " << strerror(errno) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool MappedStorageEngine::loadCatalog(){
+
+    m_metadataCatalog.clear();
+    m_descriptions.clear();
+    m_lastPersistenceId = 0;
+
+    const string path = m_settings.directory + "/" + CATALOG_FILE_NAME;
+    std::ifstream file( path );
+    if( ! file.is_open() ){
+        // fresh storage
+        return true;
+    }
+
+    string line;
+    int lineNum = 0;
+    while( std::getline(file, line) ){
+        lineNum++;
+        if( line.empty() ){
+            continue;
+        }
+
+        std::istringstream ss( line );
+        char tag = 0;
+        ss >> tag;
+
+        if( 'N' == tag ){
+            ss >> m_lastPersistenceId;
+        }
+        else if( 'M' == tag ){
+            int sourceType = 0, dataType = 0, layout = 0;
+            long long sourceSpecific = 0;
+            SPersistenceMetadataDescr descr;
+            ss >> sourceType
+               >> descr.persistenceSetId
+               >> descr.contextId
+               >> descr.missionId
+               >> descr.timeStepIntervalMillisec
+               >> descr.lastRecordedSession
+               >> dataType
+               >> layout
+               >> sourceSpecific;
+            descr.sourceType = (EPersistenceSourceType)sourceType;
+            descr.dataType = (EPersistenceDataType)dataType;
+            descr.storageLayout = (EPersistenceStorageLayout)layout;
+
+            if( ss.fail() ){
+                VS_LOG_ERROR << PRINT_HEADER << " catalog corrupted at line " << lineNum << endl;
+                return false;
+            }
+
+            switch( descr.sourceType ){
+            case EPersistenceSourceType::VIDEO_SERVER : {
+                SPersistenceMetadataVideo meta;
+                static_cast<SPersistenceMetadataDescr &>( meta ) = descr;
+                meta.recordedFromSensorId = sourceSpecific;
+                m_metadataCatalog.put( meta );
+                break;
+            }
+            case EPersistenceSourceType::DSS : {
+                SPersistenceMetadataDSS meta;
+                static_cast<SPersistenceMetadataDescr &>( meta ) = descr;
+                meta.realData = ( sourceSpecific != 0 );
+                m_metadataCatalog.put( meta );
+                break;
+            }
+            case EPersistenceSourceType::AUTONOMOUS_RECORDER : {
+                SPersistenceMetadataRaw meta;
+                static_cast<SPersistenceMetadataDescr &>( meta ) = descr;
+                meta.a = sourceSpecific;
+                m_metadataCatalog.put( meta );
+                break;
+            }
+            default : {
+                VS_LOG_WARN << PRINT_HEADER << " unknown source type at line " << lineNum << endl;
+            }
+            }
+
+            m_lastPersistenceId = std::max( m_lastPersistenceId, descr.persistenceSetId );
+        }
+        else if( 'D' == tag ){
+            TPersistenceSetId persId = 0;
+            SEventsSessionInfo descr;
+            ss >> persId
+               >> descr.number
+               >> descr.minLogicStep
+               >> descr.maxLogicStep
+               >> descr.minTimestampMillisec
+               >> descr.maxTimestampMillisec
+               >> descr.emptyStepsBegin
+               >> descr.emptyStepsEnd;
+
+            if( ss.fail() ){
+                VS_LOG_ERROR << PRINT_HEADER << " catalog corrupted at line " << lineNum << endl;
+                return false;
+            }
+
+            m_descriptions[ persId ][ descr.number ] = descr;
+        }
+    }
+
+    return true;
+}
+
+// -------------------------------------------------------------------------------------
+// payload description
+// -------------------------------------------------------------------------------------
+bool MappedStorageEngine::insertSessionDescription( const TPersistenceSetId _persId, const SEventsSessionInfo & _descr ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    std::map<TSessionNum, SEventsSessionInfo> & sessions = m_descriptions[ _persId ];
+    if( sessions.find(_descr.number) != sessions.end() ){
+        VS_LOG_ERROR << PRINT_HEADER << " insert description failed, such session num [" << _descr.number << "] ALREADY exist" << endl;
+        return false;
+    }
+
+    SEventsSessionInfo & stored = sessions[ _descr.number ];
+    stored = _descr;
+    stored.steps.clear();
+    stored.emptyStepsBegin = 0;
+    stored.emptyStepsEnd = 0;
+
+    return saveCatalog();
+}
+
+bool MappedStorageEngine::updateSessionDescription( const TPersistenceSetId _persId, const SEventsSessionInfo & _descr ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    auto iter = m_descriptions.find( _persId );
+    if( iter == m_descriptions.end() || iter->second.find(_descr.number) == iter->second.end() ){
+        VS_LOG_ERROR << PRINT_HEADER << " update description failed, such session num [" << _descr.number << "] is NOT exist" << endl;
+        return false;
+    }
+
+    SEventsSessionInfo & stored = iter->second[ _descr.number ];
+    stored = _descr;
+    stored.steps.clear();
+    stored.emptyStepsBegin = 0;
+    stored.emptyStepsEnd = 0;
+
+    return saveCatalog();
+}
+
+std::vector<SEventsSessionInfo> MappedStorageEngine::selectSessionDescriptions( const TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    std::vector<SEventsSessionInfo> out;
+    auto iter = m_descriptions.find( _persId );
+    if( iter != m_descriptions.end() ){
+        out.reserve( iter->second.size() );
+        for( const auto & valuePair : iter->second ){
+            out.push_back( valuePair.second );
+        }
+    }
+
+    return out;
+}
+
+void MappedStorageEngine::discoverSessions( const TPersistenceSetId _persId,
+                                            const std::pair<TSessionNum, TSessionNum> _sessionRange,
+                                            const TLogicStep _gapThreshold,
+                                            std::vector<SEventsSessionInfo> & _out ){
+
+    // distinct ( session, step ) pairs in key order
+    std::map<TRecordKey, int64_t> maxAstroTimeByStep;
+    TTrajectoryViewFunc collect = [ & maxAstroTimeByStep ]( const SPersistenceTrajectory * _records, size_t _count ){
+        for( size_t i = 0; i < _count; i++ ){
+            const SPersistenceTrajectory & record = _records[ i ];
+            auto iter = maxAstroTimeByStep.emplace( TRecordKey(record.sessionNum, record.logicTime), record.astroTimeMillisec ).first;
+            iter->second = std::max( iter->second, record.astroTimeMillisec );
+        }
+    };
+
+    visitRange( _persId,
+                TRecordKey(_sessionRange.first, std::numeric_limits<TLogicStep>::min()),
+                TRecordKey(_sessionRange.second, std::numeric_limits<TLogicStep>::max()),
+                collect );
+
+    SEventsSessionInfo segment;
+    bool segmentOpened = false;
+
+    for( const auto & valuePair : maxAstroTimeByStep ){
+        const TSessionNum sessionNum = valuePair.first.first;
+        const TLogicStep logicStep = valuePair.first.second;
+        const int64_t astroTime = valuePair.second;
+
+        // close on session change or on gap
+        if( segmentOpened
+                && (sessionNum != segment.number
+                    || (_gapThreshold >= 0 && (logicStep - segment.maxLogicStep) > (_gapThreshold + 1))) ){
+            _out.push_back( segment );
+            segment.clear();
+            segmentOpened = false;
+        }
+
+        if( ! segmentOpened ){
+            segment.number = sessionNum;
+            segment.minLogicStep = logicStep;
+            segment.minTimestampMillisec = astroTime;
+            segmentOpened = true;
+        }
+
+        segment.maxLogicStep = logicStep;
+        segment.maxTimestampMillisec = astroTime;
+    }
+
+    if( segmentOpened ){
+        _out.push_back( segment );
+    }
+}
+
+std::vector<SEventsSessionInfo> MappedStorageEngine::scanPayloadForSessions( const TPersistenceSetId _persId,
+                                                                             const TSessionNum _beginFromSession ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    std::vector<SEventsSessionInfo> out;
+    discoverSessions( _persId, {_beginFromSession, std::numeric_limits<TSessionNum>::max()}, 0, out );
+    return out;
+}
+
+SEventsSessionInfo MappedStorageEngine::scanPayloadHeadForSessions( const TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    // segment key bounds give first session without scan
+    auto iter = m_payloadSets.find( _persId );
+    if( iter == m_payloadSets.end() ){
+        return SEventsSessionInfo();
+    }
+
+    bool found = false;
+    TSessionNum sessionNum = 0;
+    for( SSegment * segment : iter->second.segments ){
+        if( segment->header()->recordsCount > 0 && (! found || segment->minKey.first < sessionNum) ){
+            sessionNum = segment->minKey.first;
+            found = true;
+        }
+    }
+
+    std::vector<SEventsSessionInfo> out;
+    if( found ){
+        discoverSessions( _persId, {sessionNum, sessionNum}, NO_GAP_SPLIT, out );
+    }
+
+    return out.empty() ? SEventsSessionInfo() : out.front();
+}
+
+SEventsSessionInfo MappedStorageEngine::scanPayloadTailForSessions( const TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    auto iter = m_payloadSets.find( _persId );
+    if( iter == m_payloadSets.end() ){
+        return SEventsSessionInfo();
+    }
+
+    bool found = false;
+    TSessionNum sessionNum = 0;
+    for( SSegment * segment : iter->second.segments ){
+        if( segment->header()->recordsCount > 0 && (! found || segment->maxKey.first > sessionNum) ){
+            sessionNum = segment->maxKey.first;
+            found = true;
+        }
+    }
+
+    std::vector<SEventsSessionInfo> out;
+    if( found ){
+        discoverSessions( _persId, {sessionNum, sessionNum}, NO_GAP_SPLIT, out );
+    }
+
+    return out.empty() ? SEventsSessionInfo() : out.front();
+}
+
+std::vector<SEventsSessionInfo> MappedStorageEngine::scanPayloadRangeForSessions( const TPersistenceSetId _persId,
+        const std::pair<TSessionNum, TSessionNum> _sessionRange ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    std::vector<SEventsSessionInfo> out;
+    discoverSessions( _persId, _sessionRange, NO_GAP_SPLIT, out );
+    return out;
+}
+
+void MappedStorageEngine::deleteSessionDescription( const TPersistenceSetId _persId, const TSessionNum _sessionNum ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStorage );
+
+    auto iter = m_descriptions.find( _persId );
+    if( iter == m_descriptions.end() ){
+        return;
+    }
+
+    if( common_vars::ALL_SESSION_NUM == _sessionNum ){
+        m_descriptions.erase( iter );
+    }
+    else{
+        iter->second.erase( _sessionNum );
+    }
+
+    saveCatalog();
+}
+
+void MappedStorageEngine::deleteSessionDescription( const TContextId _ctxId ){
+
+    for( const TPersistenceSetId persId : getPersistenceIds(_ctxId) ){
+        deleteSessionDescription( persId );
+    }
+}
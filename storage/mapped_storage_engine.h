@@ -0,0 +1,143 @@
+#ifndef MAPPED_STORAGE_ENGINE_H
+#define MAPPED_STORAGE_ENGINE_H
+
+#include <map>
+#include <mutex>
+#include <functional>
+
+#include "i_persistence_storage.h"
+#include "metadata_catalog.h"
+#include "trajectory_point_predicate.h"
+
+// embedded engine without database server: payload in append-only memory-mapped segment files,
+// metadata & descriptions in local catalog file. All files are local ( not portable across platforms )
+class MappedStorageEngine : public IPersistenceStorage
+{
+public:
+    // view into mapping, valid only inside callback
+    using TTrajectoryViewFunc = std::function<void( const common_types::SPersistenceTrajectory * _records, size_t _count )>;
+
+    struct SInitSettings {
+        SInitSettings()
+            : segmentMaxBytes( 64 * 1024 * 1024 )
+            , indexStride(64)
+        {}
+        std::string directory;
+        int64_t segmentMaxBytes; // preallocated size of one segment file
+        int32_t indexStride; // records between sparse index entries
+    };
+
+    MappedStorageEngine();
+    ~MappedStorageEngine();
+
+    bool init( const SInitSettings & _settings );
+    void shutdown();
+
+    // metadata
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataVideo & _videoMetadata ) override;
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataDSS & _dssMetadata ) override;
+    virtual common_types::TPersistenceSetId writePersistenceSetMetadata( const common_types::SPersistenceMetadataRaw & _rawMetadata ) override;
+    virtual std::vector<common_types::SPersistenceMetadata> getPersistenceSetMetadata( common_types::TContextId _ctxId = common_vars::ALL_CONTEXT_ID ) override;
+    virtual common_types::SPersistenceMetadata getPersistenceSetMetadata( common_types::TPersistenceSetId _persId ) override;
+    virtual void deletePersistenceSetMetadata( common_types::TPersistenceSetId _id ) override;
+    virtual void deletePersistenceSetMetadata( common_types::TContextId _ctxId ) override;
+
+    // payload
+    virtual bool writeTrajectoryData( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data ) override;
+    virtual std::vector<common_types::SPersistenceTrajectory> readTrajectoryData( const common_types::SPersistenceSetFilter & _filter ) override;
+    // zero-copy read, callback must not call the engine
+    void forEachTrajectoryRange( const common_types::SPersistenceSetFilter & _filter, TTrajectoryViewFunc _func );
+    virtual void deleteDataRange( const common_types::SPersistenceSetFilter & _filter ) override;
+    virtual void deleteTotalData( const common_types::TContextId _ctxId ) override;
+
+    // payload description
+    virtual bool insertSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr ) override;
+    virtual bool updateSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::SEventsSessionInfo & _descr ) override;
+    virtual std::vector<common_types::SEventsSessionInfo> selectSessionDescriptions( const common_types::TPersistenceSetId _persId ) override;
+    virtual std::vector<common_types::SEventsSessionInfo> scanPayloadForSessions( const common_types::TPersistenceSetId _persId,
+            const common_types::TSessionNum _beginFromSession = 0 ) override;
+    virtual common_types::SEventsSessionInfo scanPayloadHeadForSessions( const common_types::TPersistenceSetId _persId ) override;
+    virtual common_types::SEventsSessionInfo scanPayloadTailForSessions( const common_types::TPersistenceSetId _persId ) override;
+    virtual std::vector<common_types::SEventsSessionInfo> scanPayloadRangeForSessions( const common_types::TPersistenceSetId _persId,
+            const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange ) override;
+    virtual void deleteSessionDescription( const common_types::TPersistenceSetId _persId, const common_types::TSessionNum _sessionNum = common_vars::ALL_SESSION_NUM ) override;
+    virtual void deleteSessionDescription( const common_types::TContextId _ctxId ) override;
+
+
+private:
+    // ( session, logic step )
+    using TRecordKey = std::pair<common_types::TSessionNum, common_types::TLogicStep>;
+
+    struct SSegmentHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t reserved;
+        uint64_t recordsCount;
+    };
+
+    struct SSegment {
+        SSegment()
+            : fd(-1)
+            , mapped(nullptr)
+            , mappedBytes(0)
+            , capacity(0)
+            , sorted(true)
+        {}
+        std::string path;
+        int fd;
+        void * mapped;
+        size_t mappedBytes;
+        uint64_t capacity;
+
+        // appended in ( session, logic step ) order -> sparse index is usable
+        bool sorted;
+        TRecordKey minKey;
+        TRecordKey maxKey;
+        std::vector<std::pair<TRecordKey, uint64_t>> sparseIndex;
+
+        SSegmentHeader * header(){ return static_cast<SSegmentHeader *>( mapped ); }
+        common_types::SPersistenceTrajectory * records(){
+            return reinterpret_cast<common_types::SPersistenceTrajectory *>( static_cast<char *>(mapped) + sizeof(SSegmentHeader) );
+        }
+    };
+
+    struct SPayloadSet {
+        std::vector<SSegment *> segments;
+    };
+
+    // payload
+    SPayloadSet & getPayloadSet( common_types::TPersistenceSetId _persId );
+    SSegment * openSegment( const std::string & _path, bool _create );
+    void closeSegment( SSegment * _segment, bool _unlink );
+    void indexRecord( SSegment * _segment, uint64_t _idx );
+    void loadPayloadSets();
+    void removePayloadSet( common_types::TPersistenceSetId _persId );
+    void removePayloadRange( common_types::TPersistenceSetId _persId, const TRecordKey & _from, const TRecordKey & _to, const TrajectoryPointPredicate & _predicate );
+    void visitRange( common_types::TPersistenceSetId _persId, const TRecordKey & _from, const TRecordKey & _to, TTrajectoryViewFunc & _func );
+    void discoverSessions( const common_types::TPersistenceSetId _persId,
+                           const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange,
+                           const common_types::TLogicStep _gapThreshold,
+                           std::vector<common_types::SEventsSessionInfo> & _out );
+
+    // catalog
+    template< typename T_Metadata >
+    common_types::TPersistenceSetId writeMetadata( const T_Metadata & _meta );
+    bool isPersistenceMetadataValid( common_types::TPersistenceSetId _persId, const common_types::SPersistenceMetadataDescr & _meta );
+    bool loadCatalog();
+    bool saveCatalog();
+    std::vector<common_types::TPersistenceSetId> getPersistenceIds( common_types::TContextId _ctxId );
+
+    // data
+    MetadataCatalog m_metadataCatalog;
+    std::map<common_types::TPersistenceSetId, std::map<common_types::TSessionNum, common_types::SEventsSessionInfo>> m_descriptions;
+    std::map<common_types::TPersistenceSetId, SPayloadSet> m_payloadSets;
+    common_types::TPersistenceSetId m_lastPersistenceId;
+    SInitSettings m_settings;
+    bool m_inited;
+
+    // service
+    std::mutex m_mutexStorage;
+};
+
+#endif // MAPPED_STORAGE_ENGINE_H
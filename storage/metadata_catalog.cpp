@@ -0,0 +1,201 @@
+#include <algorithm>
+
+#include "common/ms_common_vars.h"
+#include "metadata_catalog.h"
+
+using namespace std;
+using namespace common_types;
+
+MetadataCatalog::MetadataCatalog()
+{
+
+}
+
+MetadataCatalog::~MetadataCatalog()
+{
+
+}
+
+void MetadataCatalog::put( const SPersistenceMetadataVideo & _meta ){
+
+    SEntry entry;
+    entry.sourceType = EPersistenceSourceType::VIDEO_SERVER;
+    entry.video = _meta;
+    putEntry( _meta, entry );
+}
+
+void MetadataCatalog::put( const SPersistenceMetadataDSS & _meta ){
+
+    SEntry entry;
+    entry.sourceType = EPersistenceSourceType::DSS;
+    entry.dss = _meta;
+    putEntry( _meta, entry );
+}
+
+void MetadataCatalog::put( const SPersistenceMetadataRaw & _meta ){
+
+    SEntry entry;
+    entry.sourceType = EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    entry.raw = _meta;
+    putEntry( _meta, entry );
+}
+
+void MetadataCatalog::putEntry( const SPersistenceMetadataDescr & _descr, SEntry & _entry ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+
+    // context of the set may be changed by update
+    auto iter = m_contextByPersistenceId.find( _descr.persistenceSetId );
+    if( iter != m_contextByPersistenceId.end() && iter->second != _descr.contextId ){
+        auto iterCtx = m_setsByContext.find( iter->second );
+        iterCtx->second.erase( _descr.persistenceSetId );
+        if( iterCtx->second.empty() ){
+            m_setsByContext.erase( iterCtx );
+        }
+    }
+
+    m_contextByPersistenceId[ _descr.persistenceSetId ] = _descr.contextId;
+    m_setsByContext[ _descr.contextId ][ _descr.persistenceSetId ] = std::move( _entry );
+}
+
+void MetadataCatalog::clear(){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    m_setsByContext.clear();
+    m_contextByPersistenceId.clear();
+}
+
+bool MetadataCatalog::contains( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    return ( m_contextByPersistenceId.find(_persId) != m_contextByPersistenceId.end() );
+}
+
+bool MetadataCatalog::getDescr( TPersistenceSetId _persId, SPersistenceMetadataDescr & _out ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    auto iter = m_contextByPersistenceId.find( _persId );
+    if( iter == m_contextByPersistenceId.end() ){
+        return false;
+    }
+
+    _out = getEntryDescr( m_setsByContext[ iter->second ][ _persId ] );
+    return true;
+}
+
+SPersistenceMetadata MetadataCatalog::get( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    SPersistenceMetadata out;
+
+    auto iter = m_contextByPersistenceId.find( _persId );
+    if( iter != m_contextByPersistenceId.end() ){
+        appendEntry( m_setsByContext[ iter->second ][ _persId ], out );
+    }
+
+    return out;
+}
+
+std::vector<SPersistenceMetadata> MetadataCatalog::getByContext( TContextId _ctxId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    std::vector<SPersistenceMetadata> out;
+
+    if( _ctxId == common_vars::ALL_CONTEXT_ID ){
+        out.reserve( m_setsByContext.size() );
+        for( auto iter = m_setsByContext.rbegin(); iter != m_setsByContext.rend(); ++iter ){
+            out.resize( out.size() + 1 );
+            for( const auto & valuePair : iter->second ){
+                appendEntry( valuePair.second, out.back() );
+            }
+        }
+    }
+    else{
+        auto iter = m_setsByContext.find( _ctxId );
+        if( iter != m_setsByContext.end() ){
+            out.resize( 1 );
+            for( const auto & valuePair : iter->second ){
+                appendEntry( valuePair.second, out.back() );
+            }
+        }
+    }
+
+    return out;
+}
+
+TPersistenceSetId MetadataCatalog::getMaxPersistenceId(){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    TPersistenceSetId maxId = 0;
+    for( const auto & valuePair : m_contextByPersistenceId ){
+        maxId = std::max( maxId, valuePair.first );
+    }
+    return maxId;
+}
+
+void MetadataCatalog::removeSet( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    auto iter = m_contextByPersistenceId.find( _persId );
+    if( iter == m_contextByPersistenceId.end() ){
+        return;
+    }
+
+    auto iterCtx = m_setsByContext.find( iter->second );
+    iterCtx->second.erase( _persId );
+    if( iterCtx->second.empty() ){
+        m_setsByContext.erase( iterCtx );
+    }
+
+    m_contextByPersistenceId.erase( iter );
+}
+
+void MetadataCatalog::removeContext( TContextId _ctxId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCatalog );
+    auto iterCtx = m_setsByContext.find( _ctxId );
+    if( iterCtx == m_setsByContext.end() ){
+        return;
+    }
+
+    for( const auto & valuePair : iterCtx->second ){
+        m_contextByPersistenceId.erase( valuePair.first );
+    }
+    m_setsByContext.erase( iterCtx );
+}
+
+void MetadataCatalog::appendEntry( const SEntry & _entry, SPersistenceMetadata & _out ){
+
+    switch( _entry.sourceType ){
+    case EPersistenceSourceType::VIDEO_SERVER : {
+        _out.persistenceFromVideo.push_back( _entry.video );
+        break;
+    }
+    case EPersistenceSourceType::DSS : {
+        _out.persistenceFromDSS.push_back( _entry.dss );
+        break;
+    }
+    case EPersistenceSourceType::AUTONOMOUS_RECORDER : {
+        _out.persistenceFromRaw.push_back( _entry.raw );
+        break;
+    }
+    default : {
+
+    }
+    }
+}
+
+const SPersistenceMetadataDescr & MetadataCatalog::getEntryDescr( const SEntry & _entry ){
+
+    switch( _entry.sourceType ){
+    case EPersistenceSourceType::VIDEO_SERVER : {
+        return _entry.video;
+    }
+    case EPersistenceSourceType::DSS : {
+        return _entry.dss;
+    }
+    default : {
+        return _entry.raw;
+    }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef METADATA_CATALOG_H
+#define METADATA_CATALOG_H
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "common/ms_common_types.h"
+
+// in-memory copy of persistence set metadata, indexed by context id and persistence id
+class MetadataCatalog
+{
+public:
+    MetadataCatalog();
+    ~MetadataCatalog();
+
+    // fill
+    void put( const common_types::SPersistenceMetadataVideo & _meta );
+    void put( const common_types::SPersistenceMetadataDSS & _meta );
+    void put( const common_types::SPersistenceMetadataRaw & _meta );
+    void clear();
+
+    // read
+    bool contains( common_types::TPersistenceSetId _persId );
+    bool getDescr( common_types::TPersistenceSetId _persId, common_types::SPersistenceMetadataDescr & _out );
+    common_types::SPersistenceMetadata get( common_types::TPersistenceSetId _persId );
+    // all contexts are ordered by context id descending
+    std::vector<common_types::SPersistenceMetadata> getByContext( common_types::TContextId _ctxId );
+    common_types::TPersistenceSetId getMaxPersistenceId();
+
+    // remove
+    void removeSet( common_types::TPersistenceSetId _persId );
+    void removeContext( common_types::TContextId _ctxId );
+
+
+private:
+    struct SEntry {
+        common_types::EPersistenceSourceType sourceType;
+        common_types::SPersistenceMetadataVideo video;
+        common_types::SPersistenceMetadataDSS dss;
+        common_types::SPersistenceMetadataRaw raw;
+    };
+
+    using TSetsOfContext = std::map<common_types::TPersistenceSetId, SEntry>;
+
+    void putEntry( const common_types::SPersistenceMetadataDescr & _descr, SEntry & _entry );
+    static void appendEntry( const SEntry & _entry, common_types::SPersistenceMetadata & _out );
+    static const common_types::SPersistenceMetadataDescr & getEntryDescr( const SEntry & _entry );
+
+    // data
+    std::map<common_types::TContextId, TSetsOfContext> m_setsByContext;
+    std::unordered_map<common_types::TPersistenceSetId, common_types::TContextId> m_contextByPersistenceId;
+
+    // service
+    std::mutex m_mutexCatalog;
+};
+
+#endif // METADATA_CATALOG_H
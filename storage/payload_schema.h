@@ -0,0 +1,270 @@
+#ifndef PAYLOAD_SCHEMA_H
+#define PAYLOAD_SCHEMA_H
+
+#include <array>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+#include <mongoc.h>
+
+#include "common/ms_common_types.h"
+#include "common/ms_common_vars.h"
+#include "bson_record_decoder.h"
+
+// field of payload schema: document key + record member ( member may belong to base, e.g. SPersistenceObj )
+template< typename T_Class, typename T_Value >
+struct SPayloadField {
+    using TValue = T_Value;
+    const char * key;
+    T_Value T_Class::* member;
+};
+
+template< typename T_Class, typename T_Value >
+inline SPayloadField<T_Class, T_Value> payloadField( const std::string & _key, T_Value T_Class::* _member ){
+    return SPayloadField<T_Class, T_Value>{ _key.c_str(), _member };
+}
+
+// specialized per payload type:
+//   static const auto & fields() - tuple of SPayloadField in the order they are written to store
+//   static std::vector<std::vector<std::string>> indexes() - compound indexes of payload table
+// writer, reader layout & columns below are generated from it
+template< typename T_Record >
+struct SPayloadSchema;
+
+namespace payload_schema {
+
+template< typename T_Record >
+using TFields = typename std::decay<decltype(SPayloadSchema<T_Record>::fields())>::type;
+
+template< typename T_Record >
+constexpr size_t fieldsCount(){
+    return std::tuple_size<TFields<T_Record>>::value;
+}
+
+template< typename T_Tuple, typename T_Func, size_t... I >
+inline void forEach( const T_Tuple & _fields, T_Func && _func, std::index_sequence<I...> ){
+    (void)std::initializer_list<int>{ ( _func(std::get<I>(_fields)), 0 )... };
+}
+
+template< typename T_Tuple, typename T_Func >
+inline void forEach( const T_Tuple & _fields, T_Func && _func ){
+    forEach( _fields, std::forward<T_Func>(_func), std::make_index_sequence<std::tuple_size<T_Tuple>::value>() );
+}
+
+// member type -> BSON type: small signed integers & enums - int32, other integers - int64 ( as in trajectory documents )
+template< typename T >
+inline typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type
+append( bson_t * _doc, const char * _key, T _value ){
+    if( sizeof(T) <= sizeof(int32_t) && std::is_signed<T>::value ){
+        bson_append_int32( _doc, _key, -1, (int32_t)_value );
+    }
+    else{
+        bson_append_int64( _doc, _key, -1, (int64_t)_value );
+    }
+}
+
+template< typename T >
+inline typename std::enable_if<std::is_floating_point<T>::value>::type
+append( bson_t * _doc, const char * _key, T _value ){
+    bson_append_double( _doc, _key, -1, (double)_value );
+}
+
+template< typename T >
+inline typename std::enable_if<std::is_enum<T>::value>::type
+append( bson_t * _doc, const char * _key, T _value ){
+    bson_append_int32( _doc, _key, -1, (int32_t)_value );
+}
+
+inline void append( bson_t * _doc, const char * _key, bool _value ){
+    bson_append_bool( _doc, _key, -1, _value );
+}
+
+template< typename T >
+inline typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type
+read( const bson_iter_t * _iter, T & _out ){
+    _out = (T)bsonReadInteger( _iter );
+}
+
+template< typename T >
+inline typename std::enable_if<std::is_floating_point<T>::value>::type
+read( const bson_iter_t * _iter, T & _out ){
+    _out = (T)bsonReadDouble( _iter );
+}
+
+template< typename T >
+inline typename std::enable_if<std::is_enum<T>::value>::type
+read( const bson_iter_t * _iter, T & _out ){
+    _out = (T)bsonReadInteger( _iter );
+}
+
+inline void read( const bson_iter_t * _iter, bool & _out ){
+    _out = bson_iter_as_bool( _iter );
+}
+
+template< typename T_Tuple >
+struct SColumnsOf;
+
+template< typename... T_Field >
+struct SColumnsOf<std::tuple<T_Field...>> {
+    using type = std::tuple<std::vector<typename T_Field::TValue>...>;
+};
+
+} // payload_schema
+
+// -------------------------------------------------------------------------------------
+// generated parts
+// -------------------------------------------------------------------------------------
+// document writer
+template< typename T_Record >
+class PayloadCodec
+{
+public:
+    static void append( bson_t * _doc, const T_Record & _record ){
+
+        payload_schema::forEach( SPayloadSchema<T_Record>::fields(), [ _doc, & _record ]( const auto & _field ){
+            payload_schema::append( _doc, _field.key, _record.*(_field.member) );
+        });
+    }
+
+    static void appendBulk( mongoc_bulk_operation_t * _bulk, const T_Record * _records, size_t _count ){
+
+        // one document buffer for the whole bulk ( insert copies it )
+        bson_t doc;
+        bson_init( & doc );
+        for( size_t i = 0; i < _count; i++ ){
+            bson_reinit( & doc );
+            append( & doc, _records[ i ] );
+            mongoc_bulk_operation_insert( _bulk, & doc );
+        }
+        bson_destroy( & doc );
+    }
+
+    static void appendBulk( mongoc_bulk_operation_t * _bulk, const std::vector<T_Record> & _data ){
+        appendBulk( _bulk, _data.data(), _data.size() );
+    }
+
+    static std::vector<std::vector<std::string>> indexes(){
+        return SPayloadSchema<T_Record>::indexes();
+    }
+};
+
+// reader layout for BsonRecordDecoder ( same positional path as hand-written layouts )
+template< typename T_Record >
+struct SPayloadSchemaLayout {
+    static constexpr size_t FIELDS_COUNT = payload_schema::fieldsCount<T_Record>();
+
+    static const SBsonRecordField<T_Record> * fields(){
+        static const std::array<SBsonRecordField<T_Record>, FIELDS_COUNT> layout = makeLayout( std::make_index_sequence<FIELDS_COUNT>() );
+        return layout.data();
+    }
+
+
+private:
+    template< size_t I >
+    static void readField( const bson_iter_t * _iter, T_Record & _out ){
+        payload_schema::read( _iter, _out.*(std::get<I>(SPayloadSchema<T_Record>::fields()).member) );
+    }
+
+    template< size_t... I >
+    static std::array<SBsonRecordField<T_Record>, FIELDS_COUNT> makeLayout( std::index_sequence<I...> ){
+        return {{ { std::get<I>(SPayloadSchema<T_Record>::fields()).key, & readField<I> }... }};
+    }
+};
+
+// column per field ( cache layout )
+template< typename T_Record >
+class PayloadColumns
+{
+public:
+    using TColumns = typename payload_schema::SColumnsOf<payload_schema::TFields<T_Record>>::type;
+
+    size_t rowsCount() const { return std::get<0>( m_columns ).size(); }
+
+    template< size_t I >
+    const typename std::tuple_element<I, TColumns>::type & column() const { return std::get<I>( m_columns ); }
+
+    void reserve( size_t _rows ){
+        forEachColumn( [ _rows ]( auto & _column, const auto & ){ _column.reserve( _rows ); } );
+    }
+
+    void append( const T_Record & _record ){
+        forEachColumn( [ & _record ]( auto & _column, const auto & _field ){ _column.push_back( _record.*(_field.member) ); } );
+    }
+
+    void copyRow( size_t _idx, T_Record & _out ) const {
+        forEachColumn( [ _idx, & _out ]( const auto & _column, const auto & _field ){ _out.*(_field.member) = _column[ _idx ]; } );
+    }
+
+    void clear(){
+        forEachColumn( []( auto & _column, const auto & ){ _column.clear(); } );
+    }
+
+    int64_t memoryBytes() const {
+        int64_t out = 0;
+        forEachColumn( [ & out ]( const auto & _column, const auto & ){ out += _column.capacity() * sizeof(_column[ 0 ]); } );
+        return out;
+    }
+
+
+private:
+    template< typename T_Func, size_t... I >
+    static void forEachColumn( TColumns & _columns, T_Func && _func, std::index_sequence<I...> ){
+        (void)std::initializer_list<int>{ ( _func(std::get<I>(_columns), std::get<I>(SPayloadSchema<T_Record>::fields())), 0 )... };
+    }
+
+    template< typename T_Func, size_t... I >
+    static void forEachColumn( const TColumns & _columns, T_Func && _func, std::index_sequence<I...> ){
+        (void)std::initializer_list<int>{ ( _func(std::get<I>(_columns), std::get<I>(SPayloadSchema<T_Record>::fields())), 0 )... };
+    }
+
+    template< typename T_Func >
+    void forEachColumn( T_Func && _func ){
+        forEachColumn( m_columns, std::forward<T_Func>(_func), std::make_index_sequence<std::tuple_size<TColumns>::value>() );
+    }
+
+    template< typename T_Func >
+    void forEachColumn( T_Func && _func ) const {
+        forEachColumn( m_columns, std::forward<T_Func>(_func), std::make_index_sequence<std::tuple_size<TColumns>::value>() );
+    }
+
+    // data
+    TColumns m_columns;
+};
+
+// -------------------------------------------------------------------------------------
+// schemas
+// -------------------------------------------------------------------------------------
+template<>
+struct SPayloadSchema<common_types::SPersistenceWeather> {
+    using TRecord = common_types::SPersistenceWeather;
+
+    static const auto & fields(){
+        using namespace common_vars::mongo_fields::analytic;
+
+        static const auto schema = std::make_tuple(
+            payloadField( detected_object::OBJRERP_ID, & TRecord::objId ),
+            payloadField( detected_object::STATE, & TRecord::state ),
+            payloadField( detected_object::ASTRO_TIME, & TRecord::astroTimeMillisec ),
+            payloadField( detected_object::LOGIC_TIME, & TRecord::logicTime ),
+            payloadField( detected_object::SESSION, & TRecord::sessionNum ),
+            payloadField( weather::WIND_SPEED, & TRecord::windSpeed ),
+            payloadField( weather::HUMIDITY, & TRecord::humidity )
+        );
+        return schema;
+    }
+
+    static std::vector<std::vector<std::string>> indexes(){
+        using namespace common_vars::mongo_fields::analytic;
+
+        return { {detected_object::SESSION, detected_object::LOGIC_TIME},
+                 {detected_object::SESSION, detected_object::OBJRERP_ID, detected_object::LOGIC_TIME} };
+    }
+};
+
+template<>
+struct SBsonRecordLayout<common_types::SPersistenceWeather> : SPayloadSchemaLayout<common_types::SPersistenceWeather> {};
+
+#endif // PAYLOAD_SCHEMA_H
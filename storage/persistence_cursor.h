@@ -0,0 +1,145 @@
+#ifndef PERSISTENCE_CURSOR_H
+#define PERSISTENCE_CURSOR_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <functional>
+
+#include <mongoc.h>
+
+// streaming reader over payload table: records are decoded into one reusable batch buffer
+template< typename T_Record >
+class PersistenceCursor
+{
+public:
+    using TDecodeFunc = void( * )( const bson_t * _doc, T_Record & _out );
+    // one document -> several records ( chunked layout ), records are appended ( may be filtered out )
+    using TDecodeManyFunc = std::function<void( const bson_t * _doc, std::vector<T_Record> & _out )>;
+
+    PersistenceCursor( mongoc_cursor_t * _cursor, bson_t * _query, int32_t _batchSize, TDecodeFunc _decode )
+        : m_done(false)
+        , m_recordsRead(0)
+        , m_pendingPos(0)
+        , m_cursor(_cursor)
+        , m_query(_query)
+        , m_batchSize(_batchSize > 0 ? _batchSize : 1)
+        , m_decode(_decode)
+        , m_decodeMany(nullptr)
+    {
+        m_batch.reserve( m_batchSize );
+    }
+
+    PersistenceCursor( mongoc_cursor_t * _cursor, bson_t * _query, int32_t _batchSize, TDecodeManyFunc _decodeMany )
+        : m_done(false)
+        , m_recordsRead(0)
+        , m_pendingPos(0)
+        , m_cursor(_cursor)
+        , m_query(_query)
+        , m_batchSize(_batchSize > 0 ? _batchSize : 1)
+        , m_decode(nullptr)
+        , m_decodeMany(_decodeMany)
+    {
+        m_batch.reserve( m_batchSize );
+    }
+
+    ~PersistenceCursor(){
+        mongoc_cursor_destroy( m_cursor );
+        bson_destroy( m_query );
+    }
+
+    // empty batch means end of data ( or error )
+    const std::vector<T_Record> & nextBatch(){
+
+        if( m_decodeMany ){
+            return nextBatchMany();
+        }
+
+        // NOTE: resize within reserved capacity - no reallocation
+        m_batch.resize( m_batchSize );
+        int32_t filled = 0;
+
+        if( ! m_done ){
+            const bson_t * doc;
+            while( filled < m_batchSize && mongoc_cursor_next( m_cursor, & doc ) ){
+                m_decode( doc, m_batch[ filled++ ] );
+            }
+
+            if( filled < m_batchSize ){
+                m_done = true;
+
+                bson_error_t error;
+                if( mongoc_cursor_error( m_cursor, & error ) ){
+                    m_lastError = error.message;
+                }
+            }
+        }
+
+        m_batch.resize( filled );
+        m_recordsRead += filled;
+        return m_batch;
+    }
+
+    bool isDone() const { return m_done; }
+    int64_t getRecordsRead() const { return m_recordsRead; }
+    const std::string & getLastError() const { return m_lastError; }
+
+
+private:
+    PersistenceCursor( const PersistenceCursor & _inst ) = delete;
+    PersistenceCursor & operator=( const PersistenceCursor & _inst ) = delete;
+
+    // records of one document may be split between two batches
+    const std::vector<T_Record> & nextBatchMany(){
+
+        m_batch.clear();
+        if( m_done ){
+            return m_batch;
+        }
+
+        movePending();
+
+        const bson_t * doc;
+        while( (int32_t)m_batch.size() < m_batchSize && mongoc_cursor_next( m_cursor, & doc ) ){
+            m_pending.clear();
+            m_pendingPos = 0;
+            m_decodeMany( doc, m_pending );
+            movePending();
+        }
+
+        if( (int32_t)m_batch.size() < m_batchSize ){
+            m_done = true;
+
+            bson_error_t error;
+            if( mongoc_cursor_error( m_cursor, & error ) ){
+                m_lastError = error.message;
+            }
+        }
+
+        m_recordsRead += m_batch.size();
+        return m_batch;
+    }
+
+    void movePending(){
+        while( m_pendingPos < m_pending.size() && (int32_t)m_batch.size() < m_batchSize ){
+            m_batch.push_back( std::move(m_pending[ m_pendingPos++ ]) );
+        }
+    }
+
+    // data
+    std::vector<T_Record> m_batch;
+    std::vector<T_Record> m_pending;
+    bool m_done;
+    int64_t m_recordsRead;
+    size_t m_pendingPos;
+    std::string m_lastError;
+
+    // service
+    mongoc_cursor_t * m_cursor;
+    bson_t * m_query;
+    const int32_t m_batchSize;
+    TDecodeFunc m_decode;
+    TDecodeManyFunc m_decodeMany;
+};
+
+#endif // PERSISTENCE_CURSOR_H
@@ -0,0 +1,750 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "system/logger.h"
+#include "common/ms_common_vars.h"
+#include "persistence_snapshot.h"
+#include "trajectory_chunk_codec.h"
+#include "trajectory_downsampler.h"
+#include "trajectory_point_predicate.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "Snapshot:";
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x504E5350; // 'PSNP'
+static constexpr uint16_t SNAPSHOT_VERSION = 1;
+// magic, version, flags, blocks count, reserved, meta ( offset, size, crc ), index ( offset, size, crc ), header crc
+static constexpr size_t HEADER_SIZE = 52;
+static constexpr size_t HEADER_CRC_OFFSET = HEADER_SIZE - sizeof(uint32_t);
+static constexpr size_t INDEX_ENTRY_SIZE = 44;
+static constexpr size_t SESSION_ENTRY_SIZE = 44;
+
+using TRecordKey = std::pair<TSessionNum, TLogicStep>;
+
+static const TRecordKey ALL_RECORDS_FROM = std::make_pair( std::numeric_limits<TSessionNum>::min(), std::numeric_limits<TLogicStep>::min() );
+static const TRecordKey ALL_RECORDS_TO = std::make_pair( std::numeric_limits<TSessionNum>::max(), std::numeric_limits<TLogicStep>::max() );
+
+// -------------------------------------------------------------------------------------
+// portable encoding
+// -------------------------------------------------------------------------------------
+// CRC-32 ( IEEE 802.3, reflected )
+static uint32_t crc32( const uint8_t * _data, size_t _size ){
+
+    static uint32_t table[ 256 ];
+    static const bool tableInited = [](){
+        for( uint32_t i = 0; i < 256; i++ ){
+            uint32_t value = i;
+            for( int bit = 0; bit < 8; bit++ ){
+                value = ( value & 1 ) ? ( 0xEDB88320 ^ (value >> 1) ) : ( value >> 1 );
+            }
+            table[ i ] = value;
+        }
+        return true;
+    }();
+    (void)tableInited;
+
+    uint32_t crc = 0xFFFFFFFF;
+    for( size_t i = 0; i < _size; i++ ){
+        crc = table[ (crc ^ _data[ i ]) & 0xFF ] ^ ( crc >> 8 );
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static uint32_t crc32( const std::string & _data ){
+    return crc32( reinterpret_cast<const uint8_t *>(_data.data()), _data.size() );
+}
+
+template< typename T >
+static void putLE( std::string & _out, T _value ){
+
+    using TUnsigned = typename std::make_unsigned<T>::type;
+    uint64_t value = static_cast<TUnsigned>( _value );
+    for( size_t i = 0; i < sizeof(T); i++ ){
+        _out.push_back( static_cast<char>(value & 0xFF) );
+        value >>= 8;
+    }
+}
+
+// bounds are checked once per read, 'ok' stays false after the first overrun
+struct SByteReader {
+    SByteReader( const uint8_t * _data, size_t _size )
+        : pos(_data)
+        , end(_data + _size)
+        , ok(true)
+    {}
+
+    template< typename T >
+    T get(){
+        if( (size_t)(end - pos) < sizeof(T) ){
+            ok = false;
+            pos = end;
+            return T();
+        }
+
+        uint64_t value = 0;
+        for( size_t i = 0; i < sizeof(T); i++ ){
+            value |= (uint64_t)pos[ i ] << ( 8 * i );
+        }
+        pos += sizeof(T);
+
+        using TUnsigned = typename std::make_unsigned<T>::type;
+        return static_cast<T>( static_cast<TUnsigned>(value) );
+    }
+
+    const uint8_t * pos;
+    const uint8_t * end;
+    bool ok;
+};
+
+static void makeRecordRange( const SPersistenceSetFilter & _filter, TRecordKey & _from, TRecordKey & _to ){
+
+    // only one step
+    if( (_filter.minLogicStep == _filter.maxLogicStep) && _filter.minLogicStep >= 0 ){
+        _from = std::make_pair( _filter.sessionNum, _filter.minLogicStep );
+        _to = _from;
+    }
+    // steps range
+    else if( _filter.minLogicStep >= 0 && _filter.maxLogicStep >= 0 ){
+        _from = std::make_pair( _filter.sessionNum, _filter.minLogicStep );
+        _to = std::make_pair( _filter.sessionNum, _filter.maxLogicStep );
+    }
+    // whole area
+    else{
+        _from = ALL_RECORDS_FROM;
+        _to = ALL_RECORDS_TO;
+    }
+}
+
+// -------------------------------------------------------------------------------------
+// export
+// -------------------------------------------------------------------------------------
+static void writeSessionEntry( std::string & _out, const SEventsSessionInfo & _descr ){
+
+    putLE<int32_t>( _out, _descr.number );
+    putLE<int64_t>( _out, _descr.minLogicStep );
+    putLE<int64_t>( _out, _descr.maxLogicStep );
+    putLE<int64_t>( _out, _descr.minTimestampMillisec );
+    putLE<int64_t>( _out, _descr.maxTimestampMillisec );
+    putLE<int32_t>( _out, _descr.emptyStepsBegin );
+    putLE<int32_t>( _out, _descr.emptyStepsEnd );
+}
+
+static void writeMetadataSection( std::string & _out,
+                                  const SPersistenceMetadataDescr & _meta,
+                                  int64_t _sourceSpecific,
+                                  const std::vector<SEventsSessionInfo> & _sessions ){
+
+    putLE<int32_t>( _out, (int32_t)_meta.sourceType );
+    putLE<int64_t>( _out, _meta.persistenceSetId );
+    putLE<uint32_t>( _out, _meta.contextId );
+    putLE<uint32_t>( _out, _meta.missionId );
+    putLE<int64_t>( _out, _meta.timeStepIntervalMillisec );
+    putLE<int32_t>( _out, _meta.lastRecordedSession );
+    putLE<int32_t>( _out, (int32_t)_meta.dataType );
+    putLE<int32_t>( _out, (int32_t)_meta.storageLayout );
+    putLE<int64_t>( _out, _sourceSpecific );
+
+    putLE<uint32_t>( _out, (uint32_t)_sessions.size() );
+    for( const SEventsSessionInfo & descr : _sessions ){
+        writeSessionEntry( _out, descr );
+    }
+}
+
+static void writeIndexEntry( std::string & _out, const PersistenceSnapshot::SBlockInfo & _block ){
+
+    putLE<uint64_t>( _out, _block.offset );
+    putLE<uint32_t>( _out, _block.size );
+    putLE<uint32_t>( _out, _block.crc );
+    putLE<uint32_t>( _out, _block.pointsCount );
+    putLE<int32_t>( _out, _block.firstSession );
+    putLE<int64_t>( _out, _block.firstStep );
+    putLE<int32_t>( _out, _block.lastSession );
+    putLE<int64_t>( _out, _block.lastStep );
+}
+
+bool PersistenceSnapshot::exportSet( const SExportSettings & _settings ){
+
+    if( ! _settings.storage || _settings.path.empty() || _settings.pointsPerBlock <= 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " export: storage, path or block size is not set" << endl;
+        return false;
+    }
+
+    // descr of the set & its source specific field
+    const SPersistenceMetadata meta = _settings.storage->getPersistenceSetMetadata( _settings.persId );
+    SPersistenceMetadataDescr descr;
+    int64_t sourceSpecific = 0;
+    if( ! meta.persistenceFromVideo.empty() ){
+        descr = meta.persistenceFromVideo.front();
+        descr.sourceType = EPersistenceSourceType::VIDEO_SERVER;
+        sourceSpecific = (int64_t)meta.persistenceFromVideo.front().recordedFromSensorId;
+    }
+    else if( ! meta.persistenceFromDSS.empty() ){
+        descr = meta.persistenceFromDSS.front();
+        descr.sourceType = EPersistenceSourceType::DSS;
+        sourceSpecific = meta.persistenceFromDSS.front().realData;
+    }
+    else if( ! meta.persistenceFromRaw.empty() ){
+        descr = meta.persistenceFromRaw.front();
+        descr.sourceType = EPersistenceSourceType::AUTONOMOUS_RECORDER;
+        sourceSpecific = meta.persistenceFromRaw.front().a;
+    }
+    else{
+        VS_LOG_ERROR << PRINT_HEADER << " export: pers id [" << _settings.persId << "] not found" << endl;
+        return false;
+    }
+
+    // payload is enumerated by itself, descriptions may lag behind it
+    std::vector<TSessionNum> sessionNums;
+    const std::vector<SEventsSessionInfo> scannedSessions = _settings.storage->scanPayloadForSessions( _settings.persId );
+    for( const SEventsSessionInfo & session : scannedSessions ){
+        sessionNums.push_back( session.number );
+    }
+    std::sort( sessionNums.begin(), sessionNums.end() );
+    sessionNums.erase( std::unique(sessionNums.begin(), sessionNums.end()), sessionNums.end() );
+
+    std::vector<SEventsSessionInfo> sessions = _settings.storage->selectSessionDescriptions( _settings.persId );
+    if( sessions.empty() ){
+        sessions = scannedSessions;
+    }
+    std::sort( sessions.begin(), sessions.end(), []( const SEventsSessionInfo & _lhs, const SEventsSessionInfo & _rhs ){
+        return _lhs.number < _rhs.number;
+    });
+
+    // written aside, complete file replaces the old one
+    const string pathTmp = _settings.path + ".tmp";
+    FILE * file = std::fopen( pathTmp.c_str(), "wb" );
+    if( ! file ){
+        VS_LOG_ERROR << PRINT_HEADER << " export: cannot create [" << pathTmp << "], reason: " << strerror(errno) << endl;
+        return false;
+    }
+
+    bool writeOk = true;
+    uint64_t offset = 0;
+    auto writeBytes = [ & ]( const std::string & _bytes ){
+        writeOk = writeOk && ( std::fwrite(_bytes.data(), 1, _bytes.size(), file) == _bytes.size() );
+        offset += _bytes.size();
+    };
+
+    // header is rewritten at the end
+    writeBytes( std::string(HEADER_SIZE, '\0') );
+
+    std::vector<SBlockInfo> blocks;
+    std::string block;
+    SBlockInfo blockInfo;
+    blockInfo.pointsCount = 0;
+
+    auto flushBlock = [ & ](){
+        if( 0 == blockInfo.pointsCount ){
+            return;
+        }
+        blockInfo.offset = offset;
+        blockInfo.size = block.size();
+        blockInfo.crc = crc32( block );
+        writeBytes( block );
+        blocks.push_back( blockInfo );
+
+        block.clear();
+        blockInfo.pointsCount = 0;
+    };
+
+    std::string chunk;
+    std::vector<const SPersistenceTrajectory *> stepPoints;
+    for( const TSessionNum sessionNum : sessionNums ){
+        SPersistenceSetFilter filter( _settings.persId );
+        filter.sessionNum = sessionNum;
+        filter.minLogicStep = 0;
+        filter.maxLogicStep = std::numeric_limits<TLogicStep>::max();
+
+        std::vector<SPersistenceTrajectory> points = _settings.storage->readTrajectoryData( filter );
+        std::stable_sort( points.begin(), points.end(), []( const SPersistenceTrajectory & _lhs, const SPersistenceTrajectory & _rhs ){
+            return _lhs.logicTime < _rhs.logicTime;
+        });
+
+        for( size_t begin = 0; begin < points.size() && writeOk; ){
+            size_t end = begin;
+            stepPoints.clear();
+            while( end < points.size() && points[ end ].logicTime == points[ begin ].logicTime ){
+                stepPoints.push_back( & points[ end++ ] );
+            }
+
+            TrajectoryChunkCodec::encode( stepPoints, chunk );
+            putLE<int32_t>( block, sessionNum );
+            putLE<int64_t>( block, points[ begin ].logicTime );
+            putLE<uint32_t>( block, (uint32_t)chunk.size() );
+            block.append( chunk );
+
+            if( 0 == blockInfo.pointsCount ){
+                blockInfo.firstSession = sessionNum;
+                blockInfo.firstStep = points[ begin ].logicTime;
+            }
+            blockInfo.lastSession = sessionNum;
+            blockInfo.lastStep = points[ begin ].logicTime;
+            blockInfo.pointsCount += stepPoints.size();
+
+            // steps are never split between blocks
+            if( blockInfo.pointsCount >= (uint32_t)_settings.pointsPerBlock ){
+                flushBlock();
+            }
+            begin = end;
+        }
+    }
+    flushBlock();
+
+    std::string metaSection;
+    writeMetadataSection( metaSection, descr, sourceSpecific, sessions );
+    const uint64_t metaOffset = offset;
+    writeBytes( metaSection );
+
+    std::string indexSection;
+    for( const SBlockInfo & info : blocks ){
+        writeIndexEntry( indexSection, info );
+    }
+    const uint64_t indexOffset = offset;
+    writeBytes( indexSection );
+
+    std::string header;
+    putLE<uint32_t>( header, SNAPSHOT_MAGIC );
+    putLE<uint16_t>( header, SNAPSHOT_VERSION );
+    putLE<uint16_t>( header, 0 );
+    putLE<uint32_t>( header, (uint32_t)blocks.size() );
+    putLE<uint32_t>( header, 0 );
+    putLE<uint64_t>( header, metaOffset );
+    putLE<uint32_t>( header, (uint32_t)metaSection.size() );
+    putLE<uint32_t>( header, crc32(metaSection) );
+    putLE<uint64_t>( header, indexOffset );
+    putLE<uint32_t>( header, (uint32_t)indexSection.size() );
+    putLE<uint32_t>( header, crc32(indexSection) );
+    putLE<uint32_t>( header, crc32(reinterpret_cast<const uint8_t *>(header.data()), header.size()) );
+    assert( header.size() == HEADER_SIZE );
+
+    writeOk = writeOk && ( 0 == std::fseek(file, 0, SEEK_SET) );
+    writeBytes( header );
+    writeOk = writeOk && ( 0 == std::fflush(file) ) && ( 0 == ::fsync(::fileno(file)) );
+    writeOk = ( 0 == std::fclose(file) ) && writeOk;
+
+    if( ! writeOk || 0 != std::rename(pathTmp.c_str(), _settings.path.c_str()) ){
+        VS_LOG_ERROR << PRINT_HEADER << " export: cannot write [" << _settings.path << "], reason: " << strerror(errno) << endl;
+        std::remove( pathTmp.c_str() );
+        return false;
+    }
+
+    int64_t pointsCount = 0;
+    for( const SBlockInfo & info : blocks ){
+        pointsCount += info.pointsCount;
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " pers id [" << _settings.persId << "] exported to [" << _settings.path << "]"
+                << " sessions [" << sessionNums.size() << "]"
+                << " points [" << pointsCount << "]"
+                << " blocks [" << blocks.size() << "]"
+                << endl;
+    return true;
+}
+
+// -------------------------------------------------------------------------------------
+// import
+// -------------------------------------------------------------------------------------
+TPersistenceSetId PersistenceSnapshot::importSet( const SImportSettings & _settings ){
+
+    if( ! _settings.storage || _settings.threads <= 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " import: storage is not set or threads count is invalid" << endl;
+        return common_vars::INVALID_PERS_ID;
+    }
+
+    PersistenceSnapshot snapshot;
+    if( ! snapshot.open(_settings.path) ){
+        return common_vars::INVALID_PERS_ID;
+    }
+
+    // always a new set, source id is kept only in the file
+    const SPersistenceMetadata & meta = snapshot.getMetadata();
+    TPersistenceSetId persId = common_vars::INVALID_PERS_ID;
+    if( ! meta.persistenceFromVideo.empty() ){
+        SPersistenceMetadataVideo video = meta.persistenceFromVideo.front();
+        video.persistenceSetId = SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+        persId = _settings.storage->writePersistenceSetMetadata( video );
+    }
+    else if( ! meta.persistenceFromDSS.empty() ){
+        SPersistenceMetadataDSS dss = meta.persistenceFromDSS.front();
+        dss.persistenceSetId = SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+        persId = _settings.storage->writePersistenceSetMetadata( dss );
+    }
+    else{
+        SPersistenceMetadataRaw raw = meta.persistenceFromRaw.front();
+        raw.persistenceSetId = SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID;
+        persId = _settings.storage->writePersistenceSetMetadata( raw );
+    }
+
+    if( SPersistenceMetadataDescr::INVALID_PERSISTENCE_ID == persId ){
+        VS_LOG_ERROR << PRINT_HEADER << " import: metadata write failed, file [" << _settings.path << "]" << endl;
+        return common_vars::INVALID_PERS_ID;
+    }
+
+    TWritePayloadFunc writeFunc = _settings.writeFunc;
+    if( ! writeFunc ){
+        IPersistenceStorage * storage = _settings.storage;
+        writeFunc = [ storage ]( TPersistenceSetId _persId, const std::vector<SPersistenceTrajectory> & _data ){
+            return storage->writeTrajectoryData( _persId, _data );
+        };
+    }
+
+    // blocks are independent -> one bulk per block, in any order
+    std::atomic<size_t> nextBlock( 0 );
+    std::atomic<bool> failed( false );
+    auto writeBlocks = [ & ](){
+        std::vector<SPersistenceTrajectory> points;
+        for( size_t idx = nextBlock++; idx < snapshot.m_blocks.size() && ! failed.load(); idx = nextBlock++ ){
+            points.clear();
+            if( ! snapshot.decodeBlock(idx, ALL_RECORDS_FROM, ALL_RECORDS_TO, points) || ! writeFunc(persId, points) ){
+                failed.store( true );
+            }
+        }
+    };
+
+    const size_t threadsCount = std::min<size_t>( _settings.threads, snapshot.m_blocks.size() );
+    if( threadsCount <= 1 ){
+        writeBlocks();
+    }
+    else{
+        std::vector<std::thread> writers;
+        for( size_t i = 0; i < threadsCount; i++ ){
+            writers.emplace_back( [ & ](){
+                writeBlocks();
+                if( _settings.writerExitFunc ){
+                    _settings.writerExitFunc();
+                }
+            });
+        }
+        for( std::thread & writer : writers ){
+            writer.join();
+        }
+    }
+
+    if( failed.load() ){
+        VS_LOG_ERROR << PRINT_HEADER << " import: payload write failed, file [" << _settings.path << "]"
+                     << " partial pers id [" << persId << "] is removed"
+                     << endl;
+
+        SPersistenceSetFilter filter( persId );
+        _settings.storage->deleteDataRange( filter );
+        _settings.storage->deleteSessionDescription( persId );
+        _settings.storage->deletePersistenceSetMetadata( persId );
+        return common_vars::INVALID_PERS_ID;
+    }
+
+    for( const SEventsSessionInfo & descr : snapshot.selectSessionDescriptions() ){
+        _settings.storage->insertSessionDescription( persId, descr );
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " [" << _settings.path << "] imported as pers id [" << persId << "]"
+                << " points [" << snapshot.getPointsCount() << "]"
+                << " writers [" << std::max<size_t>(threadsCount, 1) << "]"
+                << endl;
+    return persId;
+}
+
+// -------------------------------------------------------------------------------------
+// mapped read
+// -------------------------------------------------------------------------------------
+PersistenceSnapshot::PersistenceSnapshot()
+    : m_fd(-1)
+    , m_mapped(nullptr)
+    , m_mappedBytes(0)
+{
+
+}
+
+PersistenceSnapshot::~PersistenceSnapshot()
+{
+    close();
+}
+
+bool PersistenceSnapshot::open( const std::string & _path ){
+
+    close();
+
+    const int fd = ::open( _path.c_str(), O_RDONLY );
+    if( fd < 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot open [" << _path << "], reason: " << strerror(errno) << endl;
+        return false;
+    }
+
+    struct stat st;
+    if( 0 != ::fstat(fd, & st) || st.st_size < (off_t)HEADER_SIZE ){
+        VS_LOG_ERROR << PRINT_HEADER << " snapshot is truncated [" << _path << "]" << endl;
+        ::close( fd );
+        return false;
+    }
+
+    void * mapped = ::mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    if( MAP_FAILED == mapped ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot map [" << _path << "], reason: " << strerror(errno) << endl;
+        ::close( fd );
+        return false;
+    }
+
+    m_path = _path;
+    m_fd = fd;
+    m_mapped = static_cast<const uint8_t *>( mapped );
+    m_mappedBytes = st.st_size;
+
+    SByteReader header( m_mapped, HEADER_SIZE );
+    const uint32_t magic = header.get<uint32_t>();
+    const uint16_t version = header.get<uint16_t>();
+    header.get<uint16_t>(); // flags
+    const uint32_t blocksCount = header.get<uint32_t>();
+    header.get<uint32_t>(); // reserved
+    const uint64_t metaOffset = header.get<uint64_t>();
+    const uint32_t metaSize = header.get<uint32_t>();
+    const uint32_t metaCrc = header.get<uint32_t>();
+    const uint64_t indexOffset = header.get<uint64_t>();
+    const uint32_t indexSize = header.get<uint32_t>();
+    const uint32_t indexCrc = header.get<uint32_t>();
+    const uint32_t headerCrc = header.get<uint32_t>();
+
+    if( magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION || headerCrc != crc32(m_mapped, HEADER_CRC_OFFSET) ){
+        VS_LOG_ERROR << PRINT_HEADER << " incompatible or corrupted header [" << _path << "]" << endl;
+        close();
+        return false;
+    }
+
+    if( metaOffset + metaSize > m_mappedBytes || indexOffset + indexSize > m_mappedBytes
+            || metaCrc != crc32(m_mapped + metaOffset, metaSize)
+            || indexCrc != crc32(m_mapped + indexOffset, indexSize) ){
+        VS_LOG_ERROR << PRINT_HEADER << " corrupted metadata or index [" << _path << "]" << endl;
+        close();
+        return false;
+    }
+
+    if( ! readMetadata(m_mapped + metaOffset, metaSize) || ! readIndex(m_mapped + indexOffset, indexSize, blocksCount) ){
+        VS_LOG_ERROR << PRINT_HEADER << " malformed metadata or index [" << _path << "]" << endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void PersistenceSnapshot::close(){
+
+    if( m_mapped ){
+        ::munmap( const_cast<uint8_t *>(m_mapped), m_mappedBytes );
+        m_mapped = nullptr;
+        m_mappedBytes = 0;
+    }
+    if( m_fd >= 0 ){
+        ::close( m_fd );
+        m_fd = -1;
+    }
+
+    m_metadata = SPersistenceMetadata();
+    m_descr = SPersistenceMetadataDescr();
+    m_sessions.clear();
+    m_blocks.clear();
+}
+
+bool PersistenceSnapshot::readMetadata( const uint8_t * _data, size_t _size ){
+
+    SByteReader reader( _data, _size );
+
+    m_descr.sourceType = (EPersistenceSourceType)reader.get<int32_t>();
+    m_descr.persistenceSetId = reader.get<int64_t>();
+    m_descr.contextId = reader.get<uint32_t>();
+    m_descr.missionId = reader.get<uint32_t>();
+    m_descr.timeStepIntervalMillisec = reader.get<int64_t>();
+    m_descr.lastRecordedSession = reader.get<int32_t>();
+    m_descr.dataType = (EPersistenceDataType)reader.get<int32_t>();
+    m_descr.storageLayout = (EPersistenceStorageLayout)reader.get<int32_t>();
+    const int64_t sourceSpecific = reader.get<int64_t>();
+
+    const uint32_t sessionsCount = reader.get<uint32_t>();
+    if( ! reader.ok || (size_t)(reader.end - reader.pos) != (size_t)sessionsCount * SESSION_ENTRY_SIZE ){
+        return false;
+    }
+
+    m_sessions.resize( sessionsCount );
+    for( SEventsSessionInfo & descr : m_sessions ){
+        descr.number = reader.get<int32_t>();
+        descr.minLogicStep = reader.get<int64_t>();
+        descr.maxLogicStep = reader.get<int64_t>();
+        descr.minTimestampMillisec = reader.get<int64_t>();
+        descr.maxTimestampMillisec = reader.get<int64_t>();
+        descr.emptyStepsBegin = reader.get<int32_t>();
+        descr.emptyStepsEnd = reader.get<int32_t>();
+    }
+
+    switch( m_descr.sourceType ){
+    case EPersistenceSourceType::VIDEO_SERVER : {
+        SPersistenceMetadataVideo video;
+        static_cast<SPersistenceMetadataDescr &>( video ) = m_descr;
+        video.recordedFromSensorId = (TSensorId)sourceSpecific;
+        m_metadata.persistenceFromVideo.push_back( video );
+        break;
+    }
+    case EPersistenceSourceType::DSS : {
+        SPersistenceMetadataDSS dss;
+        static_cast<SPersistenceMetadataDescr &>( dss ) = m_descr;
+        dss.realData = ( sourceSpecific != 0 );
+        m_metadata.persistenceFromDSS.push_back( dss );
+        break;
+    }
+    case EPersistenceSourceType::AUTONOMOUS_RECORDER : {
+        SPersistenceMetadataRaw raw;
+        static_cast<SPersistenceMetadataDescr &>( raw ) = m_descr;
+        raw.a = (int)sourceSpecific;
+        m_metadata.persistenceFromRaw.push_back( raw );
+        break;
+    }
+    default : {
+        return false;
+    }
+    }
+
+    return reader.ok;
+}
+
+bool PersistenceSnapshot::readIndex( const uint8_t * _data, size_t _size, uint32_t _blocksCount ){
+
+    if( _size != (size_t)_blocksCount * INDEX_ENTRY_SIZE ){
+        return false;
+    }
+
+    SByteReader reader( _data, _size );
+    m_blocks.resize( _blocksCount );
+    for( SBlockInfo & block : m_blocks ){
+        block.offset = reader.get<uint64_t>();
+        block.size = reader.get<uint32_t>();
+        block.crc = reader.get<uint32_t>();
+        block.pointsCount = reader.get<uint32_t>();
+        block.firstSession = reader.get<int32_t>();
+        block.firstStep = reader.get<int64_t>();
+        block.lastSession = reader.get<int32_t>();
+        block.lastStep = reader.get<int64_t>();
+
+        if( block.offset < HEADER_SIZE || block.offset + block.size > m_mappedBytes ){
+            return false;
+        }
+    }
+
+    return reader.ok;
+}
+
+int64_t PersistenceSnapshot::getPointsCount() const {
+
+    int64_t out = 0;
+    for( const SBlockInfo & block : m_blocks ){
+        out += block.pointsCount;
+    }
+    return out;
+}
+
+bool PersistenceSnapshot::decodeBlock( size_t _blockIdx, const TRecordKey & _from, const TRecordKey & _to, std::vector<SPersistenceTrajectory> & _out ){
+
+    const SBlockInfo & block = m_blocks[ _blockIdx ];
+    const uint8_t * data = m_mapped + block.offset;
+
+    // checked on each decode, mapping may be read long after open
+    if( crc32(data, block.size) != block.crc ){
+        VS_LOG_ERROR << PRINT_HEADER << " corrupted block [" << _blockIdx << "] in [" << m_path << "]" << endl;
+        return false;
+    }
+
+    const size_t first = _out.size();
+    SByteReader reader( data, block.size );
+    while( reader.ok && reader.pos < reader.end ){
+        const TSessionNum sessionNum = reader.get<int32_t>();
+        const TLogicStep logicStep = reader.get<int64_t>();
+        const uint32_t chunkSize = reader.get<uint32_t>();
+        if( ! reader.ok || (size_t)(reader.end - reader.pos) < chunkSize ){
+            reader.ok = false;
+            break;
+        }
+
+        const TRecordKey key( sessionNum, logicStep );
+        if( key >= _from && key <= _to && ! TrajectoryChunkCodec::decode(reader.pos, chunkSize, sessionNum, logicStep, _out) ){
+            reader.ok = false;
+            break;
+        }
+        reader.pos += chunkSize;
+    }
+
+    if( ! reader.ok ){
+        VS_LOG_ERROR << PRINT_HEADER << " malformed block [" << _blockIdx << "] in [" << m_path << "]" << endl;
+        return false;
+    }
+
+    for( size_t i = first; i < _out.size(); i++ ){
+        _out[ i ].ctxId = m_descr.contextId;
+        _out[ i ].missionId = m_descr.missionId;
+    }
+    return true;
+}
+
+std::vector<SPersistenceTrajectory> PersistenceSnapshot::readTrajectoryData( const SPersistenceSetFilter & _filter ){
+
+    std::vector<SPersistenceTrajectory> out;
+    if( ! m_mapped ){
+        return out;
+    }
+
+    TRecordKey from;
+    TRecordKey to;
+    makeRecordRange( _filter, from, to );
+
+    // blocks are ordered and do not overlap -> first block which ends not before 'from'
+    auto iter = std::lower_bound( m_blocks.begin(), m_blocks.end(), from, []( const SBlockInfo & _block, const TRecordKey & _key ){
+        return TRecordKey( _block.lastSession, _block.lastStep ) < _key;
+    });
+
+    const TrajectoryPointPredicate predicate( _filter );
+    std::unique_ptr<TrajectoryDownsampler> downsampler( _filter.isDownsampled() ? new TrajectoryDownsampler(_filter) : nullptr );
+
+    std::vector<SPersistenceTrajectory> blockPoints;
+    for( ; iter != m_blocks.end() && TRecordKey(iter->firstSession, iter->firstStep) <= to; ++iter ){
+        blockPoints.clear();
+        if( ! decodeBlock(iter - m_blocks.begin(), from, to, blockPoints) ){
+            continue;
+        }
+        predicate.apply( blockPoints );
+
+        if( downsampler ){
+            downsampler->add( blockPoints );
+        }
+        else{
+            out.insert( out.end(), blockPoints.begin(), blockPoints.end() );
+        }
+    }
+
+    return downsampler ? downsampler->getResult() : out;
+}
+
+bool PersistenceSnapshot::replay( TBlockFunc _func ){
+
+    std::vector<SPersistenceTrajectory> points;
+    for( size_t idx = 0; idx < m_blocks.size(); idx++ ){
+        points.clear();
+        if( ! decodeBlock(idx, ALL_RECORDS_FROM, ALL_RECORDS_TO, points) ){
+            return false;
+        }
+
+        if( ! _func(points) ){
+            break;
+        }
+    }
+
+    return true;
+}
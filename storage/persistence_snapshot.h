@@ -0,0 +1,105 @@
+#ifndef PERSISTENCE_SNAPSHOT_H
+#define PERSISTENCE_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "common/ms_common_types.h"
+#include "i_persistence_storage.h"
+
+// one persistence set in one portable file ( little-endian, fixed-width fields ):
+// header | payload blocks | metadata & session descriptions | block index.
+// Block is a run of whole logic steps in ( session, step ) order, each step is a TrajectoryChunkCodec chunk.
+// Header, metadata, index and every block are protected by CRC-32
+class PersistenceSnapshot
+{
+public:
+    // points of one block, in ( session, step ) order
+    using TBlockFunc = std::function<bool( const std::vector<common_types::SPersistenceTrajectory> & _points )>;
+    using TWritePayloadFunc = std::function<bool( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data )>;
+
+    struct SExportSettings {
+        SExportSettings()
+            : storage(nullptr)
+            , persId(common_vars::INVALID_PERS_ID)
+            , pointsPerBlock(16384)
+        {}
+        IPersistenceStorage * storage;
+        common_types::TPersistenceSetId persId;
+        std::string path;
+        int32_t pointsPerBlock; // block is closed on step boundary after this count
+    };
+
+    struct SImportSettings {
+        SImportSettings()
+            : storage(nullptr)
+            , threads(1)
+        {}
+        IPersistenceStorage * storage; // new persistence set is created here
+        std::string path;
+        int32_t threads; // parallel block writers, > 1 only for storage with thread-safe writes
+        TWritePayloadFunc writeFunc; // payload bulk write, storage->writeTrajectoryData() if not set
+        std::function<void()> writerExitFunc; // per-thread resources of storage ( called in each writer thread )
+    };
+
+    struct SBlockInfo {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t crc;
+        uint32_t pointsCount;
+        common_types::TSessionNum firstSession;
+        common_types::TLogicStep firstStep;
+        common_types::TSessionNum lastSession;
+        common_types::TLogicStep lastStep;
+    };
+
+    static bool exportSet( const SExportSettings & _settings );
+    // returns id of the new set or INVALID_PERS_ID
+    static common_types::TPersistenceSetId importSet( const SImportSettings & _settings );
+
+    PersistenceSnapshot();
+    ~PersistenceSnapshot();
+
+    PersistenceSnapshot( const PersistenceSnapshot & _inst ) = delete;
+    PersistenceSnapshot & operator=( const PersistenceSnapshot & _inst ) = delete;
+
+    // file is mapped read-only, payload is decoded on demand
+    bool open( const std::string & _path );
+    void close();
+
+    // set as it was in source storage ( exactly one entry )
+    const common_types::SPersistenceMetadata & getMetadata() const { return m_metadata; }
+    const common_types::SPersistenceMetadataDescr & getDescr() const { return m_descr; }
+    const std::vector<common_types::SEventsSessionInfo> & selectSessionDescriptions() const { return m_sessions; }
+    const std::vector<SBlockInfo> & getBlocks() const { return m_blocks; }
+    int64_t getPointsCount() const;
+
+    // same filter semantics as storages ( persistence id of filter is ignored )
+    std::vector<common_types::SPersistenceTrajectory> readTrajectoryData( const common_types::SPersistenceSetFilter & _filter );
+    // blocks in order, stops when function returns false
+    bool replay( TBlockFunc _func );
+
+
+private:
+    bool readMetadata( const uint8_t * _data, size_t _size );
+    bool readIndex( const uint8_t * _data, size_t _size, uint32_t _blocksCount );
+    bool decodeBlock( size_t _blockIdx,
+                      const std::pair<common_types::TSessionNum, common_types::TLogicStep> & _from,
+                      const std::pair<common_types::TSessionNum, common_types::TLogicStep> & _to,
+                      std::vector<common_types::SPersistenceTrajectory> & _out );
+
+    // data
+    std::string m_path;
+    common_types::SPersistenceMetadata m_metadata;
+    common_types::SPersistenceMetadataDescr m_descr;
+    std::vector<common_types::SEventsSessionInfo> m_sessions;
+    std::vector<SBlockInfo> m_blocks;
+
+    // service
+    int m_fd;
+    const uint8_t * m_mapped;
+    size_t m_mappedBytes;
+};
+
+#endif // PERSISTENCE_SNAPSHOT_H
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <chrono>
+
+#include "system/logger.h"
+#include "common/ms_common_utils.h"
+#include "retention_engine.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "Retention:";
+
+static int64_t nowMillisec(){
+    using namespace std::chrono;
+    return duration_cast<milliseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+RetentionEngine::RetentionEngine()
+    : m_shutdownCalled(false)
+    , m_lastBatchMillisec(0)
+    , m_threadRetention(nullptr)
+{
+
+}
+
+RetentionEngine::~RetentionEngine()
+{
+    shutdown();
+}
+
+bool RetentionEngine::init( const SInitSettings & _settings ){
+
+    if( ! _settings.storage || ! _settings.deleteBatchFunc || ! _settings.dropSetFunc ){
+        VS_LOG_ERROR << PRINT_HEADER << " storage or delete functions are not set" << endl;
+        return false;
+    }
+
+    if( _settings.batchSize <= 0 || _settings.maxBatchesPerSec < 0 || _settings.checkIntervalMillisec < 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid batch size/rate/interval: "
+                     << _settings.batchSize << "/" << _settings.maxBatchesPerSec << "/" << _settings.checkIntervalMillisec
+                     << endl;
+        return false;
+    }
+
+    m_settings = _settings;
+    m_policies = _settings.policies;
+
+    if( m_settings.checkIntervalMillisec > 0 ){
+        m_threadRetention = new std::thread( & RetentionEngine::threadRetention, this );
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " init success"
+                << " policies [" << m_policies.size() << "]"
+                << " batch [" << m_settings.batchSize << "]"
+                << " rate [" << m_settings.maxBatchesPerSec << "] batch/sec"
+                << endl;
+    return true;
+}
+
+void RetentionEngine::shutdown(){
+
+    if( m_shutdownCalled.exchange(true) ){
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutexWakeup );
+        m_cvWakeup.notify_all();
+    }
+    common_utils::threadShutdown( m_threadRetention );
+}
+
+RetentionEngine::SRetentionStats RetentionEngine::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexStats );
+    return m_stats;
+}
+
+void RetentionEngine::setPolicies( const std::vector<SRetentionPolicy> & _policies ){
+
+    std::lock_guard<std::mutex> lock( m_mutexPolicies );
+    m_policies = _policies;
+}
+
+void RetentionEngine::threadRetention(){
+
+    VS_LOG_INFO << PRINT_HEADER << " retention thread is STARTED" << endl;
+
+    while( ! m_shutdownCalled.load() ){
+        runOnce();
+
+        std::unique_lock<std::mutex> lock( m_mutexWakeup );
+        m_cvWakeup.wait_for( lock, std::chrono::milliseconds(m_settings.checkIntervalMillisec), [ this ](){ return m_shutdownCalled.load(); } );
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " retention thread go to EXIT" << endl;
+}
+
+void RetentionEngine::runOnce(){
+
+    // background pass & manual pass must not cut the same set concurrently
+    std::lock_guard<std::mutex> lockPass( m_mutexPass );
+    const int64_t passBeginMillisec = nowMillisec();
+
+    std::vector<SRetentionPolicy> policies;
+    {
+        std::lock_guard<std::mutex> lock( m_mutexPolicies );
+        policies = m_policies;
+    }
+
+    if( ! policies.empty() ){
+        // NOTE: source type is taken from the list, not from the descr
+        std::vector<SPersistenceMetadataDescr> descrs;
+        for( const SPersistenceMetadata & meta : m_settings.storage->getPersistenceSetMetadata(common_vars::ALL_CONTEXT_ID) ){
+            for( const SPersistenceMetadataVideo & video : meta.persistenceFromVideo ){
+                descrs.push_back( video );
+                descrs.back().sourceType = EPersistenceSourceType::VIDEO_SERVER;
+            }
+            for( const SPersistenceMetadataDSS & dss : meta.persistenceFromDSS ){
+                descrs.push_back( dss );
+                descrs.back().sourceType = EPersistenceSourceType::DSS;
+            }
+            for( const SPersistenceMetadataRaw & raw : meta.persistenceFromRaw ){
+                descrs.push_back( raw );
+                descrs.back().sourceType = EPersistenceSourceType::AUTONOMOUS_RECORDER;
+            }
+        }
+
+        // astro time is a wall clock of the recorder
+        const int64_t astroNowMillisec = common_utils::getCurrentTimeMillisec();
+        for( const SPersistenceMetadataDescr & descr : descrs ){
+            if( m_shutdownCalled.load() ){
+                break;
+            }
+
+            const SRetentionPolicy * policy = findPolicy( policies, descr );
+            if( policy ){
+                applyPolicy( descr, * policy, astroNowMillisec );
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexStats );
+    m_stats.passesCount++;
+    m_stats.lastPassDurationMillisec = nowMillisec() - passBeginMillisec;
+}
+
+const RetentionEngine::SRetentionPolicy * RetentionEngine::findPolicy( const std::vector<SRetentionPolicy> & _policies,
+                                                                       const SPersistenceMetadataDescr & _descr ){
+
+    const SRetentionPolicy * best = nullptr;
+    int bestRank = -1;
+
+    for( const SRetentionPolicy & policy : _policies ){
+        const bool anyContext = ( common_vars::ALL_CONTEXT_ID == policy.ctxId );
+        const bool anySource = ( EPersistenceSourceType::UNDEFINED == policy.sourceType );
+
+        if( (! anyContext && policy.ctxId != _descr.contextId) || (! anySource && policy.sourceType != _descr.sourceType) ){
+            continue;
+        }
+
+        const int rank = ( anyContext ? 0 : 2 ) + ( anySource ? 0 : 1 );
+        if( rank > bestRank ){
+            best = & policy;
+            bestRank = rank;
+        }
+    }
+
+    return best;
+}
+
+std::vector<SEventsSessionInfo> RetentionEngine::selectSessions( TPersistenceSetId _persId ){
+
+    std::vector<SEventsSessionInfo> sessions = m_settings.storage->selectSessionDescriptions( _persId );
+    std::sort( sessions.begin(), sessions.end(), []( const SEventsSessionInfo & _lhs, const SEventsSessionInfo & _rhs ){
+        return _lhs.number < _rhs.number;
+    });
+
+    // descriptions may lag behind payload ( not flushed yet or never written ) - the rest is scanned
+    SEventsSessionInfo head = m_settings.storage->scanPayloadHeadForSessions( _persId );
+    SEventsSessionInfo tail = m_settings.storage->scanPayloadTailForSessions( _persId );
+    if( head.empty() || tail.empty() ){
+        return sessions;
+    }
+
+    if( sessions.empty() ){
+        return m_settings.storage->scanPayloadRangeForSessions( _persId, {head.number, tail.number} );
+    }
+
+    if( head.number < sessions.front().number ){
+        std::vector<SEventsSessionInfo> before = m_settings.storage->scanPayloadRangeForSessions( _persId, {head.number, sessions.front().number - 1} );
+        sessions.insert( sessions.begin(), before.begin(), before.end() );
+    }
+
+    // last described session may still grow
+    if( tail.number == sessions.back().number ){
+        sessions.back() = tail;
+    }
+    else if( tail.number > sessions.back().number ){
+        const std::vector<SEventsSessionInfo> after = m_settings.storage->scanPayloadRangeForSessions( _persId, {sessions.back().number + 1, tail.number} );
+        sessions.insert( sessions.end(), after.begin(), after.end() );
+    }
+
+    return sessions;
+}
+
+void RetentionEngine::applyPolicy( const SPersistenceMetadataDescr & _descr, const SRetentionPolicy & _policy, int64_t _nowMillisec ){
+
+    const std::vector<SEventsSessionInfo> sessions = selectSessions( _descr.persistenceSetId );
+    if( sessions.empty() ){
+        return;
+    }
+
+    SRetentionCut cut;
+    cut.persId = _descr.persistenceSetId;
+    cut.beforeSession = sessions.front().number;
+
+    if( _policy.maxSessions > 0 && (int64_t)sessions.size() > _policy.maxSessions ){
+        cut.beforeSession = sessions[ sessions.size() - _policy.maxSessions ].number;
+    }
+
+    if( _policy.maxAgeMillisec > 0 ){
+        const int64_t expireBeforeMillisec = _nowMillisec - _policy.maxAgeMillisec;
+
+        // whole set is expired - drop it instead of deleting by records
+        bool wholeSetExpired = true;
+        for( const SEventsSessionInfo & session : sessions ){
+            wholeSetExpired &= ( session.maxTimestampMillisec < expireBeforeMillisec );
+        }
+
+        if( wholeSetExpired ){
+            VS_LOG_INFO << PRINT_HEADER << " pers id [" << _descr.persistenceSetId << "] is expired, drop it" << endl;
+
+            const bool dropped = m_settings.dropSetFunc( _descr.persistenceSetId );
+
+            std::lock_guard<std::mutex> lock( m_mutexStats );
+            dropped ? m_stats.setsDropped++ : m_stats.errorsCount++;
+            return;
+        }
+
+        // sessions go one after another in time
+        for( const SEventsSessionInfo & session : sessions ){
+            if( session.maxTimestampMillisec < expireBeforeMillisec ){
+                cut.beforeSession = std::max( cut.beforeSession, session.number + 1 );
+                continue;
+            }
+
+            if( session.minTimestampMillisec < expireBeforeMillisec && session.number >= cut.beforeSession ){
+                cut.boundarySession = session.number;
+                cut.beforeAstroTimeMillisec = expireBeforeMillisec;
+            }
+            break;
+        }
+    }
+
+    if( cut.beforeSession == sessions.front().number && common_vars::INVALID_SESSION_NUM == cut.boundarySession ){
+        return;
+    }
+
+    if( ! removeInBatches(cut) ){
+        return;
+    }
+
+    // descriptions follow the payload
+    int64_t sessionsRemoved = 0;
+    for( const SEventsSessionInfo & session : sessions ){
+        if( session.number < cut.beforeSession ){
+            m_settings.storage->deleteSessionDescription( _descr.persistenceSetId, session.number );
+            sessionsRemoved++;
+        }
+    }
+
+    if( cut.boundarySession != common_vars::INVALID_SESSION_NUM ){
+        refreshSessionDescription( _descr.persistenceSetId, cut.boundarySession );
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexStats );
+    m_stats.sessionsRemoved += sessionsRemoved;
+}
+
+bool RetentionEngine::removeInBatches( const SRetentionCut & _cut ){
+
+    while( ! m_shutdownCalled.load() ){
+        if( ! waitNextBatch() ){
+            return false;
+        }
+
+        const int64_t removed = m_settings.deleteBatchFunc( _cut, m_settings.batchSize );
+
+        std::lock_guard<std::mutex> lock( m_mutexStats );
+        if( removed < 0 ){
+            VS_LOG_ERROR << PRINT_HEADER << " batch delete failed, pers id [" << _cut.persId << "]" << endl;
+            m_stats.errorsCount++;
+            return false;
+        }
+
+        m_stats.batchesCount++;
+        m_stats.recordsRemoved += removed;
+
+        if( removed < m_settings.batchSize ){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void RetentionEngine::refreshSessionDescription( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    const std::vector<SEventsSessionInfo> rest = m_settings.storage->scanPayloadRangeForSessions( _persId, {_sessionNum, _sessionNum} );
+
+    m_settings.storage->deleteSessionDescription( _persId, _sessionNum );
+    for( const SEventsSessionInfo & descr : rest ){
+        m_settings.storage->insertSessionDescription( _persId, descr );
+    }
+}
+
+bool RetentionEngine::waitNextBatch(){
+
+    if( 0 == m_settings.maxBatchesPerSec ){
+        return true;
+    }
+
+    // readers get the collection between batches
+    const int64_t batchIntervalMillisec = 1000 / m_settings.maxBatchesPerSec;
+    const int64_t waitMillisec = m_lastBatchMillisec + batchIntervalMillisec - nowMillisec();
+    if( waitMillisec > 0 ){
+        std::unique_lock<std::mutex> lock( m_mutexWakeup );
+        m_cvWakeup.wait_for( lock, std::chrono::milliseconds(waitMillisec), [ this ](){ return m_shutdownCalled.load(); } );
+    }
+
+    m_lastBatchMillisec = nowMillisec();
+    return ! m_shutdownCalled.load();
+}
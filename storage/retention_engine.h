@@ -0,0 +1,124 @@
+#ifndef RETENTION_ENGINE_H
+#define RETENTION_ENGINE_H
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+#include "common/ms_common_types.h"
+#include "common/ms_common_vars.h"
+#include "i_persistence_storage.h"
+
+// background cleanup of old payload: expired sessions are removed in small rate-limited batches,
+// fully expired persistence set is dropped at once
+class RetentionEngine
+{
+public:
+    // most specific policy wins: ( ctx, source ) -> ( ctx ) -> ( source ) -> default
+    struct SRetentionPolicy {
+        SRetentionPolicy()
+            : ctxId(common_vars::ALL_CONTEXT_ID)
+            , sourceType(common_types::EPersistenceSourceType::UNDEFINED)
+            , maxAgeMillisec(0)
+            , maxSessions(0)
+        {}
+        common_types::TContextId ctxId; // ALL_CONTEXT_ID - any
+        common_types::EPersistenceSourceType sourceType; // UNDEFINED - any
+        int64_t maxAgeMillisec; // by astro time, 0 - unlimited
+        int32_t maxSessions; // per persistence set, 0 - unlimited
+    };
+
+    // sessions before 'beforeSession' and points of 'boundarySession' older than 'beforeAstroTimeMillisec'
+    struct SRetentionCut {
+        SRetentionCut()
+            : persId(common_vars::INVALID_PERS_ID)
+            , beforeSession(0)
+            , boundarySession(common_vars::INVALID_SESSION_NUM)
+            , beforeAstroTimeMillisec(0)
+        {}
+        common_types::TPersistenceSetId persId;
+        common_types::TSessionNum beforeSession;
+        common_types::TSessionNum boundarySession;
+        int64_t beforeAstroTimeMillisec;
+    };
+
+    // one batch in index order, returns removed records count ( < 0 on error )
+    using TDeleteBatchFunc = std::function<int64_t( const SRetentionCut & _cut, int32_t _batchSize )>;
+    // payload, descriptions & metadata of the set
+    using TDropSetFunc = std::function<bool( common_types::TPersistenceSetId _persId )>;
+
+    struct SInitSettings {
+        SInitSettings()
+            : storage(nullptr)
+            , checkIntervalMillisec(60000)
+            , batchSize(1000)
+            , maxBatchesPerSec(20)
+        {}
+        IPersistenceStorage * storage; // metadata & descriptions
+        TDeleteBatchFunc deleteBatchFunc;
+        TDropSetFunc dropSetFunc;
+        std::vector<SRetentionPolicy> policies;
+        int64_t checkIntervalMillisec; // 0 - no background thread, only runOnce()
+        int32_t batchSize;
+        int32_t maxBatchesPerSec; // 0 - unlimited
+    };
+
+    struct SRetentionStats {
+        SRetentionStats()
+            : passesCount(0)
+            , setsDropped(0)
+            , sessionsRemoved(0)
+            , recordsRemoved(0)
+            , batchesCount(0)
+            , errorsCount(0)
+            , lastPassDurationMillisec(0)
+        {}
+        int64_t passesCount;
+        int64_t setsDropped;
+        int64_t sessionsRemoved;
+        int64_t recordsRemoved;
+        int64_t batchesCount;
+        int64_t errorsCount;
+        int64_t lastPassDurationMillisec;
+    };
+
+    RetentionEngine();
+    ~RetentionEngine();
+
+    bool init( const SInitSettings & _settings );
+    void shutdown();
+    SRetentionStats getStats();
+
+    void setPolicies( const std::vector<SRetentionPolicy> & _policies );
+    // one pass in caller thread
+    void runOnce();
+
+
+private:
+    void threadRetention();
+    const SRetentionPolicy * findPolicy( const std::vector<SRetentionPolicy> & _policies, const common_types::SPersistenceMetadataDescr & _descr );
+    void applyPolicy( const common_types::SPersistenceMetadataDescr & _descr, const SRetentionPolicy & _policy, int64_t _nowMillisec );
+    std::vector<common_types::SEventsSessionInfo> selectSessions( common_types::TPersistenceSetId _persId );
+    bool removeInBatches( const SRetentionCut & _cut );
+    void refreshSessionDescription( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+    bool waitNextBatch();
+
+    // data
+    SInitSettings m_settings;
+    std::vector<SRetentionPolicy> m_policies;
+    SRetentionStats m_stats;
+    std::atomic<bool> m_shutdownCalled;
+    int64_t m_lastBatchMillisec;
+
+    // service
+    std::thread * m_threadRetention;
+    std::mutex m_mutexPolicies;
+    std::mutex m_mutexStats;
+    std::mutex m_mutexPass;
+    std::mutex m_mutexWakeup;
+    std::condition_variable m_cvWakeup;
+};
+
+#endif // RETENTION_ENGINE_H
@@ -0,0 +1,254 @@
+
+#include "session_summary.h"
+
+using namespace std;
+using namespace common_types;
+
+SessionSummary::SessionSummary()
+{
+
+}
+
+SessionSummary::~SessionSummary()
+{
+
+}
+
+bool SessionSummary::isSeeded( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    return ( m_sets.find(_persId) != m_sets.end() );
+}
+
+void SessionSummary::seed( TPersistenceSetId _persId, const std::vector<SEventsSessionInfo> & _gapSplittedSessions ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    SPersistenceSetState & set = m_sets[ _persId ];
+    set.sessions.clear();
+
+    // each segment is one continuous interval
+    for( const SEventsSessionInfo & segment : _gapSplittedSessions ){
+        SStepInterval interval;
+        interval.endStep = segment.maxLogicStep;
+        interval.beginAstroTimeMillisec = segment.minTimestampMillisec;
+        interval.endAstroTimeMillisec = segment.maxTimestampMillisec;
+
+        set.sessions[ segment.number ].intervals[ segment.minLogicStep ] = interval;
+    }
+}
+
+void SessionSummary::addStep( SPersistenceSetState & _set, TSessionNum _sessionNum, TLogicStep _step, int64_t _astroTimeMillisec ){
+
+    SSessionState & session = _set.sessions[ _sessionNum ];
+    auto & intervals = session.intervals;
+
+    auto next = intervals.upper_bound( _step );
+    auto prev = ( next == intervals.begin() ) ? intervals.end() : std::prev( next );
+
+    // already covered - only astro bounds may grow
+    if( prev != intervals.end() && _step <= prev->second.endStep ){
+        if( _step == prev->first && _astroTimeMillisec > prev->second.beginAstroTimeMillisec ){
+            prev->second.beginAstroTimeMillisec = _astroTimeMillisec;
+            session.dirty = true;
+        }
+        if( _step == prev->second.endStep && _astroTimeMillisec > prev->second.endAstroTimeMillisec ){
+            prev->second.endAstroTimeMillisec = _astroTimeMillisec;
+            session.dirty = true;
+        }
+        return;
+    }
+
+    const bool joinsPrev = ( prev != intervals.end() && (prev->second.endStep + 1) == _step );
+    const bool joinsNext = ( next != intervals.end() && next->first == (_step + 1) );
+
+    // gap is closed
+    if( joinsPrev && joinsNext ){
+        prev->second.endStep = next->second.endStep;
+        prev->second.endAstroTimeMillisec = next->second.endAstroTimeMillisec;
+        intervals.erase( next );
+    }
+    else if( joinsPrev ){
+        prev->second.endStep = _step;
+        prev->second.endAstroTimeMillisec = _astroTimeMillisec;
+    }
+    else if( joinsNext ){
+        SStepInterval interval = next->second;
+        interval.beginAstroTimeMillisec = _astroTimeMillisec;
+        intervals.erase( next );
+        intervals[ _step ] = interval;
+    }
+    // new gap
+    else{
+        SStepInterval interval;
+        interval.endStep = _step;
+        interval.beginAstroTimeMillisec = _astroTimeMillisec;
+        interval.endAstroTimeMillisec = _astroTimeMillisec;
+        intervals[ _step ] = interval;
+    }
+
+    session.dirty = true;
+}
+
+SEventsSessionInfo SessionSummary::makeInfo( TSessionNum _sessionNum, const SSessionState & _session ){
+
+    SEventsSessionInfo out;
+    out.number = _sessionNum;
+
+    if( ! _session.intervals.empty() ){
+        const auto & first = * _session.intervals.begin();
+        const auto & last = * _session.intervals.rbegin();
+
+        out.minLogicStep = first.first;
+        out.minTimestampMillisec = first.second.beginAstroTimeMillisec;
+        out.maxLogicStep = last.second.endStep;
+        out.maxTimestampMillisec = last.second.endAstroTimeMillisec;
+    }
+
+    return out;
+}
+
+bool SessionSummary::getHead( TPersistenceSetId _persId, SEventsSessionInfo & _out ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    auto iter = m_sets.find( _persId );
+    if( iter == m_sets.end() ){
+        return false;
+    }
+
+    if( ! iter->second.sessions.empty() ){
+        const auto & head = * iter->second.sessions.begin();
+        _out = makeInfo( head.first, head.second );
+    }
+    return true;
+}
+
+bool SessionSummary::getTail( TPersistenceSetId _persId, SEventsSessionInfo & _out ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    auto iter = m_sets.find( _persId );
+    if( iter == m_sets.end() ){
+        return false;
+    }
+
+    if( ! iter->second.sessions.empty() ){
+        const auto & tail = * iter->second.sessions.rbegin();
+        _out = makeInfo( tail.first, tail.second );
+    }
+    return true;
+}
+
+bool SessionSummary::getRange( TPersistenceSetId _persId,
+                               const std::pair<TSessionNum, TSessionNum> _sessionRange,
+                               std::vector<SEventsSessionInfo> & _out ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    auto iter = m_sets.find( _persId );
+    if( iter == m_sets.end() ){
+        return false;
+    }
+
+    const auto & sessions = iter->second.sessions;
+    for( auto sessionIter = sessions.lower_bound( _sessionRange.first );
+         sessionIter != sessions.end() && sessionIter->first <= _sessionRange.second;
+         ++sessionIter ){
+        _out.push_back( makeInfo(sessionIter->first, sessionIter->second) );
+    }
+    return true;
+}
+
+bool SessionSummary::getGapSplitted( TPersistenceSetId _persId,
+                                     const std::pair<TSessionNum, TSessionNum> _sessionRange,
+                                     const TLogicStep _logicStepThreshold,
+                                     std::vector<SEventsSessionInfo> & _out ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    auto iter = m_sets.find( _persId );
+    if( iter == m_sets.end() ){
+        return false;
+    }
+
+    const auto & sessions = iter->second.sessions;
+    for( auto sessionIter = sessions.lower_bound( _sessionRange.first );
+         sessionIter != sessions.end() && sessionIter->first <= _sessionRange.second;
+         ++sessionIter ){
+
+        // gaps not longer than threshold are merged
+        SEventsSessionInfo segment;
+        bool segmentOpened = false;
+
+        for( const auto & valuePair : sessionIter->second.intervals ){
+            if( segmentOpened && (valuePair.first - segment.maxLogicStep) > (_logicStepThreshold + 1) ){
+                _out.push_back( segment );
+                segmentOpened = false;
+            }
+
+            if( ! segmentOpened ){
+                segment.clear();
+                segment.number = sessionIter->first;
+                segment.minLogicStep = valuePair.first;
+                segment.minTimestampMillisec = valuePair.second.beginAstroTimeMillisec;
+                segmentOpened = true;
+            }
+
+            segment.maxLogicStep = valuePair.second.endStep;
+            segment.maxTimestampMillisec = valuePair.second.endAstroTimeMillisec;
+        }
+
+        if( segmentOpened ){
+            _out.push_back( segment );
+        }
+    }
+    return true;
+}
+
+void SessionSummary::takeDirty( TPersistenceSetId _persId, bool _withTail, std::vector<SEventsSessionInfo> & _out ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    auto iter = m_sets.find( _persId );
+    if( iter == m_sets.end() || iter->second.sessions.empty() ){
+        return;
+    }
+
+    // tail is still growing, other sessions are closed
+    const TSessionNum tailSession = iter->second.sessions.rbegin()->first;
+
+    for( auto & valuePair : iter->second.sessions ){
+        if( ! valuePair.second.dirty || (! _withTail && valuePair.first == tailSession) ){
+            continue;
+        }
+
+        _out.push_back( makeInfo(valuePair.first, valuePair.second) );
+        valuePair.second.dirty = false;
+    }
+}
+
+void SessionSummary::markDirty( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    auto iter = m_sets.find( _persId );
+    if( iter == m_sets.end() ){
+        return;
+    }
+
+    auto sessionIter = iter->second.sessions.find( _sessionNum );
+    if( sessionIter != iter->second.sessions.end() ){
+        sessionIter->second.dirty = true;
+    }
+}
+
+std::vector<TPersistenceSetId> SessionSummary::getSeededSets(){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    std::vector<TPersistenceSetId> out;
+    out.reserve( m_sets.size() );
+    for( const auto & valuePair : m_sets ){
+        out.push_back( valuePair.first );
+    }
+    return out;
+}
+
+void SessionSummary::invalidate( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSummary );
+    m_sets.erase( _persId );
+}
@@ -0,0 +1,85 @@
+#ifndef SESSION_SUMMARY_H
+#define SESSION_SUMMARY_H
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "common/ms_common_types.h"
+
+// per persistence set summary of written sessions: covered step intervals ( gaps between them ) and astro bounds
+class SessionSummary
+{
+public:
+    SessionSummary();
+    ~SessionSummary();
+
+    // fill
+    bool isSeeded( common_types::TPersistenceSetId _persId );
+    void seed( common_types::TPersistenceSetId _persId, const std::vector<common_types::SEventsSessionInfo> & _gapSplittedSessions );
+
+    template< typename T_Obj >
+    void update( common_types::TPersistenceSetId _persId, const std::vector<T_Obj> & _data ){
+
+        std::lock_guard<std::mutex> lock( m_mutexSummary );
+        auto iter = m_sets.find( _persId );
+        // NOTE: not seeded set will be scanned from the store entirely
+        if( iter == m_sets.end() ){
+            return;
+        }
+
+        for( const common_types::SPersistenceObj & obj : _data ){
+            addStep( iter->second, obj.sessionNum, obj.logicTime, obj.astroTimeMillisec );
+        }
+    }
+
+    // read
+    bool getHead( common_types::TPersistenceSetId _persId, common_types::SEventsSessionInfo & _out );
+    bool getTail( common_types::TPersistenceSetId _persId, common_types::SEventsSessionInfo & _out );
+    bool getRange( common_types::TPersistenceSetId _persId,
+                   const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange,
+                   std::vector<common_types::SEventsSessionInfo> & _out );
+    bool getGapSplitted( common_types::TPersistenceSetId _persId,
+                         const std::pair<common_types::TSessionNum, common_types::TSessionNum> _sessionRange,
+                         const common_types::TLogicStep _logicStepThreshold,
+                         std::vector<common_types::SEventsSessionInfo> & _out );
+
+    // lazy flush to description
+    void takeDirty( common_types::TPersistenceSetId _persId, bool _withTail, std::vector<common_types::SEventsSessionInfo> & _out );
+    void markDirty( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+    std::vector<common_types::TPersistenceSetId> getSeededSets();
+
+    // invalidate
+    void invalidate( common_types::TPersistenceSetId _persId );
+
+
+private:
+    struct SStepInterval {
+        common_types::TLogicStep endStep;
+        int64_t beginAstroTimeMillisec;
+        int64_t endAstroTimeMillisec;
+    };
+
+    struct SSessionState {
+        SSessionState()
+            : dirty(false)
+        {}
+        std::map<common_types::TLogicStep, SStepInterval> intervals; // by begin step
+        bool dirty;
+    };
+
+    struct SPersistenceSetState {
+        std::map<common_types::TSessionNum, SSessionState> sessions;
+    };
+
+    static void addStep( SPersistenceSetState & _set, common_types::TSessionNum _sessionNum, common_types::TLogicStep _step, int64_t _astroTimeMillisec );
+    static common_types::SEventsSessionInfo makeInfo( common_types::TSessionNum _sessionNum, const SSessionState & _session );
+
+    // data
+    std::unordered_map<common_types::TPersistenceSetId, SPersistenceSetState> m_sets;
+
+    // service
+    std::mutex m_mutexSummary;
+};
+
+#endif // SESSION_SUMMARY_H
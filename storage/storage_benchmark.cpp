@@ -0,0 +1,416 @@
+#include <chrono>
+#include <thread>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "system/logger.h"
+#include "storage_benchmark.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "StorageBench:";
+
+using TClock = std::chrono::steady_clock;
+
+static inline int64_t elapsedNanosec( const TClock::time_point & _from ){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( TClock::now() - _from ).count();
+}
+
+StorageBenchmark::StorageBenchmark()
+    : m_persId(common_vars::INVALID_PERS_ID)
+{
+
+}
+
+StorageBenchmark::~StorageBenchmark()
+{
+
+}
+
+bool StorageBenchmark::run( const SInitSettings & _settings, SResult & _out ){
+
+    if( ! _settings.storage ){
+        VS_LOG_ERROR << PRINT_HEADER << " storage is not set" << endl;
+        return false;
+    }
+    if( _settings.objectsPerStep <= 0 || _settings.stepsPerSession <= 0 || _settings.sessionsPerSet <= 0 || _settings.pointsPerWrite <= 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid data shape, objects per step [" << _settings.objectsPerStep << "]"
+                     << " steps per session [" << _settings.stepsPerSession << "]"
+                     << " sessions per set [" << _settings.sessionsPerSet << "]"
+                     << " points per write [" << _settings.pointsPerWrite << "]"
+                     << endl;
+        return false;
+    }
+
+    m_settings = _settings;
+    _out = SResult();
+
+    VS_LOG_INFO << PRINT_HEADER << " run on [" << m_settings.backendName << "]"
+                << " shape [" << m_settings.objectsPerStep << " x " << m_settings.stepsPerSession << " x " << m_settings.sessionsPerSet << "]"
+                << endl;
+
+    clearContext();
+    if( ! createSet() ){
+        return false;
+    }
+
+    if( ! runIngest(_out) ){
+        clearContext();
+        return false;
+    }
+    runPointReads( _out );
+    runRangeReads( _out );
+    runSessionScans( _out );
+    runMetadataLookups( _out );
+    runConcurrent( _out );
+
+    clearContext();
+
+    const std::string report = toJson( m_settings, _out );
+    VS_LOG_INFO << PRINT_HEADER << " " << report << endl;
+
+    if( ! m_settings.reportPath.empty() ){
+        std::ofstream file( m_settings.reportPath, std::ios::trunc );
+        if( ! file.is_open() ){
+            VS_LOG_ERROR << PRINT_HEADER << " can't open report file: " << m_settings.reportPath << endl;
+            return false;
+        }
+        file << report << std::endl;
+    }
+
+    return true;
+}
+
+void StorageBenchmark::clearContext(){
+
+    m_settings.storage->deleteTotalData( m_settings.ctxId );
+    m_settings.storage->deleteSessionDescription( m_settings.ctxId );
+    m_settings.storage->deletePersistenceSetMetadata( m_settings.ctxId );
+}
+
+bool StorageBenchmark::createSet(){
+
+    SPersistenceMetadataRaw metadata;
+    metadata.contextId = m_settings.ctxId;
+    metadata.missionId = m_settings.missionId;
+    metadata.lastRecordedSession = m_settings.sessionsPerSet;
+    metadata.sourceType = EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    metadata.dataType = EPersistenceDataType::TRAJECTORY;
+    metadata.storageLayout = m_settings.storageLayout;
+    metadata.timeStepIntervalMillisec = 1000;
+
+    m_persId = m_settings.storage->writePersistenceSetMetadata( metadata );
+    if( common_vars::INVALID_PERS_ID == m_persId ){
+        VS_LOG_ERROR << PRINT_HEADER << " benchmark set creation failed, ctx id: " << m_settings.ctxId << endl;
+        return false;
+    }
+
+    if( m_settings.setCreatedFunc ){
+        m_settings.setCreatedFunc( m_persId );
+    }
+
+    return true;
+}
+
+std::vector<SPersistenceTrajectory> StorageBenchmark::makeStep( TSessionNum _sessionNum, TLogicStep _step ){
+
+    std::vector<SPersistenceTrajectory> out( m_settings.objectsPerStep );
+    for( int32_t i = 0; i < m_settings.objectsPerStep; i++ ){
+        SPersistenceTrajectory & point = out[ i ];
+        point.objId = 1000 + i;
+        point.state = SPersistenceObj::EState::ACTIVE;
+        point.sessionNum = _sessionNum;
+        point.logicTime = _step;
+        point.astroTimeMillisec = 1000000 + _step * 1000;
+        point.latDeg = 40.0 + i * 0.001 + _step * 0.00001;
+        point.lonDeg = 90.0 + i * 0.001;
+        point.height = 100.0;
+        point.yawDeg = (double)( _step % 360 );
+    }
+    return out;
+}
+
+bool StorageBenchmark::runIngest( SResult & _out ){
+
+    std::vector<int64_t> latencies;
+    std::vector<SPersistenceTrajectory> batch;
+    batch.reserve( m_settings.pointsPerWrite + m_settings.objectsPerStep );
+
+    auto write = [ this, & batch, & latencies, & _out ](){
+        const TClock::time_point start = TClock::now();
+        const bool rt = m_settings.storage->writeTrajectoryData( m_persId, batch );
+        latencies.push_back( elapsedNanosec(start) );
+        _out.ingestPoints += batch.size();
+        batch.clear();
+        return rt;
+    };
+
+    const TClock::time_point ingestStart = TClock::now();
+    for( TSessionNum sessionNum = 1; sessionNum <= m_settings.sessionsPerSet; sessionNum++ ){
+        for( TLogicStep step = 0; step < m_settings.stepsPerSession; step++ ){
+            const std::vector<SPersistenceTrajectory> points = makeStep( sessionNum, step );
+            batch.insert( batch.end(), points.begin(), points.end() );
+
+            if( (int32_t)batch.size() >= m_settings.pointsPerWrite && ! write() ){
+                VS_LOG_ERROR << PRINT_HEADER << " ingest failed, pers id: " << m_persId << endl;
+                return false;
+            }
+        }
+    }
+    if( ! batch.empty() && ! write() ){
+        VS_LOG_ERROR << PRINT_HEADER << " ingest failed, pers id: " << m_persId << endl;
+        return false;
+    }
+    const double ingestSec = std::chrono::duration<double>( TClock::now() - ingestStart ).count();
+
+    _out.ingestPointsPerSec = ( ingestSec > 0.0 ) ? ( _out.ingestPoints / ingestSec ) : 0.0;
+    _out.ingestWrite = makeLatency( latencies );
+
+    // descriptions for session list phase ( not measured )
+    for( const SEventsSessionInfo & descr : m_settings.storage->scanPayloadForSessions(m_persId) ){
+        m_settings.storage->insertSessionDescription( m_persId, descr );
+    }
+
+    return true;
+}
+
+void StorageBenchmark::runPointReads( SResult & _out ){
+
+    std::mt19937 generator( m_settings.seed );
+    std::uniform_int_distribution<TSessionNum> sessions( 1, m_settings.sessionsPerSet );
+    std::uniform_int_distribution<TLogicStep> steps( 0, m_settings.stepsPerSession - 1 );
+
+    std::vector<int64_t> latencies;
+    latencies.reserve( m_settings.pointReads );
+    for( int32_t i = 0; i < m_settings.pointReads; i++ ){
+        SPersistenceSetFilter filter( m_persId );
+        filter.sessionNum = sessions( generator );
+        filter.minLogicStep = filter.maxLogicStep = steps( generator );
+
+        const TClock::time_point start = TClock::now();
+        _out.pointReadPoints += m_settings.storage->readTrajectoryData( filter ).size();
+        latencies.push_back( elapsedNanosec(start) );
+    }
+
+    _out.pointRead = makeLatency( latencies );
+}
+
+void StorageBenchmark::runRangeReads( SResult & _out ){
+
+    const TLogicStep rangeSteps = std::max( 1, std::min(m_settings.rangeSteps, m_settings.stepsPerSession) );
+
+    std::mt19937 generator( m_settings.seed + 1 );
+    std::uniform_int_distribution<TSessionNum> sessions( 1, m_settings.sessionsPerSet );
+    std::uniform_int_distribution<TLogicStep> steps( 0, m_settings.stepsPerSession - rangeSteps );
+
+    std::vector<int64_t> latencies;
+    latencies.reserve( m_settings.rangeReads );
+    for( int32_t i = 0; i < m_settings.rangeReads; i++ ){
+        SPersistenceSetFilter filter( m_persId );
+        filter.sessionNum = sessions( generator );
+        filter.minLogicStep = steps( generator );
+        filter.maxLogicStep = filter.minLogicStep + rangeSteps - 1;
+
+        const TClock::time_point start = TClock::now();
+        _out.rangeReadPoints += m_settings.storage->readTrajectoryData( filter ).size();
+        latencies.push_back( elapsedNanosec(start) );
+    }
+
+    _out.rangeRead = makeLatency( latencies );
+}
+
+void StorageBenchmark::runSessionScans( SResult & _out ){
+
+    std::vector<int64_t> scanLatencies, listLatencies;
+    for( int32_t i = 0; i < m_settings.sessionScans; i++ ){
+        TClock::time_point start = TClock::now();
+        m_settings.storage->scanPayloadForSessions( m_persId );
+        scanLatencies.push_back( elapsedNanosec(start) );
+
+        start = TClock::now();
+        if( m_settings.sessionsFunc ){
+            m_settings.sessionsFunc( m_persId );
+        }
+        else{
+            m_settings.storage->selectSessionDescriptions( m_persId );
+        }
+        listLatencies.push_back( elapsedNanosec(start) );
+    }
+
+    _out.sessionScan = makeLatency( scanLatencies );
+    _out.sessionList = makeLatency( listLatencies );
+}
+
+void StorageBenchmark::runMetadataLookups( SResult & _out ){
+
+    std::vector<int64_t> latencies;
+    latencies.reserve( m_settings.metadataLookups );
+    for( int32_t i = 0; i < m_settings.metadataLookups; i++ ){
+        const TClock::time_point start = TClock::now();
+        if( i % 2 ){
+            m_settings.storage->getPersistenceSetMetadata( m_settings.ctxId );
+        }
+        else{
+            m_settings.storage->getPersistenceSetMetadata( m_persId );
+        }
+        latencies.push_back( elapsedNanosec(start) );
+    }
+
+    _out.metadataLookup = makeLatency( latencies );
+}
+
+void StorageBenchmark::runConcurrent( SResult & _out ){
+
+    if( m_settings.concurrentThreads <= 0 || m_settings.concurrentOpsPerThread <= 0 ){
+        return;
+    }
+
+    std::vector<std::vector<int64_t>> readLatencies( m_settings.concurrentThreads );
+    std::vector<std::vector<int64_t>> writeLatencies( m_settings.concurrentThreads );
+
+    // readers hit the ingested sessions, each writer appends to its own session after them
+    auto workload = [ this, & readLatencies, & writeLatencies ]( int32_t _threadIdx ){
+        std::mt19937 generator( m_settings.seed + 100 + _threadIdx );
+        std::uniform_int_distribution<int32_t> percents( 0, 99 );
+        std::uniform_int_distribution<TSessionNum> sessions( 1, m_settings.sessionsPerSet );
+        std::uniform_int_distribution<TLogicStep> steps( 0, m_settings.stepsPerSession - 1 );
+
+        const TSessionNum writeSession = m_settings.sessionsPerSet + 1 + _threadIdx;
+        TLogicStep writeStep = 0;
+
+        for( int32_t i = 0; i < m_settings.concurrentOpsPerThread; i++ ){
+            if( percents(generator) < m_settings.concurrentWritePercent ){
+                const std::vector<SPersistenceTrajectory> points = makeStep( writeSession, writeStep++ );
+                const TClock::time_point start = TClock::now();
+                m_settings.storage->writeTrajectoryData( m_persId, points );
+                writeLatencies[ _threadIdx ].push_back( elapsedNanosec(start) );
+            }
+            else{
+                SPersistenceSetFilter filter( m_persId );
+                filter.sessionNum = sessions( generator );
+                filter.minLogicStep = filter.maxLogicStep = steps( generator );
+                const TClock::time_point start = TClock::now();
+                m_settings.storage->readTrajectoryData( filter );
+                readLatencies[ _threadIdx ].push_back( elapsedNanosec(start) );
+            }
+        }
+
+        if( m_settings.threadExitFunc ){
+            m_settings.threadExitFunc();
+        }
+    };
+
+    const TClock::time_point start = TClock::now();
+    std::vector<std::thread> threads;
+    for( int32_t i = 0; i < m_settings.concurrentThreads; i++ ){
+        threads.emplace_back( workload, i );
+    }
+    for( std::thread & thread : threads ){
+        thread.join();
+    }
+    const double elapsedSec = std::chrono::duration<double>( TClock::now() - start ).count();
+
+    std::vector<int64_t> reads, writes;
+    for( int32_t i = 0; i < m_settings.concurrentThreads; i++ ){
+        reads.insert( reads.end(), readLatencies[ i ].begin(), readLatencies[ i ].end() );
+        writes.insert( writes.end(), writeLatencies[ i ].begin(), writeLatencies[ i ].end() );
+    }
+
+    const int64_t opsCount = reads.size() + writes.size();
+    _out.concurrentOpsPerSec = ( elapsedSec > 0.0 ) ? ( opsCount / elapsedSec ) : 0.0;
+    _out.concurrentRead = makeLatency( reads );
+    _out.concurrentWrite = makeLatency( writes );
+}
+
+StorageBenchmark::SLatency StorageBenchmark::makeLatency( std::vector<int64_t> & _nanosec ){
+
+    SLatency out;
+    if( _nanosec.empty() ){
+        return out;
+    }
+
+    std::sort( _nanosec.begin(), _nanosec.end() );
+
+    auto percentile = [ & _nanosec ]( int32_t _percent ){
+        const size_t idx = ( (_nanosec.size() - 1) * _percent ) / 100;
+        return _nanosec[ idx ];
+    };
+
+    int64_t totalNanosec = 0;
+    for( const int64_t value : _nanosec ){
+        totalNanosec += value;
+    }
+
+    out.count = _nanosec.size();
+    out.totalSec = totalNanosec / 1000000000.0;
+    out.minNanosec = _nanosec.front();
+    out.p50Nanosec = percentile( 50 );
+    out.p90Nanosec = percentile( 90 );
+    out.p99Nanosec = percentile( 99 );
+    out.maxNanosec = _nanosec.back();
+    return out;
+}
+
+static void writeLatency( std::ostringstream & _out, const char * _name, const StorageBenchmark::SLatency & _latency ){
+
+    _out << "\"" << _name << "\":{"
+         << "\"count\":" << _latency.count
+         << ",\"total_sec\":" << _latency.totalSec
+         << ",\"min_ns\":" << _latency.minNanosec
+         << ",\"p50_ns\":" << _latency.p50Nanosec
+         << ",\"p90_ns\":" << _latency.p90Nanosec
+         << ",\"p99_ns\":" << _latency.p99Nanosec
+         << ",\"max_ns\":" << _latency.maxNanosec
+         << "}";
+}
+
+std::string StorageBenchmark::toJson( const SInitSettings & _settings, const SResult & _result ){
+
+    std::ostringstream out;
+
+    out << "{\"backend\":\"" << _settings.backendName << "\""
+        << ",\"shape\":{"
+        << "\"objects_per_step\":" << _settings.objectsPerStep
+        << ",\"steps_per_session\":" << _settings.stepsPerSession
+        << ",\"sessions_per_set\":" << _settings.sessionsPerSet
+        << ",\"points_per_write\":" << _settings.pointsPerWrite
+        << ",\"chunked\":" << ( EPersistenceStorageLayout::CHUNK_PER_STEP == _settings.storageLayout ? "true" : "false" )
+        << "}";
+
+    out << ",\"ingest\":{"
+        << "\"points\":" << _result.ingestPoints
+        << ",\"points_per_sec\":" << (int64_t)_result.ingestPointsPerSec
+        << ",";
+    writeLatency( out, "write", _result.ingestWrite );
+    out << "}";
+
+    out << ",\"point_read\":{\"points\":" << _result.pointReadPoints << ",";
+    writeLatency( out, "latency", _result.pointRead );
+    out << "}";
+
+    out << ",\"range_read\":{\"points\":" << _result.rangeReadPoints << ",\"steps\":" << _settings.rangeSteps << ",";
+    writeLatency( out, "latency", _result.rangeRead );
+    out << "}";
+
+    out << ",";
+    writeLatency( out, "session_scan", _result.sessionScan );
+    out << ",";
+    writeLatency( out, "session_list", _result.sessionList );
+    out << ",";
+    writeLatency( out, "metadata_lookup", _result.metadataLookup );
+
+    out << ",\"concurrent\":{"
+        << "\"threads\":" << _settings.concurrentThreads
+        << ",\"write_percent\":" << _settings.concurrentWritePercent
+        << ",\"ops_per_sec\":" << (int64_t)_result.concurrentOpsPerSec
+        << ",";
+    writeLatency( out, "read", _result.concurrentRead );
+    out << ",";
+    writeLatency( out, "write", _result.concurrentWrite );
+    out << "}}";
+
+    return out.str();
+}
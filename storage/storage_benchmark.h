@@ -0,0 +1,137 @@
+#ifndef STORAGE_BENCHMARK_H
+#define STORAGE_BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "common/ms_common_types.h"
+#include "i_persistence_storage.h"
+
+// throughput & latency of one storage on a synthetic persistence set:
+// bulk ingest, point / range reads, session scans, metadata lookups, concurrent mixed workload.
+// Context of the benchmark is wiped before and after the run
+class StorageBenchmark
+{
+public:
+    using TSessionsFunc = std::function<std::vector<common_types::SEventsSessionInfo>( common_types::TPersistenceSetId _persId )>;
+
+    struct SInitSettings {
+        SInitSettings()
+            : storage(nullptr)
+            , ctxId(0)
+            , missionId(0)
+            , storageLayout(common_types::EPersistenceStorageLayout::DOCUMENT_PER_POINT)
+            , objectsPerStep(100)
+            , stepsPerSession(1000)
+            , sessionsPerSet(3)
+            , pointsPerWrite(10000)
+            , pointReads(1000)
+            , rangeReads(200)
+            , rangeSteps(100)
+            , sessionScans(20)
+            , metadataLookups(1000)
+            , concurrentThreads(4)
+            , concurrentOpsPerThread(500)
+            , concurrentWritePercent(20)
+            , seed(1)
+        {}
+        IPersistenceStorage * storage;
+        std::string backendName; // goes to report as is
+        common_types::TContextId ctxId; // must be used only by benchmark
+        common_types::TMissionId missionId;
+        common_types::EPersistenceStorageLayout storageLayout;
+
+        // data shape
+        int32_t objectsPerStep;
+        int32_t stepsPerSession;
+        int32_t sessionsPerSet;
+        int32_t pointsPerWrite;
+
+        // operations count of each phase ( 0 - phase is skipped )
+        int32_t pointReads;
+        int32_t rangeReads;
+        int32_t rangeSteps;
+        int32_t sessionScans;
+        int32_t metadataLookups;
+        int32_t concurrentThreads; // > 1 only for storage with thread-safe calls
+        int32_t concurrentOpsPerThread;
+        int32_t concurrentWritePercent;
+        uint32_t seed;
+
+        TSessionsFunc sessionsFunc; // session list of storage, selectSessionDescriptions() if not set
+        std::function<void( common_types::TPersistenceSetId _persId )> setCreatedFunc; // storage specific options of benchmark set ( e.g. write policy )
+        std::function<void()> threadExitFunc; // per-thread resources of storage ( called in each workload thread )
+        std::string reportPath; // JSON report is written here if set
+    };
+
+    // nanoseconds
+    struct SLatency {
+        SLatency()
+            : count(0)
+            , totalSec(0.0)
+            , minNanosec(0)
+            , p50Nanosec(0)
+            , p90Nanosec(0)
+            , p99Nanosec(0)
+            , maxNanosec(0)
+        {}
+        int64_t count;
+        double totalSec;
+        int64_t minNanosec;
+        int64_t p50Nanosec;
+        int64_t p90Nanosec;
+        int64_t p99Nanosec;
+        int64_t maxNanosec;
+    };
+
+    struct SResult {
+        SResult()
+            : ingestPoints(0)
+            , ingestPointsPerSec(0.0)
+            , pointReadPoints(0)
+            , rangeReadPoints(0)
+            , concurrentOpsPerSec(0.0)
+        {}
+        int64_t ingestPoints;
+        double ingestPointsPerSec;
+        SLatency ingestWrite;
+        SLatency pointRead;
+        int64_t pointReadPoints;
+        SLatency rangeRead;
+        int64_t rangeReadPoints;
+        SLatency sessionScan;
+        SLatency sessionList;
+        SLatency metadataLookup;
+        SLatency concurrentRead;
+        SLatency concurrentWrite;
+        double concurrentOpsPerSec;
+    };
+
+    StorageBenchmark();
+    ~StorageBenchmark();
+
+    bool run( const SInitSettings & _settings, SResult & _out );
+
+    static std::string toJson( const SInitSettings & _settings, const SResult & _result );
+
+
+private:
+    static SLatency makeLatency( std::vector<int64_t> & _nanosec );
+
+    bool createSet();
+    void clearContext();
+    std::vector<common_types::SPersistenceTrajectory> makeStep( common_types::TSessionNum _sessionNum, common_types::TLogicStep _step );
+    bool runIngest( SResult & _out );
+    void runPointReads( SResult & _out );
+    void runRangeReads( SResult & _out );
+    void runSessionScans( SResult & _out );
+    void runMetadataLookups( SResult & _out );
+    void runConcurrent( SResult & _out );
+
+    // data
+    SInitSettings m_settings;
+    common_types::TPersistenceSetId m_persId;
+};
+
+#endif // STORAGE_BENCHMARK_H
@@ -0,0 +1,517 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include "system/logger.h"
+#include "trajectory_cache.h"
+#include "trajectory_point_predicate.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "TrajectoryCache:";
+
+// objId + logicTime + lat + lon + height + yaw + astroTime + state
+static constexpr int64_t ROW_BYTES = sizeof(TObjectId)
+                                    + sizeof(TLogicStep)
+                                    + sizeof(double) * 4
+                                    + sizeof(int64_t)
+                                    + sizeof(SPersistenceObj::EState);
+
+// geohash of 24 bits ( ~2.4 km cell on equator )
+static constexpr int GEOHASH_BITS_PER_AXIS = 12;
+static constexpr int64_t GEOHASH_CELLS_PER_AXIS = 1 << GEOHASH_BITS_PER_AXIS;
+// larger bounding box is cheaper to scan
+static constexpr int64_t MAX_GEOHASH_CELLS_PER_READ = 4096;
+
+static int64_t getGeohashCell( double _deg, double _minDeg, double _maxDeg ){
+
+    // NaN & out of range coords are clamped to the edge cells
+    if( ! (_deg > _minDeg) ){
+        return 0;
+    }
+    if( ! (_deg < _maxDeg) ){
+        return GEOHASH_CELLS_PER_AXIS - 1;
+    }
+
+    const int64_t cell = (int64_t)std::floor( (_deg - _minDeg) / (_maxDeg - _minDeg) * GEOHASH_CELLS_PER_AXIS );
+    return std::min( cell, GEOHASH_CELLS_PER_AXIS - 1 );
+}
+
+static uint32_t getGeohash( int64_t _latCell, int64_t _lonCell ){
+
+    // bits interleaving as in geohash: longitude goes first
+    uint32_t out = 0;
+    for( int bit = GEOHASH_BITS_PER_AXIS - 1; bit >= 0; bit-- ){
+        out = (out << 1) | ((_lonCell >> bit) & 1);
+        out = (out << 1) | ((_latCell >> bit) & 1);
+    }
+    return out;
+}
+
+static uint32_t getGeohash( double _latDeg, double _lonDeg ){
+    return getGeohash( getGeohashCell(_latDeg, -90.0, 90.0), getGeohashCell(_lonDeg, -180.0, 180.0) );
+}
+
+// -------------------------------------------------------------------------------------
+// session columns
+// -------------------------------------------------------------------------------------
+int64_t TrajectoryCache::SSessionColumns::memoryBytes() const {
+    return rowsCount() * ROW_BYTES;
+}
+
+void TrajectoryCache::SSessionColumns::insertRow( const SPersistenceTrajectory & _traj ){
+
+    dropIndexes();
+
+    // common case - recorder writes steps in ascending order
+    if( logicTime.empty() || logicTime.back() <= _traj.logicTime ){
+        objId.push_back( _traj.objId );
+        logicTime.push_back( _traj.logicTime );
+        lat.push_back( _traj.latDeg );
+        lon.push_back( _traj.lonDeg );
+        height.push_back( _traj.height );
+        yaw.push_back( _traj.yawDeg );
+        astroTime.push_back( _traj.astroTimeMillisec );
+        state.push_back( _traj.state );
+        return;
+    }
+
+    // late step - keep columns sorted
+    const size_t pos = std::upper_bound( logicTime.begin(), logicTime.end(), _traj.logicTime ) - logicTime.begin();
+    objId.insert( objId.begin() + pos, _traj.objId );
+    logicTime.insert( logicTime.begin() + pos, _traj.logicTime );
+    lat.insert( lat.begin() + pos, _traj.latDeg );
+    lon.insert( lon.begin() + pos, _traj.lonDeg );
+    height.insert( height.begin() + pos, _traj.height );
+    yaw.insert( yaw.begin() + pos, _traj.yawDeg );
+    astroTime.insert( astroTime.begin() + pos, _traj.astroTimeMillisec );
+    state.insert( state.begin() + pos, _traj.state );
+}
+
+void TrajectoryCache::SSessionColumns::clear(){
+
+    dropIndexes();
+
+    objId.clear();
+    logicTime.clear();
+    lat.clear();
+    lon.clear();
+    height.clear();
+    yaw.clear();
+    astroTime.clear();
+    state.clear();
+}
+
+void TrajectoryCache::SSessionColumns::copyRow( size_t _idx, TSessionNum _sessionNum, SPersistenceTrajectory & _out ) const {
+
+    _out.objId = objId[ _idx ];
+    _out.logicTime = logicTime[ _idx ];
+    _out.latDeg = lat[ _idx ];
+    _out.lonDeg = lon[ _idx ];
+    _out.height = height[ _idx ];
+    _out.yawDeg = yaw[ _idx ];
+    _out.astroTimeMillisec = astroTime[ _idx ];
+    _out.state = state[ _idx ];
+    _out.sessionNum = _sessionNum;
+}
+
+void TrajectoryCache::SSessionColumns::buildIndexes(){
+
+    if( indexesBuilt ){
+        return;
+    }
+
+    for( size_t idx = 0; idx < rowsCount(); idx++ ){
+        rowsByObject[ objId[ idx ] ].push_back( idx );
+        rowsByGeohash[ getGeohash(lat[ idx ], lon[ idx ]) ].push_back( idx );
+    }
+    indexesBuilt = true;
+}
+
+void TrajectoryCache::SSessionColumns::dropIndexes(){
+
+    if( ! indexesBuilt ){
+        return;
+    }
+
+    rowsByObject.clear();
+    rowsByGeohash.clear();
+    indexesBuilt = false;
+}
+
+// -------------------------------------------------------------------------------------
+// cache
+// -------------------------------------------------------------------------------------
+TrajectoryCache::TrajectoryCache()
+    : m_memoryBytes(0)
+    , m_generationCounter(0)
+{
+
+}
+
+TrajectoryCache::~TrajectoryCache()
+{
+
+}
+
+bool TrajectoryCache::init( const SInitSettings & _settings ){
+
+    if( _settings.maxMemoryBytes <= 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid memory budget: " << _settings.maxMemoryBytes << endl;
+        return false;
+    }
+
+    m_settings = _settings;
+
+    VS_LOG_INFO << PRINT_HEADER << " init success, memory budget [" << m_settings.maxMemoryBytes << "] bytes" << endl;
+    return true;
+}
+
+TrajectoryCache::SCacheStats TrajectoryCache::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    SCacheStats out = m_stats;
+    out.memoryBytes = m_memoryBytes;
+    out.sessionsCount = m_lru.size();
+    return out;
+}
+
+void TrajectoryCache::markSetAuthoritative( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    // NOTE: set is just created by this instance -> payload table is empty, every written session will be complete
+    m_sets[ _persId ].authoritative = true;
+}
+
+TrajectoryCache::SSessionColumns & TrajectoryCache::getSessionColumns( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    SPersistenceSetColumns & set = m_sets[ _persId ];
+
+    auto iter = set.sessions.find( _sessionNum );
+    if( iter != set.sessions.end() ){
+        return iter->second;
+    }
+
+    SSessionColumns & columns = set.sessions[ _sessionNum ];
+    columns.complete = set.authoritative;
+    columns.writeGeneration = ++m_generationCounter;
+    m_lru.push_front( {_persId, _sessionNum} );
+    columns.lruIter = m_lru.begin();
+    return columns;
+}
+
+void TrajectoryCache::append( TPersistenceSetId _persId, const std::vector<SPersistenceTrajectory> & _data ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    SSessionColumns * columns = nullptr;
+    TSessionNum currentSession = common_vars::INVALID_SESSION_NUM;
+
+    for( const SPersistenceTrajectory & traj : _data ){
+
+        if( ! columns || traj.sessionNum != currentSession ){
+            currentSession = traj.sessionNum;
+            columns = & getSessionColumns( _persId, currentSession );
+            touch( * columns );
+        }
+
+        // any in-flight load of this session becomes stale
+        columns->writeGeneration = ++m_generationCounter;
+
+        if( columns->complete ){
+            columns->insertRow( traj );
+            m_memoryBytes += ROW_BYTES;
+        }
+    }
+
+    evictIfNeeded();
+}
+
+uint64_t TrajectoryCache::beginSessionLoad( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    SSessionColumns & columns = getSessionColumns( _persId, _sessionNum );
+    return columns.writeGeneration;
+}
+
+bool TrajectoryCache::loadSession( TPersistenceSetId _persId,
+                                   TSessionNum _sessionNum,
+                                   uint64_t _loadTicket,
+                                   const std::vector<SPersistenceTrajectory> & _data ){
+
+    if( (int64_t)_data.size() * ROW_BYTES > m_settings.maxMemoryBytes ){
+        VS_LOG_WARN << PRINT_HEADER << " session [" << _sessionNum << "] of pers id [" << _persId << "]"
+                    << " exceeds memory budget, not cached"
+                    << endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    auto iterSet = m_sets.find( _persId );
+    if( iterSet == m_sets.end() ){
+        return false;
+    }
+
+    auto iterSession = iterSet->second.sessions.find( _sessionNum );
+    if( iterSession == iterSet->second.sessions.end() ){
+        return false;
+    }
+
+    // session was written ( or evicted & recreated ) while loading
+    SSessionColumns & columns = iterSession->second;
+    if( columns.writeGeneration != _loadTicket ){
+        return false;
+    }
+
+    if( columns.complete ){
+        return true;
+    }
+
+    std::vector<const SPersistenceTrajectory *> sorted;
+    sorted.reserve( _data.size() );
+    for( const SPersistenceTrajectory & traj : _data ){
+        sorted.push_back( & traj );
+    }
+    std::stable_sort( sorted.begin(), sorted.end(), []( const SPersistenceTrajectory * _lhs, const SPersistenceTrajectory * _rhs ){
+        return _lhs->logicTime < _rhs->logicTime;
+    });
+
+    m_memoryBytes -= columns.memoryBytes();
+    columns.clear();
+    for( const SPersistenceTrajectory * traj : sorted ){
+        columns.insertRow( * traj );
+    }
+    columns.complete = true;
+    m_memoryBytes += columns.memoryBytes();
+
+    touch( columns );
+    evictIfNeeded();
+    return true;
+}
+
+bool TrajectoryCache::isSessionCached( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    auto iterSet = m_sets.find( _persId );
+    if( iterSet == m_sets.end() ){
+        return false;
+    }
+
+    auto iterSession = iterSet->second.sessions.find( _sessionNum );
+    return ( iterSession != iterSet->second.sessions.end() && iterSession->second.complete );
+}
+
+bool TrajectoryCache::read( const SPersistenceSetFilter & _filter, std::vector<SPersistenceTrajectory> & _out ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    auto iterSet = m_sets.find( _filter.persistenceSetId );
+    if( iterSet == m_sets.end() ){
+        m_stats.misses++;
+        return false;
+    }
+    SPersistenceSetColumns & set = iterSet->second;
+
+    // steps range ( or only one step ) of the session
+    if( _filter.minLogicStep >= 0 && _filter.maxLogicStep >= 0 ){
+
+        auto iterSession = set.sessions.find( _filter.sessionNum );
+        if( iterSession == set.sessions.end() || ! iterSession->second.complete ){
+            m_stats.misses++;
+            return false;
+        }
+
+        touch( iterSession->second );
+        readSessionRange( iterSession->second, _filter.sessionNum, _filter.minLogicStep, _filter.maxLogicStep, _filter, _out );
+    }
+    // whole area - only if nothing was lost since set creation
+    else{
+        if( ! set.authoritative ){
+            m_stats.misses++;
+            return false;
+        }
+
+        std::vector<TSessionNum> sessionNumbers;
+        sessionNumbers.reserve( set.sessions.size() );
+        for( const auto & valuePair : set.sessions ){
+            sessionNumbers.push_back( valuePair.first );
+        }
+        std::sort( sessionNumbers.begin(), sessionNumbers.end() );
+
+        for( const TSessionNum sessionNum : sessionNumbers ){
+            SSessionColumns & columns = set.sessions[ sessionNum ];
+            touch( columns );
+            readSessionRange( columns, sessionNum, 0, std::numeric_limits<TLogicStep>::max(), _filter, _out );
+        }
+    }
+
+    m_stats.hits++;
+    return true;
+}
+
+void TrajectoryCache::readSessionRange( SSessionColumns & _columns,
+                                        TSessionNum _sessionNum,
+                                        TLogicStep _minLogicStep,
+                                        TLogicStep _maxLogicStep,
+                                        const SPersistenceSetFilter & _filter,
+                                        std::vector<SPersistenceTrajectory> & _out ){
+
+    const auto iterFrom = std::lower_bound( _columns.logicTime.begin(), _columns.logicTime.end(), _minLogicStep );
+    const auto iterTo = std::upper_bound( iterFrom, _columns.logicTime.end(), _maxLogicStep );
+
+    const size_t idxFrom = iterFrom - _columns.logicTime.begin();
+    const size_t idxTo = iterTo - _columns.logicTime.begin();
+
+    if( ! _filter.hasPointPredicates() ){
+        const size_t outIdx = _out.size();
+        _out.resize( _out.size() + (idxTo - idxFrom) );
+
+        for( size_t idx = idxFrom; idx < idxTo; idx++ ){
+            _columns.copyRow( idx, _sessionNum, _out[ outIdx + (idx - idxFrom) ] );
+        }
+        return;
+    }
+
+    std::vector<uint32_t> rows;
+    selectIndexedRows( _columns, idxFrom, idxTo, _filter, rows );
+
+    const TrajectoryPointPredicate predicate( _filter );
+    for( const uint32_t idx : rows ){
+        if( predicate.accepts(_columns.objId[ idx ], _columns.lat[ idx ], _columns.lon[ idx ]) ){
+            _out.resize( _out.size() + 1 );
+            _columns.copyRow( idx, _sessionNum, _out.back() );
+        }
+    }
+}
+
+void TrajectoryCache::selectIndexedRows( SSessionColumns & _columns,
+                                         size_t _idxFrom,
+                                         size_t _idxTo,
+                                         const SPersistenceSetFilter & _filter,
+                                         std::vector<uint32_t> & _rows ){
+
+    // candidate rows from objects index, or from geohash cells covering the bounding box
+    std::vector<const std::vector<uint32_t> *> lists;
+    bool indexed = false;
+
+    if( ! _filter.objIds.empty() ){
+        _columns.buildIndexes();
+        for( const TObjectId objId : _filter.objIds ){
+            auto iter = _columns.rowsByObject.find( objId );
+            if( iter != _columns.rowsByObject.end() ){
+                lists.push_back( & iter->second );
+            }
+        }
+        indexed = true;
+    }
+    else{
+        const SGeoBoundingBox & box = _filter.boundingBox;
+        const int64_t latCellFrom = getGeohashCell( box.minLatDeg, -90.0, 90.0 );
+        const int64_t latCellTo = getGeohashCell( box.maxLatDeg, -90.0, 90.0 );
+        const int64_t lonCellFrom = getGeohashCell( box.minLonDeg, -180.0, 180.0 );
+        const int64_t lonCellTo = getGeohashCell( box.maxLonDeg, -180.0, 180.0 );
+
+        if( (latCellTo - latCellFrom + 1) * (lonCellTo - lonCellFrom + 1) <= MAX_GEOHASH_CELLS_PER_READ ){
+            _columns.buildIndexes();
+            for( int64_t latCell = latCellFrom; latCell <= latCellTo; latCell++ ){
+                for( int64_t lonCell = lonCellFrom; lonCell <= lonCellTo; lonCell++ ){
+                    auto iter = _columns.rowsByGeohash.find( getGeohash(latCell, lonCell) );
+                    if( iter != _columns.rowsByGeohash.end() ){
+                        lists.push_back( & iter->second );
+                    }
+                }
+            }
+            indexed = true;
+        }
+    }
+
+    size_t candidatesCount = 0;
+    for( const std::vector<uint32_t> * list : lists ){
+        candidatesCount += list->size();
+    }
+
+    // steps range is narrower than the index selection
+    if( ! indexed || candidatesCount >= (_idxTo - _idxFrom) ){
+        _rows.resize( _idxTo - _idxFrom );
+        for( size_t idx = _idxFrom; idx < _idxTo; idx++ ){
+            _rows[ idx - _idxFrom ] = idx;
+        }
+        return;
+    }
+
+    _rows.reserve( candidatesCount );
+    for( const std::vector<uint32_t> * list : lists ){
+        const auto iterFrom = std::lower_bound( list->begin(), list->end(), (uint32_t)_idxFrom );
+        const auto iterTo = std::lower_bound( iterFrom, list->end(), (uint32_t)_idxTo );
+        _rows.insert( _rows.end(), iterFrom, iterTo );
+    }
+
+    // same order as without predicates ( by logic time )
+    std::sort( _rows.begin(), _rows.end() );
+    _rows.erase( std::unique(_rows.begin(), _rows.end()), _rows.end() );
+}
+
+void TrajectoryCache::invalidate( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    auto iterSet = m_sets.find( _persId );
+    if( iterSet == m_sets.end() ){
+        return;
+    }
+
+    for( auto & valuePair : iterSet->second.sessions ){
+        m_memoryBytes -= valuePair.second.memoryBytes();
+        m_lru.erase( valuePair.second.lruIter );
+    }
+
+    m_sets.erase( iterSet );
+}
+
+void TrajectoryCache::invalidate( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    std::lock_guard<std::mutex> lock( m_mutexCache );
+
+    dropSession( _persId, _sessionNum );
+}
+
+void TrajectoryCache::touch( SSessionColumns & _columns ){
+
+    m_lru.splice( m_lru.begin(), m_lru, _columns.lruIter );
+}
+
+void TrajectoryCache::dropSession( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    auto iterSet = m_sets.find( _persId );
+    if( iterSet == m_sets.end() ){
+        return;
+    }
+
+    auto iterSession = iterSet->second.sessions.find( _sessionNum );
+    if( iterSession == iterSet->second.sessions.end() ){
+        return;
+    }
+
+    m_memoryBytes -= iterSession->second.memoryBytes();
+    m_lru.erase( iterSession->second.lruIter );
+    iterSet->second.sessions.erase( iterSession );
+
+    // whole set is not in memory anymore
+    iterSet->second.authoritative = false;
+}
+
+void TrajectoryCache::evictIfNeeded(){
+
+    // NOTE: most recent session is never evicted, it has been just written/read
+    while( m_memoryBytes > m_settings.maxMemoryBytes && m_lru.size() > 1 ){
+        const TLruKey key = m_lru.back();
+        dropSession( key.first, key.second );
+        m_stats.evictions++;
+    }
+}
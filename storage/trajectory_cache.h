@@ -0,0 +1,135 @@
+#ifndef TRAJECTORY_CACHE_H
+#define TRAJECTORY_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "common/ms_common_types.h"
+#include "common/ms_common_vars.h"
+
+// in-memory columnar copy of trajectory payload, sliced by ( persistence set, session )
+class TrajectoryCache
+{
+public:
+    struct SInitSettings {
+        SInitSettings()
+            : maxMemoryBytes( 256 * 1024 * 1024 )
+        {}
+        int64_t maxMemoryBytes;
+    };
+
+    struct SCacheStats {
+        SCacheStats()
+            : memoryBytes(0)
+            , sessionsCount(0)
+            , hits(0)
+            , misses(0)
+            , evictions(0)
+        {}
+        int64_t memoryBytes;
+        int64_t sessionsCount;
+        int64_t hits;
+        int64_t misses;
+        int64_t evictions;
+    };
+
+    TrajectoryCache();
+    ~TrajectoryCache();
+
+    bool init( const SInitSettings & _settings );
+    SCacheStats getStats();
+
+    // fill
+    void markSetAuthoritative( common_types::TPersistenceSetId _persId );
+    void append( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data );
+    uint64_t beginSessionLoad( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+    bool loadSession( common_types::TPersistenceSetId _persId,
+                      common_types::TSessionNum _sessionNum,
+                      uint64_t _loadTicket,
+                      const std::vector<common_types::SPersistenceTrajectory> & _data );
+
+    // read
+    bool isSessionCached( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+    bool read( const common_types::SPersistenceSetFilter & _filter, std::vector<common_types::SPersistenceTrajectory> & _out );
+
+    // invalidate
+    void invalidate( common_types::TPersistenceSetId _persId );
+    void invalidate( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+
+
+private:
+    using TLruKey = std::pair<common_types::TPersistenceSetId, common_types::TSessionNum>;
+
+    // columns are kept sorted by logic time ( insertion order inside one step )
+    struct SSessionColumns {
+        SSessionColumns()
+            : complete(false)
+            , writeGeneration(0)
+            , indexesBuilt(false)
+        {}
+
+        size_t rowsCount() const { return logicTime.size(); }
+        int64_t memoryBytes() const;
+        void insertRow( const common_types::SPersistenceTrajectory & _traj );
+        void clear();
+        void copyRow( size_t _idx, common_types::TSessionNum _sessionNum, common_types::SPersistenceTrajectory & _out ) const;
+        void buildIndexes();
+        void dropIndexes();
+
+        std::vector<common_types::TObjectId> objId;
+        std::vector<common_types::TLogicStep> logicTime;
+        std::vector<double> lat;
+        std::vector<double> lon;
+        std::vector<double> height;
+        std::vector<double> yaw;
+        std::vector<int64_t> astroTime;
+        std::vector<common_types::SPersistenceObj::EState> state;
+
+        bool complete;
+        uint64_t writeGeneration;
+        std::list<TLruKey>::iterator lruIter;
+
+        // built on first predicate read, dropped on any rows change ( not counted in memory budget )
+        bool indexesBuilt;
+        std::unordered_map<common_types::TObjectId, std::vector<uint32_t>> rowsByObject;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> rowsByGeohash;
+    };
+
+    struct SPersistenceSetColumns {
+        SPersistenceSetColumns()
+            : authoritative(false)
+        {}
+        bool authoritative;
+        std::unordered_map<common_types::TSessionNum, SSessionColumns> sessions;
+    };
+
+    SSessionColumns & getSessionColumns( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+    void readSessionRange( SSessionColumns & _columns,
+                           common_types::TSessionNum _sessionNum,
+                           common_types::TLogicStep _minLogicStep,
+                           common_types::TLogicStep _maxLogicStep,
+                           const common_types::SPersistenceSetFilter & _filter,
+                           std::vector<common_types::SPersistenceTrajectory> & _out );
+    void selectIndexedRows( SSessionColumns & _columns,
+                            size_t _idxFrom,
+                            size_t _idxTo,
+                            const common_types::SPersistenceSetFilter & _filter,
+                            std::vector<uint32_t> & _rows );
+    void touch( SSessionColumns & _columns );
+    void dropSession( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+    void evictIfNeeded();
+
+    // data
+    SInitSettings m_settings;
+    std::unordered_map<common_types::TPersistenceSetId, SPersistenceSetColumns> m_sets;
+    std::list<TLruKey> m_lru;
+    int64_t m_memoryBytes;
+    uint64_t m_generationCounter;
+    SCacheStats m_stats;
+
+    // service
+    std::mutex m_mutexCache;
+};
+
+#endif // TRAJECTORY_CACHE_H
@@ -0,0 +1,173 @@
+
+#include <cstring>
+
+#include "trajectory_chunk_codec.h"
+
+using namespace std;
+using namespace common_types;
+
+static inline uint64_t zigzag( int64_t _value ){
+    return ( (uint64_t)_value << 1 ) ^ (uint64_t)( _value >> 63 );
+}
+
+static inline int64_t unzigzag( uint64_t _value ){
+    return (int64_t)( _value >> 1 ) ^ -(int64_t)( _value & 1 );
+}
+
+static inline uint64_t doubleBits( double _value ){
+    uint64_t bits;
+    std::memcpy( & bits, & _value, sizeof(bits) );
+    return bits;
+}
+
+static inline double bitsDouble( uint64_t _bits ){
+    double value;
+    std::memcpy( & value, & _bits, sizeof(value) );
+    return value;
+}
+
+void TrajectoryChunkCodec::writeVarint( uint64_t _value, std::string & _out ){
+
+    while( _value >= 0x80 ){
+        _out.push_back( (char)((_value & 0x7F) | 0x80) );
+        _value >>= 7;
+    }
+    _out.push_back( (char)_value );
+}
+
+bool TrajectoryChunkCodec::readVarint( const uint8_t * & _pos, const uint8_t * _end, uint64_t & _value ){
+
+    _value = 0;
+    for( int shift = 0; shift < 64; shift += 7 ){
+        if( _pos == _end ){
+            return false;
+        }
+
+        const uint8_t byte = * _pos++;
+        _value |= (uint64_t)( byte & 0x7F ) << shift;
+        if( ! (byte & 0x80) ){
+            return true;
+        }
+    }
+    return false;
+}
+
+void TrajectoryChunkCodec::encode( const std::vector<const SPersistenceTrajectory *> & _points, std::string & _out ){
+
+    _out.clear();
+    _out.reserve( 2 + _points.size() * 16 );
+
+    _out.push_back( (char)FORMAT_VERSION );
+    writeVarint( _points.size(), _out );
+
+    // integer columns
+    int64_t prev = 0;
+    for( const SPersistenceTrajectory * point : _points ){
+        writeVarint( zigzag(point->objId - prev), _out );
+        prev = point->objId;
+    }
+
+    for( const SPersistenceTrajectory * point : _points ){
+        writeVarint( (uint32_t)point->state, _out );
+    }
+
+    prev = 0;
+    for( const SPersistenceTrajectory * point : _points ){
+        writeVarint( zigzag(point->astroTimeMillisec - prev), _out );
+        prev = point->astroTimeMillisec;
+    }
+
+    // double columns ( neighbour values share sign, exponent & high mantissa bits )
+    const double SPersistenceTrajectory::* doubleColumns[] = {
+        & SPersistenceTrajectory::latDeg,
+        & SPersistenceTrajectory::lonDeg,
+        & SPersistenceTrajectory::height,
+        & SPersistenceTrajectory::yawDeg
+    };
+
+    for( const double SPersistenceTrajectory::* column : doubleColumns ){
+        uint64_t prevBits = 0;
+        for( const SPersistenceTrajectory * point : _points ){
+            const uint64_t bits = doubleBits( point->*column );
+            writeVarint( bits ^ prevBits, _out );
+            prevBits = bits;
+        }
+    }
+}
+
+bool TrajectoryChunkCodec::decode( const uint8_t * _data,
+                                   size_t _size,
+                                   TSessionNum _sessionNum,
+                                   TLogicStep _logicStep,
+                                   std::vector<SPersistenceTrajectory> & _out ){
+
+    const uint8_t * pos = _data;
+    const uint8_t * end = _data + _size;
+
+    if( pos == end || * pos++ != FORMAT_VERSION ){
+        return false;
+    }
+
+    uint64_t count = 0;
+    if( ! readVarint(pos, end, count) || count > _size ){
+        return false;
+    }
+
+    const size_t first = _out.size();
+    _out.resize( first + count );
+
+    for( size_t i = first; i < _out.size(); i++ ){
+        _out[ i ].sessionNum = _sessionNum;
+        _out[ i ].logicTime = _logicStep;
+    }
+
+    uint64_t value = 0;
+    int64_t prev = 0;
+    for( size_t i = first; i < _out.size(); i++ ){
+        if( ! readVarint(pos, end, value) ){
+            _out.resize( first );
+            return false;
+        }
+        prev += unzigzag( value );
+        _out[ i ].objId = prev;
+    }
+
+    for( size_t i = first; i < _out.size(); i++ ){
+        if( ! readVarint(pos, end, value) ){
+            _out.resize( first );
+            return false;
+        }
+        _out[ i ].state = (SPersistenceObj::EState)value;
+    }
+
+    prev = 0;
+    for( size_t i = first; i < _out.size(); i++ ){
+        if( ! readVarint(pos, end, value) ){
+            _out.resize( first );
+            return false;
+        }
+        prev += unzigzag( value );
+        _out[ i ].astroTimeMillisec = prev;
+    }
+
+    double SPersistenceTrajectory::* doubleColumns[] = {
+        & SPersistenceTrajectory::latDeg,
+        & SPersistenceTrajectory::lonDeg,
+        & SPersistenceTrajectory::height,
+        & SPersistenceTrajectory::yawDeg
+    };
+
+    for( double SPersistenceTrajectory::* column : doubleColumns ){
+        uint64_t prevBits = 0;
+        for( size_t i = first; i < _out.size(); i++ ){
+            if( ! readVarint(pos, end, value) ){
+                _out.resize( first );
+                return false;
+            }
+            prevBits ^= value;
+            _out[ i ].*column = bitsDouble( prevBits );
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef TRAJECTORY_CHUNK_CODEC_H
+#define TRAJECTORY_CHUNK_CODEC_H
+
+#include <string>
+#include <vector>
+
+#include "common/ms_common_types.h"
+
+// binary columns for all points of one logic step:
+// objId & astro time - zigzag delta varint, state - varint, doubles - xor with previous + varint
+class TrajectoryChunkCodec
+{
+public:
+    static constexpr uint8_t FORMAT_VERSION = 1;
+
+    static void encode( const std::vector<const common_types::SPersistenceTrajectory *> & _points, std::string & _out );
+    static bool decode( const uint8_t * _data,
+                        size_t _size,
+                        common_types::TSessionNum _sessionNum,
+                        common_types::TLogicStep _logicStep,
+                        std::vector<common_types::SPersistenceTrajectory> & _out );
+
+
+private:
+    static void writeVarint( uint64_t _value, std::string & _out );
+    static bool readVarint( const uint8_t * & _pos, const uint8_t * _end, uint64_t & _value );
+};
+
+#endif // TRAJECTORY_CHUNK_CODEC_H
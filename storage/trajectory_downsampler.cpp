@@ -0,0 +1,90 @@
+#include "trajectory_downsampler.h"
+
+using namespace std;
+using namespace common_types;
+
+TrajectoryDownsampler::TrajectoryDownsampler( const SPersistenceSetFilter & _filter )
+    : m_filter(_filter)
+{
+
+}
+
+TrajectoryDownsampler::~TrajectoryDownsampler()
+{
+
+}
+
+int64_t TrajectoryDownsampler::getBucket( const SPersistenceSetFilter & _filter, const SPersistenceTrajectory & _point ){
+
+    // NOTE: 'v - v % n' as in store aggregation ( $mod keeps sign of dividend, same as C++ )
+    if( _filter.bucketLogicSteps > 0 ){
+        return _point.logicTime - _point.logicTime % _filter.bucketLogicSteps;
+    }
+    return _point.astroTimeMillisec - _point.astroTimeMillisec % _filter.bucketMillisec;
+}
+
+void TrajectoryDownsampler::add( const SPersistenceTrajectory * _points, size_t _count ){
+
+    for( size_t i = 0; i < _count; i++ ){
+        const SPersistenceTrajectory & point = _points[ i ];
+        const TBucketKey key( point.sessionNum, getBucket(m_filter, point), point.objId );
+
+        auto iter = m_buckets.find( key );
+        if( iter == m_buckets.end() ){
+            SBucket & bucket = m_buckets[ key ];
+            bucket.point = point;
+            bucket.latSum = point.latDeg;
+            bucket.lonSum = point.lonDeg;
+            bucket.heightSum = point.height;
+            bucket.yawSum = point.yawDeg;
+            bucket.count = 1;
+            continue;
+        }
+
+        SBucket & bucket = iter->second;
+        bucket.latSum += point.latDeg;
+        bucket.lonSum += point.lonDeg;
+        bucket.heightSum += point.height;
+        bucket.yawSum += point.yawDeg;
+        bucket.count++;
+
+        switch( m_filter.downsampleMode ){
+        case EDownsampleMode::LAST : {
+            if( point.logicTime >= bucket.point.logicTime ){
+                bucket.point = point;
+            }
+            break;
+        }
+        default : {
+            if( point.logicTime < bucket.point.logicTime ){
+                bucket.point = point;
+            }
+        }
+        }
+    }
+}
+
+void TrajectoryDownsampler::add( const std::vector<SPersistenceTrajectory> & _points ){
+    add( _points.data(), _points.size() );
+}
+
+std::vector<SPersistenceTrajectory> TrajectoryDownsampler::getResult() const {
+
+    std::vector<SPersistenceTrajectory> out;
+    out.reserve( m_buckets.size() );
+
+    for( const auto & valuePair : m_buckets ){
+        const SBucket & bucket = valuePair.second;
+        out.push_back( bucket.point );
+
+        if( EDownsampleMode::AVG == m_filter.downsampleMode ){
+            SPersistenceTrajectory & point = out.back();
+            point.latDeg = bucket.latSum / bucket.count;
+            point.lonDeg = bucket.lonSum / bucket.count;
+            point.height = bucket.heightSum / bucket.count;
+            point.yawDeg = bucket.yawSum / bucket.count;
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,42 @@
+#ifndef TRAJECTORY_DOWNSAMPLER_H
+#define TRAJECTORY_DOWNSAMPLER_H
+
+#include <map>
+#include <tuple>
+
+#include "common/ms_common_types.h"
+
+// in-memory reduction of points to one per ( session, bucket, object ), same rules as store aggregation
+class TrajectoryDownsampler
+{
+public:
+    TrajectoryDownsampler( const common_types::SPersistenceSetFilter & _filter );
+    ~TrajectoryDownsampler();
+
+    static int64_t getBucket( const common_types::SPersistenceSetFilter & _filter, const common_types::SPersistenceTrajectory & _point );
+
+    void add( const common_types::SPersistenceTrajectory * _points, size_t _count );
+    void add( const std::vector<common_types::SPersistenceTrajectory> & _points );
+
+    // ordered by session, bucket, object
+    std::vector<common_types::SPersistenceTrajectory> getResult() const;
+
+
+private:
+    using TBucketKey = std::tuple<common_types::TSessionNum, int64_t, common_types::TObjectId>;
+
+    struct SBucket {
+        common_types::SPersistenceTrajectory point;
+        double latSum;
+        double lonSum;
+        double heightSum;
+        double yawSum;
+        int64_t count;
+    };
+
+    // data
+    const common_types::SPersistenceSetFilter m_filter;
+    std::map<TBucketKey, SBucket> m_buckets;
+};
+
+#endif // TRAJECTORY_DOWNSAMPLER_H
@@ -0,0 +1,54 @@
+#ifndef TRAJECTORY_POINT_PREDICATE_H
+#define TRAJECTORY_POINT_PREDICATE_H
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "common/ms_common_types.h"
+
+// point level part of the filter ( objects, bounding box ) for in-memory paths
+class TrajectoryPointPredicate
+{
+public:
+    TrajectoryPointPredicate( const common_types::SPersistenceSetFilter & _filter )
+        : m_objIds(_filter.objIds.begin(), _filter.objIds.end())
+        , m_boundingBox(_filter.boundingBox)
+        , m_byObjects(! _filter.objIds.empty())
+        , m_byBoundingBox(! _filter.boundingBox.empty())
+    {}
+
+    bool empty() const {
+        return ( ! m_byObjects && ! m_byBoundingBox );
+    }
+
+    bool accepts( common_types::TObjectId _objId, double _latDeg, double _lonDeg ) const {
+        return ( (! m_byObjects || m_objIds.count(_objId) > 0)
+                 && (! m_byBoundingBox || m_boundingBox.contains(_latDeg, _lonDeg)) );
+    }
+
+    bool accepts( const common_types::SPersistenceTrajectory & _point ) const {
+        return accepts( _point.objId, _point.latDeg, _point.lonDeg );
+    }
+
+    // keeps order of accepted points, starting from '_fromIdx'
+    void apply( std::vector<common_types::SPersistenceTrajectory> & _points, size_t _fromIdx = 0 ) const {
+
+        if( empty() ){
+            return;
+        }
+
+        auto iter = std::remove_if( _points.begin() + _fromIdx, _points.end(), [ this ]( const common_types::SPersistenceTrajectory & _point ){
+            return ! accepts( _point );
+        });
+        _points.erase( iter, _points.end() );
+    }
+
+
+private:
+    const std::unordered_set<common_types::TObjectId> m_objIds;
+    const common_types::SGeoBoundingBox m_boundingBox;
+    const bool m_byObjects;
+    const bool m_byBoundingBox;
+};
+
+#endif // TRAJECTORY_POINT_PREDICATE_H
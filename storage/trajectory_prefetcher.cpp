@@ -0,0 +1,290 @@
+
+#include <chrono>
+#include <cmath>
+
+#include "system/logger.h"
+#include "common/ms_common_utils.h"
+#include "trajectory_prefetcher.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "Prefetcher:";
+static constexpr double EMA_FACTOR = 0.2;
+
+static int64_t nowMillisec(){
+    using namespace std::chrono;
+    return duration_cast<milliseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+static double updateEma( double _current, double _sample ){
+    return ( _current <= 0 ) ? _sample : ( _current * (1 - EMA_FACTOR) + _sample * EMA_FACTOR );
+}
+
+TrajectoryPrefetcher::TrajectoryPrefetcher()
+    : m_shutdownCalled(false)
+    , m_threadFetching(nullptr)
+{
+
+}
+
+TrajectoryPrefetcher::~TrajectoryPrefetcher()
+{
+    shutdown();
+}
+
+bool TrajectoryPrefetcher::init( const SInitSettings & _settings ){
+
+    if( ! _settings.fetchFunc ){
+        VS_LOG_ERROR << PRINT_HEADER << " fetch function is not set" << endl;
+        return false;
+    }
+
+    if( _settings.minWindowSteps <= 0 || _settings.maxWindowSteps < _settings.minWindowSteps ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid window limits: " << _settings.minWindowSteps << "/" << _settings.maxWindowSteps << endl;
+        return false;
+    }
+
+    m_settings = _settings;
+    m_threadFetching = new std::thread( & TrajectoryPrefetcher::threadFetching, this );
+
+    VS_LOG_INFO << PRINT_HEADER << " init success, window [" << m_settings.minWindowSteps << ".." << m_settings.maxWindowSteps << "] steps" << endl;
+    return true;
+}
+
+void TrajectoryPrefetcher::shutdown(){
+
+    if( m_shutdownCalled.exchange(true) ){
+        return;
+    }
+
+    m_cvFetchEvent.notify_all();
+    common_utils::threadShutdown( m_threadFetching );
+}
+
+TrajectoryPrefetcher::SPrefetchStats TrajectoryPrefetcher::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexStreams );
+    return m_stats;
+}
+
+bool TrajectoryPrefetcher::read( const SPersistenceSetFilter & _filter, std::vector<SPersistenceTrajectory> & _out ){
+
+    if( _filter.minLogicStep != _filter.maxLogicStep || _filter.minLogicStep < 0 ){
+        return false;
+    }
+
+    const TLogicStep step = _filter.minLogicStep;
+    const TStreamKey key( _filter.persistenceSetId, _filter.sessionNum );
+
+    std::lock_guard<std::mutex> lock( m_mutexStreams );
+    SStream & stream = m_streams[ key ];
+    trackAccess( stream, step, nowMillisec() );
+
+    const bool hit = ( stream.windowEnd >= stream.windowBegin && step >= stream.windowBegin && step <= stream.windowEnd );
+    if( hit ){
+        auto iter = stream.window.find( step );
+        if( iter != stream.window.end() ){
+            _out = iter->second;
+        }
+        m_stats.hits++;
+
+        // already passed steps are not needed anymore
+        if( stream.direction > 0 ){
+            stream.window.erase( stream.window.begin(), stream.window.lower_bound(step) );
+            stream.windowBegin = step;
+        }
+        else if( stream.direction < 0 ){
+            stream.window.erase( stream.window.upper_bound(step), stream.window.end() );
+            stream.windowEnd = step;
+        }
+    }
+    else{
+        m_stats.misses++;
+    }
+
+    scheduleIfNeeded( key, stream, step );
+    return hit;
+}
+
+void TrajectoryPrefetcher::trackAccess( SStream & _stream, TLogicStep _step, int64_t _nowMillisec ){
+
+    if( _stream.lastStep >= 0 && _step != _stream.lastStep ){
+        const TLogicStep delta = _step - _stream.lastStep;
+
+        // sequential
+        if( 1 == delta || -1 == delta ){
+            if( _stream.direction == delta ){
+                _stream.sequentialHits++;
+            }
+            else{
+                _stream.direction = delta;
+                _stream.sequentialHits = 1;
+            }
+            _stream.stepIntervalMillisec = updateEma( _stream.stepIntervalMillisec, _nowMillisec - _stream.lastRequestMillisec );
+        }
+        // seek - window is useless
+        else{
+            _stream.direction = 0;
+            _stream.sequentialHits = 0;
+            _stream.window.clear();
+            _stream.windowBegin = 0;
+            _stream.windowEnd = -1;
+            _stream.fetchInFlight = false;
+            _stream.generation++;
+        }
+    }
+
+    _stream.lastStep = _step;
+    _stream.lastRequestMillisec = _nowMillisec;
+}
+
+int32_t TrajectoryPrefetcher::calcWindowSteps( const SStream & _stream ) const {
+
+    if( _stream.stepIntervalMillisec <= 0 || _stream.fetchLatencyMillisec <= 0 ){
+        return m_settings.minWindowSteps;
+    }
+
+    // cover two fetch latencies at current playback rate
+    const double steps = std::ceil( 2 * _stream.fetchLatencyMillisec / std::max(_stream.stepIntervalMillisec, 1.0) ) + 1;
+    return (int32_t)std::min<double>( m_settings.maxWindowSteps, std::max<double>(m_settings.minWindowSteps, steps) );
+}
+
+void TrajectoryPrefetcher::scheduleIfNeeded( const TStreamKey & _key, SStream & _stream, TLogicStep _step ){
+
+    if( _stream.sequentialHits < m_settings.sequentialHitsToStart || _stream.fetchInFlight ){
+        return;
+    }
+
+    const int32_t windowSteps = calcWindowSteps( _stream );
+    const bool stepInWindow = ( _stream.windowEnd >= _stream.windowBegin && _step >= _stream.windowBegin && _step <= _stream.windowEnd );
+
+    SFetchRequest request;
+    request.key = _key;
+    request.generation = _stream.generation;
+
+    if( _stream.direction > 0 ){
+        const TLogicStep stepsAhead = stepInWindow ? (_stream.windowEnd - _step) : 0;
+        if( stepsAhead >= windowSteps / 2 ){
+            return;
+        }
+
+        request.minStep = stepInWindow ? (_stream.windowEnd + 1) : (_step + 1);
+        request.maxStep = request.minStep + windowSteps - 1;
+    }
+    else{
+        const TLogicStep stepsAhead = stepInWindow ? (_step - _stream.windowBegin) : 0;
+        if( stepsAhead >= windowSteps / 2 ){
+            return;
+        }
+
+        request.maxStep = stepInWindow ? (_stream.windowBegin - 1) : (_step - 1);
+        request.minStep = std::max<TLogicStep>( 0, request.maxStep - windowSteps + 1 );
+        if( request.maxStep < 0 ){
+            return;
+        }
+    }
+
+    _stream.fetchInFlight = true;
+    _stream.windowSteps = windowSteps;
+    m_fetchQueue.push_back( request );
+    m_cvFetchEvent.notify_one();
+}
+
+void TrajectoryPrefetcher::applyFetched( const SFetchRequest & _request, std::vector<SPersistenceTrajectory> & _data, double _latencyMillisec ){
+
+    auto iter = m_streams.find( _request.key );
+    // stream was reset while fetching
+    if( iter == m_streams.end() || iter->second.generation != _request.generation ){
+        return;
+    }
+
+    SStream & stream = iter->second;
+    stream.fetchInFlight = false;
+    stream.fetchLatencyMillisec = updateEma( stream.fetchLatencyMillisec, _latencyMillisec );
+
+    const bool windowValid = ( stream.windowEnd >= stream.windowBegin );
+    if( windowValid && _request.minStep == stream.windowEnd + 1 ){
+        stream.windowEnd = _request.maxStep;
+    }
+    else if( windowValid && _request.maxStep == stream.windowBegin - 1 ){
+        stream.windowBegin = _request.minStep;
+    }
+    else{
+        stream.window.clear();
+        stream.windowBegin = _request.minStep;
+        stream.windowEnd = _request.maxStep;
+    }
+
+    for( SPersistenceTrajectory & traj : _data ){
+        stream.window[ traj.logicTime ].push_back( std::move(traj) );
+    }
+
+    m_stats.fetches++;
+    m_stats.lastWindowSteps = stream.windowSteps;
+}
+
+void TrajectoryPrefetcher::threadFetching(){
+
+    VS_LOG_INFO << PRINT_HEADER << " fetching thread is STARTED" << endl;
+
+    while( ! m_shutdownCalled.load() ){
+
+        SFetchRequest request;
+        {
+            std::unique_lock<std::mutex> lock( m_mutexStreams );
+            m_cvFetchEvent.wait( lock, [this](){ return ( ! m_fetchQueue.empty() || m_shutdownCalled.load() ); } );
+            if( m_shutdownCalled.load() ){
+                break;
+            }
+
+            request = m_fetchQueue.front();
+            m_fetchQueue.pop_front();
+        }
+
+        SPersistenceSetFilter filter( request.key.first );
+        filter.sessionNum = request.key.second;
+        filter.minLogicStep = request.minStep;
+        filter.maxLogicStep = request.maxStep;
+
+        const int64_t beginMillisec = nowMillisec();
+        std::vector<SPersistenceTrajectory> data = m_settings.fetchFunc( filter );
+        const double latencyMillisec = nowMillisec() - beginMillisec;
+
+        std::lock_guard<std::mutex> lock( m_mutexStreams );
+        applyFetched( request, data, latencyMillisec );
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " fetching thread go to EXIT" << endl;
+}
+
+void TrajectoryPrefetcher::invalidate( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStreams );
+    for( auto iter = m_streams.lower_bound( TStreamKey(_persId, std::numeric_limits<TSessionNum>::min()) );
+         iter != m_streams.end() && iter->first.first == _persId;
+         ++iter ){
+        SStream & stream = iter->second;
+        stream.window.clear();
+        stream.windowBegin = 0;
+        stream.windowEnd = -1;
+        stream.fetchInFlight = false;
+        stream.generation++;
+    }
+}
+
+void TrajectoryPrefetcher::invalidate( TPersistenceSetId _persId, TSessionNum _sessionNum ){
+
+    std::lock_guard<std::mutex> lock( m_mutexStreams );
+    auto iter = m_streams.find( TStreamKey(_persId, _sessionNum) );
+    if( iter == m_streams.end() ){
+        return;
+    }
+
+    SStream & stream = iter->second;
+    stream.window.clear();
+    stream.windowBegin = 0;
+    stream.windowEnd = -1;
+    stream.fetchInFlight = false;
+    stream.generation++;
+}
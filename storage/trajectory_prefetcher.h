@@ -0,0 +1,119 @@
+#ifndef TRAJECTORY_PREFETCHER_H
+#define TRAJECTORY_PREFETCHER_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+#include "common/ms_common_types.h"
+
+// read-ahead for step-by-step playback: sequential single step requests are served from a window fetched in background
+class TrajectoryPrefetcher
+{
+public:
+    using TFetchFunc = std::function<std::vector<common_types::SPersistenceTrajectory>( const common_types::SPersistenceSetFilter & )>;
+
+    struct SInitSettings {
+        SInitSettings()
+            : minWindowSteps(8)
+            , maxWindowSteps(1024)
+            , sequentialHitsToStart(2)
+        {}
+        int32_t minWindowSteps;
+        int32_t maxWindowSteps;
+        int32_t sequentialHitsToStart;
+        TFetchFunc fetchFunc;
+    };
+
+    struct SPrefetchStats {
+        SPrefetchStats()
+            : hits(0)
+            , misses(0)
+            , fetches(0)
+            , lastWindowSteps(0)
+        {}
+        int64_t hits;
+        int64_t misses;
+        int64_t fetches;
+        int32_t lastWindowSteps;
+    };
+
+    TrajectoryPrefetcher();
+    ~TrajectoryPrefetcher();
+
+    bool init( const SInitSettings & _settings );
+    void shutdown();
+    SPrefetchStats getStats();
+
+    // only one step filters, false -> caller reads by itself
+    bool read( const common_types::SPersistenceSetFilter & _filter, std::vector<common_types::SPersistenceTrajectory> & _out );
+
+    void invalidate( common_types::TPersistenceSetId _persId );
+    void invalidate( common_types::TPersistenceSetId _persId, common_types::TSessionNum _sessionNum );
+
+
+private:
+    using TStreamKey = std::pair<common_types::TPersistenceSetId, common_types::TSessionNum>;
+
+    struct SStream {
+        SStream()
+            : lastStep(-1)
+            , direction(0)
+            , sequentialHits(0)
+            , windowBegin(0)
+            , windowEnd(-1)
+            , windowSteps(0)
+            , fetchInFlight(false)
+            , generation(0)
+            , lastRequestMillisec(0)
+            , stepIntervalMillisec(0)
+            , fetchLatencyMillisec(0)
+        {}
+        common_types::TLogicStep lastStep;
+        int32_t direction; // +1 forward, -1 backward, 0 unknown
+        int32_t sequentialHits;
+
+        // fetched steps [ begin, end ], absent step == empty step
+        std::map<common_types::TLogicStep, std::vector<common_types::SPersistenceTrajectory>> window;
+        common_types::TLogicStep windowBegin;
+        common_types::TLogicStep windowEnd;
+        int32_t windowSteps;
+
+        bool fetchInFlight;
+        uint64_t generation;
+        int64_t lastRequestMillisec;
+        double stepIntervalMillisec; // playback rate
+        double fetchLatencyMillisec;
+    };
+
+    struct SFetchRequest {
+        TStreamKey key;
+        common_types::TLogicStep minStep;
+        common_types::TLogicStep maxStep;
+        uint64_t generation;
+    };
+
+    void threadFetching();
+    void trackAccess( SStream & _stream, common_types::TLogicStep _step, int64_t _nowMillisec );
+    void scheduleIfNeeded( const TStreamKey & _key, SStream & _stream, common_types::TLogicStep _step );
+    int32_t calcWindowSteps( const SStream & _stream ) const;
+    void applyFetched( const SFetchRequest & _request, std::vector<common_types::SPersistenceTrajectory> & _data, double _latencyMillisec );
+
+    // data
+    SInitSettings m_settings;
+    std::map<TStreamKey, SStream> m_streams;
+    std::deque<SFetchRequest> m_fetchQueue;
+    SPrefetchStats m_stats;
+    std::atomic<bool> m_shutdownCalled;
+
+    // service
+    std::thread * m_threadFetching;
+    std::mutex m_mutexStreams;
+    std::condition_variable m_cvFetchEvent;
+};
+
+#endif // TRAJECTORY_PREFETCHER_H
@@ -0,0 +1,202 @@
+#include "system/logger.h"
+#include "common/ms_common_utils.h"
+#include "trajectory_subscriptions.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "LiveTail:";
+
+TrajectorySubscriptions::TrajectorySubscriptions()
+    : m_idGenerator(0)
+    , m_deliveringId(INVALID_SUBSCRIPTION_ID)
+    , m_shutdownCalled(false)
+    , m_threadDelivery(nullptr)
+{
+
+}
+
+TrajectorySubscriptions::~TrajectorySubscriptions()
+{
+    shutdown();
+}
+
+bool TrajectorySubscriptions::init( const SInitSettings & _settings ){
+
+    if( _settings.maxPendingPoints <= 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid pending points limit: " << _settings.maxPendingPoints << endl;
+        return false;
+    }
+
+    m_settings = _settings;
+    m_threadDelivery = new std::thread( & TrajectorySubscriptions::threadDelivery, this );
+
+    VS_LOG_INFO << PRINT_HEADER << " init success, pending limit [" << m_settings.maxPendingPoints << "] points" << endl;
+    return true;
+}
+
+void TrajectorySubscriptions::shutdown(){
+
+    if( m_shutdownCalled.exchange(true) ){
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutexSubscribers );
+        m_cvPublished.notify_all();
+    }
+    common_utils::threadShutdown( m_threadDelivery );
+}
+
+TrajectorySubscriptions::SLiveTailStats TrajectorySubscriptions::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexSubscribers );
+
+    SLiveTailStats out = m_stats;
+    out.subscribersCount = m_subscribers.size();
+    return out;
+}
+
+TrajectorySubscriptions::TSubscriptionId TrajectorySubscriptions::subscribe( TPersistenceSetId _persId,
+                                                                             const std::vector<TObjectId> & _objIds,
+                                                                             TDeliverFunc _deliver ){
+
+    if( ! _deliver ){
+        VS_LOG_ERROR << PRINT_HEADER << " deliver function is not set, pers id [" << _persId << "]" << endl;
+        return INVALID_SUBSCRIPTION_ID;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutexSubscribers );
+
+    SSubscriber & subscriber = m_subscribers[ ++m_idGenerator ];
+    subscriber.id = m_idGenerator;
+    subscriber.persId = _persId;
+    subscriber.objIds.insert( _objIds.begin(), _objIds.end() );
+    subscriber.deliver = _deliver;
+    m_subscribersBySet[ _persId ]++;
+
+    VS_LOG_INFO << PRINT_HEADER << " subscription [" << subscriber.id << "] on pers id [" << _persId << "]"
+                << " objects [" << (_objIds.empty() ? std::string("all") : std::to_string(_objIds.size())) << "]"
+                << endl;
+    return subscriber.id;
+}
+
+bool TrajectorySubscriptions::unsubscribe( TSubscriptionId _id, TPersistenceSetId & _persId ){
+
+    std::unique_lock<std::mutex> lock( m_mutexSubscribers );
+
+    auto iter = m_subscribers.find( _id );
+    if( iter == m_subscribers.end() ){
+        return false;
+    }
+
+    _persId = iter->second.persId;
+    if( 0 == --m_subscribersBySet[ _persId ] ){
+        m_subscribersBySet.erase( _persId );
+    }
+    m_subscribers.erase( iter );
+
+    // in-flight delivery to this subscriber must finish first
+    if( std::this_thread::get_id() != m_deliveryThreadId ){
+        m_cvDelivered.wait( lock, [ this, _id ](){ return m_deliveringId != _id; } );
+    }
+
+    return true;
+}
+
+bool TrajectorySubscriptions::hasSubscribers( TPersistenceSetId _persId ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSubscribers );
+    return ( m_subscribersBySet.find(_persId) != m_subscribersBySet.end() );
+}
+
+void TrajectorySubscriptions::publish( TPersistenceSetId _persId, const std::vector<SPersistenceTrajectory> & _points ){
+
+    std::lock_guard<std::mutex> lock( m_mutexSubscribers );
+
+    if( m_subscribersBySet.find(_persId) == m_subscribersBySet.end() ){
+        return;
+    }
+
+    m_stats.pointsPublished += _points.size();
+
+    bool published = false;
+    for( auto & valuePair : m_subscribers ){
+        SSubscriber & subscriber = valuePair.second;
+        if( subscriber.persId != _persId ){
+            continue;
+        }
+
+        const size_t pendingBefore = subscriber.pending.size();
+        if( subscriber.objIds.empty() ){
+            subscriber.pending.insert( subscriber.pending.end(), _points.begin(), _points.end() );
+        }
+        else{
+            for( const SPersistenceTrajectory & point : _points ){
+                if( subscriber.objIds.count(point.objId) > 0 ){
+                    subscriber.pending.push_back( point );
+                }
+            }
+        }
+
+        // oldest points go away
+        if( (int64_t)subscriber.pending.size() > m_settings.maxPendingPoints ){
+            const int64_t excess = subscriber.pending.size() - m_settings.maxPendingPoints;
+            subscriber.pending.erase( subscriber.pending.begin(), subscriber.pending.begin() + excess );
+            m_stats.pointsDropped += excess;
+        }
+
+        published |= ( subscriber.pending.size() != pendingBefore );
+    }
+
+    if( published ){
+        m_cvPublished.notify_one();
+    }
+}
+
+void TrajectorySubscriptions::threadDelivery(){
+
+    VS_LOG_INFO << PRINT_HEADER << " delivery thread is STARTED" << endl;
+
+    std::vector<SPersistenceTrajectory> batch;
+
+    std::unique_lock<std::mutex> lock( m_mutexSubscribers );
+    m_deliveryThreadId = std::this_thread::get_id();
+    while( ! m_shutdownCalled.load() ){
+
+        bool delivered = false;
+        for( TSubscriptionId nextId = 0; ! m_shutdownCalled.load(); ){
+
+            // subscribers may come & go while callback runs -> continue from the next id
+            auto iter = m_subscribers.upper_bound( nextId );
+            while( iter != m_subscribers.end() && iter->second.pending.empty() ){
+                ++iter;
+            }
+            if( iter == m_subscribers.end() ){
+                break;
+            }
+
+            SSubscriber & subscriber = iter->second;
+            nextId = subscriber.id;
+            batch.swap( subscriber.pending );
+            subscriber.pending.clear();
+            TDeliverFunc deliver = subscriber.deliver;
+            m_deliveringId = subscriber.id;
+
+            lock.unlock();
+            deliver( nextId, batch );
+            lock.lock();
+
+            m_stats.pointsDelivered += batch.size();
+            m_deliveringId = INVALID_SUBSCRIPTION_ID;
+            m_cvDelivered.notify_all();
+            delivered = true;
+        }
+
+        if( ! delivered ){
+            m_cvPublished.wait( lock );
+        }
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " delivery thread go to EXIT" << endl;
+}
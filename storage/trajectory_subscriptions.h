@@ -0,0 +1,95 @@
+#ifndef TRAJECTORY_SUBSCRIPTIONS_H
+#define TRAJECTORY_SUBSCRIPTIONS_H
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <unordered_set>
+#include <condition_variable>
+
+#include "common/ms_common_types.h"
+
+// live tail: newly written points are pushed to subscribers from one delivery thread,
+// slow subscriber loses its oldest points instead of blocking writers
+class TrajectorySubscriptions
+{
+public:
+    using TSubscriptionId = int64_t;
+    // called from delivery thread, points of one set in write order
+    using TDeliverFunc = std::function<void( TSubscriptionId _id, const std::vector<common_types::SPersistenceTrajectory> & _points )>;
+
+    static constexpr TSubscriptionId INVALID_SUBSCRIPTION_ID = -1;
+
+    struct SInitSettings {
+        SInitSettings()
+            : maxPendingPoints(100000)
+        {}
+        int64_t maxPendingPoints; // per subscriber
+    };
+
+    struct SLiveTailStats {
+        SLiveTailStats()
+            : subscribersCount(0)
+            , pointsPublished(0)
+            , pointsDelivered(0)
+            , pointsDropped(0)
+        {}
+        int64_t subscribersCount;
+        int64_t pointsPublished;
+        int64_t pointsDelivered;
+        int64_t pointsDropped;
+    };
+
+    TrajectorySubscriptions();
+    ~TrajectorySubscriptions();
+
+    bool init( const SInitSettings & _settings );
+    void shutdown();
+    SLiveTailStats getStats();
+
+    // empty objects list -> all objects of the set
+    TSubscriptionId subscribe( common_types::TPersistenceSetId _persId,
+                               const std::vector<common_types::TObjectId> & _objIds,
+                               TDeliverFunc _deliver );
+    // no delivery to this subscriber after return ( except call from its own callback )
+    bool unsubscribe( TSubscriptionId _id, common_types::TPersistenceSetId & _persId );
+    bool hasSubscribers( common_types::TPersistenceSetId _persId );
+
+    void publish( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _points );
+
+
+private:
+    struct SSubscriber {
+        SSubscriber()
+            : id(INVALID_SUBSCRIPTION_ID)
+            , persId(0)
+        {}
+        TSubscriptionId id;
+        common_types::TPersistenceSetId persId;
+        std::unordered_set<common_types::TObjectId> objIds;
+        TDeliverFunc deliver;
+        std::vector<common_types::SPersistenceTrajectory> pending;
+    };
+
+    void threadDelivery();
+
+    // data
+    SInitSettings m_settings;
+    std::map<TSubscriptionId, SSubscriber> m_subscribers;
+    std::map<common_types::TPersistenceSetId, int64_t> m_subscribersBySet;
+    TSubscriptionId m_idGenerator;
+    TSubscriptionId m_deliveringId;
+    SLiveTailStats m_stats;
+    std::atomic<bool> m_shutdownCalled;
+
+    // service
+    std::thread * m_threadDelivery;
+    std::thread::id m_deliveryThreadId;
+    std::mutex m_mutexSubscribers;
+    std::condition_variable m_cvPublished;
+    std::condition_variable m_cvDelivered;
+};
+
+#endif // TRAJECTORY_SUBSCRIPTIONS_H
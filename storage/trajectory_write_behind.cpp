@@ -0,0 +1,321 @@
+
+#include <algorithm>
+#include <chrono>
+
+#include "system/logger.h"
+#include "trajectory_write_behind.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "WriteBehind:";
+static constexpr int64_t IDLE_WAIT_MILLISEC = 50;
+
+static int64_t nowMillisec(){
+    using namespace std::chrono;
+    return duration_cast<milliseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+static int64_t nowMicrosec(){
+    using namespace std::chrono;
+    return duration_cast<microseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+TrajectoryWriteBehind::TrajectoryWriteBehind()
+    : m_shutdownCalled(false)
+    , m_multitaskClientId(threaded_multitask_service::INVALID_CLIENT_ID)
+    , m_threadFlushing(nullptr)
+{
+
+}
+
+TrajectoryWriteBehind::~TrajectoryWriteBehind()
+{
+    shutdown();
+}
+
+bool TrajectoryWriteBehind::init( const SInitSettings & _settings ){
+
+    if( ! _settings.flushFunc ){
+        VS_LOG_ERROR << PRINT_HEADER << " flush function is not set" << endl;
+        return false;
+    }
+
+    if( _settings.maxBulkRecords <= 0 || _settings.maxQueueRecords < _settings.maxBulkRecords ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid queue/bulk limits: " << _settings.maxQueueRecords << "/" << _settings.maxBulkRecords << endl;
+        return false;
+    }
+
+    m_settings = _settings;
+
+    if( m_settings.runInMultitaskService ){
+        m_multitaskClientId = threaded_multitask_service::ThreadedMultitaskService::singleton().addRunnableClient( this );
+        if( threaded_multitask_service::INVALID_CLIENT_ID == m_multitaskClientId ){
+            return false;
+        }
+    }
+    else{
+        m_threadFlushing = new std::thread( & TrajectoryWriteBehind::threadFlushing, this );
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " init success"
+                << " queue [" << m_settings.maxQueueRecords << "]"
+                << " bulk [" << m_settings.maxBulkRecords << "]"
+                << " deadline [" << m_settings.flushDeadlineMillisec << "] ms"
+                << endl;
+    return true;
+}
+
+void TrajectoryWriteBehind::shutdown(){
+
+    if( m_shutdownCalled.exchange(true) ){
+        return;
+    }
+
+    m_cvQueueEvent.notify_all();
+    m_cvSpaceAvailable.notify_all();
+
+    if( m_multitaskClientId != threaded_multitask_service::INVALID_CLIENT_ID ){
+        threaded_multitask_service::ThreadedMultitaskService::singleton().removeDumpToDatabaseClient( m_multitaskClientId );
+        m_multitaskClientId = threaded_multitask_service::INVALID_CLIENT_ID;
+    }
+    common_utils::threadShutdown( m_threadFlushing );
+
+    // drain the rest in caller thread ( one attempt per bulk ),
+    // keys are copied as flushQueue() unlocks and iterators of the map don't survive its rehash
+    std::unique_lock<std::mutex> lock( m_mutexQueues );
+    std::vector<TPersistenceSetId> persIds;
+    persIds.reserve( m_queues.size() );
+    for( const auto & valuePair : m_queues ){
+        persIds.push_back( valuePair.first );
+    }
+
+    for( const TPersistenceSetId persId : persIds ){
+        SSetQueue & queue = m_queues[ persId ];
+
+        while( ! queue.records.empty() ){
+            const int64_t errorsBefore = m_stats.flushErrors;
+            flushQueue( persId, queue, lock );
+
+            if( m_stats.flushErrors != errorsBefore ){
+                VS_LOG_ERROR << PRINT_HEADER << " pers id [" << persId << "]"
+                             << " records lost on shutdown: " << queue.records.size()
+                             << endl;
+                m_stats.queueDepth -= queue.records.size();
+                queue.records.clear();
+            }
+        }
+    }
+
+    m_cvFlushed.notify_all();
+}
+
+TrajectoryWriteBehind::SIngestStats TrajectoryWriteBehind::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexQueues );
+    return m_stats;
+}
+
+bool TrajectoryWriteBehind::enqueue( TPersistenceSetId _persId, const std::vector<SPersistenceTrajectory> & _data ){
+
+    if( _data.empty() ){
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock( m_mutexQueues );
+    // new set must not appear while shutdown drains the queues
+    if( m_shutdownCalled.load() ){
+        VS_LOG_ERROR << PRINT_HEADER << " enqueue after shutdown, pers id [" << _persId << "]" << endl;
+        return false;
+    }
+    SSetQueue & queue = m_queues[ _persId ];
+
+    // back-pressure ( oversized batch is accepted into an empty queue )
+    while( ! m_shutdownCalled.load()
+           && ! queue.records.empty()
+           && (int64_t)(queue.records.size() + _data.size()) > m_settings.maxQueueRecords ){
+        m_stats.backPressureWaits++;
+        m_cvQueueEvent.notify_one();
+        m_cvSpaceAvailable.wait( lock );
+    }
+
+    if( m_shutdownCalled.load() ){
+        VS_LOG_ERROR << PRINT_HEADER << " enqueue after shutdown, pers id [" << _persId << "]" << endl;
+        return false;
+    }
+
+    if( queue.records.empty() ){
+        queue.oldestEnqueueMillisec = nowMillisec();
+    }
+    queue.records.insert( queue.records.end(), _data.begin(), _data.end() );
+
+    m_stats.queueDepth += _data.size();
+    m_stats.maxQueueDepth = std::max( m_stats.maxQueueDepth, m_stats.queueDepth );
+
+    if( (int64_t)queue.records.size() >= m_settings.maxBulkRecords ){
+        m_cvQueueEvent.notify_one();
+    }
+    return true;
+}
+
+bool TrajectoryWriteBehind::isDrained( TPersistenceSetId _persId ){
+
+    auto iter = m_queues.find( _persId );
+    return ( iter == m_queues.end() || (iter->second.records.empty() && ! iter->second.flushing) );
+}
+
+void TrajectoryWriteBehind::flush( TPersistenceSetId _persId ){
+
+    std::unique_lock<std::mutex> lock( m_mutexQueues );
+    if( isDrained(_persId) ){
+        return;
+    }
+
+    // NOTE: all writes go through flusher thread, here we only wait for it
+    const int64_t errorsBefore = m_stats.flushErrors;
+    m_forcedFlush[ _persId ] = true;
+    m_cvQueueEvent.notify_one();
+
+    m_cvFlushed.wait( lock, [&](){
+        return ( isDrained(_persId) || m_shutdownCalled.load() || m_stats.flushErrors != errorsBefore );
+    });
+
+    m_forcedFlush.erase( _persId );
+}
+
+void TrajectoryWriteBehind::flushAll(){
+
+    std::vector<TPersistenceSetId> persIds;
+    {
+        std::lock_guard<std::mutex> lock( m_mutexQueues );
+        for( const auto & valuePair : m_queues ){
+            persIds.push_back( valuePair.first );
+        }
+    }
+
+    for( const TPersistenceSetId persId : persIds ){
+        flush( persId );
+    }
+}
+
+bool TrajectoryWriteBehind::isReadyToFlush( const SSetQueue & _queue, int64_t _nowMillisec ) const {
+
+    if( _queue.flushing || _queue.records.empty() ){
+        return false;
+    }
+
+    // failed set is not retried until backoff expires, even if it's full
+    if( _nowMillisec < _queue.retryAfterMillisec ){
+        return false;
+    }
+
+    return ( (int64_t)_queue.records.size() >= m_settings.maxBulkRecords
+             || (_nowMillisec - _queue.oldestEnqueueMillisec) >= m_settings.flushDeadlineMillisec );
+}
+
+void TrajectoryWriteBehind::flushQueue( TPersistenceSetId _persId, SSetQueue & _queue, std::unique_lock<std::mutex> & _lock ){
+
+    // take one bulk
+    const size_t bulkSize = std::min( (size_t)m_settings.maxBulkRecords, _queue.records.size() );
+    std::vector<SPersistenceTrajectory> bulk( _queue.records.begin(), _queue.records.begin() + bulkSize );
+    _queue.records.erase( _queue.records.begin(), _queue.records.begin() + bulkSize );
+    _queue.flushing = true;
+
+    // write without lock - producers keep enqueueing
+    _lock.unlock();
+    const int64_t beginMicrosec = nowMicrosec();
+    const size_t written = std::min( m_settings.flushFunc(_persId, bulk), bulk.size() );
+    const int64_t latencyMicrosec = nowMicrosec() - beginMicrosec;
+    _lock.lock();
+
+    _queue.flushing = false;
+    m_stats.flushesCount++;
+    m_stats.lastFlushLatencyMicrosec = latencyMicrosec;
+    m_stats.maxFlushLatencyMicrosec = std::max( m_stats.maxFlushLatencyMicrosec, latencyMicrosec );
+    m_stats.totalFlushLatencyMicrosec += latencyMicrosec;
+
+    m_stats.recordsFlushed += written;
+    m_stats.queueDepth -= written;
+
+    // only not written tail returns to the head, next attempt after growing backoff
+    if( written < bulk.size() ){
+        const int64_t firstBackoffMillisec = std::max<int64_t>( m_settings.flushDeadlineMillisec, 1 );
+        _queue.retryBackoffMillisec = ( 0 == _queue.retryBackoffMillisec
+                                        ? firstBackoffMillisec
+                                        : std::min( _queue.retryBackoffMillisec * 2, std::max(m_settings.maxRetryBackoffMillisec, firstBackoffMillisec) ) );
+        _queue.retryAfterMillisec = nowMillisec() + _queue.retryBackoffMillisec;
+
+        VS_LOG_ERROR << PRINT_HEADER << " bulk flush failed, pers id [" << _persId << "]"
+                     << " records [" << bulk.size() << "] written [" << written << "]"
+                     << " retry in [" << _queue.retryBackoffMillisec << "] ms"
+                     << endl;
+        m_stats.flushErrors++;
+        _queue.records.insert( _queue.records.begin(), bulk.begin() + written, bulk.end() );
+        _queue.oldestEnqueueMillisec = nowMillisec();
+    }
+    else{
+        _queue.retryBackoffMillisec = 0;
+        _queue.retryAfterMillisec = 0;
+    }
+
+    if( _queue.records.empty() ){
+        _queue.oldestEnqueueMillisec = 0;
+    }
+
+    m_cvSpaceAvailable.notify_all();
+    m_cvFlushed.notify_all();
+}
+
+void TrajectoryWriteBehind::runInThreadService(){
+
+    std::unique_lock<std::mutex> lock( m_mutexQueues );
+    if( m_shutdownCalled.load() ){
+        return;
+    }
+
+    // collect ready sets ( references to map values are stable, iterators - not )
+    const int64_t now = nowMillisec();
+    int64_t nearestDeadlineMillisec = IDLE_WAIT_MILLISEC;
+    std::vector<TPersistenceSetId> readySets;
+
+    for( const auto & valuePair : m_queues ){
+        const SSetQueue & queue = valuePair.second;
+
+        const bool forced = ( ! queue.records.empty()
+                              && now >= queue.retryAfterMillisec
+                              && m_forcedFlush.find(valuePair.first) != m_forcedFlush.end() );
+
+        if( isReadyToFlush(queue, now) || forced ){
+            readySets.push_back( valuePair.first );
+        }
+        else if( ! queue.records.empty() ){
+            const int64_t leftMillisec = ( now < queue.retryAfterMillisec
+                                           ? queue.retryAfterMillisec - now
+                                           : m_settings.flushDeadlineMillisec - (now - queue.oldestEnqueueMillisec) );
+            nearestDeadlineMillisec = std::min( nearestDeadlineMillisec, std::max<int64_t>(leftMillisec, 1) );
+        }
+    }
+
+    if( readySets.empty() ){
+        m_cvQueueEvent.wait_for( lock, std::chrono::milliseconds(nearestDeadlineMillisec) );
+        return;
+    }
+
+    for( const TPersistenceSetId persId : readySets ){
+        SSetQueue & queue = m_queues[ persId ];
+        if( ! queue.flushing && ! queue.records.empty() ){
+            flushQueue( persId, queue, lock );
+        }
+    }
+}
+
+void TrajectoryWriteBehind::threadFlushing(){
+
+    VS_LOG_INFO << PRINT_HEADER << " flushing thread is STARTED" << endl;
+
+    while( ! m_shutdownCalled.load() ){
+        runInThreadService();
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " flushing thread go to EXIT" << endl;
+}
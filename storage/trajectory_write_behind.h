@@ -0,0 +1,111 @@
+#ifndef TRAJECTORY_WRITE_BEHIND_H
+#define TRAJECTORY_WRITE_BEHIND_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "common/ms_common_types.h"
+#include "system/threaded_multitask_service.h"
+
+// asynchronous ingest: producers enqueue, one flusher merges small batches into large bulks
+class TrajectoryWriteBehind : public threaded_multitask_service::IRunnableDumpToDatabase
+{
+public:
+    // returns count of written records from the head of bulk
+    using TFlushFunc = std::function<size_t( common_types::TPersistenceSetId, const std::vector<common_types::SPersistenceTrajectory> & )>;
+
+    struct SInitSettings {
+        SInitSettings()
+            : maxQueueRecords(100000)
+            , maxBulkRecords(10000)
+            , flushDeadlineMillisec(100)
+            , maxRetryBackoffMillisec(5000)
+            , runInMultitaskService(false)
+        {}
+        int64_t maxQueueRecords; // per persistence set
+        int64_t maxBulkRecords;
+        int64_t flushDeadlineMillisec;
+        int64_t maxRetryBackoffMillisec; // failed set waits deadline, 2x deadline, ... up to this
+        bool runInMultitaskService;
+        TFlushFunc flushFunc;
+    };
+
+    struct SIngestStats {
+        SIngestStats()
+            : queueDepth(0)
+            , maxQueueDepth(0)
+            , flushesCount(0)
+            , flushErrors(0)
+            , recordsFlushed(0)
+            , backPressureWaits(0)
+            , lastFlushLatencyMicrosec(0)
+            , maxFlushLatencyMicrosec(0)
+            , totalFlushLatencyMicrosec(0)
+        {}
+        int64_t queueDepth;
+        int64_t maxQueueDepth;
+        int64_t flushesCount;
+        int64_t flushErrors;
+        int64_t recordsFlushed;
+        int64_t backPressureWaits;
+        int64_t lastFlushLatencyMicrosec;
+        int64_t maxFlushLatencyMicrosec;
+        int64_t totalFlushLatencyMicrosec;
+    };
+
+    TrajectoryWriteBehind();
+    ~TrajectoryWriteBehind();
+
+    bool init( const SInitSettings & _settings );
+    void shutdown();
+    SIngestStats getStats();
+
+    bool enqueue( common_types::TPersistenceSetId _persId, const std::vector<common_types::SPersistenceTrajectory> & _data );
+    void flush( common_types::TPersistenceSetId _persId );
+    void flushAll();
+
+    virtual void runInThreadService() override;
+
+
+private:
+    struct SSetQueue {
+        SSetQueue()
+            : oldestEnqueueMillisec(0)
+            , retryAfterMillisec(0)
+            , retryBackoffMillisec(0)
+            , flushing(false)
+        {}
+        std::deque<common_types::SPersistenceTrajectory> records;
+        int64_t oldestEnqueueMillisec;
+        int64_t retryAfterMillisec;
+        int64_t retryBackoffMillisec;
+        bool flushing;
+    };
+
+    void threadFlushing();
+    bool isReadyToFlush( const SSetQueue & _queue, int64_t _nowMillisec ) const;
+    void flushQueue( common_types::TPersistenceSetId _persId, SSetQueue & _queue, std::unique_lock<std::mutex> & _lock );
+    bool isDrained( common_types::TPersistenceSetId _persId );
+
+    // data
+    SInitSettings m_settings;
+    std::unordered_map<common_types::TPersistenceSetId, SSetQueue> m_queues;
+    std::unordered_map<common_types::TPersistenceSetId, bool> m_forcedFlush;
+    SIngestStats m_stats;
+    std::atomic<bool> m_shutdownCalled;
+
+    // service
+    threaded_multitask_service::TRunnableClientId m_multitaskClientId;
+    std::thread * m_threadFlushing;
+    std::mutex m_mutexQueues;
+    std::condition_variable m_cvQueueEvent;
+    std::condition_variable m_cvSpaceAvailable;
+    std::condition_variable m_cvFlushed;
+};
+
+#endif // TRAJECTORY_WRITE_BEHIND_H
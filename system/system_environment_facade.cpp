@@ -49,6 +49,26 @@ bool SystemEnvironmentFacade::init( const SInitSettings & _settings ){
     WriteAheadLogger::SInitSettings walSettings;
     walSettings.active = _settings.restoreSystemAfterInterrupt;
     walSettings.persistService = this;
+    if( ! _settings.walDirectory.empty() ){
+        WALFileStorage::SInitSettings walFileSettings;
+        walFileSettings.directory = _settings.walDirectory;
+        if( ! m_walFileStorage.init(walFileSettings) ){
+            return false;
+        }
+        walSettings.persistService = & m_walFileStorage;
+
+        if( ! _settings.walReplicationSocket.empty() ){
+            WALReplicationSource::SInitSettings replicationSettings;
+            replicationSettings.storage = & m_walFileStorage;
+            replicationSettings.socketFileName = _settings.walReplicationSocket;
+            if( ! m_walReplication.init(replicationSettings) ){
+                return false;
+            }
+        }
+    }
+    else if( ! _settings.walReplicationSocket.empty() ){
+        VS_LOG_WARN << PRINT_HEADER << " wal replication works only with journal files, socket is ignored" << endl;
+    }
     if( ! m_wal.init(walSettings) ){
         return false;
     }
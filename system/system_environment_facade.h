@@ -4,6 +4,8 @@
 #include <unordered_map>
 
 #include "wal.h"
+#include "wal_file_storage.h"
+#include "wal_replication.h"
 #include "storage/database_manager_base.h"
 #include "common/ms_common_types.h"
 
@@ -25,6 +27,8 @@ public:
         std::string databaseName;
         // wal
         bool restoreSystemAfterInterrupt;
+        std::string walDirectory; // local journal files instead of database ( if set )
+        std::string walReplicationSocket; // journal files are streamed to standby over this unix socket ( if set )
         // file stuff
         std::string uniqueLockFileFullPath;
 
@@ -77,6 +81,8 @@ private:
 
     // service
     WriteAheadLogger m_wal;
+    WALFileStorage m_walFileStorage;
+    WALReplicationSource m_walReplication;
     DatabaseManagerBase * m_database;
 };
 
@@ -68,6 +68,8 @@ TRunnableClientId ThreadedMultitaskService::addRunnableClient( IRunnableDumpToDa
     m_clientsForDumpToDatabase.insert( {clientId, _client} );
     m_muDumpToDatabaseLock.unlock();
 
+    m_cvDumpToDatabaseEvent.notify_one();
+
     return clientId;
 }
 
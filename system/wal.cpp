@@ -76,7 +76,7 @@ void WriteAheadLogger::openOperation( const common_types::SWALClientOperation &
     if( _operation.begin ){
         const bool rt = m_settings.persistService->write( _operation );
         if( ! rt ){
-            // TODO: do
+            VS_LOG_ERROR << PRINT_HEADER << " client operation is not journaled [" << _operation.uniqueKey << "]" << endl;
         }
     }
     else{
@@ -84,6 +84,40 @@ void WriteAheadLogger::openOperation( const common_types::SWALClientOperation &
     }
 }
 
+void WriteAheadLogger::openOperationAsync( const common_types::SWALClientOperation & _operation, TDurableCallback _callback ){
+
+    if( ! m_settings.active ){
+        _callback( true );
+        return;
+    }
+
+    if( ! _operation.begin ){
+        m_settings.persistService->remove( _operation.uniqueKey );
+        _callback( true );
+        return;
+    }
+
+    const common_types::SWALClientOperation::TUniqueKey uniqueKey = _operation.uniqueKey;
+    m_settings.persistService->writeAsync( _operation, [ uniqueKey, _callback ]( bool _durable ){
+        if( ! _durable ){
+            VS_LOG_ERROR << PRINT_HEADER << " client operation is not journaled [" << uniqueKey << "]" << endl;
+        }
+        _callback( _durable );
+    });
+}
+
+std::future<bool> WriteAheadLogger::openOperationAsync( const common_types::SWALClientOperation & _operation ){
+
+    std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> out = promise->get_future();
+
+    openOperationAsync( _operation, [ promise ]( bool _durable ){
+        promise->set_value( _durable );
+    });
+
+    return out;
+}
+
 void WriteAheadLogger::closeClientOperation( common_types::SWALClientOperation::TUniqueKey _uniqueKey ){
 
     m_settings.persistService->remove( _uniqueKey );
@@ -122,10 +156,26 @@ void WriteAheadLogger::openProcessEvent( const common_types::SWALProcessEvent &
 
     const bool rt = m_settings.persistService->write( _event );
     if( ! rt ){
-        // TODO: do
+        VS_LOG_ERROR << PRINT_HEADER << " process event is not journaled [" << _event.pid << ", " << _event.programName << "]" << endl;
     }
 }
 
+void WriteAheadLogger::openProcessEventAsync( const common_types::SWALProcessEvent & _event, TDurableCallback _callback ){
+
+    if( ! m_settings.active ){
+        _callback( true );
+        return;
+    }
+
+    const common_types::TPid pid = _event.pid;
+    m_settings.persistService->writeAsync( _event, [ pid, _callback ]( bool _durable ){
+        if( ! _durable ){
+            VS_LOG_ERROR << PRINT_HEADER << " process event is not journaled [" << pid << "]" << endl;
+        }
+        _callback( _durable );
+    });
+}
+
 void WriteAheadLogger::closeProcessEvent( common_types::SWALProcessEvent::TUniqueKey _pid ){
 
     m_settings.persistService->remove( _pid );
@@ -161,10 +211,10 @@ bool WriteAheadLogger::openUserRegistration( const common_types::SWALUserRegistr
 
     const bool rt = m_settings.persistService->write( _registration );
     if( ! rt ){
-        // TODO: do
+        VS_LOG_ERROR << PRINT_HEADER << " user registration is not journaled [" << _registration.registerId << "]" << endl;
     }
 
-    return true;
+    return rt;
 }
 
 void WriteAheadLogger::closeUserRegistration( common_types::SWALUserRegistration::TRegisterId _id ){
@@ -1,6 +1,8 @@
 #ifndef WAL_H
 #define WAL_H
 
+#include <future>
+
 #include "common/ms_common_types.h"
 #include "communication/network_interface.h"
 
@@ -24,13 +26,19 @@ public:
     std::string getFullHistory();
     void cleanJournal();
 
+    using TDurableCallback = common_types::IWALPersistenceService::TDurableCallback;
+
     // client operation
     void openOperation( const common_types::SWALClientOperation & _operation );
+    // command may run while record goes to journal, client is acknowledged after callback / future
+    void openOperationAsync( const common_types::SWALClientOperation & _operation, TDurableCallback _callback );
+    std::future<bool> openOperationAsync( const common_types::SWALClientOperation & _operation );
     void closeClientOperation( common_types::SWALClientOperation::TUniqueKey _uniqueKey );
     std::vector<PEnvironmentRequest> getInterruptedOperations();
 
     // child process
     void openProcessEvent( const common_types::SWALProcessEvent & _event );
+    void openProcessEventAsync( const common_types::SWALProcessEvent & _event, TDurableCallback _callback );
     void closeProcessEvent( common_types::SWALProcessEvent::TUniqueKey _pid );
     std::vector<common_types::TPid> getNonClosedProcesses();
 
@@ -0,0 +1,1346 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <thread>
+#include <type_traits>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common/ms_common_utils.h"
+#include "logger.h"
+#include "wal_file_storage.h"
+
+using namespace std;
+using namespace common_types;
+
+static constexpr const char * PRINT_HEADER = "WALFile:";
+static const string SEGMENT_FILE_PREFIX = "wal_";
+static const string SEGMENT_FILE_SUFFIX = ".log";
+static const string CHECKPOINT_FILE_PREFIX = "checkpoint_";
+static const string CHECKPOINT_FILE_SUFFIX = ".chk";
+
+// frame: payload length, payload crc, payload ( sequence + entry )
+static constexpr size_t FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+static constexpr size_t FRAME_MIN_PAYLOAD = sizeof(uint64_t) + sizeof(uint8_t);
+static constexpr uint32_t FRAME_MAX_PAYLOAD = 64 * 1024 * 1024;
+
+// checkpoint: magic, version, sequence, entries count, header crc, frames of open items
+static constexpr uint32_t CHECKPOINT_MAGIC = 0x4B484357; // 'WCHK'
+static constexpr uint32_t CHECKPOINT_VERSION = 2; // 2 - records in wal_record_codec form
+static constexpr size_t CHECKPOINT_HEADER_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+// *_WRITE - plain fields of the first journal version ( only replayed )
+enum class EEntryType : uint8_t {
+    OPERATION_WRITE = 1,
+    OPERATION_REMOVE,
+    PROCESS_WRITE,
+    PROCESS_REMOVE,
+    REGISTRATION_WRITE,
+    REGISTRATION_REMOVE,
+    RECORD_WRITE,
+    DICTIONARY_RESET // takes no sequence, next records start new interning stream
+};
+
+// CRC-32 ( IEEE 802.3, reflected )
+static uint32_t crc32( const uint8_t * _data, size_t _size ){
+
+    static uint32_t table[ 256 ];
+    static const bool tableInited = [](){
+        for( uint32_t i = 0; i < 256; i++ ){
+            uint32_t value = i;
+            for( int bit = 0; bit < 8; bit++ ){
+                value = ( value & 1 ) ? ( 0xEDB88320 ^ (value >> 1) ) : ( value >> 1 );
+            }
+            table[ i ] = value;
+        }
+        return true;
+    }();
+    (void)tableInited;
+
+    uint32_t crc = 0xFFFFFFFF;
+    for( size_t i = 0; i < _size; i++ ){
+        crc = table[ (crc ^ _data[ i ]) & 0xFF ] ^ ( crc >> 8 );
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+template< typename T >
+static void putLE( std::string & _out, T _value ){
+
+    using TUnsigned = typename std::make_unsigned<T>::type;
+    uint64_t value = static_cast<TUnsigned>( _value );
+    for( size_t i = 0; i < sizeof(T); i++ ){
+        _out.push_back( static_cast<char>(value & 0xFF) );
+        value >>= 8;
+    }
+}
+
+static void putString( std::string & _out, const std::string & _value ){
+    putLE<uint32_t>( _out, (uint32_t)_value.size() );
+    _out.append( _value );
+}
+
+// bounds are checked once per read, 'ok' stays false after the first overrun
+struct SByteReader {
+    SByteReader( const uint8_t * _data, size_t _size )
+        : pos(_data)
+        , end(_data + _size)
+        , ok(true)
+    {}
+
+    template< typename T >
+    T get(){
+        if( (size_t)(end - pos) < sizeof(T) ){
+            ok = false;
+            pos = end;
+            return T();
+        }
+
+        uint64_t value = 0;
+        for( size_t i = 0; i < sizeof(T); i++ ){
+            value |= (uint64_t)pos[ i ] << ( 8 * i );
+        }
+        pos += sizeof(T);
+
+        using TUnsigned = typename std::make_unsigned<T>::type;
+        return static_cast<T>( static_cast<TUnsigned>(value) );
+    }
+
+    std::string getString(){
+        const uint32_t size = get<uint32_t>();
+        if( (size_t)(end - pos) < size ){
+            ok = false;
+            pos = end;
+            return std::string();
+        }
+
+        std::string out( reinterpret_cast<const char *>(pos), size );
+        pos += size;
+        return out;
+    }
+
+    const uint8_t * pos;
+    const uint8_t * end;
+    bool ok;
+};
+
+// -------------------------------------------------------------------------------------
+// entries & frames
+// -------------------------------------------------------------------------------------
+static void appendFrame( std::string & _out, uint64_t _sequence, const std::string & _entry ){
+
+    std::string payload;
+    payload.reserve( sizeof(uint64_t) + _entry.size() );
+    putLE<uint64_t>( payload, _sequence );
+    payload.append( _entry );
+
+    putLE<uint32_t>( _out, (uint32_t)payload.size() );
+    putLE<uint32_t>( _out, crc32(reinterpret_cast<const uint8_t *>(payload.data()), payload.size()) );
+    _out.append( payload );
+}
+
+// calls '_func' for every valid frame, returns size of valid part
+template< typename T_Func >
+static size_t parseFrames( const uint8_t * _data, size_t _size, T_Func && _func ){
+
+    size_t offset = 0;
+    while( offset < _size ){
+        SByteReader header( _data + offset, _size - offset );
+        const uint32_t payloadSize = header.get<uint32_t>();
+        const uint32_t payloadCrc = header.get<uint32_t>();
+
+        if( ! header.ok
+                || payloadSize < FRAME_MIN_PAYLOAD
+                || payloadSize > FRAME_MAX_PAYLOAD
+                || payloadSize > _size - offset - FRAME_HEADER_SIZE ){
+            break;
+        }
+
+        const uint8_t * payload = _data + offset + FRAME_HEADER_SIZE;
+        if( crc32(payload, payloadSize) != payloadCrc ){
+            break;
+        }
+
+        SByteReader reader( payload, payloadSize );
+        const uint64_t sequence = reader.get<uint64_t>();
+        _func( sequence, reader.pos, (size_t)(reader.end - reader.pos) );
+
+        offset += FRAME_HEADER_SIZE + payloadSize;
+    }
+
+    return offset;
+}
+
+// -------------------------------------------------------------------------------------
+// files
+// -------------------------------------------------------------------------------------
+static string makeFilePath( const string & _directory, const string & _prefix, const string & _suffix, uint64_t _num ){
+
+    char name[ 32 ];
+    std::snprintf( name, sizeof(name), "%08llu", (unsigned long long)_num );
+    return _directory + "/" + _prefix + name + _suffix;
+}
+
+static bool parseFileName( const string & _name, const string & _prefix, const string & _suffix, uint64_t & _num ){
+
+    if( _name.size() <= _prefix.size() + _suffix.size()
+            || 0 != _name.compare(0, _prefix.size(), _prefix)
+            || 0 != _name.compare(_name.size() - _suffix.size(), _suffix.size(), _suffix) ){
+        return false;
+    }
+
+    unsigned long long num = 0;
+    if( 1 != std::sscanf(_name.c_str() + _prefix.size(), "%llu", & num) ){
+        return false;
+    }
+
+    _num = num;
+    return true;
+}
+
+static bool readFile( const string & _path, std::string & _out ){
+
+    std::ifstream file( _path, std::ios::binary );
+    if( ! file.is_open() ){
+        return false;
+    }
+    _out.assign( (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>() );
+    return true;
+}
+
+// -------------------------------------------------------------------------------------
+// journal state
+// -------------------------------------------------------------------------------------
+void WALFileStorage::SJournalState::apply( uint64_t _sequence, const SWALClientOperation & _operation ){
+
+    // upsert: operation keeps its first position
+    auto iter = operations.find( _operation.uniqueKey );
+    if( iter != operations.end() ){
+        iter->second.second = _operation;
+    }
+    else{
+        operations.insert( {_operation.uniqueKey, std::make_pair(_sequence, _operation)} );
+    }
+}
+
+void WALFileStorage::SJournalState::apply( uint64_t _sequence, const SWALProcessEvent & _event ){
+    processEvents.insert( {_sequence, _event} );
+}
+
+void WALFileStorage::SJournalState::apply( uint64_t _sequence, const SWALUserRegistration & _registration ){
+    registrations.insert( {_sequence, _registration} );
+}
+
+void WALFileStorage::SJournalState::removeOperations( const SWALClientOperation::TUniqueKey & _filter ){
+
+    if( SWALClientOperation::ALL_KEYS == _filter ){
+        operations.clear();
+    }
+    else{
+        operations.erase( _filter );
+    }
+}
+
+void WALFileStorage::SJournalState::removeProcessEvents( TPid _filter ){
+
+    for( auto iter = processEvents.begin(); iter != processEvents.end(); ){
+        if( SWALProcessEvent::ALL_PIDS == _filter || iter->second.pid == _filter ){
+            iter = processEvents.erase( iter );
+        }
+        else{
+            ++iter;
+        }
+    }
+}
+
+void WALFileStorage::SJournalState::removeRegistrations( const SWALUserRegistration::TRegisterId & _filter ){
+
+    for( auto iter = registrations.begin(); iter != registrations.end(); ){
+        if( SWALUserRegistration::ALL_IDS == _filter || iter->second.registerId == _filter ){
+            iter = registrations.erase( iter );
+        }
+        else{
+            ++iter;
+        }
+    }
+}
+
+// applies written record ( appended or decoded one )
+struct WALFileStorage::SJournalApplier : public common_types::IWALRecordVisitor, public wal_record_codec::IRecordViewVisitor {
+    SJournalApplier( SJournalState & _journal, uint64_t _sequence )
+        : journal(_journal)
+        , sequence(_sequence)
+    {}
+
+    virtual void visit( const SWALClientOperation * _record ) override { journal.apply( sequence, * _record ); }
+    virtual void visit( const SWALProcessEvent * _record ) override { journal.apply( sequence, * _record ); }
+    virtual void visit( const SWALUserRegistration * _record ) override { journal.apply( sequence, * _record ); }
+    virtual void visit( const SWALOnceMoreRecord * ) override {}
+
+    virtual void visit( const wal_record_codec::SClientOperationView & _record ) override { journal.apply( sequence, _record.toRecord() ); }
+    virtual void visit( const wal_record_codec::SProcessEventView & _record ) override { journal.apply( sequence, _record.toRecord() ); }
+    virtual void visit( const wal_record_codec::SUserRegistrationView & _record ) override { journal.apply( sequence, _record.toRecord() ); }
+
+    SJournalState & journal;
+    const uint64_t sequence;
+};
+
+// records of primary are encoded again into own stream, so checkpoints of standby stay independent
+struct WALFileStorage::SReplicaApplier : public wal_record_codec::IRecordViewVisitor {
+    SReplicaApplier( WALFileStorage & _storage, uint64_t _sequence )
+        : storage(_storage)
+        , sequence(_sequence)
+    {}
+
+    virtual void visit( const wal_record_codec::SClientOperationView & _record ) override { enqueue( _record.toRecord() ); }
+    virtual void visit( const wal_record_codec::SProcessEventView & _record ) override { enqueue( _record.toRecord() ); }
+    virtual void visit( const wal_record_codec::SUserRegistrationView & _record ) override { enqueue( _record.toRecord() ); }
+
+    template< typename T >
+    void enqueue( const T & _record ){
+        storage.enqueue( & _record, std::string(), sequence );
+    }
+
+    WALFileStorage & storage;
+    const uint64_t sequence;
+};
+
+// pending record outlives the caller's one until its group is written
+struct WALFileStorage::SRecordCopier : public common_types::IWALRecordVisitor {
+    virtual void visit( const SWALClientOperation * _record ) override { copy = std::make_shared<SWALClientOperation>( * _record ); }
+    virtual void visit( const SWALProcessEvent * _record ) override { copy = std::make_shared<SWALProcessEvent>( * _record ); }
+    virtual void visit( const SWALUserRegistration * _record ) override { copy = std::make_shared<SWALUserRegistration>( * _record ); }
+    virtual void visit( const SWALOnceMoreRecord * _record ) override { copy = std::make_shared<SWALOnceMoreRecord>( * _record ); }
+
+    std::shared_ptr<const SWALRecord> copy;
+};
+
+// new file entry is durable only after directory sync
+static void syncDirectory( const string & _directory ){
+
+    const int fd = ::open( _directory.c_str(), O_RDONLY | O_DIRECTORY );
+    if( fd >= 0 ){
+        ::fsync( fd );
+        ::close( fd );
+    }
+}
+
+WALFileStorage::WALFileStorage()
+    : m_lastSequence(0)
+    , m_checkpointSequence(0)
+    , m_recordsSinceCheckpoint(0)
+    , m_pendingGroup(std::make_shared<SCommitGroup>())
+    , m_replicaDecoder(wal_record_codec::DEFAULT_DICTIONARY_CAPACITY, true)
+    , m_commitInProgress(false)
+    , m_inited(false)
+    , m_shutdownCalled(false)
+    , m_segmentFd(-1)
+    , m_segmentNum(0)
+    , m_segmentBytes(0)
+    , m_threadCommit(nullptr)
+{
+
+}
+
+WALFileStorage::~WALFileStorage()
+{
+    shutdown();
+}
+
+bool WALFileStorage::init( const SInitSettings & _settings ){
+
+    if( _settings.directory.empty() ){
+        VS_LOG_ERROR << PRINT_HEADER << " journal directory is not set" << endl;
+        return false;
+    }
+
+    if( _settings.segmentMaxBytes <= 0 || _settings.groupCommitWindowMicrosec < 0 || _settings.checkpointEveryRecords < 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid segment size, group commit window or checkpoint interval" << endl;
+        return false;
+    }
+
+    if( 0 != ::mkdir(_settings.directory.c_str(), 0755) && errno != EEXIST ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot create dir [" << _settings.directory << "], reason: " << strerror(errno) << endl;
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    m_settings = _settings;
+
+    if( ! replay() ){
+        return false;
+    }
+    m_stats.currentSegment = m_segmentNum;
+
+    // encoder knows nothing about names interned before restart
+    resetEncoderStream();
+
+    VS_LOG_INFO << PRINT_HEADER << " inited in [" << m_settings.directory << "]"
+                << " segment: " << m_segmentNum
+                << " checkpoint sequence: " << m_checkpointSequence
+                << " last sequence: " << m_lastSequence
+                << " open operations: " << m_journal.operations.size()
+                << " process events: " << m_journal.processEvents.size()
+                << " registrations: " << m_journal.registrations.size()
+                << endl;
+
+    // long tail after previous checkpoint is compacted right away
+    m_inited = true;
+    if( m_settings.checkpointEveryRecords > 0 && m_recordsSinceCheckpoint >= m_settings.checkpointEveryRecords ){
+        m_commitInProgress = true;
+        makeCheckpoint( lock );
+        m_commitInProgress = false;
+    }
+
+    m_threadCommit = new std::thread( & WALFileStorage::threadCommit, this );
+    return true;
+}
+
+void WALFileStorage::shutdown(){
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutexJournal );
+        if( ! m_inited || m_shutdownCalled ){
+            return;
+        }
+        m_shutdownCalled = true;
+        m_cvCommit.notify_all();
+    }
+
+    // commit thread drains async records before exit
+    common_utils::threadShutdown( m_threadCommit );
+
+    // sync records have their waiters, so only the running commit matters
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    m_cvCommit.wait( lock, [ this ](){ return ! m_commitInProgress; } );
+
+    closeSegment();
+    m_journal = SJournalState();
+    m_inited = false;
+    m_shutdownCalled = false;
+}
+
+bool WALFileStorage::checkpoint(){
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    if( ! m_inited ){
+        return false;
+    }
+
+    // writers are held as during commit
+    m_cvCommit.wait( lock, [ this ](){ return ! m_commitInProgress; } );
+    m_commitInProgress = true;
+    const bool success = makeCheckpoint( lock );
+    m_commitInProgress = false;
+    m_cvCommit.notify_all();
+    return success;
+}
+
+WALFileStorage::SStats WALFileStorage::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexJournal );
+    SStats out = m_stats;
+    out.lastSequence = m_lastSequence;
+    out.lastCheckpointSequence = m_checkpointSequence;
+    return out;
+}
+
+// -------------------------------------------------------------------------------------
+// replication
+// -------------------------------------------------------------------------------------
+void WALFileStorage::addObserver( IWALFramesObserver * _observer ){
+
+    std::lock_guard<std::mutex> lock( m_mutexJournal );
+    m_observers.push_back( _observer );
+}
+
+void WALFileStorage::removeObserver( IWALFramesObserver * _observer ){
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+
+    // running leader may still call it
+    m_cvCommit.wait( lock, [ this ](){ return ! m_commitInProgress; } );
+    m_observers.erase( std::remove(m_observers.begin(), m_observers.end(), _observer), m_observers.end() );
+}
+
+bool WALFileStorage::makeReplicaCheckpoint( std::string & _checkpoint, uint64_t & _sequence ){
+
+    std::lock_guard<std::mutex> lock( m_mutexJournal );
+    if( ! m_inited || m_shutdownCalled ){
+        return false;
+    }
+
+    // as with own checkpoint: frames up to its sequence are skipped by standby
+    _sequence = m_lastSequence;
+    _checkpoint = snapshotJournal( _sequence );
+    resetEncoderStream();
+    return true;
+}
+
+bool WALFileStorage::loadReplicaCheckpoint( const std::string & _checkpoint ){
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    if( ! m_inited || m_shutdownCalled ){
+        VS_LOG_ERROR << PRINT_HEADER << " replica checkpoint to not inited journal" << endl;
+        return false;
+    }
+
+    // writers are held as during commit
+    m_cvCommit.wait( lock, [ this ](){ return ! m_commitInProgress; } );
+    if( m_pendingGroup->recordsCount > 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " replica checkpoint over not committed local records" << endl;
+        return false;
+    }
+
+    if( ! applyCheckpoint(_checkpoint, "replica") ){
+        return false;
+    }
+    const uint64_t sequence = m_checkpointSequence;
+    m_recordsSinceCheckpoint = 0;
+    m_replicaDecoder.reset();
+    m_pendingGroup = std::make_shared<SCommitGroup>();
+    resetEncoderStream();
+
+    // previous files may be ahead of primary, all of them are replaced
+    m_commitInProgress = true;
+    lock.unlock();
+    const bool success = writeCheckpoint( sequence, _checkpoint );
+    lock.lock();
+    m_commitInProgress = false;
+    m_cvCommit.notify_all();
+
+    if( success ){
+        m_stats.checkpointsCount++;
+        m_stats.currentSegment = m_segmentNum;
+        VS_LOG_INFO << PRINT_HEADER << " replica checkpoint at sequence [" << sequence << "]"
+                    << " open operations: " << m_journal.operations.size()
+                    << " process events: " << m_journal.processEvents.size()
+                    << " registrations: " << m_journal.registrations.size()
+                    << endl;
+    }
+    return success;
+}
+
+bool WALFileStorage::appendReplicated( const std::string & _frames ){
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    if( ! m_inited || m_shutdownCalled ){
+        VS_LOG_ERROR << PRINT_HEADER << " replicated append to not inited journal" << endl;
+        return false;
+    }
+
+    // frames up to the last sequence came before checkpoint of primary ( or twice )
+    bool decoded = true;
+    int64_t recordsCount = 0;
+    const size_t parsedBytes = parseFrames( reinterpret_cast<const uint8_t *>(_frames.data()), _frames.size(),
+                                            [ & ]( uint64_t _sequence, const uint8_t * _entry, size_t _size ){
+        const EEntryType type = (EEntryType)_entry[ 0 ];
+        if( EEntryType::DICTIONARY_RESET == type ){
+            m_replicaDecoder.reset();
+            return;
+        }
+        if( ! decoded || _sequence <= m_lastSequence ){
+            return;
+        }
+
+        if( EEntryType::RECORD_WRITE == type ){
+            SReplicaApplier applier( * this, _sequence );
+            decoded = m_replicaDecoder.decode( _entry + 1, _size - 1, & applier );
+        }
+        else{
+            enqueue( nullptr, std::string(reinterpret_cast<const char *>(_entry), _size), _sequence );
+        }
+        recordsCount++;
+    });
+
+    if( parsedBytes != _frames.size() || ! decoded ){
+        VS_LOG_ERROR << PRINT_HEADER << " malformed replicated frames, last sequence [" << m_lastSequence << "]" << endl;
+    }
+    m_stats.replicatedRecords += recordsCount;
+
+    bool success = ( parsedBytes == _frames.size() ) && decoded;
+    if( recordsCount > 0 ){
+        const PCommitGroup group = m_pendingGroup;
+        success = commit( lock, group ) && success;
+    }
+    return success;
+}
+
+// -------------------------------------------------------------------------------------
+// records
+// -------------------------------------------------------------------------------------
+bool WALFileStorage::write( const SWALClientOperation & _clientOperation ){
+
+    return append( & _clientOperation, std::string() );
+}
+
+void WALFileStorage::remove( SWALClientOperation::TUniqueKey _filter ){
+
+    std::string entry;
+    putLE<uint8_t>( entry, (uint8_t)EEntryType::OPERATION_REMOVE );
+    putString( entry, _filter );
+    append( nullptr, entry );
+}
+
+const std::vector<SWALClientOperation> WALFileStorage::readOperations( SWALClientOperation::TUniqueKey _filter ){
+
+    std::lock_guard<std::mutex> lock( m_mutexJournal );
+
+    // closed operation is removed, so every stored one is non integrity
+    std::map<uint64_t, const SWALClientOperation *> bySequence;
+    for( const auto & valuePair : m_journal.operations ){
+        if( SWALClientOperation::ALL_KEYS == _filter
+                || SWALClientOperation::NON_INTEGRITY_KEYS == _filter
+                || valuePair.first == _filter ){
+            bySequence.insert( {valuePair.second.first, & valuePair.second.second} );
+        }
+    }
+
+    std::vector<SWALClientOperation> out;
+    out.reserve( bySequence.size() );
+    for( const auto & valuePair : bySequence ){
+        out.push_back( * valuePair.second );
+    }
+    return out;
+}
+
+bool WALFileStorage::write( const SWALProcessEvent & _processEvent ){
+
+    return append( & _processEvent, std::string() );
+}
+
+void WALFileStorage::remove( SWALProcessEvent::TUniqueKey _filter ){
+
+    std::string entry;
+    putLE<uint8_t>( entry, (uint8_t)EEntryType::PROCESS_REMOVE );
+    putLE<int64_t>( entry, _filter );
+    append( nullptr, entry );
+}
+
+const std::vector<SWALProcessEvent> WALFileStorage::readEvents( SWALProcessEvent::TUniqueKey _filter ){
+
+    std::lock_guard<std::mutex> lock( m_mutexJournal );
+
+    std::vector<SWALProcessEvent> out;
+    if( SWALProcessEvent::NON_INTEGRITY_PIDS == _filter ){
+        // launch without stop - the only event of pid
+        std::unordered_map<TPid, int32_t> eventsByPid;
+        for( const auto & valuePair : m_journal.processEvents ){
+            eventsByPid[ valuePair.second.pid ]++;
+        }
+        for( const auto & valuePair : m_journal.processEvents ){
+            if( 1 == eventsByPid[ valuePair.second.pid ] ){
+                out.push_back( valuePair.second );
+            }
+        }
+        return out;
+    }
+
+    for( const auto & valuePair : m_journal.processEvents ){
+        if( SWALProcessEvent::ALL_PIDS == _filter || valuePair.second.pid == _filter ){
+            out.push_back( valuePair.second );
+        }
+    }
+    return out;
+}
+
+bool WALFileStorage::write( const SWALUserRegistration & _userRegistration ){
+
+    return append( & _userRegistration, std::string() );
+}
+
+void WALFileStorage::writeAsync( const SWALClientOperation & _clientOperation, TDurableCallback _callback ){
+
+    appendAsync( _clientOperation, _callback );
+}
+
+void WALFileStorage::writeAsync( const SWALProcessEvent & _processEvent, TDurableCallback _callback ){
+
+    appendAsync( _processEvent, _callback );
+}
+
+void WALFileStorage::writeAsync( const SWALUserRegistration & _userRegistration, TDurableCallback _callback ){
+
+    appendAsync( _userRegistration, _callback );
+}
+
+void WALFileStorage::removeRegistration( SWALUserRegistration::TRegisterId _filter ){
+
+    std::string entry;
+    putLE<uint8_t>( entry, (uint8_t)EEntryType::REGISTRATION_REMOVE );
+    putString( entry, _filter );
+    append( nullptr, entry );
+}
+
+const std::vector<SWALUserRegistration> WALFileStorage::readRegistrations( SWALUserRegistration::TRegisterId _filter ){
+
+    std::lock_guard<std::mutex> lock( m_mutexJournal );
+
+    std::vector<SWALUserRegistration> out;
+    for( const auto & valuePair : m_journal.registrations ){
+        if( SWALUserRegistration::ALL_IDS == _filter || valuePair.second.registerId == _filter ){
+            out.push_back( valuePair.second );
+        }
+    }
+    return out;
+}
+
+// -------------------------------------------------------------------------------------
+// group commit
+// -------------------------------------------------------------------------------------
+void WALFileStorage::enqueue( const SWALRecord * _record, const std::string & _removal, uint64_t _sequence ){
+
+    const uint64_t sequence = _sequence;
+    m_lastSequence = sequence;
+    m_pendingGroup->lastSequence = sequence;
+    m_pendingGroup->recordsCount++;
+    m_recordsSinceCheckpoint++;
+
+    SGroupEntry entry;
+    entry.sequence = sequence;
+    if( _record ){
+        SRecordCopier copier;
+        _record->accept( & copier );
+        entry.record = copier.copy;
+    }
+    else{
+        entry.removal = _removal;
+    }
+    encodeEntry( entry, m_pendingGroup->frames );
+    m_pendingGroup->entries.push_back( std::move(entry) );
+
+    // readers see the record right away, as with database upsert
+    if( _record ){
+        SJournalApplier applier( m_journal, sequence );
+        _record->accept( & applier );
+    }
+    else{
+        applyEntry( sequence, reinterpret_cast<const uint8_t *>(_removal.data()), _removal.size(), nullptr );
+    }
+}
+
+void WALFileStorage::resetEncoderStream(){
+
+    SGroupEntry entry;
+    entry.sequence = m_lastSequence;
+    entry.dictionaryReset = true;
+    encodeEntry( entry, m_pendingGroup->frames );
+    m_pendingGroup->entries.push_back( entry );
+    m_pendingGroup->lastSequence = m_lastSequence;
+}
+
+// encoded in sequence order: interned names refer to previous records of stream
+void WALFileStorage::encodeEntry( const SGroupEntry & _entry, std::string & _frames ){
+
+    if( _entry.dictionaryReset ){
+        m_encoder.reset();
+        m_entryBuffer.assign( 1, static_cast<char>(EEntryType::DICTIONARY_RESET) );
+        appendFrame( _frames, _entry.sequence, m_entryBuffer );
+    }
+    else if( _entry.record ){
+        m_entryBuffer.clear();
+        m_entryBuffer.push_back( static_cast<char>(EEntryType::RECORD_WRITE) );
+        m_encoder.encode( * _entry.record, m_entryBuffer );
+        appendFrame( _frames, _entry.sequence, m_entryBuffer );
+    }
+    else{
+        appendFrame( _frames, _entry.sequence, _entry.removal );
+    }
+}
+
+// names interned by the lost group are unknown for replay & standby, so pending records start new stream
+void WALFileStorage::encodePendingGroupAgain(){
+
+    std::vector<SGroupEntry> entries;
+    entries.swap( m_pendingGroup->entries );
+    m_pendingGroup->frames.clear();
+
+    SGroupEntry reset;
+    reset.dictionaryReset = true;
+    reset.sequence = m_lastSequence;
+    if( ! entries.empty() ){
+        reset.sequence = entries.front().dictionaryReset ? entries.front().sequence : entries.front().sequence - 1;
+    }
+    encodeEntry( reset, m_pendingGroup->frames );
+    m_pendingGroup->entries.push_back( reset );
+
+    for( SGroupEntry & entry : entries ){
+        encodeEntry( entry, m_pendingGroup->frames );
+        m_pendingGroup->entries.push_back( std::move(entry) );
+    }
+    m_pendingGroup->lastSequence = std::max( m_pendingGroup->lastSequence, reset.sequence );
+}
+
+bool WALFileStorage::append( const SWALRecord * _record, const std::string & _removal ){
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    if( ! m_inited || m_shutdownCalled ){
+        VS_LOG_ERROR << PRINT_HEADER << " append to not inited journal" << endl;
+        return false;
+    }
+
+    enqueue( _record, _removal, m_lastSequence + 1 );
+
+    const PCommitGroup group = m_pendingGroup;
+    return commit( lock, group );
+}
+
+void WALFileStorage::appendAsync( const SWALRecord & _record, TDurableCallback _callback ){
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    if( ! m_inited || m_shutdownCalled ){
+        lock.unlock();
+        VS_LOG_ERROR << PRINT_HEADER << " async append to not inited journal" << endl;
+        _callback( false );
+        return;
+    }
+
+    enqueue( & _record, std::string(), m_lastSequence + 1 );
+    m_pendingGroup->callbacks.push_back( _callback );
+    m_stats.asyncRecords++;
+    m_cvCommit.notify_all();
+}
+
+void WALFileStorage::threadCommit(){
+
+    VS_LOG_INFO << PRINT_HEADER << " commit thread started" << endl;
+
+    std::unique_lock<std::mutex> lock( m_mutexJournal );
+    while( true ){
+        m_cvCommit.wait( lock, [ this ](){ return m_shutdownCalled || ! m_pendingGroup->callbacks.empty(); } );
+
+        // sync writer may lead this group as well, then commit() just waits for it
+        if( ! m_pendingGroup->callbacks.empty() ){
+            const PCommitGroup group = m_pendingGroup;
+            commit( lock, group );
+        }
+        else if( m_shutdownCalled ){
+            break;
+        }
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " commit thread stopped" << endl;
+}
+
+bool WALFileStorage::commit( std::unique_lock<std::mutex> & _lock, const PCommitGroup & _group ){
+
+    while( ! _group->done ){
+        if( m_commitInProgress ){
+            m_cvCommit.wait( _lock );
+            continue;
+        }
+
+        // leader: takes every record appended so far, followers wait for its fsync
+        m_commitInProgress = true;
+        if( m_settings.groupCommitWindowMicrosec > 0 ){
+            _lock.unlock();
+            std::this_thread::sleep_for( std::chrono::microseconds(m_settings.groupCommitWindowMicrosec) );
+            _lock.lock();
+        }
+
+        const PCommitGroup leading = m_pendingGroup;
+        m_pendingGroup = std::make_shared<SCommitGroup>();
+        const std::vector<IWALFramesObserver *> observers = m_observers;
+
+        _lock.unlock();
+        const bool success = writeGroup( leading->frames );
+
+        // observers get only durable frames
+        if( success && ! leading->frames.empty() ){
+            for( IWALFramesObserver * observer : observers ){
+                observer->callbackFramesCommitted( leading->frames, leading->lastSequence );
+            }
+        }
+        _lock.lock();
+
+        m_stats.groupCommits++;
+        if( success ){
+            m_stats.recordsAppended += leading->recordsCount;
+            m_stats.bytesWritten += leading->frames.size();
+        }
+        else{
+            m_stats.commitErrors++;
+            encodePendingGroupAgain();
+        }
+        m_stats.currentSegment = m_segmentNum;
+
+        leading->success = success;
+        leading->done = true;
+        m_cvCommit.notify_all();
+
+        // followers are already released, only the leader pays for checkpoint
+        if( success && m_settings.checkpointEveryRecords > 0 && m_recordsSinceCheckpoint >= m_settings.checkpointEveryRecords ){
+            makeCheckpoint( _lock );
+        }
+
+        m_commitInProgress = false;
+        m_cvCommit.notify_all();
+
+        // outside of lock, callback may write to journal again
+        if( ! leading->callbacks.empty() ){
+            _lock.unlock();
+            for( const TDurableCallback & callback : leading->callbacks ){
+                callback( success );
+            }
+            _lock.lock();
+        }
+    }
+
+    return _group->success;
+}
+
+bool WALFileStorage::writeGroup( const std::string & _frames ){
+
+    // group is never split between segments
+    if( m_segmentBytes > 0 && m_segmentBytes + (int64_t)_frames.size() > m_settings.segmentMaxBytes ){
+        closeSegment();
+    }
+
+    if( m_segmentFd < 0 && ! openSegment(m_segmentNum + 1, true) ){
+        return false;
+    }
+
+    size_t written = 0;
+    while( written < _frames.size() ){
+        const ssize_t rt = ::write( m_segmentFd, _frames.data() + written, _frames.size() - written );
+        if( rt < 0 ){
+            if( EINTR == errno ){
+                continue;
+            }
+            VS_LOG_ERROR << PRINT_HEADER << " segment write failed, reason: " << strerror(errno) << endl;
+
+            // partial frame would stop replay of the following groups
+            if( 0 != ::ftruncate(m_segmentFd, m_segmentBytes) ){
+                VS_LOG_ERROR << PRINT_HEADER << " cannot cut partial group, reason: " << strerror(errno) << endl;
+            }
+            return false;
+        }
+        written += rt;
+    }
+    m_segmentBytes += written;
+
+    if( m_settings.syncOnCommit && 0 != ::fdatasync(m_segmentFd) ){
+        VS_LOG_ERROR << PRINT_HEADER << " segment sync failed, reason: " << strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
+
+bool WALFileStorage::openSegment( size_t _segmentNum, bool _create ){
+
+    const string path = makeFilePath( m_settings.directory, SEGMENT_FILE_PREFIX, SEGMENT_FILE_SUFFIX, _segmentNum );
+    const int fd = ::open( path.c_str(), _create ? (O_WRONLY | O_CREAT | O_TRUNC | O_APPEND) : (O_WRONLY | O_APPEND), 0644 );
+    if( fd < 0 ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot open segment [" << path << "], reason: " << strerror(errno) << endl;
+        return false;
+    }
+
+    struct stat st;
+    if( 0 != ::fstat(fd, & st) ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot stat segment [" << path << "], reason: " << strerror(errno) << endl;
+        ::close( fd );
+        return false;
+    }
+
+    if( _create ){
+        syncDirectory( m_settings.directory );
+    }
+
+    m_segmentFd = fd;
+    m_segmentNum = _segmentNum;
+    m_segmentBytes = st.st_size;
+    return true;
+}
+
+void WALFileStorage::closeSegment(){
+
+    if( m_segmentFd < 0 ){
+        return;
+    }
+
+    if( m_settings.syncOnCommit ){
+        ::fdatasync( m_segmentFd );
+    }
+    ::close( m_segmentFd );
+    m_segmentFd = -1;
+    m_segmentBytes = 0;
+}
+
+// -------------------------------------------------------------------------------------
+// checkpoint
+// -------------------------------------------------------------------------------------
+std::string WALFileStorage::snapshotJournal( uint64_t _sequence ) const {
+
+    // items keep their sequences, so order of records survives compaction.
+    // Checkpoint is own interning stream
+    wal_record_codec::WALRecordEncoder encoder;
+    std::string frames;
+    std::string entry;
+    uint64_t entriesCount = 0;
+    auto appendRecord = [ & ]( uint64_t _sequence, const SWALRecord & _record ){
+        entry.clear();
+        entry.push_back( static_cast<char>(EEntryType::RECORD_WRITE) );
+        encoder.encode( _record, entry );
+        appendFrame( frames, _sequence, entry );
+        entriesCount++;
+    };
+
+    for( const auto & valuePair : m_journal.operations ){
+        appendRecord( valuePair.second.first, valuePair.second.second );
+    }
+    for( const auto & valuePair : m_journal.processEvents ){
+        appendRecord( valuePair.first, valuePair.second );
+    }
+    for( const auto & valuePair : m_journal.registrations ){
+        appendRecord( valuePair.first, valuePair.second );
+    }
+
+    std::string out;
+    out.reserve( CHECKPOINT_HEADER_SIZE + frames.size() );
+    putLE<uint32_t>( out, CHECKPOINT_MAGIC );
+    putLE<uint32_t>( out, CHECKPOINT_VERSION );
+    putLE<uint64_t>( out, _sequence );
+    putLE<uint64_t>( out, entriesCount );
+    putLE<uint32_t>( out, crc32(reinterpret_cast<const uint8_t *>(out.data()), out.size()) );
+    out.append( frames );
+    return out;
+}
+
+bool WALFileStorage::makeCheckpoint( std::unique_lock<std::mutex> & _lock ){
+
+    // state may already contain records of pending group: they are in snapshot,
+    // and replay skips their frames by sequence
+    const uint64_t sequence = m_lastSequence;
+    const int64_t recordsSinceCheckpoint = m_recordsSinceCheckpoint;
+    const std::string snapshot = snapshotJournal( sequence );
+    m_recordsSinceCheckpoint = 0;
+
+    // records after checkpoint must not refer to names of removed segments
+    // ( marker keeps the stream right if checkpoint fails )
+    resetEncoderStream();
+
+    _lock.unlock();
+    const bool success = writeCheckpoint( sequence, snapshot );
+    _lock.lock();
+
+    if( success ){
+        m_checkpointSequence = sequence;
+        m_stats.checkpointsCount++;
+        m_stats.currentSegment = m_segmentNum;
+        VS_LOG_INFO << PRINT_HEADER << " checkpoint at sequence [" << sequence << "]"
+                    << " bytes: " << snapshot.size()
+                    << " compacted records: " << recordsSinceCheckpoint
+                    << endl;
+    }
+    else{
+        m_recordsSinceCheckpoint += recordsSinceCheckpoint;
+    }
+    return success;
+}
+
+// runs without lock, segment is owned by the caller as by commit leader
+bool WALFileStorage::writeCheckpoint( uint64_t _sequence, const std::string & _snapshot ){
+
+    const string path = makeFilePath( m_settings.directory, CHECKPOINT_FILE_PREFIX, CHECKPOINT_FILE_SUFFIX, _sequence );
+    const string pathTmp = path + ".tmp";
+
+    bool success = false;
+    const int fd = ::open( pathTmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( fd >= 0 ){
+        size_t written = 0;
+        while( written < _snapshot.size() ){
+            const ssize_t rt = ::write( fd, _snapshot.data() + written, _snapshot.size() - written );
+            if( rt < 0 && EINTR == errno ){
+                continue;
+            }
+            if( rt <= 0 ){
+                break;
+            }
+            written += rt;
+        }
+        success = ( written == _snapshot.size() ) && ( 0 == ::fsync(fd) );
+        success = ( 0 == ::close(fd) ) && success;
+    }
+
+    if( success && 0 == std::rename(pathTmp.c_str(), path.c_str()) ){
+        syncDirectory( m_settings.directory );
+
+        // everything before new segment is covered by checkpoint
+        closeSegment();
+        const size_t firstSegment = m_segmentNum + 1;
+        if( ! openSegment(firstSegment, true) ){
+            VS_LOG_WARN << PRINT_HEADER << " segment after checkpoint is not created, will try on next commit" << endl;
+        }
+        removeObsoleteFiles( firstSegment, _sequence );
+        return true;
+    }
+
+    VS_LOG_ERROR << PRINT_HEADER << " cannot write checkpoint [" << path << "], reason: " << strerror(errno) << endl;
+    std::remove( pathTmp.c_str() );
+    return false;
+}
+
+void WALFileStorage::removeObsoleteFiles( size_t _firstSegment, uint64_t _checkpointSequence ){
+
+    DIR * dir = ::opendir( m_settings.directory.c_str() );
+    if( ! dir ){
+        return;
+    }
+
+    std::vector<string> obsolete;
+    dirent * de = nullptr;
+    while( (de = ::readdir( dir )) != nullptr ){
+        uint64_t num = 0;
+        if( (parseFileName(de->d_name, SEGMENT_FILE_PREFIX, SEGMENT_FILE_SUFFIX, num) && num < _firstSegment)
+                || (parseFileName(de->d_name, CHECKPOINT_FILE_PREFIX, CHECKPOINT_FILE_SUFFIX, num) && num != _checkpointSequence) ){
+            obsolete.push_back( m_settings.directory + "/" + de->d_name );
+        }
+    }
+    ::closedir( dir );
+
+    for( const string & path : obsolete ){
+        if( 0 != std::remove(path.c_str()) ){
+            VS_LOG_WARN << PRINT_HEADER << " cannot remove [" << path << "], reason: " << strerror(errno) << endl;
+        }
+    }
+}
+
+bool WALFileStorage::loadCheckpoint( const std::string & _path ){
+
+    std::string content;
+    if( ! readFile(_path, content) ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot read checkpoint [" << _path << "]" << endl;
+        return false;
+    }
+    return applyCheckpoint( content, _path );
+}
+
+bool WALFileStorage::applyCheckpoint( const std::string & _content, const std::string & _name ){
+
+    const uint8_t * data = reinterpret_cast<const uint8_t *>( _content.data() );
+    SByteReader header( data, _content.size() );
+    const uint32_t magic = header.get<uint32_t>();
+    const uint32_t version = header.get<uint32_t>();
+    const uint64_t sequence = header.get<uint64_t>();
+    const uint64_t entriesCount = header.get<uint64_t>();
+    const uint32_t headerCrc = header.get<uint32_t>();
+
+    if( ! header.ok
+            || CHECKPOINT_MAGIC != magic
+            || 0 == version
+            || version > CHECKPOINT_VERSION
+            || crc32(data, CHECKPOINT_HEADER_SIZE - sizeof(uint32_t)) != headerCrc ){
+        VS_LOG_ERROR << PRINT_HEADER << " checkpoint [" << _name << "] has broken header" << endl;
+        return false;
+    }
+
+    SJournalState journal;
+    std::swap( journal, m_journal );
+
+    wal_record_codec::WALRecordDecoder decoder;
+    uint64_t parsedCount = 0;
+    const size_t parsedBytes = parseFrames( data + CHECKPOINT_HEADER_SIZE, _content.size() - CHECKPOINT_HEADER_SIZE,
+                                            [ this, & parsedCount, & decoder ]( uint64_t _sequence, const uint8_t * _entry, size_t _size ){
+        applyEntry( _sequence, _entry, _size, & decoder );
+        parsedCount++;
+    });
+
+    if( parsedBytes != _content.size() - CHECKPOINT_HEADER_SIZE || parsedCount != entriesCount ){
+        VS_LOG_ERROR << PRINT_HEADER << " checkpoint [" << _name << "] is corrupted" << endl;
+        std::swap( journal, m_journal );
+        return false;
+    }
+
+    m_checkpointSequence = sequence;
+    m_lastSequence = sequence;
+    return true;
+}
+
+// -------------------------------------------------------------------------------------
+// replay
+// -------------------------------------------------------------------------------------
+bool WALFileStorage::replay(){
+
+    DIR * dir = ::opendir( m_settings.directory.c_str() );
+    if( ! dir ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot open dir [" << m_settings.directory << "]" << endl;
+        return false;
+    }
+
+    std::map<uint64_t, string> pathsBySegment;
+    std::map<uint64_t, string> pathsByCheckpoint;
+    dirent * de = nullptr;
+    while( (de = ::readdir( dir )) != nullptr ){
+        uint64_t num = 0;
+        if( parseFileName(de->d_name, SEGMENT_FILE_PREFIX, SEGMENT_FILE_SUFFIX, num) ){
+            pathsBySegment[ num ] = m_settings.directory + "/" + de->d_name;
+        }
+        else if( parseFileName(de->d_name, CHECKPOINT_FILE_PREFIX, CHECKPOINT_FILE_SUFFIX, num) ){
+            pathsByCheckpoint[ num ] = m_settings.directory + "/" + de->d_name;
+        }
+    }
+    ::closedir( dir );
+
+    m_journal = SJournalState();
+    m_lastSequence = 0;
+    m_checkpointSequence = 0;
+    m_recordsSinceCheckpoint = 0;
+
+    // latest valid checkpoint, then only records after it
+    for( auto iter = pathsByCheckpoint.rbegin(); iter != pathsByCheckpoint.rend(); ++iter ){
+        if( loadCheckpoint(iter->second) ){
+            break;
+        }
+    }
+
+    // interned names point into previous segments, so all of them stay in memory until the end
+    wal_record_codec::WALRecordDecoder decoder;
+    std::list<std::string> contents;
+    for( auto iter = pathsBySegment.begin(); iter != pathsBySegment.end(); ++iter ){
+        const bool lastSegment = ( std::next(iter) == pathsBySegment.end() );
+        contents.emplace_back();
+        if( ! replaySegment(iter->second, lastSegment, decoder, contents.back()) ){
+            return false;
+        }
+    }
+
+    if( pathsBySegment.empty() ){
+        return openSegment( 1, true );
+    }
+    return openSegment( pathsBySegment.rbegin()->first, false );
+}
+
+bool WALFileStorage::replaySegment( const std::string & _path, bool _lastSegment, wal_record_codec::WALRecordDecoder & _decoder, std::string & _content ){
+
+    std::string & content = _content;
+    if( ! readFile(_path, content) ){
+        VS_LOG_ERROR << PRINT_HEADER << " cannot read segment [" << _path << "]" << endl;
+        return false;
+    }
+
+    const size_t offset = parseFrames( reinterpret_cast<const uint8_t *>(content.data()), content.size(),
+                                       [ this, & _decoder ]( uint64_t _sequence, const uint8_t * _entry, size_t _size ){
+        // covered by checkpoint ( stream of such records is already reset )
+        if( _sequence <= m_checkpointSequence ){
+            return;
+        }
+        applyEntry( _sequence, _entry, _size, & _decoder );
+        if( _sequence > m_lastSequence ){
+            m_lastSequence = _sequence;
+            m_recordsSinceCheckpoint++;
+        }
+    });
+
+    if( offset == content.size() ){
+        return true;
+    }
+
+    // torn tail of crashed commit - it was never acknowledged, so just cut it
+    if( _lastSegment ){
+        VS_LOG_WARN << PRINT_HEADER << " segment [" << _path << "] has broken tail at [" << offset << "]"
+                    << " of [" << content.size() << "] bytes, cut it"
+                    << endl;
+        if( 0 != ::truncate(_path.c_str(), offset) ){
+            VS_LOG_ERROR << PRINT_HEADER << " cannot cut segment [" << _path << "], reason: " << strerror(errno) << endl;
+            return false;
+        }
+        return true;
+    }
+
+    VS_LOG_ERROR << PRINT_HEADER << " segment [" << _path << "] is corrupted at [" << offset << "]"
+                 << " of [" << content.size() << "] bytes, rest of segment is skipped"
+                 << endl;
+    return true;
+}
+
+// decoder is needed only for records ( removals are applied at enqueue without it )
+void WALFileStorage::applyEntry( uint64_t _sequence, const uint8_t * _entry, size_t _size, wal_record_codec::WALRecordDecoder * _decoder ){
+
+    SByteReader reader( _entry, _size );
+    const EEntryType type = (EEntryType)reader.get<uint8_t>();
+
+    switch( type ){
+    case EEntryType::RECORD_WRITE : {
+        SJournalApplier applier( m_journal, _sequence );
+        reader.ok = reader.ok && _decoder && _decoder->decode( _entry + 1, _size - 1, & applier );
+        break;
+    }
+    case EEntryType::DICTIONARY_RESET : {
+        if( _decoder ){
+            _decoder->reset();
+        }
+        break;
+    }
+    case EEntryType::OPERATION_WRITE : {
+        SWALClientOperation operation;
+        operation.uniqueKey = reader.getString();
+        operation.begin = reader.get<uint8_t>();
+        operation.commandFullText = reader.getString();
+        if( reader.ok ){
+            m_journal.apply( _sequence, operation );
+        }
+        break;
+    }
+    case EEntryType::OPERATION_REMOVE : {
+        const SWALClientOperation::TUniqueKey key = reader.getString();
+        if( reader.ok ){
+            m_journal.removeOperations( key );
+        }
+        break;
+    }
+    case EEntryType::PROCESS_WRITE : {
+        SWALProcessEvent event;
+        event.pid = (TPid)reader.get<int64_t>();
+        event.begin = reader.get<uint8_t>();
+        event.programName = reader.getString();
+        const uint32_t argsCount = reader.get<uint32_t>();
+        for( uint32_t i = 0; i < argsCount && reader.ok; i++ ){
+            event.programArgs.push_back( reader.getString() );
+        }
+        if( reader.ok ){
+            m_journal.apply( _sequence, event );
+        }
+        break;
+    }
+    case EEntryType::PROCESS_REMOVE : {
+        const TPid pid = (TPid)reader.get<int64_t>();
+        if( reader.ok ){
+            m_journal.removeProcessEvents( pid );
+        }
+        break;
+    }
+    case EEntryType::REGISTRATION_WRITE : {
+        SWALUserRegistration registration;
+        registration.registerId = reader.getString();
+        registration.userIp = reader.getString();
+        registration.userPid = (TPid)reader.get<int64_t>();
+        registration.registeredAtDateTime = reader.getString();
+        if( reader.ok ){
+            m_journal.apply( _sequence, registration );
+        }
+        break;
+    }
+    case EEntryType::REGISTRATION_REMOVE : {
+        const SWALUserRegistration::TRegisterId id = reader.getString();
+        if( reader.ok ){
+            m_journal.removeRegistrations( id );
+        }
+        break;
+    }
+    default : {
+        reader.ok = false;
+    }
+    }
+
+    if( ! reader.ok ){
+        VS_LOG_ERROR << PRINT_HEADER << " malformed entry, sequence [" << _sequence << "] type [" << (int)type << "]" << endl;
+    }
+}
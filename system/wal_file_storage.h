@@ -0,0 +1,214 @@
+#ifndef WAL_FILE_STORAGE_H
+#define WAL_FILE_STORAGE_H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "common/ms_common_types.h"
+#include "wal_record_codec.h"
+
+// WAL persistence without database: records are appended to local segment files
+// ( length + CRC-32 framed ), concurrent writers share one fsync ( group commit ).
+// Async records are committed by own thread together with synchronous ones.
+// Records are stored in wal_record_codec form, segments after checkpoint are one interning stream
+// Open operations, processes & registrations are kept in memory and rebuilt by replay on init
+// from the latest checkpoint ( snapshot of open items ) and segments written after it
+
+// receives frames of every committed group in commit order
+// ( called by commit leader outside of journal lock, must not write to the journal )
+class IWALFramesObserver {
+public:
+    virtual ~IWALFramesObserver(){}
+
+    virtual void callbackFramesCommitted( const std::string & _frames, uint64_t _lastSequence ) = 0;
+};
+
+class WALFileStorage : public common_types::IWALPersistenceService
+{
+public:
+    struct SInitSettings {
+        SInitSettings()
+            : segmentMaxBytes( 16 * 1024 * 1024 )
+            , groupCommitWindowMicrosec(0)
+            , syncOnCommit(true)
+            , checkpointEveryRecords(10000)
+        {}
+        std::string directory;
+        int64_t segmentMaxBytes; // next segment is started when current one exceeds it
+        int32_t groupCommitWindowMicrosec; // commit leader waits for more writers ( 0 - only those came during previous fsync )
+        bool syncOnCommit; // false - record is durable only against process crash
+        int64_t checkpointEveryRecords; // 0 - only by checkpoint() call
+    };
+
+    struct SStats {
+        SStats()
+            : recordsAppended(0)
+            , asyncRecords(0)
+            , groupCommits(0)
+            , commitErrors(0)
+            , bytesWritten(0)
+            , currentSegment(0)
+            , checkpointsCount(0)
+            , replicatedRecords(0)
+            , lastSequence(0)
+            , lastCheckpointSequence(0)
+        {}
+        int64_t recordsAppended;
+        int64_t asyncRecords;
+        int64_t groupCommits;
+        int64_t commitErrors;
+        int64_t bytesWritten;
+        uint64_t currentSegment;
+        int64_t checkpointsCount;
+        int64_t replicatedRecords;
+        uint64_t lastSequence;
+        uint64_t lastCheckpointSequence;
+    };
+
+    WALFileStorage();
+    ~WALFileStorage();
+
+    bool init( const SInitSettings & _settings );
+    void shutdown();
+
+    // writes snapshot of open items and drops segments before it
+    bool checkpoint();
+    SStats getStats();
+
+    // replication, primary side: checkpoint image of current state,
+    // frames committed after it start new interning stream
+    void addObserver( IWALFramesObserver * _observer );
+    void removeObserver( IWALFramesObserver * _observer );
+    bool makeReplicaCheckpoint( std::string & _checkpoint, uint64_t & _sequence );
+
+    // replication, standby side: state is replaced by checkpoint of primary,
+    // then its frames are appended with the same sequences ( true - durable here )
+    bool loadReplicaCheckpoint( const std::string & _checkpoint );
+    bool appendReplicated( const std::string & _frames );
+
+    // client operation
+    virtual bool write( const common_types::SWALClientOperation & _clientOperation ) override;
+    virtual void remove( common_types::SWALClientOperation::TUniqueKey _filter ) override;
+    virtual const std::vector<common_types::SWALClientOperation> readOperations( common_types::SWALClientOperation::TUniqueKey _filter ) override;
+
+    // child process
+    virtual bool write( const common_types::SWALProcessEvent & _processEvent ) override;
+    virtual void remove( common_types::SWALProcessEvent::TUniqueKey _filter ) override;
+    virtual const std::vector<common_types::SWALProcessEvent> readEvents( common_types::SWALProcessEvent::TUniqueKey _filter ) override;
+
+    // user registration
+    virtual bool write( const common_types::SWALUserRegistration & _userRegistration ) override;
+    virtual void removeRegistration( common_types::SWALUserRegistration::TRegisterId _filter ) override;
+    virtual const std::vector<common_types::SWALUserRegistration> readRegistrations( common_types::SWALUserRegistration::TRegisterId _filter ) override;
+
+    // callback is fired from commit leader thread, record is visible for reads right away
+    virtual void writeAsync( const common_types::SWALClientOperation & _clientOperation, TDurableCallback _callback ) override;
+    virtual void writeAsync( const common_types::SWALProcessEvent & _processEvent, TDurableCallback _callback ) override;
+    virtual void writeAsync( const common_types::SWALUserRegistration & _userRegistration, TDurableCallback _callback ) override;
+
+
+private:
+    // source of one frame, kept until the group is written ( to encode it again after failed write )
+    struct SGroupEntry {
+        SGroupEntry()
+            : sequence(0)
+            , dictionaryReset(false)
+        {}
+        uint64_t sequence;
+        std::shared_ptr<const common_types::SWALRecord> record;
+        std::string removal;
+        bool dictionaryReset;
+    };
+
+    // records of one fsync
+    struct SCommitGroup {
+        SCommitGroup()
+            : recordsCount(0)
+            , lastSequence(0)
+            , done(false)
+            , success(false)
+        {}
+        std::string frames;
+        std::vector<SGroupEntry> entries;
+        std::vector<TDurableCallback> callbacks;
+        int64_t recordsCount;
+        uint64_t lastSequence;
+        bool done;
+        bool success;
+    };
+    using PCommitGroup = std::shared_ptr<SCommitGroup>;
+
+    // current content of journal, values are ordered by sequence
+    struct SJournalState {
+        void apply( uint64_t _sequence, const common_types::SWALClientOperation & _operation );
+        void apply( uint64_t _sequence, const common_types::SWALProcessEvent & _event );
+        void apply( uint64_t _sequence, const common_types::SWALUserRegistration & _registration );
+        void removeOperations( const common_types::SWALClientOperation::TUniqueKey & _filter );
+        void removeProcessEvents( common_types::TPid _filter );
+        void removeRegistrations( const common_types::SWALUserRegistration::TRegisterId & _filter );
+
+        std::unordered_map<common_types::SWALClientOperation::TUniqueKey, std::pair<uint64_t, common_types::SWALClientOperation>> operations;
+        std::map<uint64_t, common_types::SWALProcessEvent> processEvents;
+        std::map<uint64_t, common_types::SWALUserRegistration> registrations;
+    };
+    struct SJournalApplier;
+    struct SReplicaApplier;
+    struct SRecordCopier;
+
+    void enqueue( const common_types::SWALRecord * _record, const std::string & _removal, uint64_t _sequence );
+    void resetEncoderStream();
+    void encodeEntry( const SGroupEntry & _entry, std::string & _frames );
+    void encodePendingGroupAgain();
+    bool append( const common_types::SWALRecord * _record, const std::string & _removal );
+    void appendAsync( const common_types::SWALRecord & _record, TDurableCallback _callback );
+    void threadCommit();
+    bool commit( std::unique_lock<std::mutex> & _lock, const PCommitGroup & _group );
+    bool writeGroup( const std::string & _frames );
+    bool openSegment( size_t _segmentNum, bool _create );
+    void closeSegment();
+
+    std::string snapshotJournal( uint64_t _sequence ) const;
+    bool makeCheckpoint( std::unique_lock<std::mutex> & _lock );
+    bool writeCheckpoint( uint64_t _sequence, const std::string & _snapshot );
+    void removeObsoleteFiles( size_t _firstSegment, uint64_t _checkpointSequence );
+    bool loadCheckpoint( const std::string & _path );
+    bool applyCheckpoint( const std::string & _content, const std::string & _name );
+
+    bool replay();
+    bool replaySegment( const std::string & _path, bool _lastSegment, wal_record_codec::WALRecordDecoder & _decoder, std::string & _content );
+    void applyEntry( uint64_t _sequence, const uint8_t * _entry, size_t _size, wal_record_codec::WALRecordDecoder * _decoder );
+
+    // data
+    SInitSettings m_settings;
+    SJournalState m_journal;
+    SStats m_stats;
+    uint64_t m_lastSequence;
+    uint64_t m_checkpointSequence;
+    int64_t m_recordsSinceCheckpoint;
+    PCommitGroup m_pendingGroup;
+    wal_record_codec::WALRecordEncoder m_encoder;
+    wal_record_codec::WALRecordDecoder m_replicaDecoder;
+    std::string m_entryBuffer;
+    std::vector<IWALFramesObserver *> m_observers;
+    bool m_commitInProgress;
+    bool m_inited;
+    bool m_shutdownCalled;
+
+    // segment is touched only by commit leader ( or under lock when no commit is running )
+    int m_segmentFd;
+    size_t m_segmentNum;
+    int64_t m_segmentBytes;
+
+    // service
+    std::mutex m_mutexJournal;
+    std::condition_variable m_cvCommit;
+    std::thread * m_threadCommit;
+};
+
+#endif // WAL_FILE_STORAGE_H
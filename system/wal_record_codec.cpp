@@ -0,0 +1,335 @@
+#include "wal_record_codec.h"
+
+using namespace std;
+using namespace common_types;
+
+namespace wal_record_codec {
+
+enum class ERecordType : uint8_t {
+    CLIENT_OPERATION = 1,
+    PROCESS_EVENT,
+    USER_REGISTRATION,
+    ONCE_MORE
+};
+
+static constexpr size_t VARINT_MAX_BYTES = 10;
+
+static inline uint8_t makeHeader( ERecordType _type ){
+    return (uint8_t)( (FORMAT_VERSION << 4) | (uint8_t)_type );
+}
+
+static inline uint64_t zigzag( int64_t _value ){
+    return ( (uint64_t)_value << 1 ) ^ (uint64_t)( _value >> 63 );
+}
+
+static inline int64_t unzigzag( uint64_t _value ){
+    return (int64_t)( _value >> 1 ) ^ -(int64_t)( _value & 1 );
+}
+
+static inline void putVarint( std::string & _out, uint64_t _value ){
+
+    while( _value >= 0x80 ){
+        _out.push_back( static_cast<char>((_value & 0x7F) | 0x80) );
+        _value >>= 7;
+    }
+    _out.push_back( static_cast<char>(_value) );
+}
+
+static inline void putString( std::string & _out, const std::string & _value ){
+    putVarint( _out, _value.size() );
+    _out.append( _value );
+}
+
+static inline bool getVarint( const uint8_t * & _pos, const uint8_t * _end, uint64_t & _out ){
+
+    _out = 0;
+    for( size_t i = 0; i < VARINT_MAX_BYTES && _pos < _end; i++ ){
+        const uint8_t byte = * _pos++;
+        _out |= (uint64_t)( byte & 0x7F ) << ( 7 * i );
+        if( ! (byte & 0x80) ){
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool getString( const uint8_t * & _pos, const uint8_t * _end, SStringView & _out ){
+
+    uint64_t size = 0;
+    if( ! getVarint(_pos, _end, size) || size > (uint64_t)(_end - _pos) ){
+        return false;
+    }
+
+    _out.data = reinterpret_cast<const char *>( _pos );
+    _out.size = (uint32_t)size;
+    _pos += size;
+    return true;
+}
+
+static inline bool getByte( const uint8_t * & _pos, const uint8_t * _end, uint8_t & _out ){
+
+    if( _pos >= _end ){
+        return false;
+    }
+    _out = * _pos++;
+    return true;
+}
+
+// -------------------------------------------------------------------------------------
+// views
+// -------------------------------------------------------------------------------------
+std::vector<std::string> SArgsView::toVector() const {
+
+    std::vector<std::string> out;
+    out.reserve( count );
+
+    const uint8_t * pos = data;
+    const uint8_t * end = data + size;
+    SStringView arg;
+    for( uint32_t i = 0; i < count && getString(pos, end, arg); i++ ){
+        out.push_back( arg.str() );
+    }
+    return out;
+}
+
+SWALClientOperation SClientOperationView::toRecord() const {
+
+    SWALClientOperation out;
+    out.uniqueKey = uniqueKey.str();
+    out.begin = begin;
+    out.commandFullText = commandFullText.str();
+    return out;
+}
+
+SWALProcessEvent SProcessEventView::toRecord() const {
+
+    SWALProcessEvent out;
+    out.pid = pid;
+    out.begin = begin;
+    out.programName = programName.str();
+    out.programArgs = programArgs.toVector();
+    return out;
+}
+
+SWALUserRegistration SUserRegistrationView::toRecord() const {
+
+    SWALUserRegistration out;
+    out.registerId = registerId.str();
+    out.userIp = userIp.str();
+    out.userPid = userPid;
+    out.registeredAtDateTime = registeredAtDateTime.str();
+    return out;
+}
+
+// -------------------------------------------------------------------------------------
+// encoder
+// -------------------------------------------------------------------------------------
+WALRecordEncoder::WALRecordEncoder( uint32_t _dictionaryCapacity )
+    : m_dictionaryCapacity(_dictionaryCapacity)
+    , m_out(nullptr)
+{
+
+}
+
+void WALRecordEncoder::encode( const SWALRecord & _record, std::string & _out ){
+
+    m_out = & _out;
+    _record.accept( this );
+    m_out = nullptr;
+}
+
+void WALRecordEncoder::reset(){
+
+    m_dictionary.clear();
+}
+
+void WALRecordEncoder::visit( const SWALClientOperation * _record ){
+
+    m_out->push_back( static_cast<char>(makeHeader(ERecordType::CLIENT_OPERATION)) );
+    putString( * m_out, _record->uniqueKey );
+    m_out->push_back( static_cast<char>(_record->begin) );
+    putString( * m_out, _record->commandFullText );
+}
+
+void WALRecordEncoder::visit( const SWALProcessEvent * _record ){
+
+    m_out->push_back( static_cast<char>(makeHeader(ERecordType::PROCESS_EVENT)) );
+    putVarint( * m_out, zigzag(_record->pid) );
+    m_out->push_back( static_cast<char>(_record->begin) );
+    putInterned( _record->programName );
+
+    // the same program is usually launched with the same args
+    m_argsBuffer.clear();
+    putVarint( m_argsBuffer, _record->programArgs.size() );
+    for( const std::string & arg : _record->programArgs ){
+        putString( m_argsBuffer, arg );
+    }
+    putInterned( m_argsBuffer );
+}
+
+void WALRecordEncoder::visit( const SWALUserRegistration * _record ){
+
+    m_out->push_back( static_cast<char>(makeHeader(ERecordType::USER_REGISTRATION)) );
+    putString( * m_out, _record->registerId );
+    putString( * m_out, _record->userIp );
+    putVarint( * m_out, zigzag(_record->userPid) );
+    putString( * m_out, _record->registeredAtDateTime );
+}
+
+void WALRecordEncoder::visit( const SWALOnceMoreRecord * _record ){
+
+    m_out->push_back( static_cast<char>(makeHeader(ERecordType::ONCE_MORE)) );
+}
+
+// tag: ( id << 1 ) - dictionary reference, ( size << 1 | 1 ) - literal, added to dictionary while it has space
+void WALRecordEncoder::putInterned( const std::string & _value ){
+
+    auto iter = m_dictionary.find( _value );
+    if( iter != m_dictionary.end() ){
+        putVarint( * m_out, (uint64_t)iter->second << 1 );
+        return;
+    }
+
+    putVarint( * m_out, ((uint64_t)_value.size() << 1) | 1 );
+    m_out->append( _value );
+
+    if( m_dictionary.size() < m_dictionaryCapacity ){
+        const uint32_t id = m_dictionary.size();
+        m_dictionary.insert( {_value, id} );
+    }
+}
+
+// -------------------------------------------------------------------------------------
+// decoder
+// -------------------------------------------------------------------------------------
+WALRecordDecoder::WALRecordDecoder( uint32_t _dictionaryCapacity, bool _copyInterned )
+    : m_dictionaryCapacity(_dictionaryCapacity)
+    , m_copyInterned(_copyInterned)
+{
+    m_dictionary.reserve( m_dictionaryCapacity );
+}
+
+void WALRecordDecoder::reset(){
+
+    m_dictionary.clear();
+    m_internedCopies.clear();
+}
+
+bool WALRecordDecoder::getInterned( const uint8_t * & _pos, const uint8_t * _end, SBlob & _out ){
+
+    uint64_t tag = 0;
+    if( ! getVarint(_pos, _end, tag) ){
+        return false;
+    }
+
+    if( tag & 1 ){
+        const uint64_t size = tag >> 1;
+        if( size > (uint64_t)(_end - _pos) ){
+            return false;
+        }
+
+        _out.data = _pos;
+        _out.size = (uint32_t)size;
+        _pos += size;
+
+        if( m_dictionary.size() < m_dictionaryCapacity ){
+            if( m_copyInterned ){
+                // deque keeps addresses of strings
+                m_internedCopies.emplace_back( reinterpret_cast<const char *>(_out.data), _out.size );
+                _out.data = reinterpret_cast<const uint8_t *>( m_internedCopies.back().data() );
+            }
+            m_dictionary.push_back( _out );
+        }
+        return true;
+    }
+
+    const uint64_t id = tag >> 1;
+    if( id >= m_dictionary.size() ){
+        return false;
+    }
+    _out = m_dictionary[ id ];
+    return true;
+}
+
+bool WALRecordDecoder::decode( const uint8_t * _data, size_t _size, IRecordViewVisitor * _visitor ){
+
+    const uint8_t * pos = _data;
+    const uint8_t * end = _data + _size;
+
+    uint8_t header = 0;
+    if( ! getByte(pos, end, header) || (header >> 4) != FORMAT_VERSION ){
+        return false;
+    }
+
+    uint8_t flag = 0;
+    uint64_t value = 0;
+    switch( (ERecordType)(header & 0x0F) ){
+    case ERecordType::CLIENT_OPERATION : {
+        SClientOperationView record;
+        if( ! getString(pos, end, record.uniqueKey)
+                || ! getByte(pos, end, flag)
+                || ! getString(pos, end, record.commandFullText) ){
+            return false;
+        }
+        record.begin = flag;
+        _visitor->visit( record );
+        return true;
+    }
+    case ERecordType::PROCESS_EVENT : {
+        SProcessEventView record;
+        SBlob name;
+        SBlob args;
+        if( ! getVarint(pos, end, value)
+                || ! getByte(pos, end, flag)
+                || ! getInterned(pos, end, name)
+                || ! getInterned(pos, end, args) ){
+            return false;
+        }
+        record.pid = (TPid)unzigzag( value );
+        record.begin = flag;
+        record.programName.data = reinterpret_cast<const char *>( name.data );
+        record.programName.size = name.size;
+
+        // args are checked here, so toVector() never meets broken data
+        const uint8_t * argsPos = args.data;
+        const uint8_t * argsEnd = args.data + args.size;
+        uint64_t count = 0;
+        if( ! getVarint(argsPos, argsEnd, count) ){
+            return false;
+        }
+        record.programArgs.data = argsPos;
+        record.programArgs.size = (uint32_t)( argsEnd - argsPos );
+        record.programArgs.count = (uint32_t)count;
+
+        SStringView arg;
+        for( uint64_t i = 0; i < count; i++ ){
+            if( ! getString(argsPos, argsEnd, arg) ){
+                return false;
+            }
+        }
+
+        _visitor->visit( record );
+        return true;
+    }
+    case ERecordType::USER_REGISTRATION : {
+        SUserRegistrationView record;
+        if( ! getString(pos, end, record.registerId)
+                || ! getString(pos, end, record.userIp)
+                || ! getVarint(pos, end, value)
+                || ! getString(pos, end, record.registeredAtDateTime) ){
+            return false;
+        }
+        record.userPid = (TPid)unzigzag( value );
+        _visitor->visit( record );
+        return true;
+    }
+    case ERecordType::ONCE_MORE : {
+        return true;
+    }
+    default : {
+        return false;
+    }
+    }
+}
+
+} // wal_record_codec
@@ -0,0 +1,137 @@
+#ifndef WAL_RECORD_CODEC_H
+#define WAL_RECORD_CODEC_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "common/ms_common_types.h"
+
+// binary form of WAL records ( journal files & replication stream ):
+//   header byte ( version << 4 | record type ), varint lengths, zigzag varint integers.
+// Program names & argument vectors are interned per stream: first occurrence is literal,
+// next ones are dictionary ids. Encoder & decoder of one stream must see the same records in the same order,
+// reset() starts a new stream
+namespace wal_record_codec {
+
+static constexpr uint8_t FORMAT_VERSION = 1;
+static constexpr uint32_t DEFAULT_DICTIONARY_CAPACITY = 4096;
+
+// view into decoded buffer, valid while the buffer is alive
+struct SStringView {
+    SStringView()
+        : data(nullptr)
+        , size(0)
+    {}
+    std::string str() const { return std::string( data, size ); }
+    bool operator==( const std::string & _rhs ) const { return _rhs.size() == size && 0 == _rhs.compare( 0, size, data, size ); }
+
+    const char * data;
+    uint32_t size;
+};
+
+// encoded argument vector: varint count, then length-prefixed args
+struct SArgsView {
+    SArgsView()
+        : data(nullptr)
+        , size(0)
+        , count(0)
+    {}
+    std::vector<std::string> toVector() const;
+
+    const uint8_t * data;
+    uint32_t size;
+    uint32_t count;
+};
+
+struct SClientOperationView {
+    SStringView uniqueKey;
+    bool begin;
+    SStringView commandFullText;
+
+    common_types::SWALClientOperation toRecord() const;
+};
+
+struct SProcessEventView {
+    common_types::TPid pid;
+    bool begin;
+    SStringView programName;
+    SArgsView programArgs;
+
+    common_types::SWALProcessEvent toRecord() const;
+};
+
+struct SUserRegistrationView {
+    SStringView registerId;
+    SStringView userIp;
+    common_types::TPid userPid;
+    SStringView registeredAtDateTime;
+
+    common_types::SWALUserRegistration toRecord() const;
+};
+
+class IRecordViewVisitor {
+public:
+    virtual ~IRecordViewVisitor(){}
+
+    virtual void visit( const SClientOperationView & _record ) = 0;
+    virtual void visit( const SProcessEventView & _record ) = 0;
+    virtual void visit( const SUserRegistrationView & _record ) = 0;
+};
+
+class WALRecordEncoder : public common_types::IWALRecordVisitor
+{
+public:
+    WALRecordEncoder( uint32_t _dictionaryCapacity = DEFAULT_DICTIONARY_CAPACITY );
+
+    // appends encoded record to '_out'
+    void encode( const common_types::SWALRecord & _record, std::string & _out );
+    void reset();
+
+
+private:
+    virtual void visit( const common_types::SWALClientOperation * _record ) override;
+    virtual void visit( const common_types::SWALProcessEvent * _record ) override;
+    virtual void visit( const common_types::SWALUserRegistration * _record ) override;
+    virtual void visit( const common_types::SWALOnceMoreRecord * _record ) override;
+
+    void putInterned( const std::string & _value );
+
+    // data
+    const uint32_t m_dictionaryCapacity;
+    std::unordered_map<std::string, uint32_t> m_dictionary;
+    std::string * m_out;
+    std::string m_argsBuffer;
+};
+
+class WALRecordDecoder
+{
+public:
+    // '_copyInterned' - interned values are copied, so previous records of the stream may be freed
+    // ( only new dictionary entries allocate )
+    WALRecordDecoder( uint32_t _dictionaryCapacity = DEFAULT_DICTIONARY_CAPACITY, bool _copyInterned = false );
+
+    // one pass, no allocation: views point into '_data' ( and into previous records of the stream )
+    bool decode( const uint8_t * _data, size_t _size, IRecordViewVisitor * _visitor );
+    void reset();
+
+
+private:
+    struct SBlob {
+        const uint8_t * data;
+        uint32_t size;
+    };
+
+    bool getInterned( const uint8_t * & _pos, const uint8_t * _end, SBlob & _out );
+
+    // data
+    const uint32_t m_dictionaryCapacity;
+    const bool m_copyInterned;
+    std::vector<SBlob> m_dictionary;
+    std::deque<std::string> m_internedCopies;
+};
+
+} // wal_record_codec
+
+#endif // WAL_RECORD_CODEC_H
@@ -0,0 +1,558 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <type_traits>
+
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "common/ms_common_utils.h"
+#include "logger.h"
+#include "wal_replication.h"
+
+using namespace std;
+
+static constexpr const char * PRINT_HEADER = "WALReplication:";
+static constexpr uint32_t PROTOCOL_VERSION = 1;
+static constexpr uint32_t MESSAGE_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+static constexpr uint32_t MESSAGE_MAX_SIZE = 512 * 1024 * 1024;
+
+// message: size of type & payload, type, payload ( little endian )
+enum class EMessageType : uint8_t {
+    HELLO = 1, // standby -> primary: protocol version
+    CHECKPOINT, // primary -> standby: checkpoint image
+    FRAMES, // primary -> standby: committed frames of one or more groups
+    ACK // standby -> primary: last durable sequence
+};
+
+template< typename T >
+static void putLE( std::string & _out, T _value ){
+
+    using TUnsigned = typename std::make_unsigned<T>::type;
+    uint64_t value = static_cast<TUnsigned>( _value );
+    for( size_t i = 0; i < sizeof(T); i++ ){
+        _out.push_back( static_cast<char>(value & 0xFF) );
+        value >>= 8;
+    }
+}
+
+template< typename T >
+static T getLE( const char * _data ){
+
+    uint64_t value = 0;
+    for( size_t i = 0; i < sizeof(T); i++ ){
+        value |= (uint64_t)(uint8_t)_data[ i ] << ( 8 * i );
+    }
+    return static_cast<T>( value );
+}
+
+// -1 - error, 0 - timeout, 1 - readable
+static int waitReadable( int _socketDscr, int32_t _timeoutMillisec ){
+
+    struct timeval timeout;
+    timeout.tv_sec = _timeoutMillisec / 1000;
+    timeout.tv_usec = ( _timeoutMillisec % 1000 ) * 1000;
+    fd_set readfds;
+    FD_ZERO( & readfds );
+    FD_SET( _socketDscr, & readfds );
+
+    const int readyDescrCount = ::select( _socketDscr + 1, & readfds, NULL, NULL, & timeout );
+    if( readyDescrCount < 0 ){
+        return ( EINTR == errno ) ? 0 : -1;
+    }
+    return ( readyDescrCount > 0 ) ? 1 : 0;
+}
+
+static bool sendAll( int _socketDscr, const char * _data, size_t _size ){
+
+    size_t sent = 0;
+    while( sent < _size ){
+        const ssize_t rt = ::send( _socketDscr, _data + sent, _size - sent, MSG_NOSIGNAL );
+        if( rt < 0 && EINTR == errno ){
+            continue;
+        }
+        if( rt <= 0 ){
+            return false;
+        }
+        sent += rt;
+    }
+    return true;
+}
+
+static bool sendMessage( int _socketDscr, EMessageType _type, const std::string & _payload ){
+
+    std::string header;
+    putLE<uint32_t>( header, (uint32_t)(_payload.size() + sizeof(uint8_t)) );
+    putLE<uint8_t>( header, (uint8_t)_type );
+
+    if( ! sendAll(_socketDscr, header.data(), header.size()) || ! sendAll(_socketDscr, _payload.data(), _payload.size()) ){
+        VS_LOG_ERROR << PRINT_HEADER << " send failed, reason: " << strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
+
+// waits for all bytes, gives up on shutdown or closed socket
+static bool receiveAll( int _socketDscr, char * _out, size_t _size, int32_t _pollTimeoutMillisec, const std::atomic<bool> & _shutdownCalled ){
+
+    size_t received = 0;
+    while( received < _size ){
+        if( _shutdownCalled ){
+            return false;
+        }
+
+        const int ready = waitReadable( _socketDscr, _pollTimeoutMillisec );
+        if( ready < 0 ){
+            return false;
+        }
+        if( 0 == ready ){
+            continue;
+        }
+
+        const ssize_t rt = ::recv( _socketDscr, _out + received, _size - received, 0 );
+        if( rt < 0 && EINTR == errno ){
+            continue;
+        }
+        if( rt <= 0 ){
+            return false;
+        }
+        received += rt;
+    }
+    return true;
+}
+
+static bool receiveMessage( int _socketDscr, EMessageType & _type, std::string & _payload, int32_t _pollTimeoutMillisec, const std::atomic<bool> & _shutdownCalled ){
+
+    char header[ MESSAGE_HEADER_SIZE ];
+    if( ! receiveAll(_socketDscr, header, sizeof(header), _pollTimeoutMillisec, _shutdownCalled) ){
+        return false;
+    }
+
+    const uint32_t size = getLE<uint32_t>( header );
+    if( size < sizeof(uint8_t) || size > MESSAGE_MAX_SIZE ){
+        VS_LOG_ERROR << PRINT_HEADER << " invalid message size [" << size << "]" << endl;
+        return false;
+    }
+    _type = (EMessageType)getLE<uint8_t>( header + sizeof(uint32_t) );
+
+    _payload.resize( size - sizeof(uint8_t) );
+    return receiveAll( _socketDscr, & _payload[ 0 ], _payload.size(), _pollTimeoutMillisec, _shutdownCalled );
+}
+
+static sockaddr_un makeAddress( const std::string & _socketFileName ){
+
+    struct sockaddr_un addr;
+    memset( & addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, _socketFileName.c_str(), sizeof(addr.sun_path) - 1 );
+    return addr;
+}
+
+// -------------------------------------------------------------------------------------
+// primary side
+// -------------------------------------------------------------------------------------
+WALReplicationSource::WALReplicationSource()
+    : m_queueLastSequence(0)
+    , m_standbyAttached(false)
+    , m_queueOverflow(false)
+    , m_shutdownCalled(false)
+    , m_serverSocketDscr(-1)
+    , m_threadStreaming(nullptr)
+{
+
+}
+
+WALReplicationSource::~WALReplicationSource()
+{
+    shutdown();
+}
+
+bool WALReplicationSource::init( const SInitSettings & _settings ){
+
+    if( ! _settings.storage || _settings.socketFileName.empty() ){
+        VS_LOG_ERROR << PRINT_HEADER << " journal storage or socket file is not set" << endl;
+        return false;
+    }
+    m_settings = _settings;
+
+    if( (m_serverSocketDscr = ::socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ){
+        VS_LOG_ERROR << PRINT_HEADER << " socket create failed [" << m_settings.socketFileName << "]"
+                     << " Reason [" << strerror( errno ) << "]"
+                     << endl;
+        return false;
+    }
+
+    const sockaddr_un addr = makeAddress( m_settings.socketFileName );
+    ::unlink( m_settings.socketFileName.c_str() );
+
+    if( ::bind(m_serverSocketDscr, (const struct sockaddr *) & addr, sizeof(addr)) == -1
+            || ::listen(m_serverSocketDscr, 1) == -1 ){
+        VS_LOG_ERROR << PRINT_HEADER << " bind / listen failed [" << m_settings.socketFileName << "]"
+                     << " Reason [" << strerror( errno ) << "]"
+                     << endl;
+        ::close( m_serverSocketDscr );
+        m_serverSocketDscr = -1;
+        return false;
+    }
+
+    m_settings.storage->addObserver( this );
+    m_threadStreaming = new std::thread( & WALReplicationSource::threadStreaming, this );
+
+    VS_LOG_INFO << PRINT_HEADER << " primary started, socket file: " << m_settings.socketFileName << endl;
+    return true;
+}
+
+void WALReplicationSource::shutdown(){
+
+    if( ! m_threadStreaming ){
+        return;
+    }
+
+    m_settings.storage->removeObserver( this );
+
+    m_shutdownCalled = true;
+    {
+        std::lock_guard<std::mutex> lock( m_mutexQueue );
+        m_cvQueue.notify_all();
+        m_cvAck.notify_all();
+    }
+    common_utils::threadShutdown( m_threadStreaming );
+
+    ::close( m_serverSocketDscr );
+    m_serverSocketDscr = -1;
+    ::unlink( m_settings.socketFileName.c_str() );
+    m_shutdownCalled = false;
+
+    VS_LOG_INFO << PRINT_HEADER << " primary stopped, socket file: " << m_settings.socketFileName << endl;
+}
+
+bool WALReplicationSource::waitForAck( uint64_t _sequence, int32_t _timeoutMillisec ){
+
+    std::unique_lock<std::mutex> lock( m_mutexQueue );
+    m_cvAck.wait_for( lock, std::chrono::milliseconds(_timeoutMillisec), [ this, _sequence ](){
+        return m_shutdownCalled || m_stats.ackedSequence >= _sequence;
+    });
+    return m_stats.ackedSequence >= _sequence;
+}
+
+WALReplicationSource::SStats WALReplicationSource::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexQueue );
+    return m_stats;
+}
+
+void WALReplicationSource::callbackFramesCommitted( const std::string & _frames, uint64_t _lastSequence ){
+
+    std::lock_guard<std::mutex> lock( m_mutexQueue );
+    if( ! m_standbyAttached || m_queueOverflow ){
+        return;
+    }
+
+    // commit must not wait for slow standby
+    if( (int64_t)(m_queue.size() + _frames.size()) > m_settings.maxQueueBytes ){
+        m_queueOverflow = true;
+        m_queue.clear();
+    }
+    else{
+        m_queue.append( _frames );
+        m_queueLastSequence = _lastSequence;
+    }
+    m_cvQueue.notify_one();
+}
+
+void WALReplicationSource::threadStreaming(){
+
+    VS_LOG_INFO << PRINT_HEADER << " streaming thread started" << endl;
+
+    // point-to-point, as Shell: one standby at a time
+    while( ! m_shutdownCalled ){
+        const int ready = waitReadable( m_serverSocketDscr, m_settings.pollTimeoutMillisec );
+        if( ready < 0 ){
+            VS_LOG_ERROR << PRINT_HEADER << " select() failed, reason: " << strerror(errno) << endl;
+            std::this_thread::sleep_for( std::chrono::milliseconds(m_settings.pollTimeoutMillisec) );
+            continue;
+        }
+        if( 0 == ready ){
+            continue;
+        }
+
+        const int socketDscr = ::accept( m_serverSocketDscr, NULL, NULL );
+        if( socketDscr < 0 ){
+            VS_LOG_ERROR << PRINT_HEADER << " accept error. Reason [" << strerror( errno ) << "]" << endl;
+            continue;
+        }
+
+        VS_LOG_INFO << PRINT_HEADER << " standby connected" << endl;
+        serveStandby( socketDscr );
+        detachStandby();
+
+        ::shutdown( socketDscr, SHUT_RDWR );
+        ::close( socketDscr );
+        VS_LOG_INFO << PRINT_HEADER << " standby disconnected" << endl;
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " streaming thread stopped" << endl;
+}
+
+void WALReplicationSource::serveStandby( int _socketDscr ){
+
+    EMessageType type;
+    std::string payload;
+    if( ! receiveMessage(_socketDscr, type, payload, m_settings.pollTimeoutMillisec, m_shutdownCalled)
+            || EMessageType::HELLO != type
+            || payload.size() != sizeof(uint32_t)
+            || PROTOCOL_VERSION != getLE<uint32_t>(payload.data()) ){
+        VS_LOG_ERROR << PRINT_HEADER << " standby hello is not valid" << endl;
+        return;
+    }
+
+    // catch-up: frames committed after checkpoint image are queued for this standby
+    std::string checkpoint;
+    uint64_t checkpointSequence = 0;
+    {
+        std::lock_guard<std::mutex> lock( m_mutexQueue );
+        m_queue.clear();
+        m_queueOverflow = false;
+        if( ! m_settings.storage->makeReplicaCheckpoint(checkpoint, checkpointSequence) ){
+            return;
+        }
+        m_standbyAttached = true;
+        m_stats.standbyConnected = true;
+        m_stats.ackedSequence = 0;
+    }
+
+    if( ! sendMessage(_socketDscr, EMessageType::CHECKPOINT, checkpoint) ){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock( m_mutexQueue );
+        m_stats.checkpointsSent++;
+        m_stats.bytesSent += checkpoint.size();
+        m_stats.sentSequence = checkpointSequence;
+    }
+    VS_LOG_INFO << PRINT_HEADER << " checkpoint sent, sequence [" << checkpointSequence << "] bytes: " << checkpoint.size() << endl;
+
+    // everything committed while previous batch was sent goes as the next one
+    std::string batch;
+    while( ! m_shutdownCalled ){
+        uint64_t batchLastSequence = 0;
+        {
+            std::unique_lock<std::mutex> lock( m_mutexQueue );
+            m_cvQueue.wait_for( lock, std::chrono::milliseconds(m_settings.pollTimeoutMillisec), [ this ](){
+                return m_shutdownCalled || m_queueOverflow || ! m_queue.empty();
+            });
+
+            if( m_queueOverflow ){
+                VS_LOG_WARN << PRINT_HEADER << " standby is too far behind, it will catch up from checkpoint again" << endl;
+                return;
+            }
+
+            batch.clear();
+            batch.swap( m_queue );
+            batchLastSequence = m_queueLastSequence;
+        }
+
+        if( ! batch.empty() ){
+            if( ! sendMessage(_socketDscr, EMessageType::FRAMES, batch) ){
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock( m_mutexQueue );
+            m_stats.batchesSent++;
+            m_stats.bytesSent += batch.size();
+            m_stats.sentSequence = batchLastSequence;
+        }
+
+        if( ! receiveAcks(_socketDscr) ){
+            return;
+        }
+    }
+}
+
+// acks are small & come after every batch, ready ones are read without waiting
+bool WALReplicationSource::receiveAcks( int _socketDscr ){
+
+    while( true ){
+        const int ready = waitReadable( _socketDscr, 0 );
+        if( ready < 0 ){
+            return false;
+        }
+        if( 0 == ready ){
+            return true;
+        }
+
+        EMessageType type;
+        std::string payload;
+        if( ! receiveMessage(_socketDscr, type, payload, m_settings.pollTimeoutMillisec, m_shutdownCalled) ){
+            return false;
+        }
+        if( EMessageType::ACK != type || payload.size() != sizeof(uint64_t) ){
+            VS_LOG_ERROR << PRINT_HEADER << " unexpected message from standby, type [" << (int)type << "]" << endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock( m_mutexQueue );
+        m_stats.ackedSequence = std::max( m_stats.ackedSequence, getLE<uint64_t>(payload.data()) );
+        m_cvAck.notify_all();
+    }
+}
+
+void WALReplicationSource::detachStandby(){
+
+    std::lock_guard<std::mutex> lock( m_mutexQueue );
+    m_standbyAttached = false;
+    m_queueOverflow = false;
+    m_queue.clear();
+    m_stats.standbyConnected = false;
+    m_cvAck.notify_all();
+}
+
+// -------------------------------------------------------------------------------------
+// standby side
+// -------------------------------------------------------------------------------------
+WALReplicationStandby::WALReplicationStandby()
+    : m_shutdownCalled(false)
+    , m_threadReceiving(nullptr)
+{
+
+}
+
+WALReplicationStandby::~WALReplicationStandby()
+{
+    shutdown();
+}
+
+bool WALReplicationStandby::init( const SInitSettings & _settings ){
+
+    if( ! _settings.storage || _settings.socketFileName.empty() ){
+        VS_LOG_ERROR << PRINT_HEADER << " journal storage or socket file is not set" << endl;
+        return false;
+    }
+    m_settings = _settings;
+
+    // primary may be not started yet, connection is retried by thread
+    m_threadReceiving = new std::thread( & WALReplicationStandby::threadReceiving, this );
+
+    VS_LOG_INFO << PRINT_HEADER << " standby started, primary socket file: " << m_settings.socketFileName << endl;
+    return true;
+}
+
+void WALReplicationStandby::shutdown(){
+
+    if( ! m_threadReceiving ){
+        return;
+    }
+
+    m_shutdownCalled = true;
+    common_utils::threadShutdown( m_threadReceiving );
+    m_shutdownCalled = false;
+
+    VS_LOG_INFO << PRINT_HEADER << " standby stopped at sequence [" << getStats().appliedSequence << "]" << endl;
+}
+
+WALReplicationStandby::SStats WALReplicationStandby::getStats(){
+
+    std::lock_guard<std::mutex> lock( m_mutexStats );
+    return m_stats;
+}
+
+void WALReplicationStandby::threadReceiving(){
+
+    VS_LOG_INFO << PRINT_HEADER << " receiving thread started" << endl;
+
+    while( ! m_shutdownCalled ){
+        const int socketDscr = connectToPrimary();
+        if( socketDscr < 0 ){
+            for( int32_t waited = 0; waited < m_settings.reconnectIntervalMillisec && ! m_shutdownCalled; waited += m_settings.pollTimeoutMillisec ){
+                std::this_thread::sleep_for( std::chrono::milliseconds(m_settings.pollTimeoutMillisec) );
+            }
+            continue;
+        }
+
+        receiveStream( socketDscr );
+
+        ::shutdown( socketDscr, SHUT_RDWR );
+        ::close( socketDscr );
+
+        std::lock_guard<std::mutex> lock( m_mutexStats );
+        m_stats.connected = false;
+    }
+
+    VS_LOG_INFO << PRINT_HEADER << " receiving thread stopped" << endl;
+}
+
+int WALReplicationStandby::connectToPrimary(){
+
+    const int socketDscr = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( socketDscr == -1 ){
+        VS_LOG_ERROR << PRINT_HEADER << " socket create failed [" << m_settings.socketFileName << "]"
+                     << " Reason [" << strerror( errno ) << "]"
+                     << endl;
+        return -1;
+    }
+
+    const sockaddr_un addr = makeAddress( m_settings.socketFileName );
+    if( ::connect(socketDscr, (const struct sockaddr *) & addr, sizeof(addr)) == -1 ){
+        ::close( socketDscr );
+        return -1;
+    }
+    return socketDscr;
+}
+
+void WALReplicationStandby::receiveStream( int _socketDscr ){
+
+    std::string hello;
+    putLE<uint32_t>( hello, PROTOCOL_VERSION );
+    if( ! sendMessage(_socketDscr, EMessageType::HELLO, hello) ){
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutexStats );
+        m_stats.connected = true;
+    }
+    VS_LOG_INFO << PRINT_HEADER << " connected to primary [" << m_settings.socketFileName << "]" << endl;
+
+    EMessageType type;
+    std::string payload;
+    while( receiveMessage(_socketDscr, type, payload, m_settings.pollTimeoutMillisec, m_shutdownCalled) ){
+        bool applied = false;
+        if( EMessageType::CHECKPOINT == type ){
+            applied = m_settings.storage->loadReplicaCheckpoint( payload );
+        }
+        else if( EMessageType::FRAMES == type ){
+            applied = m_settings.storage->appendReplicated( payload );
+        }
+        else{
+            VS_LOG_ERROR << PRINT_HEADER << " unexpected message from primary, type [" << (int)type << "]" << endl;
+        }
+
+        // new connection starts from checkpoint again
+        if( ! applied ){
+            VS_LOG_ERROR << PRINT_HEADER << " stream is not applied, reconnect" << endl;
+            return;
+        }
+
+        // ack - everything up to this sequence is durable here
+        const uint64_t sequence = m_settings.storage->getStats().lastSequence;
+        {
+            std::lock_guard<std::mutex> lock( m_mutexStats );
+            if( EMessageType::CHECKPOINT == type ){
+                m_stats.checkpointsLoaded++;
+            }
+            else{
+                m_stats.batchesApplied++;
+            }
+            m_stats.appliedSequence = sequence;
+        }
+
+        std::string ack;
+        putLE<uint64_t>( ack, sequence );
+        if( ! sendMessage(_socketDscr, EMessageType::ACK, ack) ){
+            return;
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#ifndef WAL_REPLICATION_H
+#define WAL_REPLICATION_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <condition_variable>
+
+#include "wal_file_storage.h"
+
+// Journal replication to standby instance over unix domain socket ( as Shell ).
+// Standby connects, gets checkpoint image of primary, then committed frames in batches,
+// after every batch it acks the last sequence durable on its side.
+// Standby journal is a regular WALFileStorage: on takeover WriteAheadLogger is inited over it
+// and interrupted operations are read locally, without replay
+
+// primary side
+class WALReplicationSource : public IWALFramesObserver
+{
+public:
+    struct SInitSettings {
+        SInitSettings()
+            : storage(nullptr)
+            , pollTimeoutMillisec(100)
+            , maxQueueBytes( 64 * 1024 * 1024 )
+        {}
+        WALFileStorage * storage;
+        std::string socketFileName;
+        int32_t pollTimeoutMillisec;
+        int64_t maxQueueBytes; // standby behind it is dropped and catches up from checkpoint again
+    };
+
+    struct SStats {
+        SStats()
+            : standbyConnected(false)
+            , checkpointsSent(0)
+            , batchesSent(0)
+            , bytesSent(0)
+            , sentSequence(0)
+            , ackedSequence(0)
+        {}
+        bool standbyConnected;
+        int64_t checkpointsSent;
+        int64_t batchesSent;
+        int64_t bytesSent;
+        uint64_t sentSequence;
+        uint64_t ackedSequence;
+    };
+
+    WALReplicationSource();
+    ~WALReplicationSource();
+
+    bool init( const SInitSettings & _settings );
+    void shutdown();
+
+    // true - standby has the record with '_sequence' durable
+    bool waitForAck( uint64_t _sequence, int32_t _timeoutMillisec );
+    SStats getStats();
+
+
+private:
+    virtual void callbackFramesCommitted( const std::string & _frames, uint64_t _lastSequence ) override;
+
+    void threadStreaming();
+    void serveStandby( int _socketDscr );
+    bool receiveAcks( int _socketDscr );
+    void detachStandby();
+
+    // data
+    SInitSettings m_settings;
+    SStats m_stats;
+    std::string m_queue;
+    uint64_t m_queueLastSequence;
+    bool m_standbyAttached;
+    bool m_queueOverflow;
+    std::atomic<bool> m_shutdownCalled;
+    int m_serverSocketDscr;
+
+    // service
+    std::mutex m_mutexQueue;
+    std::condition_variable m_cvQueue;
+    std::condition_variable m_cvAck;
+    std::thread * m_threadStreaming;
+};
+
+// standby side
+class WALReplicationStandby
+{
+public:
+    struct SInitSettings {
+        SInitSettings()
+            : storage(nullptr)
+            , pollTimeoutMillisec(100)
+            , reconnectIntervalMillisec(500)
+        {}
+        WALFileStorage * storage;
+        std::string socketFileName;
+        int32_t pollTimeoutMillisec;
+        int32_t reconnectIntervalMillisec;
+    };
+
+    struct SStats {
+        SStats()
+            : connected(false)
+            , checkpointsLoaded(0)
+            , batchesApplied(0)
+            , appliedSequence(0)
+        {}
+        bool connected;
+        int64_t checkpointsLoaded;
+        int64_t batchesApplied;
+        uint64_t appliedSequence;
+    };
+
+    WALReplicationStandby();
+    ~WALReplicationStandby();
+
+    bool init( const SInitSettings & _settings );
+    // takeover: stream is stopped, storage keeps everything applied so far
+    void shutdown();
+
+    SStats getStats();
+
+
+private:
+    void threadReceiving();
+    int connectToPrimary();
+    void receiveStream( int _socketDscr );
+
+    // data
+    SInitSettings m_settings;
+    SStats m_stats;
+    std::atomic<bool> m_shutdownCalled;
+
+    // service
+    std::mutex m_mutexStats;
+    std::thread * m_threadReceiving;
+};
+
+#endif // WAL_REPLICATION_H
@@ -1,6 +1,16 @@
 
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <tuple>
+#include <cstdio>
+#include <limits>
+
 #include <microservice_common/system/logger.h>
 
+#include "common/ms_common_utils.h"
+#include "storage/trajectory_downsampler.h"
+#include "storage/trajectory_point_predicate.h"
 #include "test_database_manager_base.h"
 
 using namespace std;
@@ -52,9 +62,7 @@ TestDatabaseManagerBase::TestDatabaseManagerBase()
 
 void TestDatabaseManagerBase::SetUpTestCase(){
 
-    DatabaseManagerBase::SInitSettings settings;
-    settings.host = "localhost";
-    settings.databaseName = "unit_tests";
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
 
     m_database = DatabaseManagerBase::getInstance();
     const bool success = m_database->init(settings);
@@ -66,6 +74,23 @@ void TestDatabaseManagerBase::TearDownTestCase(){
     DatabaseManagerBase::destroyInstance( m_database );
 }
 
+DatabaseManagerBase::SInitSettings TestDatabaseManagerBase::makeSettings(){
+
+    DatabaseManagerBase::SInitSettings settings;
+    settings.host = "localhost";
+    settings.databaseName = "unit_tests";
+    return settings;
+}
+
+TestDatabaseManagerBase::PDatabase TestDatabaseManagerBase::makeDatabase( const DatabaseManagerBase::SInitSettings & _settings ){
+
+    PDatabase database( DatabaseManagerBase::getInstance() );
+    if( ! database->init(_settings) ){
+        database.reset();
+    }
+    return database;
+}
+
 // -------------------------------------------------------------------------
 // object trajectory tests
 // -------------------------------------------------------------------------
@@ -454,6 +479,1083 @@ TEST_F(TestDatabaseManagerBase, description_test_recorder){
     }
 }
 
+TEST_F(TestDatabaseManagerBase, payload_cache_test_recorder){
+
+    // NOTE: metadata & payload already written by previous tests
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const SPersistenceMetadataRaw & rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.trajectoryCacheEnable = true;
+
+    PDatabase cachedDatabase = makeDatabase( settings );
+    ASSERT_TRUE( cachedDatabase );
+
+    SPersistenceSetFilter filter( rawMetadataOutput.persistenceSetId );
+    filter.sessionNum = 1;
+    filter.minLogicStep = 3;
+    filter.maxLogicStep = 7;
+
+    // I first read goes to the store, second one - from memory
+    const std::vector<SPersistenceTrajectory> fromStore = m_database->readTrajectoryData( filter );
+    const std::vector<SPersistenceTrajectory> fromCache1 = cachedDatabase->readTrajectoryData( filter );
+    const std::vector<SPersistenceTrajectory> fromCache2 = cachedDatabase->readTrajectoryData( filter );
+    ASSERT_EQ( fromStore.size(), fromCache1.size() );
+    ASSERT_EQ( fromStore.size(), fromCache2.size() );
+    ASSERT_GE( cachedDatabase->getTrajectoryCacheStats().hits, 1 );
+
+    for( size_t i = 0; i < fromStore.size(); i++ ){
+        ASSERT_EQ( fromStore[ i ].logicTime, fromCache2[ i ].logicTime );
+        ASSERT_EQ( fromStore[ i ].astroTimeMillisec, fromCache2[ i ].astroTimeMillisec );
+        ASSERT_EQ( fromStore[ i ].objId, fromCache2[ i ].objId );
+        ASSERT_DOUBLE_EQ( fromStore[ i ].latDeg, fromCache2[ i ].latDeg );
+    }
+
+    // II write-through keeps cached session coherent
+    SPersistenceTrajectory trajInput = fromCache2.back();
+    trajInput.objId = 124;
+    cachedDatabase->writeTrajectoryData( rawMetadataOutput.persistenceSetId, {trajInput} );
+    ASSERT_EQ( cachedDatabase->readTrajectoryData(filter).size(), fromStore.size() + 1 );
+    ASSERT_EQ( m_database->readTrajectoryData(filter).size(), fromStore.size() + 1 );
+}
+
+TEST_F(TestDatabaseManagerBase, payload_stream_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const SPersistenceMetadataRaw & rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+
+    const SPersistenceSetFilter filter( rawMetadataOutput.persistenceSetId );
+    const std::vector<SPersistenceTrajectory> wholeArea = m_database->readTrajectoryData( filter );
+
+    // batches are bounded and together give the same payload
+    constexpr int32_t BATCH_SIZE = 4;
+    std::vector<SPersistenceTrajectory> streamed;
+    const bool rt = m_database->readTrajectoryDataStream( filter, BATCH_SIZE, [&]( const std::vector<SPersistenceTrajectory> & _batch ){
+        EXPECT_LE( _batch.size(), BATCH_SIZE );
+        streamed.insert( streamed.end(), _batch.begin(), _batch.end() );
+        return true;
+    });
+
+    ASSERT_TRUE( rt );
+    ASSERT_EQ( wholeArea.size(), streamed.size() );
+    for( size_t i = 0; i < wholeArea.size(); i++ ){
+        ASSERT_EQ( wholeArea[ i ].logicTime, streamed[ i ].logicTime );
+        ASSERT_EQ( wholeArea[ i ].sessionNum, streamed[ i ].sessionNum );
+    }
+}
+
+TEST_F(TestDatabaseManagerBase, payload_write_behind_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const SPersistenceMetadataRaw & rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.writeBehindEnable = true;
+    settings.writeBehind.maxBulkRecords = 8;
+    settings.writeBehind.maxQueueRecords = 16;
+    settings.writeBehind.flushDeadlineMillisec = 1000;
+
+    PDatabase bufferedDatabase = makeDatabase( settings );
+    ASSERT_TRUE( bufferedDatabase );
+
+    SPersistenceSetFilter filter( rawMetadataOutput.persistenceSetId );
+    filter.sessionNum = 3;
+    filter.minLogicStep = 0;
+    filter.maxLogicStep = 100;
+    const size_t sizeBefore = m_database->readTrajectoryData( filter ).size();
+
+    // small batches are merged, queue limit forces back-pressure
+    constexpr int RECORDS_COUNT = 40;
+    for( int i = 0; i < RECORDS_COUNT; i++ ){
+        SPersistenceTrajectory trajInput;
+        trajInput.objId = 125;
+        trajInput.sessionNum = 3;
+        trajInput.logicTime = i;
+        trajInput.astroTimeMillisec = 2000 + i;
+        ASSERT_TRUE( bufferedDatabase->writeTrajectoryData(rawMetadataOutput.persistenceSetId, {trajInput}) );
+    }
+
+    // read through the same instance flushes the queue
+    ASSERT_EQ( bufferedDatabase->readTrajectoryData(filter).size(), sizeBefore + RECORDS_COUNT );
+
+    const TrajectoryWriteBehind::SIngestStats stats = bufferedDatabase->getTrajectoryIngestStats();
+    ASSERT_EQ( stats.queueDepth, 0 );
+    ASSERT_EQ( stats.recordsFlushed, RECORDS_COUNT );
+    ASSERT_LE( stats.maxQueueDepth, settings.writeBehind.maxQueueRecords );
+    ASSERT_LT( stats.flushesCount, RECORDS_COUNT );
+}
+
+TEST_F(TestDatabaseManagerBase, session_discovery_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const SPersistenceMetadataRaw & rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+    const TPersistenceSetId persId = rawMetadataOutput.persistenceSetId;
+
+    // |***-- -***|
+    // S100 with gap
+    constexpr TSessionNum SESSION_WITH_GAP = 100;
+    vector<SPersistenceTrajectory> data;
+    SPersistenceTrajectory trajInput;
+    trajInput.objId = 126;
+    trajInput.sessionNum = SESSION_WITH_GAP;
+    for( const TLogicStep step : {0, 1, 2, 6, 7, 8} ){
+        trajInput.logicTime = step;
+        trajInput.astroTimeMillisec = 100000 + step * QUANTUM_INTERVAL_MILLISEC;
+        data.push_back( trajInput );
+    }
+    ASSERT_TRUE( m_database->writeTrajectoryData(persId, data) );
+
+    // I gaps
+    const vector<SEventsSessionInfo> segments = m_database->scanPayloadForSessions( persId, SESSION_WITH_GAP );
+    ASSERT_EQ( segments.size(), 2 );
+    ASSERT_EQ( segments[ 0 ].minLogicStep, 0 );
+    ASSERT_EQ( segments[ 0 ].maxLogicStep, 2 );
+    ASSERT_EQ( segments[ 1 ].minLogicStep, 6 );
+    ASSERT_EQ( segments[ 1 ].maxLogicStep, 8 );
+    ASSERT_EQ( segments[ 1 ].maxTimestampMillisec, 100000 + 8 * QUANTUM_INTERVAL_MILLISEC );
+
+    // II whole session
+    const SEventsSessionInfo info = m_database->scanPayloadTailForSessions( persId );
+    ASSERT_EQ( info.number, SESSION_WITH_GAP );
+    ASSERT_EQ( info.minLogicStep, 0 );
+    ASSERT_EQ( info.maxLogicStep, 8 );
+
+    // III steps of all sessions in one pass
+    const vector<SEventsSessionInfo> sessions = m_database->getPersistenceSetSessions( persId );
+    ASSERT_FALSE( sessions.empty() );
+    ASSERT_EQ( sessions.back().number, SESSION_WITH_GAP );
+    ASSERT_EQ( sessions.back().steps.size(), data.size() );
+    ASSERT_EQ( m_database->scanPayloadHeadForSessions(persId).number, sessions.front().number );
+}
+
+TEST_F(TestDatabaseManagerBase, session_summary_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const TPersistenceSetId persId = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.sessionSummaryEnable = true;
+
+    PDatabase summaryDatabase = makeDatabase( settings );
+    ASSERT_TRUE( summaryDatabase );
+
+    // I seeded summary equals to payload scan
+    const SEventsSessionInfo tailBefore = summaryDatabase->scanPayloadTailForSessions( persId );
+    const SEventsSessionInfo scannedTail = m_database->scanPayloadTailForSessions( persId );
+    ASSERT_EQ( tailBefore.number, scannedTail.number );
+    ASSERT_EQ( tailBefore.maxLogicStep, scannedTail.maxLogicStep );
+    ASSERT_EQ( tailBefore.maxTimestampMillisec, scannedTail.maxTimestampMillisec );
+
+    // II writes are reflected without scan ( gap closing included )
+    const TSessionNum newSession = tailBefore.number + 1;
+    SPersistenceTrajectory trajInput;
+    trajInput.objId = 127;
+    trajInput.sessionNum = newSession;
+    for( const TLogicStep step : {0, 1, 4, 5, 2, 3} ){
+        trajInput.logicTime = step;
+        trajInput.astroTimeMillisec = 200000 + step * QUANTUM_INTERVAL_MILLISEC;
+        ASSERT_TRUE( summaryDatabase->writeTrajectoryData(persId, {trajInput}) );
+    }
+
+    const SEventsSessionInfo tailAfter = summaryDatabase->scanPayloadTailForSessions( persId );
+    ASSERT_EQ( tailAfter.number, newSession );
+    ASSERT_EQ( tailAfter.minLogicStep, 0 );
+    ASSERT_EQ( tailAfter.maxLogicStep, 5 );
+    ASSERT_EQ( summaryDatabase->scanPayloadForSessions(persId, newSession).size(), 1 );
+
+    // III tail description is flushed on close
+    summaryDatabase.reset();
+
+    const vector<SEventsSessionInfo> descriptions = m_database->selectSessionDescriptions( persId );
+    auto iter = std::find_if( descriptions.begin(), descriptions.end(), FEqualSEventsSessionInfo(newSession) );
+    ASSERT_TRUE( iter != descriptions.end() );
+    ASSERT_EQ( iter->maxLogicStep, 5 );
+    ASSERT_EQ( iter->maxTimestampMillisec, 200000 + 5 * QUANTUM_INTERVAL_MILLISEC );
+}
+
+TEST_F(TestDatabaseManagerBase, payload_pooled_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const TPersistenceSetId persId = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.clientPoolEnable = true;
+
+    // pool smaller than threads pinning its clients is refused
+    DatabaseManagerBase::SInitSettings smallPoolSettings = settings;
+    smallPoolSettings.fanOutThreads = 4;
+    smallPoolSettings.clientPoolMaxSize = 4;
+    ASSERT_FALSE( makeDatabase(smallPoolSettings) );
+
+    PDatabase pooledDatabase = makeDatabase( settings );
+    ASSERT_TRUE( pooledDatabase );
+
+    const SPersistenceSetFilter filter( persId );
+    const size_t expectedSize = m_database->readTrajectoryData( filter ).size();
+
+    // parallel readers, each with own client
+    constexpr int THREADS_COUNT = 4;
+    std::vector<size_t> readSizes( THREADS_COUNT, 0 );
+    std::vector<std::thread> readers;
+    for( int i = 0; i < THREADS_COUNT; i++ ){
+        readers.emplace_back( [&, i](){
+            readSizes[ i ] = pooledDatabase->readTrajectoryData( filter ).size();
+            pooledDatabase->getPersistenceSetMetadata( CONTEXT_ID );
+            pooledDatabase->releaseThreadHandles();
+        });
+    }
+
+    for( std::thread & reader : readers ){
+        reader.join();
+    }
+
+    for( const size_t readSize : readSizes ){
+        ASSERT_EQ( readSize, expectedSize );
+    }
+}
+
+TEST_F(TestDatabaseManagerBase, payload_batch_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const TPersistenceSetId persId = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.fanOutThreads = 4;
+
+    PDatabase fanOutDatabase = makeDatabase( settings );
+    ASSERT_TRUE( fanOutDatabase );
+
+    // same window over several sessions
+    std::vector<SPersistenceSetFilter> filters;
+    for( TSessionNum session = 1; session <= 5; session++ ){
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = session;
+        filter.minLogicStep = 0;
+        filter.maxLogicStep = 5;
+        filters.push_back( filter );
+    }
+
+    const std::vector<std::vector<SPersistenceTrajectory>> grouped = fanOutDatabase->readTrajectoryDataBatch( filters );
+    ASSERT_EQ( grouped.size(), filters.size() );
+
+    size_t totalSize = 0;
+    for( size_t i = 0; i < filters.size(); i++ ){
+        ASSERT_EQ( grouped[ i ].size(), m_database->readTrajectoryData(filters[ i ]).size() );
+        totalSize += grouped[ i ].size();
+    }
+
+    const std::vector<SPersistenceTrajectory> merged = fanOutDatabase->readTrajectoryDataMerged( filters );
+    ASSERT_EQ( merged.size(), totalSize );
+}
+
+TEST_F(TestDatabaseManagerBase, payload_prefetch_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const TPersistenceSetId persId = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.prefetchEnable = true;
+    settings.prefetch.minWindowSteps = 4;
+
+    PDatabase prefetchDatabase = makeDatabase( settings );
+    ASSERT_TRUE( prefetchDatabase );
+
+    // step-by-step playback of S1 ( 15 steps )
+    constexpr int64_t PLAYBACK_INTERVAL_MILLISEC = 20;
+    SPersistenceSetFilter filter( persId );
+    filter.sessionNum = 1;
+
+    for( TLogicStep step = 0; step < 15; step++ ){
+        filter.minLogicStep = step;
+        filter.maxLogicStep = step;
+
+        const std::vector<SPersistenceTrajectory> played = prefetchDatabase->readTrajectoryData( filter );
+        const std::vector<SPersistenceTrajectory> expected = m_database->readTrajectoryData( filter );
+        ASSERT_EQ( played.size(), expected.size() );
+        for( size_t i = 0; i < played.size(); i++ ){
+            ASSERT_EQ( played[ i ].logicTime, step );
+            ASSERT_EQ( played[ i ].astroTimeMillisec, expected[ i ].astroTimeMillisec );
+        }
+
+        std::this_thread::sleep_for( std::chrono::milliseconds(PLAYBACK_INTERVAL_MILLISEC) );
+    }
+
+    const TrajectoryPrefetcher::SPrefetchStats stats = prefetchDatabase->getTrajectoryPrefetchStats();
+    ASSERT_GT( stats.fetches, 0 );
+    ASSERT_GT( stats.hits, 0 );
+}
+
+TEST_F(TestDatabaseManagerBase, payload_chunk_test_recorder){
+
+    // separate context, chunked set must not shadow the per-point one
+    const TContextId chunkContextId = CONTEXT_ID + 1;
+    m_database->deleteTotalData( chunkContextId );
+    m_database->deleteSessionDescription( chunkContextId );
+    m_database->deletePersistenceSetMetadata( chunkContextId );
+
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = chunkContextId;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 1;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::TRAJECTORY;
+    rawMetadataInput.timeStepIntervalMillisec = QUANTUM_INTERVAL_MILLISEC;
+    rawMetadataInput.storageLayout = EPersistenceStorageLayout::CHUNK_PER_STEP;
+
+    const TPersistenceSetId persId = m_database->writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( chunkContextId );
+    ASSERT_EQ( ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front().storageLayout, EPersistenceStorageLayout::CHUNK_PER_STEP );
+
+    // 10 steps by 5 objects
+    vector<SPersistenceTrajectory> dataToWrite;
+    for( TLogicStep step = 0; step < 10; step++ ){
+        for( int obj = 0; obj < 5; obj++ ){
+            SPersistenceTrajectory trajInput;
+            trajInput.objId = 200 + obj;
+            trajInput.state = SPersistenceObj::EState::ACTIVE;
+            trajInput.sessionNum = 1;
+            trajInput.logicTime = step;
+            trajInput.astroTimeMillisec = 10000 + step * QUANTUM_INTERVAL_MILLISEC;
+            trajInput.latDeg = 40.0 + step * 0.1 + obj;
+            trajInput.lonDeg = 90.0 - step * 0.2;
+            trajInput.height = 100.5;
+            trajInput.yawDeg = -15.25 * obj;
+            dataToWrite.push_back( trajInput );
+        }
+    }
+    ASSERT_TRUE( m_database->writeTrajectoryData(persId, dataToWrite) );
+
+    // range read
+    SPersistenceSetFilter filter( persId );
+    filter.sessionNum = 1;
+    filter.minLogicStep = 2;
+    filter.maxLogicStep = 4;
+    const std::vector<SPersistenceTrajectory> rangeData = m_database->readTrajectoryData( filter );
+    ASSERT_EQ( rangeData.size(), 3 * 5 );
+
+    // whole set is restored bit-exact ( steps are in write order )
+    filter.minLogicStep = 0;
+    filter.maxLogicStep = 9;
+    const std::vector<SPersistenceTrajectory> readData = m_database->readTrajectoryData( filter );
+    ASSERT_EQ( readData.size(), dataToWrite.size() );
+    for( size_t i = 0; i < readData.size(); i++ ){
+        ASSERT_EQ( readData[ i ].objId, dataToWrite[ i ].objId );
+        ASSERT_EQ( readData[ i ].state, dataToWrite[ i ].state );
+        ASSERT_EQ( readData[ i ].sessionNum, dataToWrite[ i ].sessionNum );
+        ASSERT_EQ( readData[ i ].logicTime, dataToWrite[ i ].logicTime );
+        ASSERT_EQ( readData[ i ].astroTimeMillisec, dataToWrite[ i ].astroTimeMillisec );
+        ASSERT_EQ( readData[ i ].latDeg, dataToWrite[ i ].latDeg );
+        ASSERT_EQ( readData[ i ].lonDeg, dataToWrite[ i ].lonDeg );
+        ASSERT_EQ( readData[ i ].height, dataToWrite[ i ].height );
+        ASSERT_EQ( readData[ i ].yawDeg, dataToWrite[ i ].yawDeg );
+    }
+
+    // cursor splits chunks between batches
+    DatabaseManagerBase::PTrajectoryCursor cursor = m_database->openTrajectoryCursor( filter, 7 );
+    size_t streamed = 0;
+    for( ;; ){
+        const std::vector<SPersistenceTrajectory> & batch = cursor->nextBatch();
+        if( batch.empty() ){
+            break;
+        }
+        streamed += batch.size();
+    }
+    ASSERT_EQ( streamed, dataToWrite.size() );
+
+    m_database->deleteTotalData( chunkContextId );
+    m_database->deletePersistenceSetMetadata( chunkContextId );
+}
+
+TEST_F(TestDatabaseManagerBase, metadata_catalog_test_recorder){
+
+    const TContextId catalogContextId = CONTEXT_ID + 2;
+    m_database->deletePersistenceSetMetadata( catalogContextId );
+    ASSERT_TRUE( m_database->getPersistenceSetMetadata(catalogContextId).empty() );
+
+    // I several sets of one context get distinct ids
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = catalogContextId;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 1;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::TRAJECTORY;
+    rawMetadataInput.timeStepIntervalMillisec = QUANTUM_INTERVAL_MILLISEC;
+
+    const TPersistenceSetId persId1 = m_database->writePersistenceSetMetadata( rawMetadataInput );
+    rawMetadataInput.missionId = MISSION_ID + 1;
+    const TPersistenceSetId persId2 = m_database->writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_NE( persId1, common_vars::INVALID_PERS_ID );
+    ASSERT_NE( persId2, common_vars::INVALID_PERS_ID );
+    ASSERT_NE( persId1, persId2 );
+    ASSERT_EQ( m_database->getPersistenceSetMetadata(catalogContextId)[ 0 ].persistenceFromRaw.size(), 2 );
+
+    // II update of existing set, context change is forbidden
+    rawMetadataInput.persistenceSetId = persId2;
+    rawMetadataInput.lastRecordedSession = 2;
+    ASSERT_EQ( m_database->writePersistenceSetMetadata(rawMetadataInput), persId2 );
+    ASSERT_EQ( m_database->getPersistenceSetMetadata(persId2).persistenceFromRaw.front().lastRecordedSession, 2 );
+
+    SPersistenceMetadataRaw movedMetadata = rawMetadataInput;
+    movedMetadata.contextId = catalogContextId + 1;
+    ASSERT_EQ( m_database->writePersistenceSetMetadata(movedMetadata), common_vars::INVALID_PERS_ID );
+
+    // III fresh instance loads the same catalog from store
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+
+    PDatabase loadedDatabase = makeDatabase( settings );
+    ASSERT_TRUE( loadedDatabase );
+    const SPersistenceMetadataRaw loadedMetadata = loadedDatabase->getPersistenceSetMetadata( persId2 ).persistenceFromRaw.front();
+    ASSERT_EQ( loadedMetadata, rawMetadataInput );
+
+    // ... and continues ids after the written ones
+    rawMetadataInput.persistenceSetId = common_vars::INVALID_PERS_ID;
+    rawMetadataInput.missionId = MISSION_ID + 2;
+    const TPersistenceSetId persId3 = loadedDatabase->writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_GT( persId3, std::max(persId1, persId2) );
+    loadedDatabase.reset();
+
+    // IV delete keeps catalog coherent
+    m_database->deletePersistenceSetMetadata( persId1 );
+    ASSERT_TRUE( m_database->getPersistenceSetMetadata(persId1).persistenceFromRaw.empty() );
+    m_database->deletePersistenceSetMetadata( catalogContextId );
+    ASSERT_TRUE( m_database->getPersistenceSetMetadata(catalogContextId).empty() );
+}
+
+TEST_F(TestDatabaseManagerBase, payload_downsample_test_recorder){
+
+    // NOTE: metadata & payload already written by previous tests
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const SPersistenceMetadataRaw & rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+
+    SPersistenceSetFilter filter( rawMetadataOutput.persistenceSetId );
+    filter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+    const std::vector<SPersistenceTrajectory> wholeArea = m_database->readTrajectoryData( filter );
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.trajectoryCacheEnable = true;
+
+    PDatabase cachedDatabase = makeDatabase( settings );
+    ASSERT_TRUE( cachedDatabase );
+
+    // aggregation in store and reduction in cache give the same points as reference reduction
+    for( const EDownsampleMode mode : { EDownsampleMode::FIRST, EDownsampleMode::LAST, EDownsampleMode::AVG } ){
+        for( const int64_t bucketMillisec : { (int64_t)0, 3 * QUANTUM_INTERVAL_MILLISEC } ){
+            SPersistenceSetFilter downsampleFilter = filter;
+            downsampleFilter.downsampleMode = mode;
+            downsampleFilter.bucketLogicSteps = ( bucketMillisec > 0 ? 0 : 4 );
+            downsampleFilter.bucketMillisec = bucketMillisec;
+
+            TrajectoryDownsampler reference( downsampleFilter );
+            reference.add( wholeArea );
+            const std::vector<SPersistenceTrajectory> expected = reference.getResult();
+
+            const std::vector<SPersistenceTrajectory> fromStore = m_database->readTrajectoryData( downsampleFilter );
+            const std::vector<SPersistenceTrajectory> fromCache = cachedDatabase->readTrajectoryData( downsampleFilter );
+            ASSERT_LT( expected.size(), wholeArea.size() );
+            ASSERT_EQ( expected.size(), fromStore.size() );
+            ASSERT_EQ( expected.size(), fromCache.size() );
+
+            for( size_t i = 0; i < expected.size(); i++ ){
+                ASSERT_EQ( expected[ i ].sessionNum, fromStore[ i ].sessionNum );
+                ASSERT_EQ( expected[ i ].logicTime, fromStore[ i ].logicTime );
+                ASSERT_EQ( expected[ i ].objId, fromStore[ i ].objId );
+                ASSERT_EQ( expected[ i ].logicTime, fromCache[ i ].logicTime );
+
+                // NOTE: points of the same step & object may come in any order, average doesn't depend on it
+                if( EDownsampleMode::AVG == mode ){
+                    ASSERT_NEAR( expected[ i ].latDeg, fromStore[ i ].latDeg, 1e-9 );
+                    ASSERT_NEAR( expected[ i ].lonDeg, fromStore[ i ].lonDeg, 1e-9 );
+                    ASSERT_NEAR( expected[ i ].latDeg, fromCache[ i ].latDeg, 1e-9 );
+                }
+            }
+        }
+    }
+}
+
+TEST_F(TestDatabaseManagerBase, payload_point_predicate_test_recorder){
+
+    // NOTE: metadata & payload already written by previous tests
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const SPersistenceMetadataRaw & rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+
+    SPersistenceSetFilter filter( rawMetadataOutput.persistenceSetId );
+    filter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+    const std::vector<SPersistenceTrajectory> wholeArea = m_database->readTrajectoryData( filter );
+    ASSERT_GT( wholeArea.size(), 20 );
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.trajectoryCacheEnable = true;
+
+    PDatabase cachedDatabase = makeDatabase( settings );
+    ASSERT_TRUE( cachedDatabase );
+
+    // box around the middle part of the track
+    const SPersistenceTrajectory & from = wholeArea[ 5 ];
+    const SPersistenceTrajectory & to = wholeArea[ wholeArea.size() - 5 ];
+    SGeoBoundingBox box;
+    box.minLatDeg = std::min( from.latDeg, to.latDeg );
+    box.maxLatDeg = std::max( from.latDeg, to.latDeg );
+    box.minLonDeg = std::min( from.lonDeg, to.lonDeg );
+    box.maxLonDeg = std::max( from.lonDeg, to.lonDeg );
+
+    SPersistenceSetFilter sessionFilter( rawMetadataOutput.persistenceSetId );
+    sessionFilter.sessionNum = from.sessionNum;
+    sessionFilter.minLogicStep = 0;
+    sessionFilter.maxLogicStep = std::numeric_limits<TLogicStep>::max();
+
+    for( SPersistenceSetFilter predicateFilter : { filter, sessionFilter } ){
+        for( const std::vector<TObjectId> & objIds : { std::vector<TObjectId>(), std::vector<TObjectId>{ from.objId }, std::vector<TObjectId>{ std::numeric_limits<TObjectId>::max() } } ){
+            predicateFilter.objIds = objIds;
+            predicateFilter.boundingBox = box;
+
+            const TrajectoryPointPredicate predicate( predicateFilter );
+            size_t expectedCount = 0;
+            for( const SPersistenceTrajectory & traj : wholeArea ){
+                if( predicate.accepts(traj)
+                        && (predicateFilter.minLogicStep == common_vars::ALL_LOGIC_STEPS || traj.sessionNum == predicateFilter.sessionNum) ){
+                    expectedCount++;
+                }
+            }
+
+            const std::vector<SPersistenceTrajectory> fromStore = m_database->readTrajectoryData( predicateFilter );
+            const std::vector<SPersistenceTrajectory> fromCache = cachedDatabase->readTrajectoryData( predicateFilter );
+            ASSERT_EQ( expectedCount, fromStore.size() );
+            ASSERT_EQ( expectedCount, fromCache.size() );
+
+            // NOTE: order from store depends on the chosen index
+            for( size_t i = 0; i < fromStore.size(); i++ ){
+                ASSERT_TRUE( box.contains(fromStore[ i ].latDeg, fromStore[ i ].lonDeg) );
+                ASSERT_TRUE( box.contains(fromCache[ i ].latDeg, fromCache[ i ].lonDeg) );
+            }
+        }
+    }
+}
+
+TEST_F(TestDatabaseManagerBase, retention_test_recorder){
+
+    // separate context, cleanup must not touch payload of other tests
+    const TContextId retentionContextId = CONTEXT_ID + 2;
+    m_database->deleteTotalData( retentionContextId );
+    m_database->deleteSessionDescription( retentionContextId );
+    m_database->deletePersistenceSetMetadata( retentionContextId );
+
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = retentionContextId;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 1;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::TRAJECTORY;
+    rawMetadataInput.timeStepIntervalMillisec = QUANTUM_INTERVAL_MILLISEC;
+
+    const TPersistenceSetId persId = m_database->writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    // 4 sessions by 50 steps, the last one ends now
+    const int64_t nowMillisec = common_utils::getCurrentTimeMillisec();
+    vector<SPersistenceTrajectory> dataToWrite;
+    for( TSessionNum sessionNum = 1; sessionNum <= 4; sessionNum++ ){
+        for( TLogicStep step = 0; step < 50; step++ ){
+            SPersistenceTrajectory trajInput;
+            trajInput.objId = 300;
+            trajInput.state = SPersistenceObj::EState::ACTIVE;
+            trajInput.sessionNum = sessionNum;
+            trajInput.logicTime = step;
+            trajInput.astroTimeMillisec = nowMillisec - ( (4 - sessionNum) * 100 + (50 - step) ) * QUANTUM_INTERVAL_MILLISEC;
+            trajInput.latDeg = 40.0;
+            trajInput.lonDeg = 90.0;
+            dataToWrite.push_back( trajInput );
+        }
+    }
+    ASSERT_TRUE( m_database->writeTrajectoryData(persId, dataToWrite) );
+
+    for( const SEventsSessionInfo & descr : m_database->scanPayloadForSessions(persId) ){
+        ASSERT_TRUE( m_database->insertSessionDescription(persId, descr) );
+    }
+    ASSERT_EQ( m_database->selectSessionDescriptions(persId).size(), 4 );
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.retentionEnable = true;
+    settings.retention.checkIntervalMillisec = 0;
+    settings.retention.batchSize = 16;
+    settings.retention.maxBatchesPerSec = 0;
+
+    PDatabase retentionDatabase = makeDatabase( settings );
+    ASSERT_TRUE( retentionDatabase );
+
+    SPersistenceSetFilter filter( persId );
+    filter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+
+    // I last 3 sessions
+    {
+        RetentionEngine::SRetentionPolicy policy;
+        policy.ctxId = retentionContextId;
+        policy.maxSessions = 3;
+        retentionDatabase->setRetentionPolicies( {policy} );
+        retentionDatabase->runRetention();
+
+        const std::vector<SPersistenceTrajectory> rest = m_database->readTrajectoryData( filter );
+        ASSERT_EQ( rest.size(), 3 * 50 );
+        ASSERT_EQ( std::min_element(rest.begin(), rest.end(), FLessSPersistenceTrajectory())->sessionNum, 2 );
+        ASSERT_EQ( m_database->selectSessionDescriptions(persId).size(), 3 );
+        ASSERT_GE( retentionDatabase->getRetentionStats().batchesCount, 50 / 16 );
+    }
+
+    // II by age: session 2 is gone, half of session 3 is gone
+    {
+        RetentionEngine::SRetentionPolicy policy;
+        policy.ctxId = retentionContextId;
+        policy.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+        policy.maxAgeMillisec = 125 * QUANTUM_INTERVAL_MILLISEC;
+        retentionDatabase->setRetentionPolicies( {policy} );
+        retentionDatabase->runRetention();
+
+        const std::vector<SPersistenceTrajectory> rest = m_database->readTrajectoryData( filter );
+        ASSERT_GT( rest.size(), 50 + 20 );
+        ASSERT_LT( rest.size(), 50 + 30 );
+        for( const SPersistenceTrajectory & traj : rest ){
+            ASSERT_GE( traj.sessionNum, 3 );
+        }
+
+        std::vector<SEventsSessionInfo> descrs = m_database->selectSessionDescriptions( persId );
+        std::sort( descrs.begin(), descrs.end(), FLessSEventsSessionInfo() );
+        ASSERT_EQ( descrs.size(), 2 );
+        ASSERT_EQ( descrs[ 0 ].number, 3 );
+        ASSERT_GT( descrs[ 0 ].minLogicStep, 0 );
+    }
+
+    // III whole set is expired
+    {
+        RetentionEngine::SRetentionPolicy policy;
+        policy.ctxId = retentionContextId;
+        policy.maxAgeMillisec = 1;
+        retentionDatabase->setRetentionPolicies( {policy} );
+        retentionDatabase->runRetention();
+
+        ASSERT_TRUE( m_database->getPersistenceSetMetadata(retentionContextId).empty() );
+        ASSERT_EQ( retentionDatabase->getRetentionStats().setsDropped, 1 );
+    }
+}
+
+TEST_F(TestDatabaseManagerBase, live_tail_test_recorder){
+
+    const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = m_database->getPersistenceSetMetadata( CONTEXT_ID );
+    const SPersistenceMetadataRaw & rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+    const TPersistenceSetId persId = rawMetadataOutput.persistenceSetId;
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.liveTailEnable = true;
+    settings.liveTail.maxPendingPoints = 1000;
+
+    PDatabase liveDatabase = makeDatabase( settings );
+    ASSERT_TRUE( liveDatabase );
+
+    std::mutex mutexReceived;
+    std::condition_variable cvReceived;
+    std::vector<SPersistenceTrajectory> receivedAll;
+    std::vector<SPersistenceTrajectory> receivedFiltered;
+
+    auto makeReceiver = [ & ]( std::vector<SPersistenceTrajectory> * _out ){
+        return [ &mutexReceived, &cvReceived, _out ]( TrajectorySubscriptions::TSubscriptionId, const std::vector<SPersistenceTrajectory> & _points ){
+            std::lock_guard<std::mutex> lock( mutexReceived );
+            _out->insert( _out->end(), _points.begin(), _points.end() );
+            cvReceived.notify_all();
+        };
+    };
+
+    const TrajectorySubscriptions::TSubscriptionId idAll = liveDatabase->subscribeTrajectory( persId, {}, makeReceiver(& receivedAll) );
+    const TrajectorySubscriptions::TSubscriptionId idFiltered = liveDatabase->subscribeTrajectory( persId, {125}, makeReceiver(& receivedFiltered) );
+    ASSERT_NE( idAll, TrajectorySubscriptions::INVALID_SUBSCRIPTION_ID );
+    ASSERT_NE( idFiltered, TrajectorySubscriptions::INVALID_SUBSCRIPTION_ID );
+    ASSERT_EQ( liveDatabase->getLiveTailStats().subscribersCount, 2 );
+
+    // 2 objects, the filtered subscriber gets only one of them
+    constexpr int STEPS_COUNT = 20;
+    for( int i = 0; i < STEPS_COUNT; i++ ){
+        vector<SPersistenceTrajectory> step( 2 );
+        for( size_t obj = 0; obj < step.size(); obj++ ){
+            step[ obj ].objId = 125 + obj;
+            step[ obj ].state = SPersistenceObj::EState::ACTIVE;
+            step[ obj ].sessionNum = 3;
+            step[ obj ].logicTime = 500 + i;
+            step[ obj ].astroTimeMillisec = 5000 + i;
+        }
+        ASSERT_TRUE( liveDatabase->writeTrajectoryData(persId, step) );
+    }
+
+    {
+        std::unique_lock<std::mutex> lock( mutexReceived );
+        const bool received = cvReceived.wait_for( lock, std::chrono::seconds(5), [ & ](){
+            return receivedAll.size() == 2 * STEPS_COUNT && receivedFiltered.size() == STEPS_COUNT;
+        });
+        ASSERT_TRUE( received );
+    }
+
+    // write order is kept
+    for( int i = 0; i < STEPS_COUNT; i++ ){
+        ASSERT_EQ( receivedFiltered[ i ].objId, 125 );
+        ASSERT_EQ( receivedFiltered[ i ].logicTime, 500 + i );
+    }
+
+    // no delivery after unsubscribe
+    liveDatabase->unsubscribeTrajectory( idAll );
+    liveDatabase->unsubscribeTrajectory( idFiltered );
+    ASSERT_EQ( liveDatabase->getLiveTailStats().subscribersCount, 0 );
+
+    SPersistenceTrajectory trajInput;
+    trajInput.objId = 125;
+    trajInput.sessionNum = 3;
+    trajInput.logicTime = 500 + STEPS_COUNT;
+    ASSERT_TRUE( liveDatabase->writeTrajectoryData(persId, {trajInput}) );
+
+    {
+        std::lock_guard<std::mutex> lock( mutexReceived );
+        ASSERT_EQ( receivedAll.size(), 2 * STEPS_COUNT );
+        ASSERT_EQ( receivedFiltered.size(), STEPS_COUNT );
+    }
+
+    const TrajectorySubscriptions::SLiveTailStats stats = liveDatabase->getLiveTailStats();
+    ASSERT_EQ( stats.pointsDelivered, 3 * STEPS_COUNT );
+    ASSERT_EQ( stats.pointsDropped, 0 );
+
+    // payload of this test
+    SPersistenceSetFilter filter( persId );
+    filter.sessionNum = 3;
+    filter.minLogicStep = 500;
+    filter.maxLogicStep = 500 + STEPS_COUNT;
+    m_database->deleteDataRange( filter );
+}
+
+TEST_F(TestDatabaseManagerBase, snapshot_test_recorder){
+
+    // separate context, the set is moved out & back
+    const TContextId snapshotContextId = CONTEXT_ID + 3;
+    m_database->deleteTotalData( snapshotContextId );
+    m_database->deleteSessionDescription( snapshotContextId );
+    m_database->deletePersistenceSetMetadata( snapshotContextId );
+
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.clientPoolEnable = true;
+    settings.snapshotImportThreads = 4;
+
+    PDatabase pooledDatabase = makeDatabase( settings );
+    ASSERT_TRUE( pooledDatabase );
+
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = snapshotContextId;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 2;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::TRAJECTORY;
+    rawMetadataInput.timeStepIntervalMillisec = QUANTUM_INTERVAL_MILLISEC;
+
+    const TPersistenceSetId persId = pooledDatabase->writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    vector<SPersistenceTrajectory> dataToWrite;
+    for( TSessionNum sessionNum = 1; sessionNum <= 2; sessionNum++ ){
+        for( TLogicStep step = 0; step < 100; step++ ){
+            for( TObjectId objId = 400; objId < 403; objId++ ){
+                SPersistenceTrajectory trajInput;
+                trajInput.objId = objId;
+                trajInput.state = SPersistenceObj::EState::ACTIVE;
+                trajInput.sessionNum = sessionNum;
+                trajInput.logicTime = step;
+                trajInput.astroTimeMillisec = 10000 + step * QUANTUM_INTERVAL_MILLISEC;
+                trajInput.latDeg = 40.0 + step * 0.001;
+                trajInput.lonDeg = 90.0 + objId * 0.001;
+                dataToWrite.push_back( trajInput );
+            }
+        }
+    }
+    ASSERT_TRUE( pooledDatabase->writeTrajectoryData(persId, dataToWrite) );
+    for( const SEventsSessionInfo & descr : pooledDatabase->scanPayloadForSessions(persId) ){
+        ASSERT_TRUE( pooledDatabase->insertSessionDescription(persId, descr) );
+    }
+
+    const std::string path = "unit_tests_snapshot.bin";
+    ASSERT_TRUE( pooledDatabase->exportSnapshot(persId, path) );
+    ASSERT_TRUE( pooledDatabase->dropPersistenceSet(persId) );
+
+    // dropped id is unknown afterwards
+    ASSERT_FALSE( pooledDatabase->writeTrajectoryData(persId, {dataToWrite.front()}) );
+    ASSERT_FALSE( pooledDatabase->dropPersistenceSet(persId) );
+
+    const TPersistenceSetId importedId = pooledDatabase->importSnapshot( path );
+    ASSERT_NE( importedId, common_vars::INVALID_PERS_ID );
+    ASSERT_NE( importedId, persId );
+
+    SPersistenceSetFilter filter( importedId );
+    filter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+    std::vector<SPersistenceTrajectory> imported = pooledDatabase->readTrajectoryData( filter );
+    ASSERT_EQ( imported.size(), dataToWrite.size() );
+
+    std::sort( imported.begin(), imported.end(), []( const SPersistenceTrajectory & _lhs, const SPersistenceTrajectory & _rhs ){
+        return std::make_tuple( _lhs.sessionNum, _lhs.logicTime, _lhs.objId ) < std::make_tuple( _rhs.sessionNum, _rhs.logicTime, _rhs.objId );
+    });
+    for( size_t i = 0; i < imported.size(); i++ ){
+        ASSERT_EQ( imported[ i ].objId, dataToWrite[ i ].objId );
+        ASSERT_EQ( imported[ i ].astroTimeMillisec, dataToWrite[ i ].astroTimeMillisec );
+        ASSERT_DOUBLE_EQ( imported[ i ].latDeg, dataToWrite[ i ].latDeg );
+    }
+
+    ASSERT_EQ( pooledDatabase->selectSessionDescriptions(importedId).size(), 2 );
+    ASSERT_EQ( pooledDatabase->getPersistenceSetMetadata(snapshotContextId).size(), 1 );
+
+    pooledDatabase.reset();
+    std::remove( path.c_str() );
+}
+
+TEST_F(TestDatabaseManagerBase, weather_test_recorder){
+
+    const TContextId weatherContextId = CONTEXT_ID + 4;
+    m_database->deleteTotalData( weatherContextId );
+    m_database->deleteSessionDescription( weatherContextId );
+    m_database->deletePersistenceSetMetadata( weatherContextId );
+
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = weatherContextId;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 2;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::WEATHER;
+    rawMetadataInput.timeStepIntervalMillisec = QUANTUM_INTERVAL_MILLISEC;
+
+    const TPersistenceSetId persId = m_database->writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    vector<SPersistenceWeather> dataToWrite;
+    for( TSessionNum sessionNum = 1; sessionNum <= 2; sessionNum++ ){
+        for( TLogicStep step = 0; step < 50; step++ ){
+            for( TObjectId objId = 500; objId < 502; objId++ ){
+                SPersistenceWeather weatherInput;
+                weatherInput.objId = objId;
+                weatherInput.state = SPersistenceObj::EState::ACTIVE;
+                weatherInput.sessionNum = sessionNum;
+                weatherInput.logicTime = step;
+                weatherInput.astroTimeMillisec = 10000 + step * QUANTUM_INTERVAL_MILLISEC;
+                weatherInput.windSpeed = 3.0 + step * 0.1;
+                weatherInput.humidity = 0.5 + objId * 0.0001;
+                dataToWrite.push_back( weatherInput );
+            }
+        }
+    }
+    ASSERT_TRUE( m_database->writeWeatherData(persId, dataToWrite) );
+
+    // step range of one session
+    SPersistenceSetFilter filter( persId );
+    filter.sessionNum = 2;
+    filter.minLogicStep = 10;
+    filter.maxLogicStep = 19;
+    std::vector<SPersistenceWeather> weather = m_database->readWeatherData( filter );
+    ASSERT_EQ( weather.size(), 10 * 2 );
+
+    std::sort( weather.begin(), weather.end(), []( const SPersistenceWeather & _lhs, const SPersistenceWeather & _rhs ){
+        return std::make_tuple( _lhs.logicTime, _lhs.objId ) < std::make_tuple( _rhs.logicTime, _rhs.objId );
+    });
+    const SPersistenceWeather & expected = dataToWrite[ 50 * 2 + 10 * 2 ];
+    ASSERT_EQ( weather.front().objId, expected.objId );
+    ASSERT_EQ( weather.front().state, expected.state );
+    ASSERT_EQ( weather.front().sessionNum, expected.sessionNum );
+    ASSERT_EQ( weather.front().logicTime, expected.logicTime );
+    ASSERT_EQ( weather.front().astroTimeMillisec, expected.astroTimeMillisec );
+    ASSERT_DOUBLE_EQ( weather.front().windSpeed, expected.windSpeed );
+    ASSERT_DOUBLE_EQ( weather.front().humidity, expected.humidity );
+
+    // object predicate
+    filter.objIds = { 501 };
+    weather = m_database->readWeatherData( filter );
+    ASSERT_EQ( weather.size(), 10 );
+    for( const SPersistenceWeather & point : weather ){
+        ASSERT_EQ( point.objId, 501 );
+    }
+
+    // whole area
+    SPersistenceSetFilter filterAll( persId );
+    filterAll.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+    ASSERT_EQ( m_database->readWeatherData(filterAll).size(), dataToWrite.size() );
+
+    // streaming read
+    DatabaseManagerBase::PWeatherCursor cursor = m_database->openWeatherCursor( filterAll, 30 );
+    ASSERT_TRUE( cursor );
+    size_t streamed = 0;
+    for( const std::vector<SPersistenceWeather> * batch = & cursor->nextBatch(); ! batch->empty(); batch = & cursor->nextBatch() ){
+        ASSERT_LE( batch->size(), 30 );
+        streamed += batch->size();
+    }
+    ASSERT_EQ( streamed, dataToWrite.size() );
+    ASSERT_TRUE( cursor->getLastError().empty() );
+
+    // session summary follows weather writes as well
+    DatabaseManagerBase::SInitSettings settings = makeSettings();
+    settings.sessionSummaryEnable = true;
+
+    PDatabase summaryDatabase = makeDatabase( settings );
+    ASSERT_TRUE( summaryDatabase );
+    ASSERT_EQ( summaryDatabase->scanPayloadTailForSessions(persId).number, 2 );
+
+    vector<SPersistenceWeather> sessionToWrite;
+    for( TLogicStep step = 0; step < 5; step++ ){
+        SPersistenceWeather weatherInput = dataToWrite.front();
+        weatherInput.sessionNum = 3;
+        weatherInput.logicTime = step;
+        weatherInput.astroTimeMillisec = 30000 + step * QUANTUM_INTERVAL_MILLISEC;
+        sessionToWrite.push_back( weatherInput );
+    }
+    ASSERT_TRUE( summaryDatabase->writeWeatherData(persId, sessionToWrite) );
+
+    const SEventsSessionInfo tail = summaryDatabase->scanPayloadTailForSessions( persId );
+    ASSERT_EQ( tail.number, 3 );
+    ASSERT_EQ( tail.minLogicStep, 0 );
+    ASSERT_EQ( tail.maxLogicStep, 4 );
+
+    // tail description is flushed on close
+    summaryDatabase.reset();
+
+    const vector<SEventsSessionInfo> descriptions = m_database->selectSessionDescriptions( persId );
+    auto iter = std::find_if( descriptions.begin(), descriptions.end(), FEqualSEventsSessionInfo(3) );
+    ASSERT_TRUE( iter != descriptions.end() );
+    ASSERT_EQ( iter->maxLogicStep, 4 );
+    ASSERT_EQ( iter->maxTimestampMillisec, 30000 + 4 * QUANTUM_INTERVAL_MILLISEC );
+}
+
+TEST_F(TestDatabaseManagerBase, write_policy_test){
+
+    BulkWritePolicies policies;
+
+    BulkWritePolicies::SWritePolicy adaptive;
+    adaptive.name = "adaptive";
+    adaptive.targetBulkLatencyMillisec = 10;
+    adaptive.minBulkSize = 100;
+    adaptive.maxBulkSize = 1000;
+    ASSERT_TRUE( policies.setPolicy(1, adaptive) );
+
+    // default policy: whole write in one bulk
+    int32_t bulkSize = 0;
+    ASSERT_EQ( policies.getPolicy(2, bulkSize).name, "default" );
+    ASSERT_EQ( bulkSize, std::numeric_limits<int32_t>::max() );
+
+    // fast bulks -> grows at most x2 per bulk up to the max
+    ASSERT_EQ( policies.getPolicy(1, bulkSize).name, "adaptive" );
+    ASSERT_EQ( bulkSize, 100 );
+    policies.bulkExecuted( 1, 100, 1000, true );
+    policies.getPolicy( 1, bulkSize );
+    ASSERT_EQ( bulkSize, 200 );
+    for( int i = 0; i < 5; i++ ){
+        policies.bulkExecuted( 1, bulkSize, 1000, true );
+        policies.getPolicy( 1, bulkSize );
+    }
+    ASSERT_EQ( bulkSize, 1000 );
+
+    // partial bulk doesn't change the size
+    policies.bulkExecuted( 1, 10, 100000, true );
+    policies.getPolicy( 1, bulkSize );
+    ASSERT_EQ( bulkSize, 1000 );
+
+    // slow bulks -> shrinks at most x0.5 per bulk down to the min
+    policies.bulkExecuted( 1, 1000, 12500, true );
+    policies.getPolicy( 1, bulkSize );
+    ASSERT_EQ( bulkSize, 800 );
+    for( int i = 0; i < 5; i++ ){
+        policies.bulkExecuted( 1, bulkSize, 100000, false );
+        policies.getPolicy( 1, bulkSize );
+    }
+    ASSERT_EQ( bulkSize, 100 );
+
+    // reported per policy name
+    const std::vector<BulkWritePolicies::SPolicyStats> stats = policies.getStats();
+    ASSERT_EQ( stats.size(), 1 );
+    ASSERT_EQ( stats[ 0 ].name, "adaptive" );
+    ASSERT_EQ( stats[ 0 ].bulksCount, 13 );
+    ASSERT_EQ( stats[ 0 ].bulkErrors, 5 );
+    ASSERT_GT( stats[ 0 ].recordsPerSec, 0.0 );
+
+    // invalid size range is rejected, previous policy stays
+    BulkWritePolicies::SWritePolicy invalid = adaptive;
+    invalid.name = "invalid";
+    invalid.minBulkSize = 2000;
+    ASSERT_FALSE( policies.setPolicy(1, invalid) );
+    invalid.minBulkSize = 0;
+    invalid.maxBulkSize = 0;
+    ASSERT_FALSE( policies.setPolicy(1, invalid) );
+    ASSERT_FALSE( policies.setDefaultPolicy(invalid) );
+    ASSERT_EQ( policies.getPolicy(1, bulkSize).name, "adaptive" );
+    ASSERT_EQ( policies.getPolicy(2, bulkSize).name, "default" );
+
+    // bulk never shrinks to zero, even with zero minimum
+    BulkWritePolicies::SWritePolicy tiny = adaptive;
+    tiny.name = "tiny";
+    tiny.minBulkSize = 0;
+    ASSERT_TRUE( policies.setPolicy(3, tiny) );
+    for( int i = 0; i < 5; i++ ){
+        policies.getPolicy( 3, bulkSize );
+        policies.bulkExecuted( 3, bulkSize, 1000000, true );
+    }
+    policies.getPolicy( 3, bulkSize );
+    ASSERT_EQ( bulkSize, 1 );
+}
+
+TEST_F(TestDatabaseManagerBase, write_policy_test_recorder){
+
+    const TContextId policyContextId = CONTEXT_ID + 5;
+    m_database->deleteTotalData( policyContextId );
+    m_database->deleteSessionDescription( policyContextId );
+    m_database->deletePersistenceSetMetadata( policyContextId );
+
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = policyContextId;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 1;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::TRAJECTORY;
+    rawMetadataInput.timeStepIntervalMillisec = QUANTUM_INTERVAL_MILLISEC;
+
+    const TPersistenceSetId persId = m_database->writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    // journaled writes in small adaptive bulks
+    BulkWritePolicies::SWritePolicy recording;
+    recording.name = "recording";
+    recording.ordered = true;
+    recording.journal = true;
+    recording.targetBulkLatencyMillisec = 20;
+    recording.minBulkSize = 100;
+    recording.maxBulkSize = 1000;
+    ASSERT_TRUE( m_database->setWritePolicy(persId, recording) );
+
+    vector<SPersistenceTrajectory> dataToWrite;
+    for( TLogicStep step = 0; step < 500; step++ ){
+        for( TObjectId objId = 600; objId < 610; objId++ ){
+            SPersistenceTrajectory trajInput;
+            trajInput.objId = objId;
+            trajInput.state = SPersistenceObj::EState::ACTIVE;
+            trajInput.sessionNum = 1;
+            trajInput.logicTime = step;
+            trajInput.astroTimeMillisec = 10000 + step * QUANTUM_INTERVAL_MILLISEC;
+            trajInput.latDeg = 40.0;
+            trajInput.lonDeg = 90.0;
+            dataToWrite.push_back( trajInput );
+        }
+    }
+    ASSERT_TRUE( m_database->writeTrajectoryData(persId, dataToWrite) );
+
+    SPersistenceSetFilter filter( persId );
+    filter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+    ASSERT_EQ( m_database->readTrajectoryData(filter).size(), dataToWrite.size() );
+
+    bool reported = false;
+    for( const BulkWritePolicies::SPolicyStats & stats : m_database->getWritePolicyStats() ){
+        if( stats.name == recording.name ){
+            ASSERT_GT( stats.bulksCount, 5 );
+            ASSERT_EQ( stats.recordsWritten, dataToWrite.size() );
+            ASSERT_EQ( stats.bulkErrors, 0 );
+            reported = true;
+        }
+    }
+    ASSERT_TRUE( reported );
+}
+
 // -------------------------------------------------------------------------
 // ... tests
 // -------------------------------------------------------------------------
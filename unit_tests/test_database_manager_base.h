@@ -1,6 +1,8 @@
 #ifndef DATABASE_MANAGER_BASE_TEST_H
 #define DATABASE_MANAGER_BASE_TEST_H
 
+#include <memory>
+
 #include <gtest/gtest.h>
 
 #include "storage/database_manager_base.h"
@@ -15,6 +17,16 @@ protected:
     static void SetUpTestCase();
     static void TearDownTestCase();
 
+    // own instance of a test, destroyed on scope exit ( failed ASSERT included )
+    struct SDatabaseDeleter {
+        void operator()( DatabaseManagerBase * _database ) const { DatabaseManagerBase::destroyInstance( _database ); }
+    };
+    using PDatabase = std::unique_ptr<DatabaseManagerBase, SDatabaseDeleter>;
+
+    static DatabaseManagerBase::SInitSettings makeSettings();
+    // null if init failed
+    static PDatabase makeDatabase( const DatabaseManagerBase::SInitSettings & _settings );
+
 //    void metadata_test_recorder();
 //    void payload_test_recorder();
 //    void description_test_recorder();
@@ -0,0 +1,578 @@
+#include <fstream>
+#include <tuple>
+
+#include <boost/filesystem.hpp>
+#include <microservice_common/system/logger.h>
+
+#include "storage/persistence_snapshot.h"
+#include "test_mapped_storage_engine.h"
+
+using namespace std;
+using namespace common_types;
+
+static const TContextId CONTEXT_ID = 777;
+static const TMissionId MISSION_ID = 555;
+static const int64_t QUANTUM_INTERVAL_MILLISEC = 1000;
+static const std::string STORAGE_DIR = "unit_tests_mapped_storage";
+
+MappedStorageEngine::SInitSettings TestMappedStorageEngine::m_settings;
+MappedStorageEngine * TestMappedStorageEngine::m_storage = nullptr;
+
+TestMappedStorageEngine::TestMappedStorageEngine()
+{
+
+
+}
+
+void TestMappedStorageEngine::SetUpTestCase(){
+
+    boost::filesystem::remove_all( STORAGE_DIR );
+
+    // small segments & stride -> several segments and index entries per set
+    m_settings.directory = STORAGE_DIR;
+    m_settings.segmentMaxBytes = 64 * 1024;
+    m_settings.indexStride = 8;
+
+    m_storage = new MappedStorageEngine();
+    const bool success = m_storage->init( m_settings );
+    assert( success && "storage must be inited properly" );
+}
+
+void TestMappedStorageEngine::TearDownTestCase(){
+
+    delete m_storage;
+    m_storage = nullptr;
+    boost::filesystem::remove_all( STORAGE_DIR );
+}
+
+static TPersistenceSetId writeRawMetadata( IPersistenceStorage * _storage ){
+
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = CONTEXT_ID;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 1;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::TRAJECTORY;
+    rawMetadataInput.timeStepIntervalMillisec = QUANTUM_INTERVAL_MILLISEC;
+
+    return _storage->writePersistenceSetMetadata( rawMetadataInput );
+}
+
+// sessions of '_stepsBySession' size, '_objects' points per step, pause of session is 5 steps
+static vector<SPersistenceTrajectory> makeTrajectories( const vector<int> & _stepsBySession, int _objects ){
+
+    vector<SPersistenceTrajectory> out;
+    SPersistenceTrajectory trajInput;
+    trajInput.ctxId = CONTEXT_ID;
+    trajInput.missionId = MISSION_ID;
+    trajInput.state = SPersistenceObj::EState::ACTIVE;
+    trajInput.latDeg = 40.0f;
+    trajInput.lonDeg = 90.0f;
+    trajInput.height = 0;
+    trajInput.yawDeg = 0;
+    trajInput.astroTimeMillisec = 9000;
+
+    for( size_t s = 0; s < _stepsBySession.size(); s++ ){
+        trajInput.sessionNum = s + 1;
+        trajInput.astroTimeMillisec += 5 * QUANTUM_INTERVAL_MILLISEC;
+
+        for( int step = 0; step < _stepsBySession[ s ]; step++ ){
+            trajInput.logicTime = step;
+            trajInput.astroTimeMillisec += QUANTUM_INTERVAL_MILLISEC;
+
+            for( int obj = 0; obj < _objects; obj++ ){
+                trajInput.objId = 123 + obj;
+                trajInput.latDeg += 0.1f;
+                trajInput.lonDeg += 0.2f;
+                out.push_back( trajInput );
+            }
+        }
+    }
+
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// object trajectory tests
+// -------------------------------------------------------------------------
+TEST_F(TestMappedStorageEngine, metadata_test){
+
+    IPersistenceStorage * storage = m_storage;
+
+    // I check for correct clearing
+    {
+        storage->deleteTotalData( CONTEXT_ID );
+        storage->deleteSessionDescription( CONTEXT_ID );
+        storage->deletePersistenceSetMetadata( CONTEXT_ID );
+
+        ASSERT_TRUE( storage->getPersistenceSetMetadata(CONTEXT_ID).empty() );
+    }
+
+    // II check for correct writing / reading
+    {
+        const TPersistenceSetId persId = writeRawMetadata( storage );
+        ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+        const std::vector<SPersistenceMetadata> ctxPersistenceMetadatas = storage->getPersistenceSetMetadata( CONTEXT_ID );
+        ASSERT_EQ( ctxPersistenceMetadatas.size(), 1 );
+        ASSERT_EQ( ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.size(), 1 );
+
+        SPersistenceMetadataRaw rawMetadataOutput = ctxPersistenceMetadatas[ 0 ].persistenceFromRaw.front();
+        ASSERT_EQ( rawMetadataOutput.persistenceSetId, persId );
+        ASSERT_EQ( rawMetadataOutput.missionId, MISSION_ID );
+
+        // III check for correct updating ( context is immutable )
+        rawMetadataOutput.lastRecordedSession = 2;
+        ASSERT_EQ( storage->writePersistenceSetMetadata(rawMetadataOutput), persId );
+        ASSERT_EQ( storage->getPersistenceSetMetadata(persId).persistenceFromRaw.front().lastRecordedSession, 2 );
+
+        rawMetadataOutput.contextId = CONTEXT_ID + 1;
+        ASSERT_EQ( storage->writePersistenceSetMetadata(rawMetadataOutput), common_vars::INVALID_PERS_ID );
+    }
+}
+
+TEST_F(TestMappedStorageEngine, payload_test){
+
+    IPersistenceStorage * storage = m_storage;
+    storage->deleteTotalData( CONTEXT_ID );
+    storage->deleteSessionDescription( CONTEXT_ID );
+    storage->deletePersistenceSetMetadata( CONTEXT_ID );
+
+    const TPersistenceSetId persId = writeRawMetadata( storage );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    // more than one segment
+    const vector<SPersistenceTrajectory> dataToWrite = makeTrajectories( {150, 100, 40, 30, 30}, 3 );
+    ASSERT_TRUE( storage->writeTrajectoryData(persId, dataToWrite) );
+
+    // I whole area in write order
+    {
+        SPersistenceSetFilter filter( persId );
+        filter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+        const std::vector<SPersistenceTrajectory> dataToRead = storage->readTrajectoryData( filter );
+
+        ASSERT_EQ( dataToWrite.size(), dataToRead.size() );
+        for( size_t i = 0; i < dataToRead.size(); i++ ){
+            ASSERT_EQ( dataToRead[ i ].sessionNum, dataToWrite[ i ].sessionNum );
+            ASSERT_EQ( dataToRead[ i ].logicTime, dataToWrite[ i ].logicTime );
+            ASSERT_EQ( dataToRead[ i ].astroTimeMillisec, dataToWrite[ i ].astroTimeMillisec );
+            ASSERT_EQ( dataToRead[ i ].objId, dataToWrite[ i ].objId );
+            ASSERT_EQ( dataToRead[ i ].state, dataToWrite[ i ].state );
+            ASSERT_DOUBLE_EQ( dataToRead[ i ].latDeg, dataToWrite[ i ].latDeg );
+        }
+    }
+
+    // II one step ( all objects of the step )
+    {
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 2;
+        filter.minLogicStep = 17;
+        filter.maxLogicStep = 17;
+        const std::vector<SPersistenceTrajectory> dataToRead = storage->readTrajectoryData( filter );
+
+        ASSERT_EQ( dataToRead.size(), 3 );
+        for( const SPersistenceTrajectory & traj : dataToRead ){
+            ASSERT_EQ( traj.sessionNum, 2 );
+            ASSERT_EQ( traj.logicTime, 17 );
+        }
+    }
+
+    // III steps range crossing segment border
+    {
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 3;
+        filter.minLogicStep = 5;
+        filter.maxLogicStep = 39;
+        ASSERT_EQ( storage->readTrajectoryData(filter).size(), 35 * 3 );
+    }
+
+    // IV zero-copy view gives the same range
+    {
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 2;
+        filter.minLogicStep = 0;
+        filter.maxLogicStep = 99;
+
+        size_t viewed = 0;
+        m_storage->forEachTrajectoryRange( filter, [ & viewed ]( const SPersistenceTrajectory * _records, size_t _count ){
+            for( size_t i = 0; i < _count; i++ ){
+                EXPECT_EQ( _records[ i ].sessionNum, 2 );
+            }
+            viewed += _count;
+        });
+        ASSERT_EQ( viewed, 100 * 3 );
+    }
+}
+
+TEST_F(TestMappedStorageEngine, description_test){
+
+    // NOTE: metadata & payload already written by previous test
+    IPersistenceStorage * storage = m_storage;
+    const TPersistenceSetId persId = storage->getPersistenceSetMetadata( CONTEXT_ID )[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    // I delete
+    storage->deleteSessionDescription( CONTEXT_ID );
+    ASSERT_TRUE( storage->selectSessionDescriptions(persId).empty() );
+
+    // II create from scan
+    const vector<SEventsSessionInfo> scannedSessionInfo = storage->scanPayloadRangeForSessions( persId, {0, std::numeric_limits<TSessionNum>::max()} );
+    ASSERT_EQ( scannedSessionInfo.size(), 5 );
+    for( const SEventsSessionInfo & descr : scannedSessionInfo ){
+        ASSERT_TRUE( storage->insertSessionDescription(persId, descr) );
+    }
+    ASSERT_FALSE( storage->insertSessionDescription(persId, scannedSessionInfo.front()) );
+
+    const vector<SEventsSessionInfo> storedSessionInfo = storage->selectSessionDescriptions( persId );
+    ASSERT_EQ( storedSessionInfo.size(), 5 );
+    ASSERT_EQ( storedSessionInfo[ 0 ].minLogicStep, 0 );
+    ASSERT_EQ( storedSessionInfo[ 0 ].maxLogicStep, 149 );
+    ASSERT_EQ( storedSessionInfo[ 4 ].maxLogicStep, 29 );
+
+    // III head / tail
+    ASSERT_EQ( storage->scanPayloadHeadForSessions(persId).number, 1 );
+    ASSERT_EQ( storage->scanPayloadTailForSessions(persId).number, 5 );
+
+    // IV continuation of the last session with gap -> tail update
+    vector<SPersistenceTrajectory> data = makeTrajectories( {0, 0, 0, 0, 10}, 1 );
+    for( SPersistenceTrajectory & traj : data ){
+        traj.logicTime += 40;
+    }
+    ASSERT_TRUE( storage->writeTrajectoryData(persId, data) );
+
+    const SEventsSessionInfo scannedTailSession = storage->scanPayloadTailForSessions( persId );
+    ASSERT_EQ( scannedTailSession.number, 5 );
+    ASSERT_EQ( scannedTailSession.maxLogicStep, 49 );
+    ASSERT_TRUE( storage->updateSessionDescription(persId, scannedTailSession) );
+    ASSERT_EQ( storage->selectSessionDescriptions(persId).back().maxLogicStep, 49 );
+
+    // gap split sees the hole in session 5
+    ASSERT_EQ( storage->scanPayloadForSessions(persId).size(), 6 );
+}
+
+TEST_F(TestMappedStorageEngine, downsample_test){
+
+    const TPersistenceSetId persId = m_storage->getPersistenceSetMetadata( CONTEXT_ID )[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    // session 2: 100 steps, 3 objects
+    SPersistenceSetFilter filter( persId );
+    filter.sessionNum = 2;
+    filter.minLogicStep = 0;
+    filter.maxLogicStep = 99;
+    const std::vector<SPersistenceTrajectory> session = m_storage->readTrajectoryData( filter );
+
+    filter.bucketLogicSteps = 10;
+
+    // first / last of each object in bucket
+    filter.downsampleMode = EDownsampleMode::FIRST;
+    const std::vector<SPersistenceTrajectory> firsts = m_storage->readTrajectoryData( filter );
+    filter.downsampleMode = EDownsampleMode::LAST;
+    const std::vector<SPersistenceTrajectory> lasts = m_storage->readTrajectoryData( filter );
+
+    ASSERT_EQ( firsts.size(), 10 * 3 );
+    ASSERT_EQ( lasts.size(), 10 * 3 );
+    for( size_t i = 0; i < firsts.size(); i++ ){
+        ASSERT_EQ( firsts[ i ].logicTime % 10, 0 );
+        ASSERT_EQ( lasts[ i ].logicTime % 10, 9 );
+        ASSERT_EQ( firsts[ i ].objId, lasts[ i ].objId );
+    }
+
+    // average over bucket
+    filter.downsampleMode = EDownsampleMode::AVG;
+    const std::vector<SPersistenceTrajectory> avgs = m_storage->readTrajectoryData( filter );
+    ASSERT_EQ( avgs.size(), 10 * 3 );
+
+    double latSum = 0;
+    for( const SPersistenceTrajectory & traj : session ){
+        if( traj.logicTime < 10 && traj.objId == avgs[ 0 ].objId ){
+            latSum += traj.latDeg;
+        }
+    }
+    ASSERT_NEAR( avgs[ 0 ].latDeg, latSum / 10, 1e-9 );
+    ASSERT_EQ( avgs[ 0 ].logicTime, 0 );
+
+    // time buckets: session 2 steps are 1 sec apart
+    filter.bucketLogicSteps = 0;
+    filter.bucketMillisec = 20 * QUANTUM_INTERVAL_MILLISEC;
+    filter.downsampleMode = EDownsampleMode::FIRST;
+    const std::vector<SPersistenceTrajectory> byTime = m_storage->readTrajectoryData( filter );
+    ASSERT_GE( byTime.size(), 5 * 3 );
+    ASSERT_LE( byTime.size(), 6 * 3 );
+}
+
+TEST_F(TestMappedStorageEngine, point_predicate_test){
+
+    const TPersistenceSetId persId = m_storage->getPersistenceSetMetadata( CONTEXT_ID )[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    SPersistenceSetFilter filter( persId );
+    filter.sessionNum = 2;
+    filter.minLogicStep = 0;
+    filter.maxLogicStep = 99;
+    const std::vector<SPersistenceTrajectory> session = m_storage->readTrajectoryData( filter );
+    ASSERT_EQ( session.size(), 100 * 3 );
+
+    // objects
+    filter.objIds = { 124, 125 };
+    std::vector<SPersistenceTrajectory> objects = m_storage->readTrajectoryData( filter );
+    ASSERT_EQ( objects.size(), 100 * 2 );
+    for( const SPersistenceTrajectory & traj : objects ){
+        ASSERT_NE( traj.objId, 123 );
+    }
+
+    // bounding box over the middle of the session
+    filter.objIds.clear();
+    filter.boundingBox.minLatDeg = session[ 90 ].latDeg;
+    filter.boundingBox.maxLatDeg = session[ 149 ].latDeg;
+    filter.boundingBox.minLonDeg = session[ 90 ].lonDeg;
+    filter.boundingBox.maxLonDeg = session[ 149 ].lonDeg;
+    const std::vector<SPersistenceTrajectory> inBox = m_storage->readTrajectoryData( filter );
+    ASSERT_EQ( inBox.size(), 60 );
+    ASSERT_EQ( inBox.front().logicTime, session[ 90 ].logicTime );
+    ASSERT_EQ( inBox.back().logicTime, session[ 149 ].logicTime );
+
+    // both
+    filter.objIds = { 123 };
+    const std::vector<SPersistenceTrajectory> objectInBox = m_storage->readTrajectoryData( filter );
+    ASSERT_EQ( objectInBox.size(), 20 );
+    for( const SPersistenceTrajectory & traj : objectInBox ){
+        ASSERT_EQ( traj.objId, 123 );
+        ASSERT_TRUE( filter.boundingBox.contains(traj.latDeg, traj.lonDeg) );
+    }
+
+    // nothing
+    filter.objIds = { 1 };
+    ASSERT_TRUE( m_storage->readTrajectoryData(filter).empty() );
+}
+
+TEST_F(TestMappedStorageEngine, reopen_test){
+
+    const TPersistenceSetId persId = m_storage->getPersistenceSetMetadata( CONTEXT_ID )[ 0 ].persistenceFromRaw.front().persistenceSetId;
+
+    SPersistenceSetFilter filter( persId );
+    filter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+    const std::vector<SPersistenceTrajectory> before = m_storage->readTrajectoryData( filter );
+    const std::vector<SEventsSessionInfo> descrBefore = m_storage->selectSessionDescriptions( persId );
+
+    // everything is restored from directory
+    delete m_storage;
+    m_storage = new MappedStorageEngine();
+    ASSERT_TRUE( m_storage->init(m_settings) );
+
+    const std::vector<SPersistenceTrajectory> after = m_storage->readTrajectoryData( filter );
+    ASSERT_EQ( before.size(), after.size() );
+    for( size_t i = 0; i < after.size(); i++ ){
+        ASSERT_EQ( before[ i ].sessionNum, after[ i ].sessionNum );
+        ASSERT_EQ( before[ i ].logicTime, after[ i ].logicTime );
+        ASSERT_EQ( before[ i ].objId, after[ i ].objId );
+    }
+
+    const std::vector<SEventsSessionInfo> descrAfter = m_storage->selectSessionDescriptions( persId );
+    ASSERT_EQ( descrBefore.size(), descrAfter.size() );
+    for( size_t i = 0; i < descrAfter.size(); i++ ){
+        ASSERT_EQ( descrBefore[ i ].number, descrAfter[ i ].number );
+        ASSERT_EQ( descrBefore[ i ].maxLogicStep, descrAfter[ i ].maxLogicStep );
+    }
+
+    // ids are not reused
+    ASSERT_GT( writeRawMetadata(m_storage), persId );
+}
+
+TEST_F(TestMappedStorageEngine, snapshot_test){
+
+    const TPersistenceSetId persId = writeRawMetadata( m_storage );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    constexpr int OBJECTS = 5;
+    const vector<SPersistenceTrajectory> source = makeTrajectories( {30, 40, 20}, OBJECTS );
+    ASSERT_TRUE( m_storage->writeTrajectoryData(persId, source) );
+    for( const SEventsSessionInfo & descr : m_storage->scanPayloadForSessions(persId) ){
+        ASSERT_TRUE( m_storage->insertSessionDescription(persId, descr) );
+    }
+
+    // small blocks -> several blocks per session
+    const std::string path = STORAGE_DIR + "/set.snapshot";
+    PersistenceSnapshot::SExportSettings exportSettings;
+    exportSettings.storage = m_storage;
+    exportSettings.persId = persId;
+    exportSettings.path = path;
+    exportSettings.pointsPerBlock = 64;
+    ASSERT_TRUE( PersistenceSnapshot::exportSet(exportSettings) );
+
+    SPersistenceSetFilter allFilter( persId );
+    allFilter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+
+    auto lessPoint = []( const SPersistenceTrajectory & _lhs, const SPersistenceTrajectory & _rhs ){
+        return std::make_tuple( _lhs.sessionNum, _lhs.logicTime, _lhs.objId ) < std::make_tuple( _rhs.sessionNum, _rhs.logicTime, _rhs.objId );
+    };
+
+    // I read without import
+    {
+        PersistenceSnapshot snapshot;
+        ASSERT_TRUE( snapshot.open(path) );
+        ASSERT_EQ( snapshot.getPointsCount(), source.size() );
+        ASSERT_GT( snapshot.getBlocks().size(), 3 );
+        ASSERT_EQ( snapshot.getDescr().contextId, CONTEXT_ID );
+        ASSERT_EQ( snapshot.getMetadata().persistenceFromRaw.size(), 1 );
+        ASSERT_EQ( snapshot.selectSessionDescriptions().size(), 3 );
+
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 2;
+        filter.minLogicStep = 17;
+        filter.maxLogicStep = 17;
+        const std::vector<SPersistenceTrajectory> step = snapshot.readTrajectoryData( filter );
+        ASSERT_EQ( step.size(), OBJECTS );
+        for( const SPersistenceTrajectory & traj : step ){
+            ASSERT_EQ( traj.sessionNum, 2 );
+            ASSERT_EQ( traj.logicTime, 17 );
+        }
+
+        const std::vector<SPersistenceTrajectory> stored = m_storage->readTrajectoryData( allFilter );
+        const std::vector<SPersistenceTrajectory> mapped = snapshot.readTrajectoryData( allFilter );
+        ASSERT_EQ( stored.size(), mapped.size() );
+        for( size_t i = 0; i < mapped.size(); i++ ){
+            ASSERT_EQ( stored[ i ].sessionNum, mapped[ i ].sessionNum );
+            ASSERT_EQ( stored[ i ].logicTime, mapped[ i ].logicTime );
+            ASSERT_EQ( stored[ i ].objId, mapped[ i ].objId );
+            ASSERT_EQ( stored[ i ].astroTimeMillisec, mapped[ i ].astroTimeMillisec );
+            ASSERT_DOUBLE_EQ( stored[ i ].latDeg, mapped[ i ].latDeg );
+            ASSERT_DOUBLE_EQ( stored[ i ].lonDeg, mapped[ i ].lonDeg );
+        }
+    }
+
+    // II import by parallel writers
+    {
+        PersistenceSnapshot::SImportSettings importSettings;
+        importSettings.storage = m_storage;
+        importSettings.path = path;
+        importSettings.threads = 4;
+        const TPersistenceSetId importedId = PersistenceSnapshot::importSet( importSettings );
+        ASSERT_NE( importedId, common_vars::INVALID_PERS_ID );
+        ASSERT_NE( importedId, persId );
+
+        SPersistenceSetFilter importedFilter( importedId );
+        importedFilter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+        std::vector<SPersistenceTrajectory> imported = m_storage->readTrajectoryData( importedFilter );
+        std::vector<SPersistenceTrajectory> stored = m_storage->readTrajectoryData( allFilter );
+        std::sort( imported.begin(), imported.end(), lessPoint );
+        std::sort( stored.begin(), stored.end(), lessPoint );
+        ASSERT_EQ( imported.size(), stored.size() );
+        for( size_t i = 0; i < imported.size(); i++ ){
+            ASSERT_EQ( imported[ i ].sessionNum, stored[ i ].sessionNum );
+            ASSERT_EQ( imported[ i ].logicTime, stored[ i ].logicTime );
+            ASSERT_EQ( imported[ i ].objId, stored[ i ].objId );
+        }
+        ASSERT_EQ( m_storage->selectSessionDescriptions(importedId).size(), 3 );
+    }
+
+    // III damaged block is detected on read, not on open
+    {
+        PersistenceSnapshot snapshot;
+        ASSERT_TRUE( snapshot.open(path) );
+        const uint64_t damagedOffset = snapshot.getBlocks()[ 1 ].offset + 20;
+        snapshot.close();
+
+        std::fstream file( path, std::ios::in | std::ios::out | std::ios::binary );
+        file.seekg( damagedOffset );
+        const char byte = file.get();
+        file.seekp( damagedOffset );
+        file.put( byte ^ 0x5A );
+        file.close();
+
+        ASSERT_TRUE( snapshot.open(path) );
+        ASSERT_FALSE( snapshot.replay([]( const std::vector<SPersistenceTrajectory> & ){ return true; }) );
+        ASSERT_LT( snapshot.readTrajectoryData(allFilter).size(), source.size() );
+    }
+}
+
+TEST_F(TestMappedStorageEngine, delete_range_test){
+
+    const TPersistenceSetId persId = writeRawMetadata( m_storage );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    constexpr int OBJECTS = 3;
+    const vector<SPersistenceTrajectory> source = makeTrajectories( {400, 100, 40}, OBJECTS );
+    ASSERT_TRUE( m_storage->writeTrajectoryData(persId, source) );
+
+    SPersistenceSetFilter allFilter( persId );
+    allFilter.minLogicStep = common_vars::ALL_LOGIC_STEPS;
+
+    auto readSession = [ & ]( TSessionNum _session, TLogicStep _maxStep ){
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = _session;
+        filter.minLogicStep = 0;
+        filter.maxLogicStep = _maxStep;
+        return m_storage->readTrajectoryData( filter );
+    };
+
+    // I steps range of one session, other sessions are intact
+    {
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 2;
+        filter.minLogicStep = 10;
+        filter.maxLogicStep = 19;
+        m_storage->deleteDataRange( filter );
+
+        ASSERT_TRUE( m_storage->readTrajectoryData(filter).empty() );
+        ASSERT_EQ( readSession(1, 399).size(), 400 * OBJECTS );
+        ASSERT_EQ( readSession(2, 99).size(), 90 * OBJECTS );
+        ASSERT_EQ( readSession(3, 39).size(), 40 * OBJECTS );
+        ASSERT_EQ( m_storage->readTrajectoryData(allFilter).size(), source.size() - 10 * OBJECTS );
+    }
+
+    // II one object over the session crossing segment border
+    {
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 1;
+        filter.minLogicStep = 0;
+        filter.maxLogicStep = 399;
+        filter.objIds = { 124 };
+        m_storage->deleteDataRange( filter );
+
+        const std::vector<SPersistenceTrajectory> session = readSession( 1, 399 );
+        ASSERT_EQ( session.size(), 400 * (OBJECTS - 1) );
+        for( const SPersistenceTrajectory & traj : session ){
+            ASSERT_NE( traj.objId, 124 );
+        }
+
+        // order is kept -> step reads by index still work
+        SPersistenceSetFilter stepFilter( persId );
+        stepFilter.sessionNum = 1;
+        stepFilter.minLogicStep = 350;
+        stepFilter.maxLogicStep = 350;
+        ASSERT_EQ( m_storage->readTrajectoryData(stepFilter).size(), OBJECTS - 1 );
+    }
+
+    // III whole area
+    {
+        m_storage->deleteDataRange( allFilter );
+        ASSERT_TRUE( m_storage->readTrajectoryData(allFilter).empty() );
+    }
+}
+
+TEST_F(TestMappedStorageEngine, playback_test){
+
+    // timing of playback is in TestStorageBenchmark.mapped_playback_benchmark
+    IPersistenceStorage * storage = m_storage;
+    const TPersistenceSetId persId = writeRawMetadata( storage );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    constexpr int STEPS = 200;
+    constexpr int OBJECTS = 50;
+    ASSERT_TRUE( storage->writeTrajectoryData(persId, makeTrajectories({STEPS}, OBJECTS)) );
+
+    // step-by-step playback as player does it
+    for( int step = 0; step < STEPS; step++ ){
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 1;
+        filter.minLogicStep = step;
+        filter.maxLogicStep = step;
+        const std::vector<SPersistenceTrajectory> points = storage->readTrajectoryData( filter );
+        ASSERT_EQ( points.size(), OBJECTS );
+        for( const SPersistenceTrajectory & point : points ){
+            ASSERT_EQ( point.logicTime, step );
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// ... tests
+// -------------------------------------------------------------------------
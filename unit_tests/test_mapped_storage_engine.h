@@ -0,0 +1,22 @@
+#ifndef MAPPED_STORAGE_ENGINE_TEST_H
+#define MAPPED_STORAGE_ENGINE_TEST_H
+
+#include <gtest/gtest.h>
+
+#include "storage/mapped_storage_engine.h"
+
+class TestMappedStorageEngine : public ::testing::Test
+{
+public:
+    TestMappedStorageEngine();
+
+
+protected:
+    static void SetUpTestCase();
+    static void TearDownTestCase();
+
+    static MappedStorageEngine::SInitSettings m_settings;
+    static MappedStorageEngine * m_storage;
+};
+
+#endif // MAPPED_STORAGE_ENGINE_TEST_H
@@ -0,0 +1,458 @@
+#include <chrono>
+#include <tuple>
+#include <cstdlib>
+
+#include <boost/filesystem.hpp>
+#include <microservice_common/system/logger.h>
+
+#include "storage/bson_record_decoder.h"
+#include "storage/database_manager_base.h"
+#include "storage/payload_schema.h"
+#include "storage/mapped_storage_engine.h"
+#include "system/wal_record_codec.h"
+#include "test_storage_benchmark.h"
+
+using namespace std;
+using namespace common_types;
+
+static const TContextId CONTEXT_ID = 888;
+static const TMissionId MISSION_ID = 555;
+static const std::string STORAGE_DIR = "unit_tests_benchmark_storage";
+
+static int32_t getEnvInt( const char * _name, int32_t _default ){
+
+    const char * value = std::getenv( _name );
+    return ( value && value[ 0 ] != '\0' ) ? std::atoi( value ) : _default;
+}
+
+TestStorageBenchmark::TestStorageBenchmark()
+{
+
+
+}
+
+StorageBenchmark::SInitSettings TestStorageBenchmark::makeSettings( const std::string & _backendName ){
+
+    StorageBenchmark::SInitSettings settings;
+    settings.backendName = _backendName;
+    settings.ctxId = CONTEXT_ID;
+    settings.missionId = MISSION_ID;
+    settings.objectsPerStep = getEnvInt( "STORAGE_BENCHMARK_OBJECTS", 50 );
+    settings.stepsPerSession = getEnvInt( "STORAGE_BENCHMARK_STEPS", 200 );
+    settings.sessionsPerSet = getEnvInt( "STORAGE_BENCHMARK_SESSIONS", 2 );
+    settings.concurrentThreads = getEnvInt( "STORAGE_BENCHMARK_THREADS", 4 );
+    settings.pointReads = 200;
+    settings.rangeReads = 50;
+    settings.rangeSteps = 50;
+    settings.sessionScans = 5;
+    settings.metadataLookups = 200;
+    settings.concurrentOpsPerThread = 100;
+
+    const char * reportDir = std::getenv( "STORAGE_BENCHMARK_REPORT_DIR" );
+    if( reportDir && reportDir[ 0 ] != '\0' ){
+        settings.reportPath = std::string( reportDir ) + "/storage_benchmark_" + _backendName + ".json";
+    }
+
+    return settings;
+}
+
+TEST_F(TestStorageBenchmark, mapped_storage_benchmark){
+
+    boost::filesystem::remove_all( STORAGE_DIR );
+
+    MappedStorageEngine::SInitSettings storageSettings;
+    storageSettings.directory = STORAGE_DIR;
+
+    MappedStorageEngine storage;
+    ASSERT_TRUE( storage.init(storageSettings) );
+
+    StorageBenchmark::SInitSettings settings = makeSettings( "mapped" );
+    settings.storage = & storage;
+
+    StorageBenchmark benchmark;
+    StorageBenchmark::SResult result;
+    ASSERT_TRUE( benchmark.run(settings, result) );
+
+    const int64_t pointsCount = (int64_t)settings.objectsPerStep * settings.stepsPerSession * settings.sessionsPerSet;
+    ASSERT_EQ( result.ingestPoints, pointsCount );
+    ASSERT_EQ( result.pointRead.count, settings.pointReads );
+    ASSERT_EQ( result.pointReadPoints, (int64_t)settings.pointReads * settings.objectsPerStep );
+    ASSERT_EQ( result.rangeReadPoints, (int64_t)settings.rangeReads * settings.rangeSteps * settings.objectsPerStep );
+    ASSERT_EQ( result.concurrentRead.count + result.concurrentWrite.count, (int64_t)settings.concurrentThreads * settings.concurrentOpsPerThread );
+    ASSERT_LE( result.pointRead.p50Nanosec, result.pointRead.p99Nanosec );
+
+    boost::filesystem::remove_all( STORAGE_DIR );
+}
+
+TEST_F(TestStorageBenchmark, mapped_playback_benchmark){
+
+    boost::filesystem::remove_all( STORAGE_DIR );
+
+    MappedStorageEngine::SInitSettings storageSettings;
+    storageSettings.directory = STORAGE_DIR;
+
+    MappedStorageEngine storage;
+    ASSERT_TRUE( storage.init(storageSettings) );
+
+    SPersistenceMetadataRaw rawMetadataInput;
+    rawMetadataInput.contextId = CONTEXT_ID;
+    rawMetadataInput.missionId = MISSION_ID;
+    rawMetadataInput.lastRecordedSession = 1;
+    rawMetadataInput.sourceType = common_types::EPersistenceSourceType::AUTONOMOUS_RECORDER;
+    rawMetadataInput.dataType = EPersistenceDataType::TRAJECTORY;
+    rawMetadataInput.timeStepIntervalMillisec = 1000;
+
+    const TPersistenceSetId persId = storage.writePersistenceSetMetadata( rawMetadataInput );
+    ASSERT_NE( persId, common_vars::INVALID_PERS_ID );
+
+    constexpr int32_t steps = 2000;
+    constexpr int32_t objects = 50;
+
+    std::vector<SPersistenceTrajectory> data;
+    data.reserve( (size_t)steps * objects );
+    SPersistenceTrajectory trajInput;
+    trajInput.ctxId = CONTEXT_ID;
+    trajInput.missionId = MISSION_ID;
+    trajInput.state = SPersistenceObj::EState::ACTIVE;
+    trajInput.sessionNum = 1;
+    for( int32_t step = 0; step < steps; step++ ){
+        trajInput.logicTime = step;
+        trajInput.astroTimeMillisec = 10000 + step * 1000;
+        for( int32_t obj = 0; obj < objects; obj++ ){
+            trajInput.objId = 123 + obj;
+            trajInput.latDeg = 40.0 + step * 0.001;
+            trajInput.lonDeg = 90.0 + obj * 0.001;
+            data.push_back( trajInput );
+        }
+    }
+    ASSERT_TRUE( storage.writeTrajectoryData(persId, data) );
+
+    // step-by-step playback as player does it
+    int64_t records = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for( int32_t step = 0; step < steps; step++ ){
+        SPersistenceSetFilter filter( persId );
+        filter.sessionNum = 1;
+        filter.minLogicStep = step;
+        filter.maxLogicStep = step;
+        records += storage.readTrajectoryData( filter ).size();
+    }
+    const double sec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    VS_LOG_INFO << "mapped storage playback, steps/sec: " << (int64_t)(steps / sec)
+                << " records/sec: " << (int64_t)(records / sec)
+                << endl;
+
+    ASSERT_EQ( records, (int64_t)steps * objects );
+
+    boost::filesystem::remove_all( STORAGE_DIR );
+}
+
+TEST_F(TestStorageBenchmark, database_benchmark){
+
+    DatabaseManagerBase::SInitSettings databaseSettings;
+    databaseSettings.host = "localhost";
+    databaseSettings.databaseName = "unit_tests";
+    databaseSettings.clientPoolEnable = true;
+
+    DatabaseManagerBase * database = DatabaseManagerBase::getInstance();
+    ASSERT_TRUE( database->init(databaseSettings) );
+
+    // durability vs speed of ingest
+    BulkWritePolicies::SWritePolicy simulation;
+    simulation.name = "simulation";
+    simulation.fireAndForget = true;
+    simulation.targetBulkLatencyMillisec = 50;
+
+    BulkWritePolicies::SWritePolicy recording;
+    recording.name = "recording";
+    recording.journal = true;
+    recording.targetBulkLatencyMillisec = 50;
+
+    const std::vector<std::tuple<std::string, EPersistenceStorageLayout, BulkWritePolicies::SWritePolicy>> runs = {
+        std::make_tuple( "mongo", EPersistenceStorageLayout::DOCUMENT_PER_POINT, BulkWritePolicies::SWritePolicy() ),
+        std::make_tuple( "mongo_chunked", EPersistenceStorageLayout::CHUNK_PER_STEP, BulkWritePolicies::SWritePolicy() ),
+        std::make_tuple( "mongo_simulation", EPersistenceStorageLayout::DOCUMENT_PER_POINT, simulation ),
+        std::make_tuple( "mongo_recording", EPersistenceStorageLayout::DOCUMENT_PER_POINT, recording )
+    };
+
+    for( const auto & run : runs ){
+        const BulkWritePolicies::SWritePolicy policy = std::get<2>( run );
+
+        StorageBenchmark::SInitSettings settings = makeSettings( std::get<0>(run) );
+        settings.storage = database;
+        settings.storageLayout = std::get<1>( run );
+        settings.setCreatedFunc = [ database, policy ]( TPersistenceSetId _persId ){ database->setWritePolicy( _persId, policy ); };
+        settings.sessionsFunc = [ database ]( TPersistenceSetId _persId ){ return database->getPersistenceSetSessions( _persId ); };
+        settings.threadExitFunc = [ database ](){ database->releaseThreadHandles(); };
+
+        StorageBenchmark benchmark;
+        StorageBenchmark::SResult result;
+        ASSERT_TRUE( benchmark.run(settings, result) );
+
+        ASSERT_EQ( result.ingestPoints, (int64_t)settings.objectsPerStep * settings.stepsPerSession * settings.sessionsPerSet );
+        // unacknowledged points may be not visible yet
+        if( ! policy.fireAndForget ){
+            ASSERT_EQ( result.pointReadPoints, (int64_t)settings.pointReads * settings.objectsPerStep );
+        }
+    }
+
+    for( const BulkWritePolicies::SPolicyStats & stats : database->getWritePolicyStats() ){
+        VS_LOG_INFO << "write policy [" << stats.name << "]"
+                    << " bulks: " << stats.bulksCount
+                    << " errors: " << stats.bulkErrors
+                    << " last bulk size: " << stats.lastBulkSize
+                    << " records/sec: " << (int64_t)stats.recordsPerSec
+                    << endl;
+    }
+
+    DatabaseManagerBase::destroyInstance( database );
+}
+
+// decoding as it was done before BsonRecordDecoder ( lookup of each field by name )
+static void decodeTrajectoryByName( const bson_t * _doc, SPersistenceTrajectory & _out ){
+    using namespace common_vars::mongo_fields::analytic;
+
+    bson_iter_t iter;
+
+    bson_iter_init_find( & iter, _doc, detected_object::OBJRERP_ID.c_str() );
+    _out.objId = bson_iter_int64( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::ASTRO_TIME.c_str() );
+    _out.astroTimeMillisec = bson_iter_int64( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::LOGIC_TIME.c_str() );
+    _out.logicTime = bson_iter_int64( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::SESSION.c_str() );
+    _out.sessionNum = bson_iter_int32( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::STATE.c_str() );
+    _out.state = (SPersistenceObj::EState)bson_iter_int32( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::LAT.c_str() );
+    _out.latDeg = bson_iter_double( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::LON.c_str() );
+    _out.lonDeg = bson_iter_double( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::HEIGHT.c_str() );
+    _out.height = bson_iter_double( & iter );
+    bson_iter_init_find( & iter, _doc, detected_object::YAW.c_str() );
+    _out.yawDeg = bson_iter_double( & iter );
+}
+
+TEST_F(TestStorageBenchmark, decode_benchmark){
+    using namespace common_vars::mongo_fields::analytic;
+
+    // documents as they come from store ( '_id' first, then fields in write order )
+    constexpr int DOCS_COUNT = 200000;
+    std::vector<bson_t *> docs;
+    docs.reserve( DOCS_COUNT );
+    for( int i = 0; i < DOCS_COUNT; i++ ){
+        bson_oid_t oid;
+        bson_oid_init( & oid, nullptr );
+        docs.push_back( BCON_NEW( "_id", BCON_OID( & oid ),
+                                  detected_object::OBJRERP_ID.c_str(), BCON_INT64( 100 + i % 50 ),
+                                  detected_object::STATE.c_str(), BCON_INT32( (int32_t)SPersistenceObj::EState::ACTIVE ),
+                                  detected_object::ASTRO_TIME.c_str(), BCON_INT64( 10000 + i ),
+                                  detected_object::LOGIC_TIME.c_str(), BCON_INT64( i / 50 ),
+                                  detected_object::SESSION.c_str(), BCON_INT32( 1 ),
+                                  detected_object::LAT.c_str(), BCON_DOUBLE( 40.0 + i * 0.0001 ),
+                                  detected_object::LON.c_str(), BCON_DOUBLE( 90.0 + i * 0.0001 ),
+                                  detected_object::HEIGHT.c_str(), BCON_DOUBLE( 100.0 ),
+                                  detected_object::YAW.c_str(), BCON_DOUBLE( 15.0 ) ) );
+    }
+
+    // before: struct per document, lookup by name, push_back
+    std::vector<SPersistenceTrajectory> before;
+    const auto beforeStart = std::chrono::steady_clock::now();
+    for( const bson_t * doc : docs ){
+        SPersistenceTrajectory detectedObject;
+        decodeTrajectoryByName( doc, detectedObject );
+        before.push_back( detectedObject );
+    }
+    const double beforeSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - beforeStart ).count();
+
+    // after: one pass per document into preallocated storage
+    std::vector<SPersistenceTrajectory> after;
+    const auto afterStart = std::chrono::steady_clock::now();
+    after.reserve( docs.size() );
+    for( const bson_t * doc : docs ){
+        BsonRecordDecoder<SPersistenceTrajectory>::decodeAppend( doc, after );
+    }
+    const double afterSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - afterStart ).count();
+
+    VS_LOG_INFO << "decode benchmark, records/sec before: " << (int64_t)(DOCS_COUNT / beforeSec)
+                << " after: " << (int64_t)(DOCS_COUNT / afterSec)
+                << endl;
+
+    ASSERT_EQ( before.size(), after.size() );
+    for( size_t i = 0; i < after.size(); i++ ){
+        ASSERT_EQ( after[ i ].objId, before[ i ].objId );
+        ASSERT_EQ( after[ i ].state, before[ i ].state );
+        ASSERT_EQ( after[ i ].astroTimeMillisec, before[ i ].astroTimeMillisec );
+        ASSERT_EQ( after[ i ].logicTime, before[ i ].logicTime );
+        ASSERT_EQ( after[ i ].sessionNum, before[ i ].sessionNum );
+        ASSERT_EQ( after[ i ].latDeg, before[ i ].latDeg );
+        ASSERT_EQ( after[ i ].yawDeg, before[ i ].yawDeg );
+    }
+
+    for( bson_t * doc : docs ){
+        bson_destroy( doc );
+    }
+}
+
+TEST_F(TestStorageBenchmark, payload_schema_benchmark){
+
+    // schema-generated weather codec vs hand-written trajectory path ( same number of fields per document )
+    constexpr int DOCS_COUNT = 200000;
+
+    std::vector<SPersistenceTrajectory> trajectory( DOCS_COUNT );
+    std::vector<SPersistenceWeather> weather( DOCS_COUNT );
+    for( int i = 0; i < DOCS_COUNT; i++ ){
+        trajectory[ i ].objId = weather[ i ].objId = 100 + i % 50;
+        trajectory[ i ].state = weather[ i ].state = SPersistenceObj::EState::ACTIVE;
+        trajectory[ i ].astroTimeMillisec = weather[ i ].astroTimeMillisec = 10000 + i;
+        trajectory[ i ].logicTime = weather[ i ].logicTime = i / 50;
+        trajectory[ i ].sessionNum = weather[ i ].sessionNum = 1;
+        trajectory[ i ].latDeg = weather[ i ].windSpeed = 40.0 + i * 0.0001;
+        trajectory[ i ].lonDeg = weather[ i ].humidity = 90.0 + i * 0.0001;
+    }
+
+    using namespace common_vars::mongo_fields::analytic;
+
+    // encode
+    std::vector<bson_t *> trajectoryDocs;
+    trajectoryDocs.reserve( DOCS_COUNT );
+    const auto handEncodeStart = std::chrono::steady_clock::now();
+    for( const SPersistenceTrajectory & traj : trajectory ){
+        trajectoryDocs.push_back( BCON_NEW( detected_object::OBJRERP_ID.c_str(), BCON_INT64( traj.objId ),
+                                            detected_object::STATE.c_str(), BCON_INT32( (int32_t)(traj.state) ),
+                                            detected_object::ASTRO_TIME.c_str(), BCON_INT64( traj.astroTimeMillisec ),
+                                            detected_object::LOGIC_TIME.c_str(), BCON_INT64( traj.logicTime ),
+                                            detected_object::SESSION.c_str(), BCON_INT32( traj.sessionNum ),
+                                            detected_object::LAT.c_str(), BCON_DOUBLE( traj.latDeg ),
+                                            detected_object::LON.c_str(), BCON_DOUBLE( traj.lonDeg ) ) );
+    }
+    const double handEncodeSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - handEncodeStart ).count();
+
+    std::vector<bson_t *> weatherDocs;
+    weatherDocs.reserve( DOCS_COUNT );
+    const auto schemaEncodeStart = std::chrono::steady_clock::now();
+    for( const SPersistenceWeather & point : weather ){
+        bson_t * doc = bson_new();
+        PayloadCodec<SPersistenceWeather>::append( doc, point );
+        weatherDocs.push_back( doc );
+    }
+    const double schemaEncodeSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - schemaEncodeStart ).count();
+
+    // decode
+    std::vector<SPersistenceTrajectory> trajectoryOut;
+    trajectoryOut.reserve( DOCS_COUNT );
+    const auto handDecodeStart = std::chrono::steady_clock::now();
+    for( const bson_t * doc : trajectoryDocs ){
+        BsonRecordDecoder<SPersistenceTrajectory>::decodeAppend( doc, trajectoryOut );
+    }
+    const double handDecodeSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - handDecodeStart ).count();
+
+    std::vector<SPersistenceWeather> weatherOut;
+    weatherOut.reserve( DOCS_COUNT );
+    const auto schemaDecodeStart = std::chrono::steady_clock::now();
+    for( const bson_t * doc : weatherDocs ){
+        BsonRecordDecoder<SPersistenceWeather>::decodeAppend( doc, weatherOut );
+    }
+    const double schemaDecodeSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - schemaDecodeStart ).count();
+
+    VS_LOG_INFO << "payload schema benchmark, records/sec"
+                << " encode hand-written: " << (int64_t)(DOCS_COUNT / handEncodeSec)
+                << " schema: " << (int64_t)(DOCS_COUNT / schemaEncodeSec)
+                << " decode hand-written: " << (int64_t)(DOCS_COUNT / handDecodeSec)
+                << " schema: " << (int64_t)(DOCS_COUNT / schemaDecodeSec)
+                << endl;
+
+    ASSERT_EQ( weatherOut.size(), weather.size() );
+    for( size_t i = 0; i < weatherOut.size(); i++ ){
+        ASSERT_EQ( weatherOut[ i ].objId, weather[ i ].objId );
+        ASSERT_EQ( weatherOut[ i ].state, weather[ i ].state );
+        ASSERT_EQ( weatherOut[ i ].astroTimeMillisec, weather[ i ].astroTimeMillisec );
+        ASSERT_EQ( weatherOut[ i ].logicTime, weather[ i ].logicTime );
+        ASSERT_EQ( weatherOut[ i ].sessionNum, weather[ i ].sessionNum );
+        ASSERT_EQ( weatherOut[ i ].windSpeed, weather[ i ].windSpeed );
+        ASSERT_EQ( weatherOut[ i ].humidity, weather[ i ].humidity );
+    }
+
+    // columnar layout holds the same rows
+    PayloadColumns<SPersistenceWeather> columns;
+    columns.reserve( weather.size() );
+    for( const SPersistenceWeather & point : weather ){
+        columns.append( point );
+    }
+    ASSERT_EQ( columns.rowsCount(), weather.size() );
+    SPersistenceWeather row;
+    columns.copyRow( DOCS_COUNT / 2, row );
+    ASSERT_EQ( row.astroTimeMillisec, weather[ DOCS_COUNT / 2 ].astroTimeMillisec );
+    ASSERT_EQ( row.humidity, weather[ DOCS_COUNT / 2 ].humidity );
+
+    for( bson_t * doc : trajectoryDocs ){
+        bson_destroy( doc );
+    }
+    for( bson_t * doc : weatherDocs ){
+        bson_destroy( doc );
+    }
+}
+
+// no-copy visitor of record views
+struct SWALRecordCounter : public wal_record_codec::IRecordViewVisitor {
+    virtual void visit( const wal_record_codec::SClientOperationView & _record ) override { bytes += _record.commandFullText.size; }
+    virtual void visit( const wal_record_codec::SProcessEventView & _record ) override { bytes += _record.programName.size + _record.programArgs.size; }
+    virtual void visit( const wal_record_codec::SUserRegistrationView & _record ) override { bytes += _record.userIp.size; }
+
+    size_t bytes = 0;
+};
+
+TEST_F(TestStorageBenchmark, wal_codec_benchmark){
+
+    constexpr int RECORDS = 100000;
+
+    std::vector<SWALProcessEvent> events;
+    events.reserve( RECORDS );
+    for( int i = 0; i < RECORDS; i++ ){
+        SWALProcessEvent event;
+        event.pid = 1000 + i % 50;
+        event.begin = true;
+        event.programName = "player_agent";
+        event.programArgs = { "--ctx", "777", "--mission", std::to_string(event.pid) };
+        events.push_back( event );
+    }
+
+    // string form
+    const auto stringBegin = std::chrono::steady_clock::now();
+    size_t stringBytes = 0;
+    for( const SWALProcessEvent & event : events ){
+        stringBytes += event.serializeToStr().size();
+    }
+    const int64_t stringMicrosec = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - stringBegin ).count();
+
+    // binary form
+    const auto encodeBegin = std::chrono::steady_clock::now();
+    wal_record_codec::WALRecordEncoder encoder;
+    std::string stream;
+    std::vector<size_t> offsets;
+    offsets.reserve( RECORDS + 1 );
+    for( const SWALProcessEvent & event : events ){
+        offsets.push_back( stream.size() );
+        encoder.encode( event, stream );
+    }
+    offsets.push_back( stream.size() );
+    const int64_t encodeMicrosec = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - encodeBegin ).count();
+
+    const auto decodeBegin = std::chrono::steady_clock::now();
+    wal_record_codec::WALRecordDecoder decoder;
+    SWALRecordCounter counter;
+    const uint8_t * data = reinterpret_cast<const uint8_t *>( stream.data() );
+    for( int i = 0; i < RECORDS; i++ ){
+        ASSERT_TRUE( decoder.decode(data + offsets[ i ], offsets[ i + 1 ] - offsets[ i ], & counter) );
+    }
+    const int64_t decodeMicrosec = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - decodeBegin ).count();
+
+    VS_LOG_INFO << "codec benchmark, records: " << RECORDS
+                << " string form: " << stringBytes << " bytes " << stringMicrosec << " us"
+                << " binary form: " << stream.size() << " bytes encode " << encodeMicrosec << " us decode " << decodeMicrosec << " us"
+                << endl;
+
+    ASSERT_GT( counter.bytes, 0 );
+}
@@ -0,0 +1,21 @@
+#ifndef STORAGE_BENCHMARK_TEST_H
+#define STORAGE_BENCHMARK_TEST_H
+
+#include <gtest/gtest.h>
+
+#include "storage/storage_benchmark.h"
+
+// shape & report dir are taken from environment:
+// STORAGE_BENCHMARK_OBJECTS, STORAGE_BENCHMARK_STEPS, STORAGE_BENCHMARK_SESSIONS,
+// STORAGE_BENCHMARK_THREADS, STORAGE_BENCHMARK_REPORT_DIR
+class TestStorageBenchmark : public ::testing::Test
+{
+public:
+    TestStorageBenchmark();
+
+
+protected:
+    static StorageBenchmark::SInitSettings makeSettings( const std::string & _backendName );
+};
+
+#endif // STORAGE_BENCHMARK_TEST_H
@@ -0,0 +1,726 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include <signal.h>
+#include <sys/resource.h>
+
+#include <boost/filesystem.hpp>
+#include <microservice_common/system/logger.h>
+
+#include "system/wal.h"
+#include "system/wal_replication.h"
+#include "test_wal_file_storage.h"
+
+using namespace std;
+using namespace common_types;
+
+static const std::string JOURNAL_DIR = "unit_tests_wal_journal";
+static const std::string STANDBY_DIR = "unit_tests_wal_standby";
+static const std::string REPLICATION_SOCKET = "unit_tests_wal_replication.sock";
+
+TestWALFileStorage::TestWALFileStorage()
+{
+
+}
+
+void TestWALFileStorage::SetUp(){
+
+    boost::filesystem::remove_all( JOURNAL_DIR );
+    boost::filesystem::remove_all( STANDBY_DIR );
+
+    m_settings = WALFileStorage::SInitSettings();
+    m_settings.directory = JOURNAL_DIR;
+}
+
+void TestWALFileStorage::TearDown(){
+
+    boost::filesystem::remove_all( JOURNAL_DIR );
+    boost::filesystem::remove_all( STANDBY_DIR );
+}
+
+static SWALClientOperation makeOperation( const std::string & _key ){
+
+    SWALClientOperation operation;
+    operation.uniqueKey = _key;
+    operation.begin = true;
+    operation.commandFullText = "{ \"cmd_type\":\"test\", \"key\":\"" + _key + "\" }";
+    return operation;
+}
+
+static SWALProcessEvent makeProcessEvent( TPid _pid ){
+
+    SWALProcessEvent event;
+    event.pid = _pid;
+    event.begin = true;
+    event.programName = "player_agent";
+    event.programArgs = { "--ctx", "777", "--mission", std::to_string(_pid) };
+    return event;
+}
+
+static size_t segmentsCount( const std::string & _dir ){
+
+    size_t out = 0;
+    for( boost::filesystem::directory_iterator iter( _dir ); iter != boost::filesystem::directory_iterator(); ++iter ){
+        if( iter->path().extension() == ".log" ){
+            out++;
+        }
+    }
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// journal tests
+// -------------------------------------------------------------------------
+TEST_F(TestWALFileStorage, replay_test){
+
+    // I fill the journal
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+
+        for( int i = 0; i < 10; i++ ){
+            ASSERT_TRUE( journal.write(makeOperation("op_" + std::to_string(i))) );
+        }
+        journal.remove( "op_3" );
+        journal.remove( "op_7" );
+
+        SWALClientOperation updated = makeOperation( "op_0" );
+        updated.commandFullText = "updated";
+        ASSERT_TRUE( journal.write(updated) );
+
+        ASSERT_TRUE( journal.write(makeProcessEvent(100)) );
+        ASSERT_TRUE( journal.write(makeProcessEvent(200)) );
+        ASSERT_TRUE( journal.write(makeProcessEvent(200)) );
+        ASSERT_TRUE( journal.write(makeProcessEvent(300)) );
+        journal.remove( (TPid)300 );
+
+        SWALUserRegistration registration;
+        registration.userIp = "127.0.0.1";
+        registration.userPid = 555;
+        registration.registeredAtDateTime = "2020-01-01 00:00:00";
+        registration.registerId = "user_1";
+        ASSERT_TRUE( journal.write(registration) );
+        registration.registerId = "user_2";
+        ASSERT_TRUE( journal.write(registration) );
+        journal.removeRegistration( "user_1" );
+    }
+
+    // II state after restart
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+
+        const std::vector<SWALClientOperation> operations = journal.readOperations( SWALClientOperation::NON_INTEGRITY_KEYS );
+        ASSERT_EQ( operations.size(), 8 );
+        ASSERT_EQ( operations.front().uniqueKey, "op_0" );
+        ASSERT_EQ( operations.front().commandFullText, "updated" );
+        ASSERT_EQ( operations.back().uniqueKey, "op_9" );
+        ASSERT_EQ( operations.back().commandFullText, makeOperation("op_9").commandFullText );
+
+        const std::vector<SWALProcessEvent> nonClosed = journal.readEvents( SWALProcessEvent::NON_INTEGRITY_PIDS );
+        ASSERT_EQ( nonClosed.size(), 1 );
+        ASSERT_EQ( nonClosed.front().pid, 100 );
+        ASSERT_EQ( nonClosed.front().programName, "player_agent" );
+        ASSERT_EQ( nonClosed.front().programArgs, makeProcessEvent(100).programArgs );
+        ASSERT_EQ( journal.readEvents(SWALProcessEvent::ALL_PIDS).size(), 3 );
+        ASSERT_EQ( journal.readEvents(200).size(), 2 );
+
+        const std::vector<SWALUserRegistration> registrations = journal.readRegistrations( SWALUserRegistration::ALL_IDS );
+        ASSERT_EQ( registrations.size(), 1 );
+        ASSERT_EQ( registrations.front().registerId, "user_2" );
+        ASSERT_EQ( registrations.front().userPid, 555 );
+
+        // III clean
+        journal.remove( SWALClientOperation::ALL_KEYS );
+        journal.remove( SWALProcessEvent::ALL_PIDS );
+        journal.removeRegistration( SWALUserRegistration::ALL_IDS );
+    }
+
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        ASSERT_TRUE( journal.readOperations(SWALClientOperation::ALL_KEYS).empty() );
+        ASSERT_TRUE( journal.readEvents(SWALProcessEvent::ALL_PIDS).empty() );
+        ASSERT_TRUE( journal.readRegistrations(SWALUserRegistration::ALL_IDS).empty() );
+    }
+}
+
+TEST_F(TestWALFileStorage, torn_tail_test){
+
+    std::string segmentPath;
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        ASSERT_TRUE( journal.write(makeOperation("op_1")) );
+        ASSERT_TRUE( journal.write(makeOperation("op_2")) );
+    }
+
+    for( boost::filesystem::directory_iterator iter( JOURNAL_DIR ); iter != boost::filesystem::directory_iterator(); ++iter ){
+        segmentPath = iter->path().string();
+    }
+    const uintmax_t validSize = boost::filesystem::file_size( segmentPath );
+
+    // half of frame from crashed commit
+    {
+        std::ofstream segment( segmentPath, std::ios::binary | std::ios::app );
+        const char tail[] = { 0x40, 0x00, 0x00, 0x00, 0x11, 0x22 };
+        segment.write( tail, sizeof(tail) );
+    }
+
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        ASSERT_EQ( boost::filesystem::file_size(segmentPath), validSize );
+        ASSERT_EQ( journal.readOperations(SWALClientOperation::ALL_KEYS).size(), 2 );
+        ASSERT_TRUE( journal.write(makeOperation("op_3")) );
+    }
+
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        ASSERT_EQ( journal.readOperations(SWALClientOperation::ALL_KEYS).size(), 3 );
+        ASSERT_EQ( journal.getStats().lastSequence, 3 );
+    }
+}
+
+TEST_F(TestWALFileStorage, segment_rotation_test){
+
+    m_settings.segmentMaxBytes = 2 * 1024;
+
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        for( int i = 0; i < 500; i++ ){
+            const std::string key = "op_" + std::to_string(i);
+            ASSERT_TRUE( journal.write(makeOperation(key)) );
+            if( i % 2 ){
+                journal.remove( key );
+            }
+        }
+    }
+
+    ASSERT_GT( segmentsCount(JOURNAL_DIR), 10 );
+
+    WALFileStorage journal;
+    ASSERT_TRUE( journal.init(m_settings) );
+    ASSERT_EQ( journal.readOperations(SWALClientOperation::NON_INTEGRITY_KEYS).size(), 250 );
+    ASSERT_EQ( journal.getStats().lastSequence, 750 );
+}
+
+TEST_F(TestWALFileStorage, checkpoint_test){
+
+    m_settings.segmentMaxBytes = 4 * 1024;
+    m_settings.checkpointEveryRecords = 100;
+
+    // open / close pairs leave only few open items
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        for( int i = 0; i < 1000; i++ ){
+            const std::string key = "op_" + std::to_string(i);
+            ASSERT_TRUE( journal.write(makeOperation(key)) );
+            if( i % 100 ){
+                journal.remove( key );
+            }
+        }
+        ASSERT_TRUE( journal.write(makeProcessEvent(100)) );
+
+        const WALFileStorage::SStats stats = journal.getStats();
+        ASSERT_GE( stats.checkpointsCount, 19 );
+        ASSERT_GT( stats.lastCheckpointSequence, 1800 );
+    }
+
+    // journal size depends on open items, not on history
+    {
+        size_t checkpoints = 0;
+        uintmax_t journalBytes = 0;
+        for( boost::filesystem::directory_iterator iter( JOURNAL_DIR ); iter != boost::filesystem::directory_iterator(); ++iter ){
+            journalBytes += boost::filesystem::file_size( iter->path() );
+            checkpoints += ( iter->path().extension() == ".chk" );
+        }
+        ASSERT_EQ( checkpoints, 1 );
+        ASSERT_LE( segmentsCount(JOURNAL_DIR), 2 );
+        ASSERT_LT( journalBytes, 2 * m_settings.segmentMaxBytes );
+    }
+
+    // restart from checkpoint keeps order of open items
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+
+        const std::vector<SWALClientOperation> operations = journal.readOperations( SWALClientOperation::NON_INTEGRITY_KEYS );
+        ASSERT_EQ( operations.size(), 10 );
+        for( size_t i = 0; i < operations.size(); i++ ){
+            ASSERT_EQ( operations[ i ].uniqueKey, "op_" + std::to_string(i * 100) );
+        }
+        ASSERT_EQ( journal.readEvents(SWALProcessEvent::NON_INTEGRITY_PIDS).size(), 1 );
+        ASSERT_EQ( journal.getStats().lastSequence, 1000 + 990 + 1 );
+
+        // manual checkpoint leaves segment without history
+        ASSERT_TRUE( journal.checkpoint() );
+        journal.remove( "op_0" );
+    }
+
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        ASSERT_EQ( journal.readOperations(SWALClientOperation::ALL_KEYS).size(), 9 );
+        ASSERT_EQ( journal.getStats().lastCheckpointSequence, 1000 + 990 + 1 );
+    }
+}
+
+TEST_F(TestWALFileStorage, group_commit_test){
+
+    constexpr int THREADS = 8;
+    constexpr int WRITES_PER_THREAD = 200;
+
+    WALFileStorage journal;
+    ASSERT_TRUE( journal.init(m_settings) );
+
+    std::vector<int64_t> latencyByThread( THREADS, 0 );
+    std::vector<std::thread> writers;
+    for( int t = 0; t < THREADS; t++ ){
+        writers.emplace_back( [ & journal, & latencyByThread, t ](){
+            for( int i = 0; i < WRITES_PER_THREAD; i++ ){
+                const auto begin = std::chrono::steady_clock::now();
+                EXPECT_TRUE( journal.write(makeOperation("t" + std::to_string(t) + "_" + std::to_string(i))) );
+                latencyByThread[ t ] += std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - begin ).count();
+            }
+        });
+    }
+    for( std::thread & writer : writers ){
+        writer.join();
+    }
+
+    const WALFileStorage::SStats stats = journal.getStats();
+    ASSERT_EQ( stats.recordsAppended, THREADS * WRITES_PER_THREAD );
+    ASSERT_EQ( stats.commitErrors, 0 );
+    ASSERT_LE( stats.groupCommits, stats.recordsAppended );
+
+    int64_t totalLatency = 0;
+    for( const int64_t latency : latencyByThread ){
+        totalLatency += latency;
+    }
+    VS_LOG_INFO << "wal file journal: records " << stats.recordsAppended
+                << " group commits " << stats.groupCommits
+                << " avg records per fsync " << (double)stats.recordsAppended / stats.groupCommits
+                << " avg write latency " << totalLatency / stats.recordsAppended << " us"
+                << endl;
+
+    journal.shutdown();
+    ASSERT_TRUE( journal.init(m_settings) );
+    ASSERT_EQ( journal.readOperations(SWALClientOperation::ALL_KEYS).size(), THREADS * WRITES_PER_THREAD );
+}
+
+TEST_F(TestWALFileStorage, async_append_test){
+
+    constexpr int THREADS = 4;
+    constexpr int WRITES_PER_THREAD = 500;
+
+    std::atomic<int> durable( 0 );
+    std::atomic<int> failed( 0 );
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+
+        // caller is not blocked by fsync
+        std::vector<std::thread> writers;
+        for( int t = 0; t < THREADS; t++ ){
+            writers.emplace_back( [ & journal, & durable, & failed, t ](){
+                for( int i = 0; i < WRITES_PER_THREAD; i++ ){
+                    journal.writeAsync( makeOperation("t" + std::to_string(t) + "_" + std::to_string(i)), [ & durable, & failed ]( bool _durable ){
+                        ( _durable ? durable : failed )++;
+                    });
+                }
+            });
+        }
+        for( std::thread & writer : writers ){
+            writer.join();
+        }
+
+        // visible before durable
+        ASSERT_EQ( journal.readOperations(SWALClientOperation::ALL_KEYS).size(), THREADS * WRITES_PER_THREAD );
+
+        // sync write is committed after async ones ( their callbacks may still run in leader thread )
+        ASSERT_TRUE( journal.write(makeProcessEvent(100)) );
+        for( int i = 0; i < 1000 && durable.load() < THREADS * WRITES_PER_THREAD; i++ ){
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+        }
+        ASSERT_EQ( durable.load(), THREADS * WRITES_PER_THREAD );
+
+        const WALFileStorage::SStats stats = journal.getStats();
+        ASSERT_EQ( stats.asyncRecords, THREADS * WRITES_PER_THREAD );
+        ASSERT_LT( stats.groupCommits, stats.recordsAppended );
+        VS_LOG_INFO << "wal file journal async: records " << stats.recordsAppended
+                    << " group commits " << stats.groupCommits
+                    << endl;
+
+        // not committed yet records are drained on shutdown
+        for( int i = 0; i < 100; i++ ){
+            journal.writeAsync( makeOperation("tail_" + std::to_string(i)), [ & durable ]( bool _durable ){ durable += _durable; } );
+        }
+    }
+    ASSERT_EQ( durable.load(), THREADS * WRITES_PER_THREAD + 100 );
+    ASSERT_EQ( failed.load(), 0 );
+
+    WALFileStorage journal;
+    ASSERT_TRUE( journal.init(m_settings) );
+    ASSERT_EQ( journal.readOperations(SWALClientOperation::ALL_KEYS).size(), THREADS * WRITES_PER_THREAD + 100 );
+    ASSERT_EQ( journal.readEvents(SWALProcessEvent::ALL_PIDS).size(), 1 );
+}
+
+TEST_F(TestWALFileStorage, write_ahead_logger_test){
+
+    WALFileStorage journal;
+    ASSERT_TRUE( journal.init(m_settings) );
+
+    WriteAheadLogger::SInitSettings walSettings;
+    walSettings.active = true;
+    walSettings.persistService = & journal;
+
+    WriteAheadLogger wal;
+    ASSERT_TRUE( wal.init(walSettings) );
+
+    wal.openOperation( makeOperation("op_1") );
+    std::future<bool> durable = wal.openOperationAsync( makeOperation("op_2") );
+    wal.closeClientOperation( "op_1" );
+    wal.openProcessEvent( makeProcessEvent(100) );
+    ASSERT_TRUE( durable.get() );
+
+    ASSERT_EQ( wal.getInterruptedOperations().size(), 1 );
+    ASSERT_EQ( wal.getNonClosedProcesses(), std::vector<TPid>{ 100 } );
+
+    wal.cleanJournal();
+    ASSERT_TRUE( wal.getInterruptedOperations().empty() );
+    ASSERT_TRUE( wal.getNonClosedProcesses().empty() );
+}
+
+TEST_F(TestWALFileStorage, restart_interning_test){
+
+    // the same program names are interned across restarts & checkpoints
+    for( int round = 0; round < 3; round++ ){
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        for( int i = 0; i < 10; i++ ){
+            ASSERT_TRUE( journal.write(makeProcessEvent(round * 100 + i)) );
+        }
+        if( 1 == round ){
+            ASSERT_TRUE( journal.checkpoint() );
+            ASSERT_TRUE( journal.write(makeProcessEvent(round * 100 + 10)) );
+        }
+    }
+
+    WALFileStorage journal;
+    ASSERT_TRUE( journal.init(m_settings) );
+    const std::vector<SWALProcessEvent> events = journal.readEvents( SWALProcessEvent::ALL_PIDS );
+    ASSERT_EQ( events.size(), 31 );
+    for( const SWALProcessEvent & event : events ){
+        ASSERT_EQ( event.programName, "player_agent" );
+        ASSERT_EQ( event.programArgs, makeProcessEvent(event.pid).programArgs );
+    }
+}
+
+TEST_F(TestWALFileStorage, failed_write_interning_test){
+
+    {
+        WALFileStorage journal;
+        ASSERT_TRUE( journal.init(m_settings) );
+        ASSERT_TRUE( journal.write(makeOperation("before_failure")) );
+
+        // segment can't grow - the first event ( with names interned ) is lost
+        struct rlimit limit;
+        ASSERT_EQ( 0, ::getrlimit(RLIMIT_FSIZE, & limit) );
+        const struct rlimit restricted = { 1, limit.rlim_max };
+        const sighandler_t handler = ::signal( SIGXFSZ, SIG_IGN );
+        ASSERT_EQ( 0, ::setrlimit(RLIMIT_FSIZE, & restricted) );
+        const bool written = journal.write( makeProcessEvent(100) );
+        ::setrlimit( RLIMIT_FSIZE, & limit );
+        ::signal( SIGXFSZ, handler );
+        ASSERT_FALSE( written );
+        ASSERT_EQ( journal.getStats().commitErrors, 1 );
+
+        // the same names are written once more after the failed group
+        for( int i = 1; i <= 10; i++ ){
+            ASSERT_TRUE( journal.write(makeProcessEvent(100 + i)) );
+        }
+    }
+
+    WALFileStorage journal;
+    ASSERT_TRUE( journal.init(m_settings) );
+    ASSERT_EQ( journal.readOperations(SWALClientOperation::NON_INTEGRITY_KEYS).size(), 1 );
+    const std::vector<SWALProcessEvent> events = journal.readEvents( SWALProcessEvent::ALL_PIDS );
+    ASSERT_EQ( events.size(), 10 );
+    for( const SWALProcessEvent & event : events ){
+        ASSERT_NE( event.pid, 100 );
+        ASSERT_EQ( event.programName, "player_agent" );
+        ASSERT_EQ( event.programArgs, makeProcessEvent(event.pid).programArgs );
+    }
+}
+
+// -------------------------------------------------------------------------
+// record codec tests
+// -------------------------------------------------------------------------
+struct SRecordCollector : public wal_record_codec::IRecordViewVisitor {
+    virtual void visit( const wal_record_codec::SClientOperationView & _record ) override { operations.push_back( _record.toRecord() ); }
+    virtual void visit( const wal_record_codec::SProcessEventView & _record ) override { events.push_back( _record.toRecord() ); }
+    virtual void visit( const wal_record_codec::SUserRegistrationView & _record ) override { registrations.push_back( _record.toRecord() ); }
+
+    std::vector<SWALClientOperation> operations;
+    std::vector<SWALProcessEvent> events;
+    std::vector<SWALUserRegistration> registrations;
+};
+
+// no-copy visitor ( record views are only measured )
+struct SRecordCounter : public wal_record_codec::IRecordViewVisitor {
+    virtual void visit( const wal_record_codec::SClientOperationView & _record ) override { bytes += _record.commandFullText.size; }
+    virtual void visit( const wal_record_codec::SProcessEventView & _record ) override { bytes += _record.programName.size + _record.programArgs.size; }
+    virtual void visit( const wal_record_codec::SUserRegistrationView & _record ) override { bytes += _record.userIp.size; }
+
+    size_t bytes = 0;
+};
+
+TEST_F(TestWALFileStorage, codec_round_trip_test){
+
+    SWALUserRegistration registration;
+    registration.registerId = "reg_1";
+    registration.userIp = "10.0.0.1";
+    registration.userPid = -1;
+    registration.registeredAtDateTime = "2020-01-01 00:00:00";
+
+    SWALProcessEvent emptyArgs = makeProcessEvent( -100 );
+    emptyArgs.programArgs.clear();
+
+    // records are encoded one after another, as in journal frames
+    wal_record_codec::WALRecordEncoder encoder;
+    std::vector<std::string> encoded;
+    const std::vector<const SWALRecord *> records = { new SWALClientOperation(makeOperation("op_1")),
+                                                      new SWALProcessEvent(makeProcessEvent(100)),
+                                                      new SWALProcessEvent(makeProcessEvent(100)),
+                                                      new SWALProcessEvent(emptyArgs),
+                                                      new SWALUserRegistration(registration) };
+    for( const SWALRecord * record : records ){
+        encoded.emplace_back();
+        encoder.encode( * record, encoded.back() );
+        delete record;
+    }
+
+    // repeated program name & args are only references
+    ASSERT_LT( encoded[ 2 ].size(), encoded[ 1 ].size() );
+    ASSERT_LE( encoded[ 2 ].size(), 8 );
+
+    wal_record_codec::WALRecordDecoder decoder;
+    SRecordCollector collector;
+    for( const std::string & record : encoded ){
+        ASSERT_TRUE( decoder.decode(reinterpret_cast<const uint8_t *>(record.data()), record.size(), & collector) );
+    }
+
+    ASSERT_EQ( collector.operations.size(), 1 );
+    ASSERT_EQ( collector.operations[ 0 ].uniqueKey, "op_1" );
+    ASSERT_EQ( collector.operations[ 0 ].commandFullText, makeOperation("op_1").commandFullText );
+    ASSERT_TRUE( collector.operations[ 0 ].begin );
+
+    ASSERT_EQ( collector.events.size(), 3 );
+    ASSERT_EQ( collector.events[ 1 ].pid, 100 );
+    ASSERT_EQ( collector.events[ 1 ].programName, "player_agent" );
+    ASSERT_EQ( collector.events[ 1 ].programArgs, makeProcessEvent(100).programArgs );
+    ASSERT_EQ( collector.events[ 2 ].pid, -100 );
+    ASSERT_TRUE( collector.events[ 2 ].programArgs.empty() );
+
+    ASSERT_EQ( collector.registrations.size(), 1 );
+    ASSERT_EQ( collector.registrations[ 0 ].userIp, registration.userIp );
+    ASSERT_EQ( collector.registrations[ 0 ].userPid, -1 );
+    ASSERT_EQ( collector.registrations[ 0 ].registeredAtDateTime, registration.registeredAtDateTime );
+
+    // broken records are rejected, not read out of bounds
+    for( const std::string & record : encoded ){
+        for( size_t size = 0; size < record.size(); size++ ){
+            wal_record_codec::WALRecordDecoder freshDecoder;
+            SRecordCollector dummy;
+            ASSERT_FALSE( freshDecoder.decode(reinterpret_cast<const uint8_t *>(record.data()), size, & dummy) );
+        }
+    }
+
+    // reference without the literal ( lost stream ) is rejected as well
+    wal_record_codec::WALRecordDecoder freshDecoder;
+    ASSERT_FALSE( freshDecoder.decode(reinterpret_cast<const uint8_t *>(encoded[ 2 ].data()), encoded[ 2 ].size(), & collector) );
+}
+
+TEST_F(TestWALFileStorage, codec_size_test){
+
+    // timing of the same stream is in TestStorageBenchmark.wal_codec_benchmark
+    constexpr int RECORDS = 10000;
+
+    size_t stringBytes = 0;
+    wal_record_codec::WALRecordEncoder encoder;
+    std::string stream;
+    std::vector<size_t> offsets;
+    offsets.reserve( RECORDS + 1 );
+    for( int i = 0; i < RECORDS; i++ ){
+        const SWALProcessEvent event = makeProcessEvent( 1000 + i % 50 );
+        stringBytes += event.serializeToStr().size();
+        offsets.push_back( stream.size() );
+        encoder.encode( event, stream );
+    }
+    offsets.push_back( stream.size() );
+
+    wal_record_codec::WALRecordDecoder decoder;
+    SRecordCounter counter;
+    const uint8_t * data = reinterpret_cast<const uint8_t *>( stream.data() );
+    for( int i = 0; i < RECORDS; i++ ){
+        ASSERT_TRUE( decoder.decode(data + offsets[ i ], offsets[ i + 1 ] - offsets[ i ], & counter) );
+    }
+
+    ASSERT_GT( counter.bytes, 0 );
+    ASSERT_LT( stream.size() * 4, stringBytes );
+}
+
+// -------------------------------------------------------------------------
+// replication tests
+// -------------------------------------------------------------------------
+static bool waitForStandby( WALReplicationStandby & _standby, uint64_t _sequence ){
+
+    for( int i = 0; i < 500; i++ ){
+        if( _standby.getStats().appliedSequence >= _sequence ){
+            return true;
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds(10) );
+    }
+    return false;
+}
+
+TEST_F(TestWALFileStorage, replication_test){
+
+    WALFileStorage::SInitSettings standbySettings = m_settings;
+    standbySettings.directory = STANDBY_DIR;
+    WALFileStorage standbyJournal;
+    ASSERT_TRUE( standbyJournal.init(standbySettings) );
+
+    // I records before standby are in checkpoint image
+    WALFileStorage primaryJournal;
+    ASSERT_TRUE( primaryJournal.init(m_settings) );
+    for( int i = 0; i < 10; i++ ){
+        ASSERT_TRUE( primaryJournal.write(makeOperation("op_" + std::to_string(i))) );
+    }
+    primaryJournal.remove( "op_0" );
+
+    WALReplicationSource::SInitSettings sourceSettings;
+    sourceSettings.storage = & primaryJournal;
+    sourceSettings.socketFileName = REPLICATION_SOCKET;
+    sourceSettings.pollTimeoutMillisec = 10;
+    WALReplicationSource source;
+    ASSERT_TRUE( source.init(sourceSettings) );
+
+    WALReplicationStandby::SInitSettings standbyStreamSettings;
+    standbyStreamSettings.storage = & standbyJournal;
+    standbyStreamSettings.socketFileName = REPLICATION_SOCKET;
+    standbyStreamSettings.pollTimeoutMillisec = 10;
+    standbyStreamSettings.reconnectIntervalMillisec = 20;
+    WALReplicationStandby standby;
+    ASSERT_TRUE( standby.init(standbyStreamSettings) );
+
+    ASSERT_TRUE( waitForStandby(standby, primaryJournal.getStats().lastSequence) );
+    ASSERT_EQ( standbyJournal.readOperations(SWALClientOperation::ALL_KEYS).size(), 9 );
+
+    // II live records come in batches, acks follow them
+    for( int i = 10; i < 200; i++ ){
+        ASSERT_TRUE( primaryJournal.write(makeOperation("op_" + std::to_string(i))) );
+        if( i % 2 ){
+            primaryJournal.remove( "op_" + std::to_string(i) );
+        }
+    }
+    ASSERT_TRUE( primaryJournal.write(makeProcessEvent(100)) );
+    primaryJournal.writeAsync( makeProcessEvent(200), []( bool ){} );
+    ASSERT_TRUE( primaryJournal.write(makeProcessEvent(300)) );
+    primaryJournal.remove( 300 );
+
+    ASSERT_TRUE( source.waitForAck(primaryJournal.getStats().lastSequence, 5000) );
+    ASSERT_GE( source.getStats().batchesSent, 1 );
+    ASSERT_EQ( source.getStats().checkpointsSent, 1 );
+
+    // III primary is gone, standby takes over with local state
+    standby.shutdown();
+    source.shutdown();
+    const std::vector<SWALClientOperation> primaryOperations = primaryJournal.readOperations( SWALClientOperation::NON_INTEGRITY_KEYS );
+    primaryJournal.shutdown();
+
+    const auto takeoverBegin = std::chrono::steady_clock::now();
+    WriteAheadLogger::SInitSettings walSettings;
+    walSettings.active = true;
+    walSettings.persistService = & standbyJournal;
+    WriteAheadLogger wal;
+    ASSERT_TRUE( wal.init(walSettings) );
+    const std::vector<PEnvironmentRequest> interrupted = wal.getInterruptedOperations();
+    const std::vector<TPid> processes = wal.getNonClosedProcesses();
+    const int64_t takeoverMillisec = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - takeoverBegin ).count();
+
+    ASSERT_EQ( interrupted.size(), primaryOperations.size() );
+    ASSERT_EQ( processes, (std::vector<TPid>{ 100, 200 }) );
+    ASSERT_LT( takeoverMillisec, 1000 );
+
+    // standby journal is durable on its own
+    ASSERT_TRUE( standbyJournal.write(makeOperation("after_takeover")) );
+    standbyJournal.shutdown();
+    ASSERT_TRUE( standbyJournal.init(standbySettings) );
+    ASSERT_EQ( standbyJournal.readOperations(SWALClientOperation::ALL_KEYS).size(), primaryOperations.size() + 1 );
+    ASSERT_EQ( standbyJournal.readEvents(SWALProcessEvent::ALL_PIDS).size(), 2 );
+}
+
+TEST_F(TestWALFileStorage, replication_reconnect_test){
+
+    m_settings.checkpointEveryRecords = 50;
+
+    WALFileStorage::SInitSettings standbySettings = m_settings;
+    standbySettings.directory = STANDBY_DIR;
+    WALFileStorage standbyJournal;
+    ASSERT_TRUE( standbyJournal.init(standbySettings) );
+
+    WALFileStorage primaryJournal;
+    ASSERT_TRUE( primaryJournal.init(m_settings) );
+
+    WALReplicationSource::SInitSettings sourceSettings;
+    sourceSettings.storage = & primaryJournal;
+    sourceSettings.socketFileName = REPLICATION_SOCKET;
+    sourceSettings.pollTimeoutMillisec = 10;
+    WALReplicationSource source;
+    ASSERT_TRUE( source.init(sourceSettings) );
+
+    WALReplicationStandby::SInitSettings standbyStreamSettings;
+    standbyStreamSettings.storage = & standbyJournal;
+    standbyStreamSettings.socketFileName = REPLICATION_SOCKET;
+    standbyStreamSettings.pollTimeoutMillisec = 10;
+    standbyStreamSettings.reconnectIntervalMillisec = 20;
+
+    // the same program names in every round, primary & standby checkpoints on the way
+    for( int round = 0; round < 3; round++ ){
+        WALReplicationStandby standby;
+        ASSERT_TRUE( standby.init(standbyStreamSettings) );
+
+        for( int i = 0; i < 100; i++ ){
+            ASSERT_TRUE( primaryJournal.write(makeProcessEvent(round * 1000 + i)) );
+            if( i % 10 ){
+                primaryJournal.remove( round * 1000 + i );
+            }
+        }
+        ASSERT_TRUE( waitForStandby(standby, primaryJournal.getStats().lastSequence) );
+        ASSERT_EQ( standbyJournal.readEvents(SWALProcessEvent::ALL_PIDS).size(), primaryJournal.readEvents(SWALProcessEvent::ALL_PIDS).size() );
+
+        // records while standby is away come with the next checkpoint image
+        standby.shutdown();
+        ASSERT_TRUE( primaryJournal.write(makeProcessEvent(round * 1000 + 500)) );
+    }
+
+    ASSERT_GE( source.getStats().checkpointsSent, 3 );
+    ASSERT_GE( standbyJournal.getStats().checkpointsCount, 3 );
+
+    const std::vector<SWALProcessEvent> expected = primaryJournal.readEvents( SWALProcessEvent::ALL_PIDS );
+    standbyJournal.shutdown();
+    ASSERT_TRUE( standbyJournal.init(standbySettings) );
+    const std::vector<SWALProcessEvent> events = standbyJournal.readEvents( SWALProcessEvent::ALL_PIDS );
+    ASSERT_EQ( events.size() + 1, expected.size() );
+    for( size_t i = 0; i < events.size(); i++ ){
+        ASSERT_EQ( events[ i ].pid, expected[ i ].pid );
+        ASSERT_EQ( events[ i ].programArgs, expected[ i ].programArgs );
+    }
+}
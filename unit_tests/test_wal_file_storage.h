@@ -0,0 +1,21 @@
+#ifndef WAL_FILE_STORAGE_TEST_H
+#define WAL_FILE_STORAGE_TEST_H
+
+#include <gtest/gtest.h>
+
+#include "system/wal_file_storage.h"
+
+class TestWALFileStorage : public ::testing::Test
+{
+public:
+    TestWALFileStorage();
+
+
+protected:
+    virtual void SetUp() override;
+    virtual void TearDown() override;
+
+    WALFileStorage::SInitSettings m_settings;
+};
+
+#endif // WAL_FILE_STORAGE_TEST_H